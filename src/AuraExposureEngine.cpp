@@ -0,0 +1,456 @@
+////////////////////////////////////////////////////////////////////////
+//
+// This file is part of sc4-data-view-extensions, a DLL Plugin for
+// SimCity 4 that extends the game's data views.
+//
+// Copyright (c) 2024 Nicholas Hayes
+//
+// This file is licensed under terms of the MIT License.
+// See LICENSE.txt for more information.
+//
+////////////////////////////////////////////////////////////////////////
+
+#include "AuraExposureEngine.h"
+#include "BuildingAttributeIndex.h"
+#include "BuildingOccupantUtil.h"
+#include "GlobalPointers.h"
+#include "cISC4City.h"
+#include "cISC4Occupant.h"
+#include "cISC4ResidentialSimulator.h"
+#include "cRZAutoRefCount.h"
+#include "SC4Rect.h"
+#include <algorithm>
+#include <limits>
+
+namespace
+{
+	// A cached value that never matches an input value, which forces the weights to be rebuilt.
+	constexpr int32_t UnknownValue = std::numeric_limits<int32_t>::min();
+
+	uint32_t GetCurrentOccupantCapacity(cISC4Occupant* pOccupant)
+	{
+		cRZAutoRefCount<cISC4BuildingOccupant> pBuildingOccupant;
+
+		if (!pOccupant->QueryInterface(GZIID_cISC4BuildingOccupant, pBuildingOccupant.AsPPVoid()))
+		{
+			return 0;
+		}
+
+		return GetBuildingProfileFields(pBuildingOccupant).currentOccupantCapacity;
+	}
+}
+
+AuraExposureEngine::AuraExposureEngine()
+	: pResidentialSimulator(nullptr),
+	  tractSize(0),
+	  tractCountX(0),
+	  tractCountZ(0),
+	  population(),
+	  weights(),
+	  resampled(),
+	  versions(),
+	  curves(),
+	  binBuffer(),
+	  valid(false)
+{
+}
+
+const AuraExposureEngine::Curve* AuraExposureEngine::GetCurve(SnapshotGrid grid, Tier tier)
+{
+	if (grid >= SnapshotGrid::Count || tier >= Tier::Count || !Update())
+	{
+		return nullptr;
+	}
+
+	return &GetCurveReference(grid, tier);
+}
+
+bool AuraExposureEngine::GetPercentAtLeast(SnapshotGrid grid, Tier tier, int32_t threshold, double& percent)
+{
+	const Curve* curve = GetCurve(grid, tier);
+
+	if (!curve)
+	{
+		return false;
+	}
+
+	percent = 0.0;
+
+	if (curve->totalResidents <= 0.0)
+	{
+		return true;
+	}
+
+	const int64_t offset = static_cast<int64_t>(threshold) - curve->minValue;
+
+	if (offset <= 0)
+	{
+		percent = 100.0;
+		return true;
+	}
+
+	const int64_t bin = offset / curve->binWidth;
+
+	if (bin >= static_cast<int64_t>(BinCount))
+	{
+		return true;
+	}
+
+	// The residents of the threshold's bin are assumed to be evenly spread over its values.
+	const double binFraction = static_cast<double>(offset % curve->binWidth) / curve->binWidth;
+	const double below = (bin > 0 ? curve->cumulative[static_cast<size_t>(bin) - 1] : 0.0)
+		+ (curve->histogram[static_cast<size_t>(bin)] * binFraction);
+
+	percent = std::clamp(100.0 * (curve->totalResidents - below) / curve->totalResidents, 0.0, 100.0);
+	return true;
+}
+
+void AuraExposureEngine::PostCityInit(cISC4City* pCity)
+{
+	pResidentialSimulator = pCity->GetResidentialSimulator();
+}
+
+void AuraExposureEngine::PreCityShutdown()
+{
+	pResidentialSimulator = nullptr;
+	Clear();
+}
+
+bool AuraExposureEngine::Update()
+{
+	if (!pResidentialSimulator || !spGridSnapshotService)
+	{
+		return false;
+	}
+
+	cISC4SimGrid<uint16_t>* populationGrid = nullptr;
+
+	if (!pResidentialSimulator->GetPopulationGrids(populationGrid, nullptr, nullptr) || !populationGrid)
+	{
+		return false;
+	}
+
+	spGridSnapshotService->Capture();
+
+	std::array<std::shared_ptr<const GridSnapshot>, GridCount> snapshots;
+
+	for (size_t i = 0; i < GridCount; i++)
+	{
+		snapshots[i] = spGridSnapshotService->GetSnapshot(static_cast<SnapshotGrid>(i));
+
+		if (!snapshots[i])
+		{
+			return false;
+		}
+	}
+
+	bool layoutChanged = false;
+	const bool populationChanged = UpdatePopulation(populationGrid, layoutChanged) || !valid;
+
+	if (populationChanged)
+	{
+		UpdateWealthWeights();
+	}
+
+	for (size_t i = 0; i < GridCount; i++)
+	{
+		const SnapshotGrid grid = static_cast<SnapshotGrid>(i);
+		const bool inputChanged = layoutChanged || !valid || snapshots[i]->version != versions[i];
+
+		if (inputChanged)
+		{
+			Resample(grid, *snapshots[i]);
+			versions[i] = snapshots[i]->version;
+		}
+
+		if (inputChanged || populationChanged)
+		{
+			BuildCurves(grid);
+		}
+	}
+
+	valid = true;
+	return true;
+}
+
+bool AuraExposureEngine::UpdatePopulation(cISC4SimGrid<uint16_t>* populationGrid, bool& layoutChanged)
+{
+	const int32_t newTractSize = std::max(populationGrid->GetTractSize(), 1);
+	const int32_t newTractCountX = std::max(populationGrid->GetTractCountX(), 0);
+	const int32_t newTractCountZ = std::max(populationGrid->GetTractCountZ(), 0);
+	const size_t tractCount = static_cast<size_t>(newTractCountX) * newTractCountZ;
+
+	layoutChanged = newTractSize != tractSize || newTractCountX != tractCountX || newTractCountZ != tractCountZ;
+
+	if (layoutChanged)
+	{
+		tractSize = newTractSize;
+		tractCountX = newTractCountX;
+		tractCountZ = newTractCountZ;
+		population.assign(tractCount, UnknownValue);
+
+		for (std::vector<float>& tierWeights : weights)
+		{
+			tierWeights.assign(tractCount, 0.0f);
+		}
+
+		for (std::vector<int16_t>& values : resampled)
+		{
+			values.assign(tractCount, 0);
+		}
+
+		binBuffer.assign(tractCount, 0);
+	}
+
+	bool changed = false;
+
+	int32_t* cachedValue = population.data();
+	float* allResidents = weights[static_cast<size_t>(Tier::AllResidents)].data();
+
+	for (int32_t z = 0; z < tractCountZ; z++)
+	{
+		for (int32_t x = 0; x < tractCountX; x++)
+		{
+			const int32_t value = static_cast<int32_t>(populationGrid->GetTractValue(x, z));
+
+			if (*cachedValue != value)
+			{
+				*cachedValue = value;
+				*allResidents = static_cast<float>(value);
+				changed = true;
+			}
+
+			cachedValue++;
+			allResidents++;
+		}
+	}
+
+	return changed;
+}
+
+void AuraExposureEngine::UpdateWealthWeights()
+{
+	const size_t tractCount = population.size();
+
+	// The vendored residential simulator only exposes the combined population grid,
+	// the residents of each tract are divided between the wealth tiers in proportion
+	// to the current occupant capacity of the residential buildings that overlap it.
+	std::array<std::vector<float>, 3> capacity;
+
+	for (std::vector<float>& item : capacity)
+	{
+		item.assign(tractCount, 0.0f);
+	}
+
+	if (spBuildingAttributeIndex && tractCount > 0)
+	{
+		const uint32_t residenceMask = 1U << (static_cast<uint32_t>(cISC4BuildingOccupant::PurposeType::Residence) - 1);
+		std::vector<cISC4Occupant*> buildings;
+
+		for (uint32_t wealth = 0; wealth < capacity.size(); wealth++)
+		{
+			// WealthType::Low is 1, the wealth mask uses bit 0 for that value.
+			spBuildingAttributeIndex->GetBuildingsByProfile(residenceMask, 1U << wealth, buildings);
+
+			float* tierCapacity = capacity[wealth].data();
+
+			for (cISC4Occupant* pOccupant : buildings)
+			{
+				SC4Rect<long> cells{};
+
+				const uint32_t occupantCapacity = GetCurrentOccupantCapacity(pOccupant);
+
+				if (occupantCapacity == 0 || !pOccupant->GetBoundingCityCells(cells))
+				{
+					continue;
+				}
+
+				// GetBoundingCityCells does not guarantee that the corners are ordered.
+				const int32_t x1 = std::max(static_cast<int32_t>(std::min(cells.topLeftX, cells.bottomRightX)) / tractSize, 0);
+				const int32_t z1 = std::max(static_cast<int32_t>(std::min(cells.topLeftY, cells.bottomRightY)) / tractSize, 0);
+				const int32_t x2 = std::min(static_cast<int32_t>(std::max(cells.topLeftX, cells.bottomRightX)) / tractSize, tractCountX - 1);
+				const int32_t z2 = std::min(static_cast<int32_t>(std::max(cells.topLeftY, cells.bottomRightY)) / tractSize, tractCountZ - 1);
+
+				if (x1 > x2 || z1 > z2)
+				{
+					continue;
+				}
+
+				const float tractCapacity = static_cast<float>(occupantCapacity) / ((x2 - x1 + 1) * (z2 - z1 + 1));
+
+				for (int32_t z = z1; z <= z2; z++)
+				{
+					float* row = tierCapacity + (static_cast<size_t>(z) * tractCountX);
+
+					for (int32_t x = x1; x <= x2; x++)
+					{
+						row[x] += tractCapacity;
+					}
+				}
+			}
+		}
+	}
+
+	const float* allResidents = weights[static_cast<size_t>(Tier::AllResidents)].data();
+	const float* lowCapacity = capacity[0].data();
+	const float* mediumCapacity = capacity[1].data();
+	const float* highCapacity = capacity[2].data();
+	float* low = weights[static_cast<size_t>(Tier::LowWealth)].data();
+	float* medium = weights[static_cast<size_t>(Tier::MediumWealth)].data();
+	float* high = weights[static_cast<size_t>(Tier::HighWealth)].data();
+
+	for (size_t i = 0; i < tractCount; i++)
+	{
+		const float totalCapacity = lowCapacity[i] + mediumCapacity[i] + highCapacity[i];
+		const float scale = totalCapacity > 0.0f ? allResidents[i] / totalCapacity : 0.0f;
+
+		low[i] = lowCapacity[i] * scale;
+		medium[i] = mediumCapacity[i] * scale;
+		high[i] = highCapacity[i] * scale;
+	}
+}
+
+void AuraExposureEngine::Resample(SnapshotGrid grid, const GridSnapshot& snapshot)
+{
+	std::vector<int16_t>& output = resampled[static_cast<size_t>(grid)];
+
+	if (snapshot.width == 0 || snapshot.height == 0)
+	{
+		std::fill(output.begin(), output.end(), static_cast<int16_t>(0));
+		return;
+	}
+
+	// Each population tract uses the input tract that contains its center cell.
+	const int32_t inputTractSize = std::max(snapshot.tractSize, 1);
+	const int32_t centerOffset = tractSize / 2;
+
+	std::vector<uint32_t> columns(static_cast<size_t>(tractCountX));
+
+	for (int32_t x = 0; x < tractCountX; x++)
+	{
+		columns[x] = std::min(
+			static_cast<uint32_t>(((x * tractSize) + centerOffset) / inputTractSize),
+			snapshot.width - 1);
+	}
+
+	int16_t* destination = output.data();
+
+	for (int32_t z = 0; z < tractCountZ; z++)
+	{
+		const uint32_t inputRow = std::min(
+			static_cast<uint32_t>(((z * tractSize) + centerOffset) / inputTractSize),
+			snapshot.height - 1);
+		const int16_t* source = snapshot.GetRow(inputRow);
+
+		for (int32_t x = 0; x < tractCountX; x++)
+		{
+			destination[x] = source[columns[x]];
+		}
+
+		destination += tractCountX;
+	}
+}
+
+void AuraExposureEngine::BuildCurves(SnapshotGrid grid)
+{
+	const std::vector<int16_t>& values = resampled[static_cast<size_t>(grid)];
+	const float* allResidents = weights[static_cast<size_t>(Tier::AllResidents)].data();
+	const size_t tractCount = values.size();
+
+	// The bins cover the value range of the populated tracts.
+	int32_t minValue = std::numeric_limits<int16_t>::max();
+	int32_t maxValue = std::numeric_limits<int16_t>::min();
+
+	for (size_t i = 0; i < tractCount; i++)
+	{
+		if (allResidents[i] > 0.0f)
+		{
+			minValue = std::min(minValue, static_cast<int32_t>(values[i]));
+			maxValue = std::max(maxValue, static_cast<int32_t>(values[i]));
+		}
+	}
+
+	if (minValue > maxValue)
+	{
+		minValue = 0;
+		maxValue = 0;
+	}
+
+	const int32_t binWidth = std::max((maxValue - minValue + static_cast<int32_t>(BinCount)) / static_cast<int32_t>(BinCount), 1);
+
+	// The bin indexes are computed in a separate loop that the compiler can vectorize.
+	uint16_t* bins = binBuffer.data();
+	const int16_t* input = values.data();
+
+	for (size_t i = 0; i < tractCount; i++)
+	{
+		bins[i] = static_cast<uint16_t>(std::clamp((input[i] - minValue) / binWidth, 0, static_cast<int32_t>(BinCount) - 1));
+	}
+
+	std::array<Curve*, TierCount> tierCurves{};
+
+	for (size_t tier = 0; tier < TierCount; tier++)
+	{
+		Curve& curve = GetCurveReference(grid, static_cast<Tier>(tier));
+
+		curve.minValue = minValue;
+		curve.binWidth = binWidth;
+		curve.histogram.fill(0.0);
+
+		tierCurves[tier] = &curve;
+	}
+
+	// Every tier is accumulated in the same pass over the population tracts.
+	for (size_t i = 0; i < tractCount; i++)
+	{
+		if (allResidents[i] > 0.0f)
+		{
+			const uint16_t bin = bins[i];
+
+			for (size_t tier = 0; tier < TierCount; tier++)
+			{
+				tierCurves[tier]->histogram[bin] += weights[tier][i];
+			}
+		}
+	}
+
+	for (Curve* curve : tierCurves)
+	{
+		double total = 0.0;
+
+		for (uint32_t bin = 0; bin < BinCount; bin++)
+		{
+			total += curve->histogram[bin];
+			curve->cumulative[bin] = total;
+		}
+
+		curve->totalResidents = total;
+	}
+}
+
+void AuraExposureEngine::Clear()
+{
+	tractSize = 0;
+	tractCountX = 0;
+	tractCountZ = 0;
+	population.clear();
+
+	for (std::vector<float>& tierWeights : weights)
+	{
+		tierWeights.clear();
+	}
+
+	for (std::vector<int16_t>& values : resampled)
+	{
+		values.clear();
+	}
+
+	versions.fill(0);
+	binBuffer.clear();
+	valid = false;
+}
+
+AuraExposureEngine::Curve& AuraExposureEngine::GetCurveReference(SnapshotGrid grid, Tier tier)
+{
+	return curves[(static_cast<size_t>(grid) * TierCount) + static_cast<size_t>(tier)];
+}
@@ -0,0 +1,97 @@
+////////////////////////////////////////////////////////////////////////
+//
+// This file is part of sc4-data-view-extensions, a DLL Plugin for
+// SimCity 4 that extends the game's data views.
+//
+// Copyright (c) 2024 Nicholas Hayes
+//
+// This file is licensed under terms of the MIT License.
+// See LICENSE.txt for more information.
+//
+////////////////////////////////////////////////////////////////////////
+
+#pragma once
+#include "GridSnapshotService.h"
+#include <array>
+#include <cstdint>
+#include <vector>
+
+class cISC4City;
+class cISC4ResidentialSimulator;
+
+// Measures how strongly the city's residents are exposed to the aura grids.
+// The aura grid, park map and landmark map are resampled onto the tract layout
+// of the residential population grid, and each populated tract adds its residents
+// to a weighted histogram of the input values.
+// The histograms for every wealth tier are accumulated in one pass over the
+// population tracts, and are reused until an input grid or the population changes.
+class AuraExposureEngine
+{
+public:
+	static constexpr uint32_t BinCount = 256;
+
+	enum class Tier : uint32_t
+	{
+		AllResidents = 0,
+		LowWealth,
+		MediumWealth,
+		HighWealth,
+		Count
+	};
+
+	struct Curve
+	{
+		// The input value of the first bin.
+		int32_t minValue;
+		// The number of input values that each bin covers.
+		int32_t binWidth;
+		double totalResidents;
+		// The number of residents in each bin.
+		std::array<double, BinCount> histogram;
+		// The number of residents in the bin and all of the bins below it.
+		std::array<double, BinCount> cumulative;
+	};
+
+	AuraExposureEngine();
+
+	// Returns nullptr if a city is not loaded or the input grids are not available.
+	const Curve* GetCurve(SnapshotGrid grid, Tier tier);
+
+	// Gets the percentage of the tier's residents that live in a tract with a
+	// value at or above the threshold.
+	// Returns false if a city is not loaded or the input grids are not available.
+	bool GetPercentAtLeast(SnapshotGrid grid, Tier tier, int32_t threshold, double& percent);
+
+	void PostCityInit(cISC4City* pCity);
+	void PreCityShutdown();
+
+private:
+	static constexpr size_t GridCount = static_cast<size_t>(SnapshotGrid::Count);
+	static constexpr size_t TierCount = static_cast<size_t>(Tier::Count);
+
+	bool Update();
+	bool UpdatePopulation(cISC4SimGrid<uint16_t>* populationGrid, bool& layoutChanged);
+	void UpdateWealthWeights();
+	void Resample(SnapshotGrid grid, const GridSnapshot& snapshot);
+	void BuildCurves(SnapshotGrid grid);
+	void Clear();
+
+	Curve& GetCurveReference(SnapshotGrid grid, Tier tier);
+
+	cISC4ResidentialSimulator* pResidentialSimulator;
+	int32_t tractSize;
+	int32_t tractCountX;
+	int32_t tractCountZ;
+	// The population grid values that the weights were built from.
+	std::vector<int32_t> population;
+	// The number of residents in each population tract, one array per tier.
+	// The wealth tiers divide a tract's residents in proportion to the
+	// occupant capacity of its low, medium and high wealth residential buildings.
+	std::array<std::vector<float>, TierCount> weights;
+	// The input grid values at the center of each population tract.
+	std::array<std::vector<int16_t>, GridCount> resampled;
+	std::array<uint64_t, GridCount> versions;
+	std::array<Curve, GridCount * TierCount> curves;
+	std::vector<uint16_t> binBuffer;
+	bool valid;
+};
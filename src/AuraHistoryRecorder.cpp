@@ -0,0 +1,119 @@
+////////////////////////////////////////////////////////////////////////
+//
+// This file is part of sc4-data-view-extensions, a DLL Plugin for
+// SimCity 4 that extends the game's data views.
+//
+// Copyright (c) 2024 Nicholas Hayes
+//
+// This file is licensed under terms of the MIT License.
+// See LICENSE.txt for more information.
+//
+////////////////////////////////////////////////////////////////////////
+
+#include "AuraHistoryRecorder.h"
+#include "GlobalPointers.h"
+#include "GridSnapshotService.h"
+#include "cISC4HistoryWarehouse.h"
+#include <cmath>
+
+// The number of months that the history warehouse keeps, 50 years.
+static constexpr uint32_t kHistoryQueueLength = 600;
+
+// The values above this threshold are counted by the AreaAboveThreshold metric.
+static constexpr int32_t kAreaThreshold = 0;
+
+uint32_t AuraHistoryRecorder::GetHistoryType(Source source, Metric metric)
+{
+	return HistoryTypeBase + (static_cast<uint32_t>(source) * 0x10) + static_cast<uint32_t>(metric);
+}
+
+AuraHistoryRecorder::AuraHistoryRecorder()
+	: pHistoryWarehouse(nullptr),
+	  transientAuraChannel(),
+	  statistics()
+{
+}
+
+void AuraHistoryRecorder::PostCityInit(cISC4HistoryWarehouse* pHistoryWarehouse)
+{
+	this->pHistoryWarehouse = pHistoryWarehouse;
+
+	if (pHistoryWarehouse)
+	{
+		for (uint32_t source = 0; source < static_cast<uint32_t>(Source::Count); source++)
+		{
+			for (uint32_t metric = 0; metric < static_cast<uint32_t>(Metric::Count); metric++)
+			{
+				pHistoryWarehouse->SetHistoryDataQueueLength(
+					GetHistoryType(static_cast<Source>(source), static_cast<Metric>(metric)),
+					kHistoryQueueLength);
+			}
+		}
+	}
+}
+
+void AuraHistoryRecorder::PreCityShutdown()
+{
+	pHistoryWarehouse = nullptr;
+	transientAuraChannel.Clear();
+
+	for (GridStatistics& item : statistics)
+	{
+		item.Clear();
+	}
+}
+
+void AuraHistoryRecorder::RecordMonth()
+{
+	if (!pHistoryWarehouse || !spAura)
+	{
+		return;
+	}
+
+	UpdateStatistics();
+
+	for (uint32_t source = 0; source < static_cast<uint32_t>(Source::Count); source++)
+	{
+		const GridStatistics& item = statistics[source];
+
+		if (item.GetCount() == 0)
+		{
+			continue;
+		}
+
+		const int32_t cellsPerTract = item.GetTractSize() * item.GetTractSize();
+
+		const int32_t mean = static_cast<int32_t>(std::lround(item.GetMean() * 100.0));
+		const int32_t percentile90 = item.GetPercentile(90.0);
+		const int32_t area = static_cast<int32_t>(item.GetCountAbove(kAreaThreshold)) * cellsPerTract;
+
+		pHistoryWarehouse->RecordHistoryData(GetHistoryType(static_cast<Source>(source), Metric::Mean), mean);
+		pHistoryWarehouse->RecordHistoryData(GetHistoryType(static_cast<Source>(source), Metric::Percentile90), percentile90);
+		pHistoryWarehouse->RecordHistoryData(GetHistoryType(static_cast<Source>(source), Metric::AreaAboveThreshold), area);
+	}
+}
+
+void AuraHistoryRecorder::UpdateStatistics()
+{
+	spGridSnapshotService->Capture();
+
+	if (std::shared_ptr<const GridSnapshot> snapshot = spGridSnapshotService->GetSnapshot(SnapshotGrid::ParkMap))
+	{
+		statistics[static_cast<size_t>(Source::ParkMap)].Update(*snapshot);
+	}
+
+	if (std::shared_ptr<const GridSnapshot> snapshot = spGridSnapshotService->GetSnapshot(SnapshotGrid::LandmarkMap))
+	{
+		statistics[static_cast<size_t>(Source::LandmarkMap)].Update(*snapshot);
+	}
+
+	if (cISC4SimGrid<int8_t>* grid = spAura->GetTransientAuraGrid())
+	{
+		transientAuraChannel.Capture(grid);
+
+		if (std::shared_ptr<const GridSnapshot> snapshot = transientAuraChannel.GetLatest())
+		{
+			statistics[static_cast<size_t>(Source::TransientAura)].Update(*snapshot);
+		}
+	}
+}
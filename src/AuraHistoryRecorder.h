@@ -0,0 +1,65 @@
+////////////////////////////////////////////////////////////////////////
+//
+// This file is part of sc4-data-view-extensions, a DLL Plugin for
+// SimCity 4 that extends the game's data views.
+//
+// Copyright (c) 2024 Nicholas Hayes
+//
+// This file is licensed under terms of the MIT License.
+// See LICENSE.txt for more information.
+//
+////////////////////////////////////////////////////////////////////////
+
+#pragma once
+#include "GridSnapshot.h"
+#include "GridStatistics.h"
+#include <array>
+
+class cISC4HistoryWarehouse;
+
+// Records the citywide aura statistics into the game's history warehouse
+// once per simulation month, which allows them to be charted over time.
+// The statistics are kept up to date from the changed rows of the grid
+// snapshots, so recording a month does not rescan the grids.
+class AuraHistoryRecorder
+{
+public:
+	enum class Source : uint32_t
+	{
+		ParkMap = 0,
+		LandmarkMap,
+		TransientAura,
+		Count
+	};
+
+	enum class Metric : uint32_t
+	{
+		// The mean value of the grid tracts, multiplied by 100.
+		Mean = 0,
+		// The 90th percentile of the grid tract values.
+		Percentile90,
+		// The number of city cells with a value above 0.
+		AreaAboveThreshold,
+		Count
+	};
+
+	static constexpr uint32_t HistoryTypeBase = 0x4C1E5B00;
+
+	// The history type ID is HistoryTypeBase + (source * 0x10) + metric.
+	static uint32_t GetHistoryType(Source source, Metric metric);
+
+	AuraHistoryRecorder();
+
+	void PostCityInit(cISC4HistoryWarehouse* pHistoryWarehouse);
+	void PreCityShutdown();
+
+	void RecordMonth();
+
+private:
+	void UpdateStatistics();
+
+	cISC4HistoryWarehouse* pHistoryWarehouse;
+	// The transient aura grid is not one of the shared snapshot grids.
+	GridSnapshotChannel transientAuraChannel;
+	std::array<GridStatistics, static_cast<size_t>(Source::Count)> statistics;
+};
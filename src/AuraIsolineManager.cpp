@@ -0,0 +1,50 @@
+////////////////////////////////////////////////////////////////////////
+//
+// This file is part of sc4-data-view-extensions, a DLL Plugin for
+// SimCity 4 that extends the game's data views.
+//
+// Copyright (c) 2024 Nicholas Hayes
+//
+// This file is licensed under terms of the MIT License.
+// See LICENSE.txt for more information.
+//
+////////////////////////////////////////////////////////////////////////
+
+#include "AuraIsolineManager.h"
+#include "GlobalPointers.h"
+#include "GridSnapshotService.h"
+
+AuraIsolineManager::AuraIsolineManager()
+	: extractors()
+{
+}
+
+const PolylineBuffer* AuraIsolineManager::GetIsolines(SnapshotGrid grid, int32_t threshold)
+{
+	if (!spAura || grid >= SnapshotGrid::Count)
+	{
+		return nullptr;
+	}
+
+	spGridSnapshotService->Capture();
+
+	std::shared_ptr<const GridSnapshot> snapshot = spGridSnapshotService->GetSnapshot(grid);
+
+	if (!snapshot)
+	{
+		return nullptr;
+	}
+
+	IsolineExtractor& extractor = extractors[static_cast<size_t>(grid)];
+	extractor.Update(*snapshot);
+
+	return &extractor.GetIsolines(threshold);
+}
+
+void AuraIsolineManager::PreCityShutdown()
+{
+	for (IsolineExtractor& extractor : extractors)
+	{
+		extractor.Clear();
+	}
+}
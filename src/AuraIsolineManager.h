@@ -0,0 +1,32 @@
+////////////////////////////////////////////////////////////////////////
+//
+// This file is part of sc4-data-view-extensions, a DLL Plugin for
+// SimCity 4 that extends the game's data views.
+//
+// Copyright (c) 2024 Nicholas Hayes
+//
+// This file is licensed under terms of the MIT License.
+// See LICENSE.txt for more information.
+//
+////////////////////////////////////////////////////////////////////////
+
+#pragma once
+#include "GridSnapshotService.h"
+#include "IsolineExtractor.h"
+#include <array>
+
+// Provides the contour lines of the game's aura, park and landmark grids.
+// The contours are updated when they are requested.
+class AuraIsolineManager
+{
+public:
+	AuraIsolineManager();
+
+	// Returns nullptr if a city is not loaded.
+	const PolylineBuffer* GetIsolines(SnapshotGrid grid, int32_t threshold);
+
+	void PreCityShutdown();
+
+private:
+	std::array<IsolineExtractor, static_cast<size_t>(SnapshotGrid::Count)> extractors;
+};
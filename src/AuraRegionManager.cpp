@@ -0,0 +1,257 @@
+////////////////////////////////////////////////////////////////////////
+//
+// This file is part of sc4-data-view-extensions, a DLL Plugin for
+// SimCity 4 that extends the game's data views.
+//
+// Copyright (c) 2024 Nicholas Hayes
+//
+// This file is licensed under terms of the MIT License.
+// See LICENSE.txt for more information.
+//
+////////////////////////////////////////////////////////////////////////
+
+#include "AuraRegionManager.h"
+#include "GlobalPointers.h"
+#include "MemoryArena.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <limits>
+
+// The default thresholds. The aura grid values range from -128 to 127,
+// the park and landmark maps hold the summed effect of the nearby buildings.
+static constexpr int32_t kDefaultAuraThreshold = 64;
+static constexpr int32_t kDefaultParkMapThreshold = 1;
+static constexpr int32_t kDefaultLandmarkMapThreshold = 1;
+
+AuraRegionManager::AuraRegionManager()
+	: labelers{
+		ConnectedComponentLabeler(kDefaultAuraThreshold),
+		ConnectedComponentLabeler(kDefaultParkMapThreshold),
+		ConnectedComponentLabeler(kDefaultLandmarkMapThreshold) },
+	  thresholds{ kDefaultAuraThreshold, kDefaultParkMapThreshold, kDefaultLandmarkMapThreshold },
+	  submittedVersions(),
+	  jobRunning(false),
+	  jobMutex(),
+	  jobFinished(),
+	  thresholdsChanged(false),
+	  jobCount(0),
+	  results(),
+	  auraRegionGrid(MemoryArenas::Get(MemorySubsystem::Overlays)),
+	  auraRegionGridJobNumber(0),
+	  auraRegionGridRefresh(
+		"aura region grid refresh",
+		FrameTaskScheduler::Priority::Normal,
+		[this](const FrameBudget&) { return RefreshAuraRegionGrid(); })
+{
+}
+
+AuraRegionManager::~AuraRegionManager()
+{
+	// The labeling job uses the manager's labelers and results.
+	WaitForLabelingJob();
+}
+
+int32_t AuraRegionManager::GetThreshold(AuraRegionSource source) const
+{
+	return thresholds[static_cast<size_t>(source)].load(std::memory_order_relaxed);
+}
+
+void AuraRegionManager::SetThreshold(AuraRegionSource source, int32_t threshold)
+{
+	thresholds[static_cast<size_t>(source)].store(threshold, std::memory_order_relaxed);
+	thresholdsChanged.store(true, std::memory_order_release);
+}
+
+const AuraRegionResults* AuraRegionManager::GetResults()
+{
+	if (!spAura)
+	{
+		return nullptr;
+	}
+
+	// The game thread does not hold any of the earlier results at this point.
+	results.ReclaimRetired();
+
+	spGridSnapshotService->Capture();
+
+	if (!jobRunning.load(std::memory_order_acquire))
+	{
+		StartLabelingJob();
+	}
+
+	return results.Get();
+}
+
+cISC4SimGrid<int16_t>* AuraRegionManager::GetAuraRegionGrid()
+{
+	if (!spAura)
+	{
+		return nullptr;
+	}
+
+	auraRegionGridRefresh.Request();
+
+	return auraRegionGrid.IsEmpty() ? nullptr : &auraRegionGrid;
+}
+
+void AuraRegionManager::PreCityShutdown()
+{
+	auraRegionGridRefresh.Cancel();
+	WaitForLabelingJob();
+
+	for (ConnectedComponentLabeler& labeler : labelers)
+	{
+		labeler.Clear();
+	}
+
+	submittedVersions.fill(0);
+	results.Reset();
+	auraRegionGrid.Clear();
+	auraRegionGridJobNumber = 0;
+}
+
+void AuraRegionManager::StartLabelingJob()
+{
+	std::array<std::shared_ptr<const GridSnapshot>, static_cast<size_t>(AuraRegionSource::Count)> snapshots;
+	std::array<int32_t, static_cast<size_t>(AuraRegionSource::Count)> jobThresholds{};
+
+	bool changed = thresholdsChanged.exchange(false, std::memory_order_acq_rel);
+
+	for (size_t i = 0; i < snapshots.size(); i++)
+	{
+		snapshots[i] = spGridSnapshotService->GetSnapshot(static_cast<AuraRegionSource>(i));
+		jobThresholds[i] = thresholds[i].load(std::memory_order_relaxed);
+
+		const uint64_t version = snapshots[i] ? snapshots[i]->version : 0;
+
+		if (version != submittedVersions[i])
+		{
+			submittedVersions[i] = version;
+			changed = true;
+		}
+	}
+
+	if (changed)
+	{
+		jobRunning.store(true, std::memory_order_release);
+
+		const uint64_t jobNumber = ++jobCount;
+
+		// The job is finished when the last copy of the task is destroyed, this also
+		// covers a task that the thread pool discards when it stops. The manager waits
+		// for that before it is shut down or destroyed, so the task never outlives it.
+		std::shared_ptr<void> completion(nullptr, [this](void*) { FinishLabelingJob(); });
+
+		spThreadPool->Submit(
+			[this, jobNumber, snapshots, jobThresholds, completion = std::move(completion)]()
+			{
+				RunLabelingJob(jobNumber, snapshots, jobThresholds);
+			});
+	}
+}
+
+void AuraRegionManager::RunLabelingJob(
+	uint64_t jobNumber,
+	std::array<std::shared_ptr<const GridSnapshot>, static_cast<size_t>(AuraRegionSource::Count)> snapshots,
+	std::array<int32_t, static_cast<size_t>(AuraRegionSource::Count)> jobThresholds)
+{
+	auto output = std::make_unique<AuraRegionResults>();
+	output->jobNumber = jobNumber;
+
+	for (size_t i = 0; i < snapshots.size(); i++)
+	{
+		const GridSnapshot* snapshot = snapshots[i].get();
+
+		if (!snapshot)
+		{
+			continue;
+		}
+
+		ConnectedComponentLabeler& labeler = labelers[i];
+		labeler.SetThreshold(jobThresholds[i]);
+		labeler.Update(*snapshot);
+
+		AuraRegionLabels& labels = output->sources[i];
+		labels.snapshotVersion = snapshot->version;
+		labels.width = labeler.GetWidth();
+		labels.height = labeler.GetHeight();
+		labels.tractSize = std::max(snapshot->tractSize, 1);
+		labels.labels = labeler.GetLabels();
+		labels.regions = labeler.GetRegions();
+	}
+
+	results.Publish(std::move(output));
+}
+
+bool AuraRegionManager::RefreshAuraRegionGrid()
+{
+	if (spAura)
+	{
+		results.ReclaimRetired();
+
+		// The data view only shows the aura grid regions, the park and landmark
+		// labels use the snapshots from the last full capture.
+		spGridSnapshotService->Capture(SnapshotGrid::Aura);
+
+		if (!jobRunning.load(std::memory_order_acquire))
+		{
+			StartLabelingJob();
+		}
+
+		const AuraRegionResults* current = results.Get();
+
+		if (current)
+		{
+			UpdateAuraRegionGrid(*current);
+		}
+	}
+
+	return true;
+}
+
+void AuraRegionManager::UpdateAuraRegionGrid(const AuraRegionResults& current)
+{
+	if (current.jobNumber == auraRegionGridJobNumber)
+	{
+		return;
+	}
+
+	auraRegionGridJobNumber = current.jobNumber;
+
+	const AuraRegionLabels& auraLabels = current.sources[static_cast<size_t>(AuraRegionSource::Aura)];
+
+	if (auraLabels.labels.empty())
+	{
+		auraRegionGrid.Clear();
+		return;
+	}
+
+	// The label grid uses the same layout as the aura grid.
+	auraRegionGrid.Resize(
+		static_cast<int32_t>(auraLabels.width) * auraLabels.tractSize,
+		static_cast<int32_t>(auraLabels.height) * auraLabels.tractSize,
+		auraLabels.tractSize);
+
+	int16_t* values = auraRegionGrid.GetValues();
+
+	for (size_t i = 0; i < auraLabels.labels.size(); i++)
+	{
+		values[i] = static_cast<int16_t>(std::min<uint32_t>(auraLabels.labels[i], std::numeric_limits<int16_t>::max()));
+	}
+}
+
+void AuraRegionManager::FinishLabelingJob()
+{
+	std::lock_guard<std::mutex> lock(jobMutex);
+	jobRunning.store(false, std::memory_order_release);
+
+	// The waiting thread can't return before the lock is released, so the
+	// condition variable is still alive when it is notified.
+	jobFinished.notify_all();
+}
+
+void AuraRegionManager::WaitForLabelingJob()
+{
+	std::unique_lock<std::mutex> lock(jobMutex);
+	jobFinished.wait(lock, [this] { return !jobRunning.load(std::memory_order_acquire); });
+}
@@ -0,0 +1,100 @@
+////////////////////////////////////////////////////////////////////////
+//
+// This file is part of sc4-data-view-extensions, a DLL Plugin for
+// SimCity 4 that extends the game's data views.
+//
+// Copyright (c) 2024 Nicholas Hayes
+//
+// This file is licensed under terms of the MIT License.
+// See LICENSE.txt for more information.
+//
+////////////////////////////////////////////////////////////////////////
+
+#pragma once
+#include "ConnectedComponentLabeler.h"
+#include "DllSimGrid.h"
+#include "FrameTaskScheduler.h"
+#include "GridSnapshotService.h"
+#include "PublishedValue.h"
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+
+typedef SnapshotGrid AuraRegionSource;
+
+struct AuraRegionLabels
+{
+	uint64_t snapshotVersion;
+	uint32_t width;
+	uint32_t height;
+	// The tract size of the source grid, in cells.
+	int32_t tractSize;
+	// See ConnectedComponentLabeler::GetLabels.
+	std::vector<uint32_t> labels;
+	std::vector<ConnectedComponentLabeler::Region> regions;
+};
+
+struct AuraRegionResults
+{
+	// The number of the labeling job that produced the results.
+	uint64_t jobNumber;
+	std::array<AuraRegionLabels, static_cast<size_t>(AuraRegionSource::Count)> sources;
+};
+
+// Labels the connected high value regions of the game's aura grids.
+// The labeling runs on the thread pool using the grid snapshots, and the
+// results are published back to the game thread when it finishes.
+class AuraRegionManager
+{
+public:
+	AuraRegionManager();
+	~AuraRegionManager();
+
+	AuraRegionManager(const AuraRegionManager&) = delete;
+	AuraRegionManager& operator=(const AuraRegionManager&) = delete;
+
+	int32_t GetThreshold(AuraRegionSource source) const;
+	void SetThreshold(AuraRegionSource source, int32_t threshold);
+
+	// Starts a labeling job if the grids changed, and returns the most recent results.
+	// This must be called on the game thread, the results remain valid until the next call.
+	// Returns nullptr if no results are available.
+	const AuraRegionResults* GetResults();
+
+	// Gets the data view grid, which contains the region label of each aura tract.
+	// This is called from the data view's render hook, so it only requests a frame
+	// task that captures the aura grid and copies the most recent results into the
+	// data view grid. The grid stays valid until the city is unloaded.
+	// Returns nullptr if no results are available.
+	cISC4SimGrid<int16_t>* GetAuraRegionGrid();
+
+	void PreCityShutdown();
+
+private:
+	void StartLabelingJob();
+	void RunLabelingJob(
+		uint64_t jobNumber,
+		std::array<std::shared_ptr<const GridSnapshot>, static_cast<size_t>(AuraRegionSource::Count)> snapshots,
+		std::array<int32_t, static_cast<size_t>(AuraRegionSource::Count)> jobThresholds);
+	bool RefreshAuraRegionGrid();
+	void UpdateAuraRegionGrid(const AuraRegionResults& current);
+	void FinishLabelingJob();
+	void WaitForLabelingJob();
+
+	// The labelers are only used by the labeling job, and only one job runs at a time.
+	std::array<ConnectedComponentLabeler, static_cast<size_t>(AuraRegionSource::Count)> labelers;
+	std::array<std::atomic<int32_t>, static_cast<size_t>(AuraRegionSource::Count)> thresholds;
+	std::array<uint64_t, static_cast<size_t>(AuraRegionSource::Count)> submittedVersions;
+	std::atomic<bool> jobRunning;
+	std::mutex jobMutex;
+	std::condition_variable jobFinished;
+	std::atomic<bool> thresholdsChanged;
+	uint64_t jobCount;
+	PublishedValue<AuraRegionResults> results;
+	// The data view grid is owned by the manager instead of the published results,
+	// because the game keeps using the grid after a newer result replaces it.
+	DllSimGrid<int16_t> auraRegionGrid;
+	uint64_t auraRegionGridJobNumber;
+	FrameTaskRequest auraRegionGridRefresh;
+};
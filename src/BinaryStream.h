@@ -0,0 +1,93 @@
+////////////////////////////////////////////////////////////////////////
+//
+// This file is part of sc4-data-view-extensions, a DLL Plugin for
+// SimCity 4 that extends the game's data views.
+//
+// Copyright (c) 2024 Nicholas Hayes
+//
+// This file is licensed under terms of the MIT License.
+// See LICENSE.txt for more information.
+//
+////////////////////////////////////////////////////////////////////////
+
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+// Reads little-endian values from a memory buffer.
+// The values are copied, so the buffer does not need to be aligned.
+class BinaryReader
+{
+public:
+	BinaryReader(const uint8_t* data, size_t size) : data(data), size(size), position(0)
+	{
+	}
+
+	// Returns false if the buffer does not have enough data remaining.
+	template<typename T>
+	bool Read(T& value)
+	{
+		if (size - position < sizeof(T))
+		{
+			return false;
+		}
+
+		std::memcpy(&value, data + position, sizeof(T));
+		position += sizeof(T);
+
+		return true;
+	}
+
+	bool Skip(size_t count)
+	{
+		if (size - position < count)
+		{
+			return false;
+		}
+
+		position += count;
+		return true;
+	}
+
+	const uint8_t* GetCurrent() const
+	{
+		return data + position;
+	}
+
+	size_t GetPosition() const
+	{
+		return position;
+	}
+
+private:
+	const uint8_t* data;
+	size_t size;
+	size_t position;
+};
+
+// Appends little-endian values to a byte vector.
+class BinaryWriter
+{
+public:
+	BinaryWriter(std::vector<uint8_t>& output) : output(output)
+	{
+	}
+
+	template<typename T>
+	void Write(T value)
+	{
+		WriteBytes(&value, sizeof(T));
+	}
+
+	void WriteBytes(const void* data, size_t count)
+	{
+		const size_t offset = output.size();
+		output.resize(offset + count);
+		std::memcpy(output.data() + offset, data, count);
+	}
+
+private:
+	std::vector<uint8_t>& output;
+};
@@ -0,0 +1,353 @@
+////////////////////////////////////////////////////////////////////////
+//
+// This file is part of sc4-data-view-extensions, a DLL Plugin for
+// SimCity 4 that extends the game's data views.
+//
+// Copyright (c) 2024 Nicholas Hayes
+//
+// This file is licensed under terms of the MIT License.
+// See LICENSE.txt for more information.
+//
+////////////////////////////////////////////////////////////////////////
+
+#include "BuildingAttributeIndex.h"
+#include "BuildingOccupantUtil.h"
+#include "cISC4City.h"
+#include "cISC4Occupant.h"
+#include "cISC4OccupantManager.h"
+#include "cISC4Simulator.h"
+#include "cRZAutoRefCount.h"
+#include "GlobalPointers.h"
+#include "OccupantEventBus.h"
+#include "OccupantTypes.h"
+#include <limits>
+
+BuildingAttributeIndex::BuildingAttributeIndex()
+	: entries(),
+	  profileBuckets(),
+	  ageBuckets(),
+	  pSimulator(nullptr),
+	  populated(false)
+{
+}
+
+void BuildingAttributeIndex::Init()
+{
+	spOccupantEventBus->Subscribe(this, kOccupantTypeBuilding);
+}
+
+void BuildingAttributeIndex::Shutdown()
+{
+	spOccupantEventBus->Unsubscribe(this);
+}
+
+bool BuildingAttributeIndex::GetBuildingAttributes(
+	cISC4Occupant* pOccupant,
+	cISC4BuildingOccupant::PurposeType& purpose,
+	cISC4BuildingOccupant::WealthType& wealth,
+	int32_t& constructionDate)
+{
+	cRZAutoRefCount<cISC4BuildingOccupant> pBuildingOccupant;
+
+	if (!pOccupant->QueryInterface(GZIID_cISC4BuildingOccupant, pBuildingOccupant.AsPPVoid()))
+	{
+		return false;
+	}
+
+	const BuildingProfileFields& profile = GetBuildingProfileFields(pBuildingOccupant);
+
+	purpose = profile.purpose;
+	wealth = profile.wealth;
+	// The building age is the sim date number when the building was constructed,
+	// it does not change after the building has been placed.
+	constructionDate = pBuildingOccupant->GetBuildingAge();
+
+	return true;
+}
+
+bool BuildingAttributeIndex::IsProfileIncluded(
+	cISC4BuildingOccupant::PurposeType purpose,
+	cISC4BuildingOccupant::WealthType wealth,
+	uint32_t purposeMask,
+	uint32_t wealthMask)
+{
+	const uint32_t purposeValue = static_cast<uint32_t>(purpose);
+	const uint32_t wealthValue = static_cast<uint32_t>(wealth);
+
+	const bool purposeIncluded = purposeMask == 0
+		|| (purposeValue > 0 && purposeValue < PurposeCount && (purposeMask & (1U << (purposeValue - 1))) != 0);
+	const bool wealthIncluded = wealthMask == 0
+		|| (wealthValue > 0 && wealthValue < WealthCount && (wealthMask & (1U << (wealthValue - 1))) != 0);
+
+	return purposeIncluded && wealthIncluded;
+}
+
+int32_t BuildingAttributeIndex::GetLatestConstructionDate(uint32_t years) const
+{
+	const int32_t today = pSimulator ? pSimulator->GetSimDateNumber() : 0;
+
+	return today - static_cast<int32_t>(years * DaysPerYear);
+}
+
+void BuildingAttributeIndex::GetBuildingsByProfile(
+	uint32_t purposeMask,
+	uint32_t wealthMask,
+	std::vector<cISC4Occupant*>& output)
+{
+	Populate();
+
+	output.clear();
+
+	for (uint32_t purpose = 0; purpose < PurposeCount; purpose++)
+	{
+		for (uint32_t wealth = 0; wealth < WealthCount; wealth++)
+		{
+			const auto purposeType = static_cast<cISC4BuildingOccupant::PurposeType>(purpose);
+			const auto wealthType = static_cast<cISC4BuildingOccupant::WealthType>(wealth);
+
+			if (IsProfileIncluded(purposeType, wealthType, purposeMask, wealthMask))
+			{
+				const Bucket& bucket = profileBuckets[GetProfileBucketIndex(purposeType, wealthType)];
+				output.insert(output.end(), bucket.begin(), bucket.end());
+			}
+		}
+	}
+}
+
+void BuildingAttributeIndex::GetBuildingsBuiltBefore(
+	int32_t latestConstructionDate,
+	std::vector<cISC4Occupant*>& output)
+{
+	GetBuildingsBuiltBetween(std::numeric_limits<int32_t>::min(), latestConstructionDate, output);
+}
+
+void BuildingAttributeIndex::GetBuildingsBuiltBetween(
+	int32_t earliestConstructionDate,
+	int32_t latestConstructionDate,
+	std::vector<cISC4Occupant*>& output)
+{
+	Populate();
+
+	output.clear();
+
+	if (earliestConstructionDate > latestConstructionDate)
+	{
+		return;
+	}
+
+	const int32_t firstYear = GetConstructionYear(earliestConstructionDate);
+	const int32_t lastYear = GetConstructionYear(latestConstructionDate);
+
+	for (auto it = ageBuckets.lower_bound(firstYear); it != ageBuckets.end() && it->first <= lastYear; ++it)
+	{
+		const auto& [year, bucket] = *it;
+
+		if (year > firstYear && year < lastYear)
+		{
+			output.insert(output.end(), bucket.begin(), bucket.end());
+		}
+		else
+		{
+			// Only part of the first and last year's buckets may qualify.
+			for (cISC4Occupant* pOccupant : bucket)
+			{
+				const int32_t constructionDate = entries.at(pOccupant).constructionDate;
+
+				if (constructionDate >= earliestConstructionDate && constructionDate <= latestConstructionDate)
+				{
+					output.push_back(pOccupant);
+				}
+			}
+		}
+	}
+}
+
+uint32_t BuildingAttributeIndex::GetCount()
+{
+	Populate();
+
+	return static_cast<uint32_t>(entries.size());
+}
+
+void BuildingAttributeIndex::OccupantInserted(cISC4Occupant* pOccupant)
+{
+	if (!populated)
+	{
+		// The occupant will be added by the scan when the index is first used.
+		return;
+	}
+
+	AddOccupant(pOccupant);
+}
+
+void BuildingAttributeIndex::OccupantRemoved(cISC4Occupant* pOccupant)
+{
+	auto item = entries.find(pOccupant);
+
+	if (item != entries.end())
+	{
+		const Entry entry = item->second;
+		entries.erase(item);
+
+		RemoveFromBucket(profileBuckets[entry.profileBucket], entry.profileSlot, true);
+
+		auto ageBucket = ageBuckets.find(entry.constructionYear);
+
+		if (ageBucket != ageBuckets.end())
+		{
+			RemoveFromBucket(ageBucket->second, entry.ageSlot, false);
+
+			if (ageBucket->second.empty())
+			{
+				ageBuckets.erase(ageBucket);
+			}
+		}
+
+		pOccupant->Release();
+	}
+}
+
+void BuildingAttributeIndex::PostCityInit(cISC4City* pCity)
+{
+	// The occupant scan is deferred until the index is first used.
+	pSimulator = pCity->GetSimulator();
+}
+
+void BuildingAttributeIndex::PreCityShutdown()
+{
+	// The index holds references to the occupants, these must be
+	// released before the city is destroyed.
+	Clear();
+	pSimulator = nullptr;
+	populated = false;
+}
+
+bool BuildingAttributeIndex::IterateOccupantsCallback(cISC4Occupant* pOccupant, void* pContext)
+{
+	static_cast<BuildingAttributeIndex*>(pContext)->AddOccupant(pOccupant);
+	return true;
+}
+
+uint32_t BuildingAttributeIndex::GetProfileBucketIndex(
+	cISC4BuildingOccupant::PurposeType purpose,
+	cISC4BuildingOccupant::WealthType wealth)
+{
+	// Out of range values are placed in the None bucket.
+	uint32_t purposeValue = static_cast<uint32_t>(purpose);
+	uint32_t wealthValue = static_cast<uint32_t>(wealth);
+
+	if (purposeValue >= PurposeCount)
+	{
+		purposeValue = 0;
+	}
+
+	if (wealthValue >= WealthCount)
+	{
+		wealthValue = 0;
+	}
+
+	return (purposeValue * WealthCount) + wealthValue;
+}
+
+int32_t BuildingAttributeIndex::GetConstructionYear(int32_t constructionDate)
+{
+	// Rounds toward negative infinity so that the years are contiguous.
+	const int32_t daysPerYear = static_cast<int32_t>(DaysPerYear);
+
+	// The negative form does not negate the date, so it can not overflow.
+	return constructionDate >= 0
+		? constructionDate / daysPerYear
+		: ((constructionDate + 1) / daysPerYear) - 1;
+}
+
+void BuildingAttributeIndex::Populate()
+{
+	if (populated || !spOccupantManager)
+	{
+		return;
+	}
+
+	populated = true;
+
+	spOccupantManager->IterateOccupants(
+		IterateOccupantsCallback,
+		this,
+		nullptr,
+		nullptr,
+		kOccupantTypeBuilding);
+}
+
+void BuildingAttributeIndex::AddOccupant(cISC4Occupant* pOccupant)
+{
+	if (entries.contains(pOccupant))
+	{
+		return;
+	}
+
+	cISC4BuildingOccupant::PurposeType purpose{};
+	cISC4BuildingOccupant::WealthType wealth{};
+	int32_t constructionDate = 0;
+
+	if (!GetBuildingAttributes(pOccupant, purpose, wealth, constructionDate))
+	{
+		return;
+	}
+
+	Entry entry{};
+	entry.profileBucket = GetProfileBucketIndex(purpose, wealth);
+	entry.constructionDate = constructionDate;
+	entry.constructionYear = GetConstructionYear(constructionDate);
+
+	Bucket& profileBucket = profileBuckets[entry.profileBucket];
+	entry.profileSlot = static_cast<uint32_t>(profileBucket.size());
+	profileBucket.push_back(pOccupant);
+
+	Bucket& ageBucket = ageBuckets[entry.constructionYear];
+	entry.ageSlot = static_cast<uint32_t>(ageBucket.size());
+	ageBucket.push_back(pOccupant);
+
+	entries.emplace(pOccupant, entry);
+	pOccupant->AddRef();
+}
+
+void BuildingAttributeIndex::RemoveFromBucket(Bucket& bucket, uint32_t slot, bool isProfileBucket)
+{
+	// The last item is moved into the removed item's slot.
+	const uint32_t lastSlot = static_cast<uint32_t>(bucket.size() - 1);
+
+	if (slot != lastSlot)
+	{
+		cISC4Occupant* pMoved = bucket[lastSlot];
+		bucket[slot] = pMoved;
+
+		Entry& movedEntry = entries.at(pMoved);
+
+		if (isProfileBucket)
+		{
+			movedEntry.profileSlot = slot;
+		}
+		else
+		{
+			movedEntry.ageSlot = slot;
+		}
+	}
+
+	bucket.pop_back();
+}
+
+void BuildingAttributeIndex::Clear()
+{
+	for (const auto& item : entries)
+	{
+		item.first->Release();
+	}
+
+	entries.clear();
+
+	for (Bucket& bucket : profileBuckets)
+	{
+		bucket.clear();
+	}
+
+	ageBuckets.clear();
+}
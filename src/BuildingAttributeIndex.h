@@ -0,0 +1,112 @@
+////////////////////////////////////////////////////////////////////////
+//
+// This file is part of sc4-data-view-extensions, a DLL Plugin for
+// SimCity 4 that extends the game's data views.
+//
+// Copyright (c) 2024 Nicholas Hayes
+//
+// This file is licensed under terms of the MIT License.
+// See LICENSE.txt for more information.
+//
+////////////////////////////////////////////////////////////////////////
+
+#pragma once
+#include "IOccupantEventSubscriber.h"
+#include "cISC4BuildingOccupant.h"
+#include <array>
+#include <cstdint>
+#include <map>
+#include <unordered_map>
+#include <vector>
+
+class cISC4Simulator;
+
+// Buckets the city's buildings by their purpose, wealth and construction
+// year as they are inserted and removed, so that the building attribute
+// highlight modes can be built from a union of buckets instead of a city scan.
+// The buckets are filled from an occupant scan the first time they are used
+// after a city is loaded, the events are ignored until then.
+class BuildingAttributeIndex : private IOccupantEventSubscriber
+{
+public:
+	// The purpose and wealth masks use one bit for each PurposeType or
+	// WealthType value, starting with bit 0 for the value 1.
+	// A mask of 0 matches any value.
+	static constexpr uint32_t PurposeCount = 10;
+	static constexpr uint32_t WealthCount = 4;
+	static constexpr uint32_t DaysPerYear = 365;
+
+	BuildingAttributeIndex();
+
+	void Init();
+	void Shutdown();
+
+	// Gets the building attributes that are used by the index.
+	// Returns false if the occupant is not a building.
+	static bool GetBuildingAttributes(
+		cISC4Occupant* pOccupant,
+		cISC4BuildingOccupant::PurposeType& purpose,
+		cISC4BuildingOccupant::WealthType& wealth,
+		int32_t& constructionDate);
+
+	static bool IsProfileIncluded(
+		cISC4BuildingOccupant::PurposeType purpose,
+		cISC4BuildingOccupant::WealthType wealth,
+		uint32_t purposeMask,
+		uint32_t wealthMask);
+
+	// Gets the latest construction date for a building that is at least the
+	// specified number of years old, based on the current simulator date.
+	int32_t GetLatestConstructionDate(uint32_t years) const;
+
+	// The output occupants do not have a reference added.
+	void GetBuildingsByProfile(uint32_t purposeMask, uint32_t wealthMask, std::vector<cISC4Occupant*>& output);
+	void GetBuildingsBuiltBefore(int32_t latestConstructionDate, std::vector<cISC4Occupant*>& output);
+	// Gets the buildings with a construction date in the inclusive range.
+	void GetBuildingsBuiltBetween(
+		int32_t earliestConstructionDate,
+		int32_t latestConstructionDate,
+		std::vector<cISC4Occupant*>& output);
+
+	uint32_t GetCount();
+
+private:
+	typedef std::vector<cISC4Occupant*> Bucket;
+
+	struct Entry
+	{
+		uint32_t profileBucket;
+		uint32_t profileSlot;
+		int32_t constructionDate;
+		int32_t constructionYear;
+		uint32_t ageSlot;
+	};
+
+	// IOccupantEventSubscriber
+
+	void OccupantInserted(cISC4Occupant* pOccupant);
+	void OccupantRemoved(cISC4Occupant* pOccupant);
+	void PostCityInit(cISC4City* pCity);
+	void PreCityShutdown();
+
+	// Private members
+
+	static bool IterateOccupantsCallback(cISC4Occupant* pOccupant, void* pContext);
+
+	static uint32_t GetProfileBucketIndex(
+		cISC4BuildingOccupant::PurposeType purpose,
+		cISC4BuildingOccupant::WealthType wealth);
+	static int32_t GetConstructionYear(int32_t constructionDate);
+
+	void Populate();
+	void AddOccupant(cISC4Occupant* pOccupant);
+	void RemoveFromBucket(Bucket& bucket, uint32_t slot, bool isProfileBucket);
+	void Clear();
+
+	std::unordered_map<cISC4Occupant*, Entry> entries;
+	std::array<Bucket, PurposeCount * WealthCount> profileBuckets;
+	// The buckets are ordered by construction year.
+	std::map<int32_t, Bucket> ageBuckets;
+	cISC4Simulator* pSimulator;
+	bool populated;
+};
@@ -0,0 +1,32 @@
+////////////////////////////////////////////////////////////////////////
+//
+// This file is part of sc4-data-view-extensions, a DLL Plugin for
+// SimCity 4 that extends the game's data views.
+//
+// Copyright (c) 2024 Nicholas Hayes
+//
+// This file is licensed under terms of the MIT License.
+// See LICENSE.txt for more information.
+//
+////////////////////////////////////////////////////////////////////////
+
+#pragma once
+#include "cISC4BuildingOccupant.h"
+#include <cstdint>
+
+// The vendored cISC4BuildingOccupant header does not define its interface ID.
+static constexpr uint32_t GZIID_cISC4BuildingOccupant = 0x87DFDD39;
+
+// The vendored BuildingProfile class declares its fields as private, this mirrors
+// the layout of the first three fields.
+struct BuildingProfileFields
+{
+	cISC4BuildingOccupant::PurposeType purpose;
+	cISC4BuildingOccupant::WealthType wealth;
+	uint16_t currentOccupantCapacity;
+};
+
+inline const BuildingProfileFields& GetBuildingProfileFields(cISC4BuildingOccupant* pBuildingOccupant)
+{
+	return *reinterpret_cast<const BuildingProfileFields*>(&pBuildingOccupant->GetBuildingProfile());
+}
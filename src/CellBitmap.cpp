@@ -0,0 +1,280 @@
+////////////////////////////////////////////////////////////////////////
+//
+// This file is part of sc4-data-view-extensions, a DLL Plugin for
+// SimCity 4 that extends the game's data views.
+//
+// Copyright (c) 2024 Nicholas Hayes
+//
+// This file is licensed under terms of the MIT License.
+// See LICENSE.txt for more information.
+//
+////////////////////////////////////////////////////////////////////////
+
+#include "CellBitmap.h"
+#include <algorithm>
+#include <stdexcept>
+#include <emmintrin.h>
+
+namespace
+{
+	constexpr uint32_t WordsPerVector = 4;
+
+	uint32_t GetPaddedWordsPerRow(uint32_t columns)
+	{
+		const uint32_t words = (columns + 31) / 32;
+
+		return (words + (WordsPerVector - 1)) & ~(WordsPerVector - 1);
+	}
+
+	// Returns a mask with the bits from firstBit to lastBit (inclusive) set.
+	uint32_t GetBitRangeMask(uint32_t firstBit, uint32_t lastBit)
+	{
+		const uint32_t high = lastBit == 31 ? 0xFFFFFFFF : (1U << (lastBit + 1)) - 1;
+		const uint32_t low = (1U << firstBit) - 1;
+
+		return high & ~low;
+	}
+
+	template <typename Op>
+	void ApplyBulkOperation(uint32_t* dest, const uint32_t* source, size_t wordCount, Op op)
+	{
+		// The word count is always a multiple of the vector size.
+		for (size_t i = 0; i < wordCount; i += WordsPerVector)
+		{
+			const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(dest + i));
+			const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i));
+
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(dest + i), op(a, b));
+		}
+	}
+}
+
+CellBitmap::CellBitmap(
+	uint32_t rows,
+	uint32_t columns,
+	bool initialValue,
+	std::pmr::memory_resource* memoryResource)
+	: rows(rows),
+	  columns(columns),
+	  wordsPerRow(GetPaddedWordsPerRow(columns)),
+	  data(static_cast<size_t>(rows) * GetPaddedWordsPerRow(columns), 0, memoryResource)
+{
+	if (initialValue)
+	{
+		Fill(true);
+	}
+}
+
+uint32_t CellBitmap::GetRowCount() const
+{
+	return rows;
+}
+
+uint32_t CellBitmap::GetColumnCount() const
+{
+	return columns;
+}
+
+bool CellBitmap::GetValue(uint32_t row, uint32_t column) const
+{
+	return (data[(row * wordsPerRow) + (column / 32)] & (1U << (column & 31))) != 0;
+}
+
+void CellBitmap::SetValue(uint32_t row, uint32_t column, bool value)
+{
+	uint32_t& word = data[(row * wordsPerRow) + (column / 32)];
+
+	if (value)
+	{
+		word |= (1U << (column & 31));
+	}
+	else
+	{
+		word &= ~(1U << (column & 31));
+	}
+}
+
+void CellBitmap::Fill(bool value)
+{
+	std::fill(data.begin(), data.end(), value ? 0xFFFFFFFF : 0);
+
+	if (value)
+	{
+		ClearPaddingBits();
+	}
+}
+
+void CellBitmap::SetRect(int32_t firstRow, int32_t firstColumn, int32_t lastRow, int32_t lastColumn, bool value)
+{
+	if (rows == 0 || columns == 0)
+	{
+		return;
+	}
+
+	const int32_t startRow = std::max(firstRow, 0);
+	const int32_t endRow = std::min(lastRow, static_cast<int32_t>(rows) - 1);
+	const int32_t startColumn = std::max(firstColumn, 0);
+	const int32_t endColumn = std::min(lastColumn, static_cast<int32_t>(columns) - 1);
+
+	if (startRow > endRow || startColumn > endColumn)
+	{
+		return;
+	}
+
+	const uint32_t firstWord = static_cast<uint32_t>(startColumn) / 32;
+	const uint32_t lastWord = static_cast<uint32_t>(endColumn) / 32;
+	const uint32_t firstWordMask = GetBitRangeMask(static_cast<uint32_t>(startColumn) & 31, 31);
+	const uint32_t lastWordMask = GetBitRangeMask(0, static_cast<uint32_t>(endColumn) & 31);
+
+	for (int32_t row = startRow; row <= endRow; row++)
+	{
+		uint32_t* rowData = data.data() + (static_cast<size_t>(row) * wordsPerRow);
+
+		for (uint32_t wordIndex = firstWord; wordIndex <= lastWord; wordIndex++)
+		{
+			uint32_t mask = 0xFFFFFFFF;
+
+			if (wordIndex == firstWord)
+			{
+				mask &= firstWordMask;
+			}
+
+			if (wordIndex == lastWord)
+			{
+				mask &= lastWordMask;
+			}
+
+			if (value)
+			{
+				rowData[wordIndex] |= mask;
+			}
+			else
+			{
+				rowData[wordIndex] &= ~mask;
+			}
+		}
+	}
+}
+
+void CellBitmap::And(const CellBitmap& other)
+{
+	if (!HasSameDimensions(other))
+	{
+		throw std::invalid_argument("The cell bitmaps must have the same dimensions.");
+	}
+
+	ApplyBulkOperation(
+		data.data(),
+		other.data.data(),
+		data.size(),
+		[](__m128i a, __m128i b) { return _mm_and_si128(a, b); });
+}
+
+void CellBitmap::Or(const CellBitmap& other)
+{
+	if (!HasSameDimensions(other))
+	{
+		throw std::invalid_argument("The cell bitmaps must have the same dimensions.");
+	}
+
+	ApplyBulkOperation(
+		data.data(),
+		other.data.data(),
+		data.size(),
+		[](__m128i a, __m128i b) { return _mm_or_si128(a, b); });
+}
+
+void CellBitmap::Xor(const CellBitmap& other)
+{
+	if (!HasSameDimensions(other))
+	{
+		throw std::invalid_argument("The cell bitmaps must have the same dimensions.");
+	}
+
+	ApplyBulkOperation(
+		data.data(),
+		other.data.data(),
+		data.size(),
+		[](__m128i a, __m128i b) { return _mm_xor_si128(a, b); });
+}
+
+void CellBitmap::AndNot(const CellBitmap& other)
+{
+	if (!HasSameDimensions(other))
+	{
+		throw std::invalid_argument("The cell bitmaps must have the same dimensions.");
+	}
+
+	// _mm_andnot_si128 computes (~first & second).
+	ApplyBulkOperation(
+		data.data(),
+		other.data.data(),
+		data.size(),
+		[](__m128i a, __m128i b) { return _mm_andnot_si128(b, a); });
+}
+
+uint32_t CellBitmap::CountSetCells() const
+{
+	uint32_t count = 0;
+
+	for (uint32_t word : data)
+	{
+		count += static_cast<uint32_t>(std::popcount(word));
+	}
+
+	return count;
+}
+
+bool CellBitmap::Any() const
+{
+	const size_t wordCount = data.size();
+	const uint32_t* words = data.data();
+
+	for (size_t i = 0; i < wordCount; i += WordsPerVector)
+	{
+		const __m128i value = _mm_loadu_si128(reinterpret_cast<const __m128i*>(words + i));
+
+		if (_mm_movemask_epi8(_mm_cmpeq_epi32(value, _mm_setzero_si128())) != 0xFFFF)
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+const uint32_t* CellBitmap::GetRowData(uint32_t row) const
+{
+	return data.data() + (static_cast<size_t>(row) * wordsPerRow);
+}
+
+uint32_t CellBitmap::GetWordsPerRow() const
+{
+	return wordsPerRow;
+}
+
+bool CellBitmap::HasSameDimensions(const CellBitmap& other) const
+{
+	return rows == other.rows && columns == other.columns;
+}
+
+void CellBitmap::ClearPaddingBits()
+{
+	const uint32_t usedWords = (columns + 31) / 32;
+	const uint32_t remainingBits = columns & 31;
+
+	for (uint32_t row = 0; row < rows; row++)
+	{
+		uint32_t* rowData = data.data() + (static_cast<size_t>(row) * wordsPerRow);
+
+		if (remainingBits != 0)
+		{
+			rowData[usedWords - 1] &= (1U << remainingBits) - 1;
+		}
+
+		for (uint32_t i = usedWords; i < wordsPerRow; i++)
+		{
+			rowData[i] = 0;
+		}
+	}
+}
@@ -0,0 +1,93 @@
+////////////////////////////////////////////////////////////////////////
+//
+// This file is part of sc4-data-view-extensions, a DLL Plugin for
+// SimCity 4 that extends the game's data views.
+//
+// Copyright (c) 2024 Nicholas Hayes
+//
+// This file is licensed under terms of the MIT License.
+// See LICENSE.txt for more information.
+//
+////////////////////////////////////////////////////////////////////////
+
+#pragma once
+#include <bit>
+#include <cstdint>
+#include <memory_resource>
+#include <vector>
+
+// A cell bitmap with the same API as cRZCellMap that stores all of its rows in a
+// single allocation.
+// Each row is padded to a multiple of 128 bits so that the bulk operations can
+// process the whole map with SSE2, the padding bits are always zero.
+class CellBitmap
+{
+public:
+	CellBitmap(
+		uint32_t rows,
+		uint32_t columns,
+		bool initialValue,
+		std::pmr::memory_resource* memoryResource = std::pmr::get_default_resource());
+
+	uint32_t GetRowCount() const;
+	uint32_t GetColumnCount() const;
+
+	bool GetValue(uint32_t row, uint32_t column) const;
+	void SetValue(uint32_t row, uint32_t column, bool value);
+
+	void Fill(bool value);
+
+	// Sets the cells in the inclusive rectangle to the specified value.
+	// The rectangle is clipped to the map bounds.
+	void SetRect(int32_t firstRow, int32_t firstColumn, int32_t lastRow, int32_t lastColumn, bool value);
+
+	// The bulk operations require both maps to have the same dimensions.
+	void And(const CellBitmap& other);
+	void Or(const CellBitmap& other);
+	void Xor(const CellBitmap& other);
+	// Clears the cells that are set in the other map.
+	void AndNot(const CellBitmap& other);
+
+	uint32_t CountSetCells() const;
+	bool Any() const;
+
+	// Calls func(row, column) for each set cell in row-major order.
+	template<typename Func>
+	void ForEachSetCell(Func&& func) const
+	{
+		const uint32_t* rowData = data.data();
+
+		for (uint32_t row = 0; row < rows; row++)
+		{
+			for (uint32_t wordIndex = 0; wordIndex < wordsPerRow; wordIndex++)
+			{
+				uint32_t word = rowData[wordIndex];
+
+				while (word != 0)
+				{
+					const uint32_t column = (wordIndex * 32) + static_cast<uint32_t>(std::countr_zero(word));
+
+					func(row, column);
+
+					// Clear the lowest set bit.
+					word &= word - 1;
+				}
+			}
+
+			rowData += wordsPerRow;
+		}
+	}
+
+	const uint32_t* GetRowData(uint32_t row) const;
+	uint32_t GetWordsPerRow() const;
+
+private:
+
+	bool HasSameDimensions(const CellBitmap& other) const;
+	void ClearPaddingBits();
+
+	uint32_t rows;
+	uint32_t columns;
+	uint32_t wordsPerRow;
+	std::pmr::vector<uint32_t> data;
+};
@@ -0,0 +1,94 @@
+////////////////////////////////////////////////////////////////////////
+//
+// This file is part of sc4-data-view-extensions, a DLL Plugin for
+// SimCity 4 that extends the game's data views.
+//
+// Copyright (c) 2024 Nicholas Hayes
+//
+// This file is licensed under terms of the MIT License.
+// See LICENSE.txt for more information.
+//
+////////////////////////////////////////////////////////////////////////
+
+#include "ColorizedTileCache.h"
+#include <algorithm>
+#include <initializer_list>
+#include <iterator>
+
+ColorizedTileCache::ColorizedTileCache(size_t capacity)
+	: capacity(std::max<size_t>(capacity, 1)),
+	  entries(),
+	  index()
+{
+}
+
+const ColorizedTile* ColorizedTileCache::Find(const ColorizedTileKey& key, uint64_t stamp)
+{
+	auto item = index.find(key);
+
+	if (item == index.end() || item->second->stamp != stamp)
+	{
+		return nullptr;
+	}
+
+	entries.splice(entries.begin(), entries, item->second);
+
+	return &item->second->tile;
+}
+
+ColorizedTile& ColorizedTileCache::Insert(const ColorizedTileKey& key, uint64_t stamp)
+{
+	auto item = index.find(key);
+
+	if (item != index.end())
+	{
+		// Reuse the stale tile and its pixel buffer.
+		entries.splice(entries.begin(), entries, item->second);
+	}
+	else
+	{
+		if (entries.size() >= capacity)
+		{
+			// Recycle the least recently used entry.
+			index.erase(entries.back().key);
+			entries.splice(entries.begin(), entries, std::prev(entries.end()));
+		}
+		else
+		{
+			entries.emplace_front();
+		}
+
+		entries.front().key = key;
+		index.emplace(key, entries.begin());
+	}
+
+	Entry& entry = entries.front();
+	entry.stamp = stamp;
+
+	return entry.tile;
+}
+
+void ColorizedTileCache::Clear()
+{
+	index.clear();
+	entries.clear();
+}
+
+size_t ColorizedTileCache::GetSize() const
+{
+	return entries.size();
+}
+
+size_t ColorizedTileCache::KeyHash::operator()(const ColorizedTileKey& key) const
+{
+	// FNV-1a over the key fields.
+	uint64_t hash = 14695981039346656037ULL;
+
+	for (const uint32_t value : { key.dataSource, key.level, key.tileX, key.tileZ })
+	{
+		hash ^= value;
+		hash *= 1099511628211ULL;
+	}
+
+	return static_cast<size_t>(hash);
+}
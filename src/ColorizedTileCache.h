@@ -0,0 +1,77 @@
+////////////////////////////////////////////////////////////////////////
+//
+// This file is part of sc4-data-view-extensions, a DLL Plugin for
+// SimCity 4 that extends the game's data views.
+//
+// Copyright (c) 2024 Nicholas Hayes
+//
+// This file is licensed under terms of the MIT License.
+// See LICENSE.txt for more information.
+//
+////////////////////////////////////////////////////////////////////////
+
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <unordered_map>
+#include <vector>
+
+struct ColorizedTileKey
+{
+	// The caller-defined ID of the grid and color mapping that the tile uses.
+	uint32_t dataSource;
+	uint32_t level;
+	uint32_t tileX;
+	uint32_t tileZ;
+
+	bool operator==(const ColorizedTileKey& other) const = default;
+};
+
+struct ColorizedTile
+{
+	uint32_t width;
+	uint32_t height;
+	// The colors are stored in row-major order.
+	std::vector<uint32_t> pixels;
+};
+
+// A least recently used cache of colorized grid tiles.
+// Each tile stores the stamp of the data it was built from, a tile with an
+// older stamp is treated as a cache miss.
+class ColorizedTileCache
+{
+public:
+	ColorizedTileCache(size_t capacity);
+
+	// Returns nullptr if the tile is not cached or its stamp does not match.
+	const ColorizedTile* Find(const ColorizedTileKey& key, uint64_t stamp);
+
+	// Returns the tile that the caller fills in, this evicts the least recently
+	// used tile when the cache is full.
+	ColorizedTile& Insert(const ColorizedTileKey& key, uint64_t stamp);
+
+	void Clear();
+
+	size_t GetSize() const;
+
+private:
+	struct KeyHash
+	{
+		size_t operator()(const ColorizedTileKey& key) const;
+	};
+
+	struct Entry
+	{
+		ColorizedTileKey key;
+		uint64_t stamp;
+		ColorizedTile tile;
+	};
+
+	typedef std::list<Entry> EntryList;
+
+	size_t capacity;
+	// The most recently used tile is at the front of the list.
+	EntryList entries;
+	std::unordered_map<ColorizedTileKey, EntryList::iterator, KeyHash> index;
+};
@@ -0,0 +1,460 @@
+////////////////////////////////////////////////////////////////////////
+//
+// This file is part of sc4-data-view-extensions, a DLL Plugin for
+// SimCity 4 that extends the game's data views.
+//
+// Copyright (c) 2024 Nicholas Hayes
+//
+// This file is licensed under terms of the MIT License.
+// See LICENSE.txt for more information.
+//
+////////////////////////////////////////////////////////////////////////
+
+#include "ConnectedComponentLabeler.h"
+#include "GlobalPointers.h"
+#include "ThreadPool.h"
+#include <algorithm>
+
+ConnectedComponentLabeler::ConnectedComponentLabeler(int32_t threshold)
+	: threshold(threshold),
+	  width(0),
+	  height(0),
+	  tileCountX(0),
+	  tileCountZ(0)
+{
+}
+
+int32_t ConnectedComponentLabeler::GetThreshold() const
+{
+	return threshold;
+}
+
+void ConnectedComponentLabeler::SetThreshold(int32_t threshold)
+{
+	if (this->threshold != threshold)
+	{
+		this->threshold = threshold;
+
+		for (Tile& tile : tiles)
+		{
+			tile.dirty = true;
+		}
+	}
+}
+
+void ConnectedComponentLabeler::Clear()
+{
+	width = 0;
+	height = 0;
+	tileCountX = 0;
+	tileCountZ = 0;
+	values = std::vector<int16_t>();
+	tiles = std::vector<Tile>();
+	tileFirstRun = std::vector<uint32_t>();
+	parents = std::vector<uint32_t>();
+	runLabels = std::vector<uint32_t>();
+	labels = std::vector<uint32_t>();
+	regions = std::vector<Region>();
+}
+
+uint32_t ConnectedComponentLabeler::GetWidth() const
+{
+	return width;
+}
+
+uint32_t ConnectedComponentLabeler::GetHeight() const
+{
+	return height;
+}
+
+bool ConnectedComponentLabeler::Update(const GridSnapshot& snapshot)
+{
+	BeginUpdate(snapshot.width, snapshot.height);
+
+	for (uint32_t z = 0; z < snapshot.height; z++)
+	{
+		UpdateRow(z, snapshot.GetRow(z));
+	}
+
+	return EndUpdate();
+}
+
+const std::vector<uint32_t>& ConnectedComponentLabeler::GetLabels() const
+{
+	return labels;
+}
+
+const std::vector<ConnectedComponentLabeler::Region>& ConnectedComponentLabeler::GetRegions() const
+{
+	return regions;
+}
+
+void ConnectedComponentLabeler::BeginUpdate(uint32_t width, uint32_t height)
+{
+	if (this->width != width || this->height != height)
+	{
+		this->width = width;
+		this->height = height;
+		tileCountX = (width + TileSize - 1) / TileSize;
+		tileCountZ = (height + TileSize - 1) / TileSize;
+
+		values.assign(static_cast<size_t>(width) * height, 0);
+		labels.assign(static_cast<size_t>(width) * height, 0);
+		tiles.clear();
+		tiles.resize(static_cast<size_t>(tileCountX) * tileCountZ);
+
+		for (Tile& tile : tiles)
+		{
+			tile.dirty = true;
+		}
+	}
+}
+
+void ConnectedComponentLabeler::UpdateRow(uint32_t row, const int16_t* rowValues)
+{
+	int16_t* labeledValues = values.data() + static_cast<size_t>(row) * width;
+	Tile* rowTiles = tiles.data() + static_cast<size_t>(row / TileSize) * tileCountX;
+
+	// Each tile only covers part of the row, so the row is compared one tile at a time.
+	for (uint32_t tileX = 0; tileX < tileCountX; tileX++)
+	{
+		const uint32_t start = tileX * TileSize;
+		const uint32_t end = std::min(start + TileSize, width);
+
+		if (!std::equal(rowValues + start, rowValues + end, labeledValues + start))
+		{
+			std::copy(rowValues + start, rowValues + end, labeledValues + start);
+			rowTiles[tileX].dirty = true;
+		}
+	}
+}
+
+bool ConnectedComponentLabeler::EndUpdate()
+{
+	const uint32_t tileCount = static_cast<uint32_t>(tiles.size());
+
+	if (std::none_of(tiles.begin(), tiles.end(), [](const Tile& tile) { return tile.dirty; }))
+	{
+		return false;
+	}
+
+	// Pass 1: The runs of the changed tiles are rebuilt, each tile is independent.
+
+	spThreadPool->ParallelFor(
+		tileCount,
+		[this](uint32_t tileIndex)
+		{
+			if (tiles[tileIndex].dirty)
+			{
+				ScanTile(tileIndex);
+			}
+		});
+
+	tileFirstRun.resize(tileCount);
+	uint32_t runCount = 0;
+
+	for (uint32_t i = 0; i < tileCount; i++)
+	{
+		tileFirstRun[i] = runCount;
+		runCount += static_cast<uint32_t>(tiles[i].runs.size());
+		tiles[i].dirty = false;
+	}
+
+	parents.resize(runCount);
+
+	for (uint32_t i = 0; i < runCount; i++)
+	{
+		parents[i] = i;
+	}
+
+	// The runs of each tile occupy their own range of the parent array,
+	// so the tiles can be joined in parallel before the tile edges are merged.
+
+	spThreadPool->ParallelFor(
+		tileCount,
+		[this](uint32_t tileIndex)
+		{
+			UnionTile(tileIndex);
+		});
+
+	for (uint32_t i = 0; i < tileCount; i++)
+	{
+		if (i % tileCountX != 0)
+		{
+			UnionLeftEdge(i);
+		}
+
+		if (i >= tileCountX)
+		{
+			UnionTopEdge(i);
+		}
+	}
+
+	// Pass 2: The region statistics are accumulated in run order, so the region
+	// labels follow the tile order of each region's first run.
+
+	runLabels.resize(runCount);
+	regions.clear();
+
+	std::vector<int64_t> sums;
+	std::vector<double> sumX;
+	std::vector<double> sumZ;
+
+	for (uint32_t tileIndex = 0; tileIndex < tileCount; tileIndex++)
+	{
+		const std::vector<Run>& runs = tiles[tileIndex].runs;
+		const uint32_t firstRun = tileFirstRun[tileIndex];
+
+		for (uint32_t i = 0; i < runs.size(); i++)
+		{
+			const Run& run = runs[i];
+			const uint32_t runIndex = firstRun + i;
+			const uint32_t root = FindRoot(runIndex);
+
+			uint32_t label = 0;
+
+			if (root == runIndex)
+			{
+				regions.push_back(Region{ 0, SC4Rect<long>(run.start, run.row, run.end - 1, run.row), 0.0f, 0.0f, 0.0f });
+				sums.push_back(0);
+				sumX.push_back(0.0);
+				sumZ.push_back(0.0);
+
+				label = static_cast<uint32_t>(regions.size());
+			}
+			else
+			{
+				// The root always precedes the other runs of the region.
+				label = runLabels[root];
+			}
+
+			runLabels[runIndex] = label;
+
+			const uint32_t regionIndex = label - 1;
+			const uint32_t length = run.end - run.start;
+
+			// A region's first run is not always in its top row when the
+			// region spans several tiles.
+			Region& region = regions[regionIndex];
+			region.area += length;
+			region.bounds.topLeftX = std::min(region.bounds.topLeftX, static_cast<long>(run.start));
+			region.bounds.topLeftY = std::min(region.bounds.topLeftY, static_cast<long>(run.row));
+			region.bounds.bottomRightX = std::max(region.bounds.bottomRightX, static_cast<long>(run.end) - 1);
+			region.bounds.bottomRightY = std::max(region.bounds.bottomRightY, static_cast<long>(run.row));
+
+			sums[regionIndex] += run.sum;
+			sumX[regionIndex] += (static_cast<double>(run.start) + static_cast<double>(run.end - 1)) * 0.5 * length;
+			sumZ[regionIndex] += static_cast<double>(run.row) * length;
+		}
+	}
+
+	for (size_t i = 0; i < regions.size(); i++)
+	{
+		Region& region = regions[i];
+
+		region.centroidX = static_cast<float>(sumX[i] / region.area);
+		region.centroidZ = static_cast<float>(sumZ[i] / region.area);
+		region.mean = static_cast<float>(static_cast<double>(sums[i]) / region.area);
+	}
+
+	spThreadPool->ParallelFor(
+		tileCount,
+		[this](uint32_t tileIndex)
+		{
+			WriteTileLabels(tileIndex);
+		});
+
+	return true;
+}
+
+SC4Rect<long> ConnectedComponentLabeler::GetTileBounds(uint32_t tileIndex) const
+{
+	// The bounds use an exclusive right and bottom edge.
+	const uint32_t left = (tileIndex % tileCountX) * TileSize;
+	const uint32_t top = (tileIndex / tileCountX) * TileSize;
+
+	return SC4Rect<long>(
+		static_cast<long>(left),
+		static_cast<long>(top),
+		static_cast<long>(std::min(left + TileSize, width)),
+		static_cast<long>(std::min(top + TileSize, height)));
+}
+
+void ConnectedComponentLabeler::ScanTile(uint32_t tileIndex)
+{
+	Tile& tile = tiles[tileIndex];
+	tile.runs.clear();
+	tile.rowOffsets.clear();
+
+	const SC4Rect<long> bounds = GetTileBounds(tileIndex);
+	const uint32_t left = static_cast<uint32_t>(bounds.topLeftX);
+	const uint32_t right = static_cast<uint32_t>(bounds.bottomRightX);
+
+	for (uint32_t row = static_cast<uint32_t>(bounds.topLeftY); row < static_cast<uint32_t>(bounds.bottomRightY); row++)
+	{
+		tile.rowOffsets.push_back(static_cast<uint32_t>(tile.runs.size()));
+
+		const int16_t* rowValues = values.data() + static_cast<size_t>(row) * width;
+		uint32_t x = left;
+
+		while (x < right)
+		{
+			if (rowValues[x] < threshold)
+			{
+				x++;
+				continue;
+			}
+
+			Run run{ row, x, x, 0 };
+
+			while (x < right && rowValues[x] >= threshold)
+			{
+				run.sum += rowValues[x];
+				x++;
+			}
+
+			run.end = x;
+			tile.runs.push_back(run);
+		}
+	}
+
+	tile.rowOffsets.push_back(static_cast<uint32_t>(tile.runs.size()));
+}
+
+void ConnectedComponentLabeler::UnionTile(uint32_t tileIndex)
+{
+	const Tile& tile = tiles[tileIndex];
+	const uint32_t firstRun = tileFirstRun[tileIndex];
+	const size_t rowCount = tile.rowOffsets.size() - 1;
+
+	for (size_t row = 1; row < rowCount; row++)
+	{
+		uint32_t above = tile.rowOffsets[row - 1];
+		const uint32_t aboveEnd = tile.rowOffsets[row];
+
+		for (uint32_t current = tile.rowOffsets[row]; current < tile.rowOffsets[row + 1]; current++)
+		{
+			const Run& run = tile.runs[current];
+
+			// Both rows are sorted by column, so the overlapping runs are found
+			// by advancing through the row above.
+
+			while (above < aboveEnd && tile.runs[above].end <= run.start)
+			{
+				above++;
+			}
+
+			for (uint32_t i = above; i < aboveEnd && tile.runs[i].start < run.end; i++)
+			{
+				Union(firstRun + i, firstRun + current);
+			}
+		}
+	}
+}
+
+void ConnectedComponentLabeler::UnionLeftEdge(uint32_t tileIndex)
+{
+	// A run that reaches the tile's left edge continues the last run of the
+	// same row in the left tile if that run reaches the shared edge.
+
+	const Tile& leftTile = tiles[tileIndex - 1];
+	const Tile& tile = tiles[tileIndex];
+
+	const uint32_t edge = static_cast<uint32_t>(GetTileBounds(tileIndex).topLeftX);
+	const uint32_t leftFirstRun = tileFirstRun[tileIndex - 1];
+	const uint32_t firstRun = tileFirstRun[tileIndex];
+	const size_t rowCount = tile.rowOffsets.size() - 1;
+
+	for (size_t row = 0; row < rowCount; row++)
+	{
+		const uint32_t current = tile.rowOffsets[row];
+		const uint32_t leftEnd = leftTile.rowOffsets[row + 1];
+
+		if (current < tile.rowOffsets[row + 1]
+			&& tile.runs[current].start == edge
+			&& leftEnd > leftTile.rowOffsets[row]
+			&& leftTile.runs[leftEnd - 1].end == edge)
+		{
+			Union(leftFirstRun + leftEnd - 1, firstRun + current);
+		}
+	}
+}
+
+void ConnectedComponentLabeler::UnionTopEdge(uint32_t tileIndex)
+{
+	const Tile& upperTile = tiles[tileIndex - tileCountX];
+	const Tile& tile = tiles[tileIndex];
+
+	const size_t upperRowCount = upperTile.rowOffsets.size() - 1;
+
+	uint32_t above = upperTile.rowOffsets[upperRowCount - 1];
+	const uint32_t aboveEnd = upperTile.rowOffsets[upperRowCount];
+
+	const uint32_t upperFirstRun = tileFirstRun[tileIndex - tileCountX];
+	const uint32_t firstRun = tileFirstRun[tileIndex];
+
+	for (uint32_t current = tile.rowOffsets[0]; current < tile.rowOffsets[1]; current++)
+	{
+		const Run& run = tile.runs[current];
+
+		while (above < aboveEnd && upperTile.runs[above].end <= run.start)
+		{
+			above++;
+		}
+
+		for (uint32_t i = above; i < aboveEnd && upperTile.runs[i].start < run.end; i++)
+		{
+			Union(upperFirstRun + i, firstRun + current);
+		}
+	}
+}
+
+void ConnectedComponentLabeler::WriteTileLabels(uint32_t tileIndex)
+{
+	const Tile& tile = tiles[tileIndex];
+	const SC4Rect<long> bounds = GetTileBounds(tileIndex);
+	const uint32_t firstRun = tileFirstRun[tileIndex];
+
+	for (long row = bounds.topLeftY; row < bounds.bottomRightY; row++)
+	{
+		uint32_t* rowLabels = labels.data() + static_cast<size_t>(row) * width;
+
+		std::fill(rowLabels + bounds.topLeftX, rowLabels + bounds.bottomRightX, 0);
+	}
+
+	for (uint32_t i = 0; i < tile.runs.size(); i++)
+	{
+		const Run& run = tile.runs[i];
+		uint32_t* rowLabels = labels.data() + static_cast<size_t>(run.row) * width;
+
+		std::fill(rowLabels + run.start, rowLabels + run.end, runLabels[firstRun + i]);
+	}
+}
+
+uint32_t ConnectedComponentLabeler::FindRoot(uint32_t run)
+{
+	while (parents[run] != run)
+	{
+		// Path halving.
+		parents[run] = parents[parents[run]];
+		run = parents[run];
+	}
+
+	return run;
+}
+
+void ConnectedComponentLabeler::Union(uint32_t a, uint32_t b)
+{
+	const uint32_t rootA = FindRoot(a);
+	const uint32_t rootB = FindRoot(b);
+
+	// The lower index becomes the root, so that each region's root is its first run.
+	if (rootA < rootB)
+	{
+		parents[rootB] = rootA;
+	}
+	else if (rootB < rootA)
+	{
+		parents[rootA] = rootB;
+	}
+}
@@ -0,0 +1,105 @@
+////////////////////////////////////////////////////////////////////////
+//
+// This file is part of sc4-data-view-extensions, a DLL Plugin for
+// SimCity 4 that extends the game's data views.
+//
+// Copyright (c) 2024 Nicholas Hayes
+//
+// This file is licensed under terms of the MIT License.
+// See LICENSE.txt for more information.
+//
+////////////////////////////////////////////////////////////////////////
+
+#pragma once
+#include "GridSnapshot.h"
+#include "SC4Rect.h"
+#include <cstdint>
+#include <vector>
+
+// Groups the 4-connected grid tracts whose value is at or above a threshold
+// into labeled regions, and computes the area, bounds, centroid and mean value
+// of each region.
+// The labeler keeps a copy of the values it last labeled, the grid is split into
+// square tiles and only the tiles whose values changed since the last update are rescanned.
+class ConnectedComponentLabeler
+{
+public:
+	// The width and height of a tile, in grid tracts.
+	static constexpr uint32_t TileSize = 32;
+
+	struct Region
+	{
+		uint32_t area;
+		// The inclusive tract bounds, X is the column and Y is the row.
+		SC4Rect<long> bounds;
+		float centroidX;
+		float centroidZ;
+		float mean;
+	};
+
+	ConnectedComponentLabeler(int32_t threshold);
+
+	int32_t GetThreshold() const;
+	void SetThreshold(int32_t threshold);
+
+	// Updates the labels from the snapshot values.
+	// Returns true if the labels changed.
+	bool Update(const GridSnapshot& snapshot);
+
+	void Clear();
+
+	uint32_t GetWidth() const;
+	uint32_t GetHeight() const;
+
+	// The labels are stored in row-major order, 0 is used for the tracts that
+	// are below the threshold and region N uses label N + 1.
+	const std::vector<uint32_t>& GetLabels() const;
+	const std::vector<Region>& GetRegions() const;
+
+private:
+	// A run never crosses a tile edge, the runs of the neighboring tiles are joined
+	// when the tiles are merged.
+	struct Run
+	{
+		uint32_t row;
+		uint32_t start;
+		// The end column is exclusive.
+		uint32_t end;
+		int64_t sum;
+	};
+
+	struct Tile
+	{
+		std::vector<Run> runs;
+		// The index of the first run in each row of the tile, with an extra
+		// item that holds the total run count.
+		std::vector<uint32_t> rowOffsets;
+		bool dirty;
+	};
+
+	void BeginUpdate(uint32_t width, uint32_t height);
+	void UpdateRow(uint32_t row, const int16_t* rowValues);
+	bool EndUpdate();
+
+	SC4Rect<long> GetTileBounds(uint32_t tileIndex) const;
+	void ScanTile(uint32_t tileIndex);
+	void UnionTile(uint32_t tileIndex);
+	void UnionLeftEdge(uint32_t tileIndex);
+	void UnionTopEdge(uint32_t tileIndex);
+	void WriteTileLabels(uint32_t tileIndex);
+	uint32_t FindRoot(uint32_t run);
+	void Union(uint32_t a, uint32_t b);
+
+	int32_t threshold;
+	uint32_t width;
+	uint32_t height;
+	std::vector<int16_t> values;
+	uint32_t tileCountX;
+	uint32_t tileCountZ;
+	std::vector<Tile> tiles;
+	std::vector<uint32_t> tileFirstRun;
+	std::vector<uint32_t> parents;
+	std::vector<uint32_t> runLabels;
+	std::vector<uint32_t> labels;
+	std::vector<Region> regions;
+};
@@ -0,0 +1,241 @@
+////////////////////////////////////////////////////////////////////////
+//
+// This file is part of sc4-data-view-extensions, a DLL Plugin for
+// SimCity 4 that extends the game's data views.
+//
+// Copyright (c) 2024 Nicholas Hayes
+//
+// This file is licensed under terms of the MIT License.
+// See LICENSE.txt for more information.
+//
+////////////////////////////////////////////////////////////////////////
+
+#include "CoverageIndexRecord.h"
+#include "BinaryStream.h"
+#include "cGZPersistResourceKey.h"
+#include "cIGZPersistDBSegment.h"
+#include "cISC4City.h"
+#include "cISC4OccupantManager.h"
+#include "cISC4Simulator.h"
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+namespace
+{
+	// The record key uses the DLL director ID as its group ID.
+	const cGZPersistResourceKey kCoverageIndexRecordKey(0x4C1E5A27, 0xEFB723C6, 0x00000001);
+
+	constexpr uint32_t kSignature = 0x49585644; // DVXI
+	// Version 2 added the header fields to the checksum.
+	constexpr uint16_t kFormatVersion = 2;
+	constexpr size_t kHeaderSize = 36;
+	// The checksum is the last header field.
+	constexpr size_t kChecksumOffset = kHeaderSize - sizeof(uint32_t);
+	constexpr size_t kFootprintSize = 8;
+
+	// FNV-1a
+	uint32_t ComputeChecksum(const uint8_t* data, size_t size, uint32_t hash)
+	{
+		for (size_t i = 0; i < size; i++)
+		{
+			hash ^= data[i];
+			hash *= 0x01000193;
+		}
+
+		return hash;
+	}
+
+	// The checksum covers the whole record except for the checksum field.
+	uint32_t ComputeRecordChecksum(const uint8_t* data, size_t size)
+	{
+		const uint32_t headerHash = ComputeChecksum(data, kChecksumOffset, 0x811C9DC5);
+
+		return ComputeChecksum(data + kHeaderSize, size - kHeaderSize, headerHash);
+	}
+
+	// A footprint that extends past the city edge is clamped, a negative
+	// coordinate would otherwise wrap around to the far side of the city.
+	uint16_t ToCellCoordinate(long value)
+	{
+		return static_cast<uint16_t>(std::clamp<long>(value, 0, 0xFFFF));
+	}
+}
+
+bool CoverageIndexRecord::GetCityStamp(cISC4City* pCity, CoverageIndexStamp& stamp)
+{
+	if (!pCity)
+	{
+		return false;
+	}
+
+	cISC4Simulator* pSimulator = pCity->GetSimulator();
+	cISC4OccupantManager* pOccupantManager = pCity->GetOccupantManager();
+
+	int cellCountX = 0;
+	int cellCountZ = 0;
+
+	if (!pSimulator
+		|| !pOccupantManager
+		|| !pOccupantManager->GetWorldCellCount(cellCountX, cellCountZ))
+	{
+		return false;
+	}
+
+	stamp.birthDate = pCity->GetBirthDate();
+	stamp.simDateNumber = pSimulator->GetSimDateNumber();
+	stamp.cellCountX = static_cast<uint32_t>(cellCountX);
+	stamp.cellCountZ = static_cast<uint32_t>(cellCountZ);
+
+	return true;
+}
+
+void CoverageIndexRecord::Serialize(const CoverageIndex& index, std::vector<uint8_t>& output)
+{
+	output.clear();
+
+	size_t footprintCount = 0;
+
+	for (const auto& layer : index.footprints)
+	{
+		footprintCount += layer.size();
+	}
+
+	output.reserve(kHeaderSize + footprintCount * kFootprintSize);
+
+	BinaryWriter writer(output);
+
+	writer.Write(kSignature);
+	writer.Write(kFormatVersion);
+	writer.Write(static_cast<uint16_t>(CoverageIndex::LayerCount));
+	writer.Write(index.stamp.birthDate);
+	writer.Write(index.stamp.simDateNumber);
+	writer.Write(index.stamp.cellCountX);
+	writer.Write(index.stamp.cellCountZ);
+
+	for (const auto& layer : index.footprints)
+	{
+		writer.Write(static_cast<uint32_t>(layer.size()));
+	}
+
+	// The checksum is written after the data, and then moved into the header.
+	writer.Write(uint32_t(0));
+
+	// The city cell coordinates fit in 16 bits, the largest city is 256 cells wide.
+	for (const auto& layer : index.footprints)
+	{
+		for (const SC4Rect<long>& footprint : layer)
+		{
+			writer.Write(ToCellCoordinate(footprint.topLeftX));
+			writer.Write(ToCellCoordinate(footprint.topLeftY));
+			writer.Write(ToCellCoordinate(footprint.bottomRightX));
+			writer.Write(ToCellCoordinate(footprint.bottomRightY));
+		}
+	}
+
+	const uint32_t checksum = ComputeRecordChecksum(output.data(), output.size());
+	std::memcpy(output.data() + kChecksumOffset, &checksum, sizeof(checksum));
+}
+
+bool CoverageIndexRecord::Deserialize(const uint8_t* data, size_t size, CoverageIndex& index)
+{
+	BinaryReader reader(data, size);
+
+	uint32_t signature = 0;
+	uint16_t formatVersion = 0;
+	uint16_t layerCount = 0;
+
+	if (!reader.Read(signature)
+		|| signature != kSignature
+		|| !reader.Read(formatVersion)
+		|| formatVersion != kFormatVersion
+		|| !reader.Read(layerCount)
+		|| layerCount != CoverageIndex::LayerCount)
+	{
+		return false;
+	}
+
+	std::array<uint32_t, CoverageIndex::LayerCount> footprintCounts{};
+	uint32_t checksum = 0;
+
+	if (!reader.Read(index.stamp.birthDate)
+		|| !reader.Read(index.stamp.simDateNumber)
+		|| !reader.Read(index.stamp.cellCountX)
+		|| !reader.Read(index.stamp.cellCountZ)
+		|| !reader.Read(footprintCounts[0])
+		|| !reader.Read(footprintCounts[1])
+		|| !reader.Read(checksum))
+	{
+		return false;
+	}
+
+	uint64_t expectedSize = kHeaderSize;
+
+	for (uint32_t count : footprintCounts)
+	{
+		expectedSize += static_cast<uint64_t>(count) * kFootprintSize;
+	}
+
+	if (reader.GetPosition() != kHeaderSize
+		|| expectedSize != size
+		|| ComputeRecordChecksum(data, size) != checksum)
+	{
+		return false;
+	}
+
+	for (size_t layerIndex = 0; layerIndex < CoverageIndex::LayerCount; layerIndex++)
+	{
+		std::vector<SC4Rect<long>>& layer = index.footprints[layerIndex];
+		layer.clear();
+		layer.reserve(footprintCounts[layerIndex]);
+
+		for (uint32_t i = 0; i < footprintCounts[layerIndex]; i++)
+		{
+			uint16_t left = 0;
+			uint16_t top = 0;
+			uint16_t right = 0;
+			uint16_t bottom = 0;
+
+			reader.Read(left);
+			reader.Read(top);
+			reader.Read(right);
+			reader.Read(bottom);
+
+			layer.emplace_back(left, top, right, bottom);
+		}
+	}
+
+	return true;
+}
+
+bool CoverageIndexRecord::Write(cIGZPersistDBSegment* pSegment, const CoverageIndex& index)
+{
+	std::vector<uint8_t> data;
+	Serialize(index, data);
+
+	return pSegment->WriteRecord(kCoverageIndexRecordKey, data.data(), static_cast<uint32_t>(data.size()));
+}
+
+bool CoverageIndexRecord::Read(cIGZPersistDBSegment* pSegment, CoverageIndex& index)
+{
+	if (!pSegment->TestForRecord(kCoverageIndexRecordKey))
+	{
+		return false;
+	}
+
+	uint32_t size = pSegment->GetRecordSize(kCoverageIndexRecordKey);
+
+	if (size < kHeaderSize)
+	{
+		return false;
+	}
+
+	std::vector<uint8_t> data(size);
+
+	if (pSegment->ReadRecord(kCoverageIndexRecordKey, data.data(), size) == 0)
+	{
+		return false;
+	}
+
+	return Deserialize(data.data(), size, index);
+}
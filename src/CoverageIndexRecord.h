@@ -0,0 +1,64 @@
+////////////////////////////////////////////////////////////////////////
+//
+// This file is part of sc4-data-view-extensions, a DLL Plugin for
+// SimCity 4 that extends the game's data views.
+//
+// Copyright (c) 2024 Nicholas Hayes
+//
+// This file is licensed under terms of the MIT License.
+// See LICENSE.txt for more information.
+//
+////////////////////////////////////////////////////////////////////////
+
+#pragma once
+#include "SC4Rect.h"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class cIGZPersistDBSegment;
+class cISC4City;
+
+// Identifies the city state that an index was saved from.
+struct CoverageIndexStamp
+{
+	uint32_t birthDate;
+	int32_t simDateNumber;
+	uint32_t cellCountX;
+	uint32_t cellCountZ;
+
+	bool operator==(const CoverageIndexStamp& other) const = default;
+};
+
+// The park and landmark footprints that are saved with the city, so that
+// the coverage maps can be built after a load without an occupant scan.
+struct CoverageIndex
+{
+	enum Layer : uint32_t
+	{
+		ParkLayer = 0,
+		LandmarkLayer,
+		LayerCount
+	};
+
+	CoverageIndexStamp stamp;
+	std::array<std::vector<SC4Rect<long>>, LayerCount> footprints;
+};
+
+namespace CoverageIndexRecord
+{
+	bool GetCityStamp(cISC4City* pCity, CoverageIndexStamp& stamp);
+
+	// Writes the index to a compact binary record.
+	// The format is a header (signature, format version, stamp, footprint counts
+	// and a checksum of the other header fields and the data that follows) and a
+	// list of 16-bit cell rectangles.
+	void Serialize(const CoverageIndex& index, std::vector<uint8_t>& output);
+
+	// Returns false if the data is not a valid index record.
+	bool Deserialize(const uint8_t* data, size_t size, CoverageIndex& index);
+
+	bool Write(cIGZPersistDBSegment* pSegment, const CoverageIndex& index);
+	bool Read(cIGZPersistDBSegment* pSegment, CoverageIndex& index);
+}
@@ -0,0 +1,392 @@
+////////////////////////////////////////////////////////////////////////
+//
+// This file is part of sc4-data-view-extensions, a DLL Plugin for
+// SimCity 4 that extends the game's data views.
+//
+// Copyright (c) 2024 Nicholas Hayes
+//
+// This file is licensed under terms of the MIT License.
+// See LICENSE.txt for more information.
+//
+////////////////////////////////////////////////////////////////////////
+
+#include "CoverageManager.h"
+#include "cISC4City.h"
+#include "cISC4Occupant.h"
+#include "cISC4OccupantManager.h"
+#include "GlobalPointers.h"
+#include "LandmarkEffectFilter.h"
+#include "MemoryArena.h"
+#include "OccupantEventBus.h"
+#include "OccupantTypes.h"
+#include "ParkEffectFilter.h"
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+	uint64_t PackCoordinate(long value)
+	{
+		// The coordinates are clamped to the range of the saved index, a footprint
+		// that extends past the city edge would otherwise wrap around.
+		return static_cast<uint64_t>(std::clamp<long>(value, 0, 0xFFFF));
+	}
+
+	uint64_t PackFootprint(const SC4Rect<long>& cells)
+	{
+		return (PackCoordinate(cells.topLeftX) << 48)
+			 | (PackCoordinate(cells.topLeftY) << 32)
+			 | (PackCoordinate(cells.bottomRightX) << 16)
+			 | PackCoordinate(cells.bottomRightY);
+	}
+
+	SC4Rect<long> UnpackFootprint(uint64_t value)
+	{
+		return SC4Rect<long>(
+			static_cast<long>((value >> 48) & 0xFFFF),
+			static_cast<long>((value >> 32) & 0xFFFF),
+			static_cast<long>((value >> 16) & 0xFFFF),
+			static_cast<long>(value & 0xFFFF));
+	}
+}
+
+CoverageManager::CoverageLayer::CoverageLayer(cISC4OccupantFilter* filter)
+	: filter(),
+	  map(MemoryArenas::Get(MemorySubsystem::Coverage)),
+	  grid(MemoryArenas::Get(MemorySubsystem::Coverage)),
+	  gridVersion(0),
+	  footprints(),
+	  unresolvedFootprints()
+{
+	// The assignment operator adds a reference to the filter.
+	this->filter = filter;
+}
+
+CoverageManager::CoverageManager()
+	: parkLayer(new ParkEffectFilter()),
+	  landmarkLayer(new LandmarkEffectFilter()),
+	  pLoadedCity(nullptr),
+	  pendingIndex(),
+	  scanPending(false)
+{
+}
+
+void CoverageManager::Init()
+{
+	spOccupantEventBus->Subscribe(this, kOccupantTypeBuilding);
+}
+
+void CoverageManager::Shutdown()
+{
+	spOccupantEventBus->Unsubscribe(this);
+}
+
+const CoverageMap& CoverageManager::GetParkCoverage()
+{
+	ScanOccupantsIfPending();
+	return parkLayer.map;
+}
+
+const CoverageMap& CoverageManager::GetLandmarkCoverage()
+{
+	ScanOccupantsIfPending();
+	return landmarkLayer.map;
+}
+
+cISC4SimGrid<int16_t>* CoverageManager::GetParkCoverageGrid()
+{
+	ScanOccupantsIfPending();
+	return GetCoverageGrid(parkLayer);
+}
+
+cISC4SimGrid<int16_t>* CoverageManager::GetLandmarkCoverageGrid()
+{
+	ScanOccupantsIfPending();
+	return GetCoverageGrid(landmarkLayer);
+}
+
+bool CoverageManager::GetIndex(CoverageIndex& index)
+{
+	if (!CoverageIndexRecord::GetCityStamp(pLoadedCity, index.stamp))
+	{
+		return false;
+	}
+
+	// The scan runs here if nothing has used the coverage maps since the
+	// city was loaded, so that the next load of the saved city is warm.
+	ScanOccupantsIfPending();
+
+	for (uint32_t i = 0; i < CoverageIndex::LayerCount; i++)
+	{
+		const CoverageLayer& layer = GetLayer(static_cast<CoverageIndex::Layer>(i));
+		std::vector<SC4Rect<long>>& output = index.footprints[i];
+
+		output.clear();
+		output.reserve(layer.footprints.size() + layer.unresolvedFootprints.size());
+
+		for (const auto& item : layer.footprints)
+		{
+			output.push_back(item.second);
+		}
+
+		for (const auto& item : layer.unresolvedFootprints)
+		{
+			output.insert(output.end(), item.second, UnpackFootprint(item.first));
+		}
+	}
+
+	return true;
+}
+
+void CoverageManager::SetPendingIndex(CoverageIndex&& index)
+{
+	pendingIndex = std::move(index);
+}
+
+void CoverageManager::OccupantInserted(cISC4Occupant* pOccupant)
+{
+	if (parkLayer.filter->IsOccupantIncluded(pOccupant))
+	{
+		AddOccupant(parkLayer, pOccupant);
+	}
+
+	if (landmarkLayer.filter->IsOccupantIncluded(pOccupant))
+	{
+		AddOccupant(landmarkLayer, pOccupant);
+	}
+}
+
+void CoverageManager::OccupantRemoved(cISC4Occupant* pOccupant)
+{
+	// The stored footprint is used for the removal, so the filters do not
+	// have to be evaluated again.
+	RemoveOccupant(parkLayer, pOccupant);
+	RemoveOccupant(landmarkLayer, pOccupant);
+}
+
+void CoverageManager::PostCityInit(cISC4City* pCity)
+{
+	pLoadedCity = pCity;
+
+	// The occupant scan is deferred until the coverage maps are first used,
+	// the occupant events are ignored until then.
+	scanPending = !LoadPendingIndex(pCity);
+}
+
+void CoverageManager::PreCityShutdown()
+{
+	for (CoverageLayer* layer : { &parkLayer, &landmarkLayer })
+	{
+		layer->footprints.clear();
+		layer->unresolvedFootprints.clear();
+		layer->map.Shutdown();
+		layer->grid.Clear();
+	}
+
+	pLoadedCity = nullptr;
+	pendingIndex.reset();
+	scanPending = false;
+}
+
+bool CoverageManager::IterateOccupantsCallback(cISC4Occupant* pOccupant, void* pContext)
+{
+	CoverageManager* pThis = static_cast<CoverageManager*>(pContext);
+
+	// Both layers are filled from a single pass over the city's buildings.
+	pThis->OccupantInserted(pOccupant);
+	return true;
+}
+
+bool CoverageManager::LoadPendingIndex(cISC4City* pCity)
+{
+	if (!pendingIndex)
+	{
+		return false;
+	}
+
+	const CoverageIndex index = std::move(pendingIndex.value());
+	pendingIndex.reset();
+
+	// The index is only used if it was saved from this city at the current date,
+	// otherwise the maps are rebuilt from the occupant scan.
+	CoverageIndexStamp stamp{};
+
+	if (!CoverageIndexRecord::GetCityStamp(pCity, stamp)
+		|| stamp != index.stamp
+		|| stamp.cellCountX == 0
+		|| stamp.cellCountZ == 0)
+	{
+		return false;
+	}
+
+	for (uint32_t i = 0; i < CoverageIndex::LayerCount; i++)
+	{
+		CoverageLayer& layer = GetLayer(static_cast<CoverageIndex::Layer>(i));
+
+		layer.map.Init(stamp.cellCountX, stamp.cellCountZ);
+		layer.grid.Resize(stamp.cellCountX, stamp.cellCountZ, 1);
+		layer.gridVersion = 0;
+
+		layer.map.BeginBulkUpdate();
+
+		for (const SC4Rect<long>& footprint : index.footprints[i])
+		{
+			layer.unresolvedFootprints[PackFootprint(footprint)]++;
+			layer.map.AddFootprint(footprint);
+		}
+
+		layer.map.EndBulkUpdate();
+	}
+
+	return true;
+}
+
+void CoverageManager::ScanOccupantsIfPending()
+{
+	if (!scanPending)
+	{
+		return;
+	}
+
+	scanPending = false;
+
+	cISC4OccupantManager* pOccupantManager = pLoadedCity ? pLoadedCity->GetOccupantManager() : nullptr;
+
+	if (!pOccupantManager)
+	{
+		return;
+	}
+
+	int cellCountX = 0;
+	int cellCountZ = 0;
+
+	if (pOccupantManager->GetWorldCellCount(cellCountX, cellCountZ) && cellCountX > 0 && cellCountZ > 0)
+	{
+		for (CoverageLayer* layer : { &parkLayer, &landmarkLayer })
+		{
+			layer->map.Init(static_cast<uint32_t>(cellCountX), static_cast<uint32_t>(cellCountZ));
+			layer->grid.Resize(cellCountX, cellCountZ, 1);
+			layer->gridVersion = 0;
+
+			// The distances are computed once for the whole city after the scan.
+			layer->map.BeginBulkUpdate();
+		}
+
+		pOccupantManager->IterateOccupants(
+			IterateOccupantsCallback,
+			this,
+			nullptr,
+			nullptr,
+			kOccupantTypeBuilding);
+
+		for (CoverageLayer* layer : { &parkLayer, &landmarkLayer })
+		{
+			layer->map.EndBulkUpdate();
+		}
+	}
+}
+
+CoverageManager::CoverageLayer& CoverageManager::GetLayer(CoverageIndex::Layer layer)
+{
+	return layer == CoverageIndex::ParkLayer ? parkLayer : landmarkLayer;
+}
+
+const CoverageManager::CoverageLayer& CoverageManager::GetLayer(CoverageIndex::Layer layer) const
+{
+	return layer == CoverageIndex::ParkLayer ? parkLayer : landmarkLayer;
+}
+
+void CoverageManager::AddOccupant(CoverageLayer& layer, cISC4Occupant* pOccupant)
+{
+	if (!layer.map.IsInitialized())
+	{
+		// The city has not finished loading or its occupant scan is still
+		// pending, the occupant will be added by the scan.
+		return;
+	}
+
+	SC4Rect<long> cells;
+	SC4Rect<long> footprint;
+
+	// The clipped footprint is stored, so the saved index only contains
+	// coordinates that are inside the city.
+	if (pOccupant->GetBoundingCityCells(cells) && layer.map.ClipToCity(cells, footprint))
+	{
+		if (layer.footprints.try_emplace(pOccupant, footprint).second)
+		{
+			layer.map.AddFootprint(footprint);
+		}
+	}
+}
+
+void CoverageManager::RemoveOccupant(CoverageLayer& layer, cISC4Occupant* pOccupant)
+{
+	auto item = layer.footprints.find(pOccupant);
+
+	if (item != layer.footprints.end())
+	{
+		layer.map.RemoveFootprint(item->second);
+		layer.footprints.erase(item);
+	}
+	else if (!layer.unresolvedFootprints.empty())
+	{
+		RemoveUnresolvedOccupant(layer, pOccupant);
+	}
+}
+
+void CoverageManager::RemoveUnresolvedOccupant(CoverageLayer& layer, cISC4Occupant* pOccupant)
+{
+	// The occupants that were present when the saved index was loaded are
+	// matched by their footprint when they are removed.
+	if (!layer.filter->IsOccupantIncluded(pOccupant))
+	{
+		return;
+	}
+
+	SC4Rect<long> cells;
+	SC4Rect<long> footprint;
+
+	if (pOccupant->GetBoundingCityCells(cells) && layer.map.ClipToCity(cells, footprint))
+	{
+		auto item = layer.unresolvedFootprints.find(PackFootprint(footprint));
+
+		if (item != layer.unresolvedFootprints.end())
+		{
+			layer.map.RemoveFootprint(footprint);
+
+			if (--item->second == 0)
+			{
+				layer.unresolvedFootprints.erase(item);
+			}
+		}
+	}
+}
+
+cISC4SimGrid<int16_t>* CoverageManager::GetCoverageGrid(CoverageLayer& layer)
+{
+	if (!layer.map.IsInitialized() || layer.grid.IsEmpty())
+	{
+		return nullptr;
+	}
+
+	if (layer.gridVersion != layer.map.GetVersion())
+	{
+		// The grid is only rebuilt when the data view reads it after a change.
+
+		const uint32_t cellCountX = layer.map.GetCellCountX();
+		const uint32_t cellCountZ = layer.map.GetCellCountZ();
+		int16_t* values = layer.grid.GetValues();
+
+		for (uint32_t z = 0; z < cellCountZ; z++)
+		{
+			for (uint32_t x = 0; x < cellCountX; x++)
+			{
+				*values++ = static_cast<int16_t>(std::lround(layer.map.GetDistance(x, z)));
+			}
+		}
+
+		layer.gridVersion = layer.map.GetVersion();
+	}
+
+	return &layer.grid;
+}
@@ -0,0 +1,95 @@
+////////////////////////////////////////////////////////////////////////
+//
+// This file is part of sc4-data-view-extensions, a DLL Plugin for
+// SimCity 4 that extends the game's data views.
+//
+// Copyright (c) 2024 Nicholas Hayes
+//
+// This file is licensed under terms of the MIT License.
+// See LICENSE.txt for more information.
+//
+////////////////////////////////////////////////////////////////////////
+
+#pragma once
+#include "CoverageIndexRecord.h"
+#include "CoverageMap.h"
+#include "DllSimGrid.h"
+#include "IOccupantEventSubscriber.h"
+#include "cISC4OccupantFilter.h"
+#include "cRZAutoRefCount.h"
+#include "SC4Rect.h"
+#include <optional>
+#include <unordered_map>
+
+// Maintains the park and landmark coverage maps from the occupant insert/remove
+// events, and exposes them as data view sources.
+class CoverageManager : private IOccupantEventSubscriber
+{
+public:
+	CoverageManager();
+
+	void Init();
+	void Shutdown();
+
+	// The coverage maps are built from an occupant scan on first use when the
+	// city did not have a matching saved index.
+	const CoverageMap& GetParkCoverage();
+	const CoverageMap& GetLandmarkCoverage();
+
+	// The data view grids contain the distance in cells to the nearest footprint.
+	// Returns nullptr if a city is not loaded.
+	cISC4SimGrid<int16_t>* GetParkCoverageGrid();
+	cISC4SimGrid<int16_t>* GetLandmarkCoverageGrid();
+
+	// Gets the current footprints for saving with the city.
+	// Returns false if a city is not loaded.
+	bool GetIndex(CoverageIndex& index);
+
+	// Sets the index that was loaded from the save game.
+	// It replaces the occupant scan if it matches the city.
+	void SetPendingIndex(CoverageIndex&& index);
+
+private:
+
+	struct CoverageLayer
+	{
+		CoverageLayer(cISC4OccupantFilter* filter);
+
+		cRZAutoRefCount<cISC4OccupantFilter> filter;
+		CoverageMap map;
+		DllSimGrid<int16_t> grid;
+		uint32_t gridVersion;
+		std::unordered_map<cISC4Occupant*, SC4Rect<long>> footprints;
+		// The footprints loaded from the saved index, these have not been matched
+		// to an occupant. The key is the packed rectangle, and the value is the
+		// number of footprints with that rectangle.
+		std::unordered_map<uint64_t, uint32_t> unresolvedFootprints;
+	};
+
+	// IOccupantEventSubscriber
+
+	void OccupantInserted(cISC4Occupant* pOccupant);
+	void OccupantRemoved(cISC4Occupant* pOccupant);
+	void PostCityInit(cISC4City* pCity);
+	void PreCityShutdown();
+
+	// Private members
+
+	static bool IterateOccupantsCallback(cISC4Occupant* pOccupant, void* pContext);
+
+	bool LoadPendingIndex(cISC4City* pCity);
+	void ScanOccupantsIfPending();
+	CoverageLayer& GetLayer(CoverageIndex::Layer layer);
+	const CoverageLayer& GetLayer(CoverageIndex::Layer layer) const;
+
+	static void AddOccupant(CoverageLayer& layer, cISC4Occupant* pOccupant);
+	static void RemoveOccupant(CoverageLayer& layer, cISC4Occupant* pOccupant);
+	static void RemoveUnresolvedOccupant(CoverageLayer& layer, cISC4Occupant* pOccupant);
+	static cISC4SimGrid<int16_t>* GetCoverageGrid(CoverageLayer& layer);
+
+	CoverageLayer parkLayer;
+	CoverageLayer landmarkLayer;
+	cISC4City* pLoadedCity;
+	std::optional<CoverageIndex> pendingIndex;
+	bool scanPending;
+};
@@ -0,0 +1,349 @@
+////////////////////////////////////////////////////////////////////////
+//
+// This file is part of sc4-data-view-extensions, a DLL Plugin for
+// SimCity 4 that extends the game's data views.
+//
+// Copyright (c) 2024 Nicholas Hayes
+//
+// This file is licensed under terms of the MIT License.
+// See LICENSE.txt for more information.
+//
+////////////////////////////////////////////////////////////////////////
+
+#include "CoverageMap.h"
+#include "DistanceTransform.h"
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+	// The distance from a coordinate to the closed interval [first, last].
+	long DistanceToInterval(long value, long first, long last)
+	{
+		if (value < first)
+		{
+			return first - value;
+		}
+		else if (value > last)
+		{
+			return value - last;
+		}
+
+		return 0;
+	}
+}
+
+CoverageMap::CoverageMap(std::pmr::memory_resource* memoryResource)
+	: memoryResource(memoryResource),
+	  cellCountX(0),
+	  cellCountZ(0),
+	  version(0),
+	  bulkUpdate(false),
+	  footprintCounts(memoryResource),
+	  footprintMask(0, 0, false, memoryResource),
+	  squaredDistances(memoryResource),
+	  scratchDistances()
+{
+}
+
+void CoverageMap::Init(uint32_t cellCountX, uint32_t cellCountZ)
+{
+	this->cellCountX = cellCountX;
+	this->cellCountZ = cellCountZ;
+
+	const size_t cellCount = static_cast<size_t>(cellCountX) * cellCountZ;
+
+	footprintCounts.assign(cellCount, 0);
+	footprintMask = CellBitmap(cellCountZ, cellCountX, false, memoryResource);
+	squaredDistances.assign(cellCount, FarSquaredDistance);
+	version++;
+}
+
+void CoverageMap::Shutdown()
+{
+	cellCountX = 0;
+	cellCountZ = 0;
+	bulkUpdate = false;
+
+	// The storage is freed so that the coverage arena can be reset at city shutdown.
+	footprintCounts.clear();
+	footprintCounts.shrink_to_fit();
+	footprintMask = CellBitmap(0, 0, false, memoryResource);
+	squaredDistances.clear();
+	squaredDistances.shrink_to_fit();
+	scratchDistances.clear();
+	scratchDistances.shrink_to_fit();
+	version++;
+}
+
+bool CoverageMap::IsInitialized() const
+{
+	return cellCountX > 0 && cellCountZ > 0;
+}
+
+uint32_t CoverageMap::GetCellCountX() const
+{
+	return cellCountX;
+}
+
+uint32_t CoverageMap::GetCellCountZ() const
+{
+	return cellCountZ;
+}
+
+uint32_t CoverageMap::GetVersion() const
+{
+	return version;
+}
+
+void CoverageMap::AddFootprint(const SC4Rect<long>& cells)
+{
+	SC4Rect<long> footprint;
+
+	if (!ClipToCity(cells, footprint))
+	{
+		return;
+	}
+
+	for (long z = footprint.topLeftY; z <= footprint.bottomRightY; z++)
+	{
+		uint16_t* rowCounts = footprintCounts.data() + (static_cast<size_t>(z) * cellCountX);
+
+		for (long x = footprint.topLeftX; x <= footprint.bottomRightX; x++)
+		{
+			rowCounts[x]++;
+		}
+	}
+
+	footprintMask.SetRect(footprint.topLeftY, footprint.topLeftX, footprint.bottomRightY, footprint.bottomRightX, true);
+
+	if (!bulkUpdate)
+	{
+		UpdateDistancesAfterInsert(footprint);
+		version++;
+	}
+}
+
+void CoverageMap::RemoveFootprint(const SC4Rect<long>& cells)
+{
+	SC4Rect<long> footprint;
+
+	if (!ClipToCity(cells, footprint))
+	{
+		return;
+	}
+
+	for (long z = footprint.topLeftY; z <= footprint.bottomRightY; z++)
+	{
+		uint16_t* rowCounts = footprintCounts.data() + (static_cast<size_t>(z) * cellCountX);
+
+		for (long x = footprint.topLeftX; x <= footprint.bottomRightX; x++)
+		{
+			if (rowCounts[x] > 0)
+			{
+				rowCounts[x]--;
+
+				if (rowCounts[x] == 0)
+				{
+					footprintMask.SetValue(static_cast<uint32_t>(z), static_cast<uint32_t>(x), false);
+				}
+			}
+		}
+	}
+
+	if (!bulkUpdate)
+	{
+		// Only the cells whose nearest footprint cell was in the removed footprint can change.
+		RecomputeDistances(GetCellsNearestTo(footprint));
+		version++;
+	}
+}
+
+void CoverageMap::BeginBulkUpdate()
+{
+	bulkUpdate = true;
+}
+
+void CoverageMap::EndBulkUpdate()
+{
+	bulkUpdate = false;
+
+	if (IsInitialized())
+	{
+		RecomputeDistances(SC4Rect<long>(0, 0, cellCountX - 1, cellCountZ - 1));
+		version++;
+	}
+}
+
+float CoverageMap::GetDistance(uint32_t x, uint32_t z) const
+{
+	const uint32_t squaredDistance = GetSquaredDistance(x, z);
+
+	if (squaredDistance >= FarSquaredDistance)
+	{
+		return static_cast<float>(MaxDistance);
+	}
+
+	return std::sqrt(static_cast<float>(squaredDistance));
+}
+
+uint32_t CoverageMap::GetSquaredDistance(uint32_t x, uint32_t z) const
+{
+	if (x >= cellCountX || z >= cellCountZ)
+	{
+		return FarSquaredDistance;
+	}
+
+	return squaredDistances[(static_cast<size_t>(z) * cellCountX) + x];
+}
+
+uint32_t CoverageMap::GetCoveredCellCount(uint32_t radius) const
+{
+	const uint32_t limit = std::min(radius, MaxDistance) * std::min(radius, MaxDistance);
+
+	return static_cast<uint32_t>(std::count_if(
+		squaredDistances.begin(),
+		squaredDistances.end(),
+		[limit](uint16_t value) { return value <= limit; }));
+}
+
+void CoverageMap::GetCoverageMask(uint32_t radius, CellBitmap& mask) const
+{
+	const uint32_t limit = std::min(radius, MaxDistance) * std::min(radius, MaxDistance);
+
+	mask = CellBitmap(cellCountZ, cellCountX, false);
+
+	const uint16_t* distances = squaredDistances.data();
+
+	for (uint32_t z = 0; z < cellCountZ; z++)
+	{
+		for (uint32_t x = 0; x < cellCountX; x++)
+		{
+			if (distances[x] <= limit)
+			{
+				mask.SetValue(z, x, true);
+			}
+		}
+
+		distances += cellCountX;
+	}
+}
+
+const CellBitmap& CoverageMap::GetFootprintMask() const
+{
+	return footprintMask;
+}
+
+bool CoverageMap::ClipToCity(const SC4Rect<long>& cells, SC4Rect<long>& clipped) const
+{
+	if (!IsInitialized())
+	{
+		return false;
+	}
+
+	// GetBoundingCityCells does not guarantee that the corners are ordered.
+	clipped.topLeftX = std::max(std::min(cells.topLeftX, cells.bottomRightX), 0L);
+	clipped.topLeftY = std::max(std::min(cells.topLeftY, cells.bottomRightY), 0L);
+	clipped.bottomRightX = std::min(std::max(cells.topLeftX, cells.bottomRightX), static_cast<long>(cellCountX) - 1);
+	clipped.bottomRightY = std::min(std::max(cells.topLeftY, cells.bottomRightY), static_cast<long>(cellCountZ) - 1);
+
+	return clipped.topLeftX <= clipped.bottomRightX && clipped.topLeftY <= clipped.bottomRightY;
+}
+
+SC4Rect<long> CoverageMap::ExpandAndClip(const SC4Rect<long>& cells, long amount) const
+{
+	return SC4Rect<long>(
+		std::max(cells.topLeftX - amount, 0L),
+		std::max(cells.topLeftY - amount, 0L),
+		std::min(cells.bottomRightX + amount, static_cast<long>(cellCountX) - 1),
+		std::min(cells.bottomRightY + amount, static_cast<long>(cellCountZ) - 1));
+}
+
+void CoverageMap::UpdateDistancesAfterInsert(const SC4Rect<long>& footprint)
+{
+	// A new footprint can only make the distances smaller, so the distance to the
+	// new rectangle is merged into the existing values.
+
+	const SC4Rect<long> area = ExpandAndClip(footprint, MaxDistance);
+	constexpr long MaxSquaredDistance = MaxDistance * MaxDistance;
+
+	for (long z = area.topLeftY; z <= area.bottomRightY; z++)
+	{
+		const long dz = DistanceToInterval(z, footprint.topLeftY, footprint.bottomRightY);
+		uint16_t* rowDistances = squaredDistances.data() + (static_cast<size_t>(z) * cellCountX);
+
+		for (long x = area.topLeftX; x <= area.bottomRightX; x++)
+		{
+			const long dx = DistanceToInterval(x, footprint.topLeftX, footprint.bottomRightX);
+			const long squaredDistance = (dx * dx) + (dz * dz);
+
+			if (squaredDistance <= MaxSquaredDistance && squaredDistance < rowDistances[x])
+			{
+				rowDistances[x] = static_cast<uint16_t>(squaredDistance);
+			}
+		}
+	}
+}
+
+SC4Rect<long> CoverageMap::GetCellsNearestTo(const SC4Rect<long>& footprint) const
+{
+	// The footprint was a source for every cell within MaxDistance, so a cell's distance
+	// is at most its distance to the footprint. The cells where the two are equal may
+	// have had their nearest source in the footprint, the other cells keep their value.
+	// The result always contains the footprint, where both distances are 0.
+
+	const SC4Rect<long> area = ExpandAndClip(footprint, MaxDistance);
+	constexpr long MaxSquaredDistance = MaxDistance * MaxDistance;
+
+	SC4Rect<long> bounds(footprint);
+
+	for (long z = area.topLeftY; z <= area.bottomRightY; z++)
+	{
+		const long dz = DistanceToInterval(z, footprint.topLeftY, footprint.bottomRightY);
+		const uint16_t* rowDistances = squaredDistances.data() + (static_cast<size_t>(z) * cellCountX);
+
+		for (long x = area.topLeftX; x <= area.bottomRightX; x++)
+		{
+			const long dx = DistanceToInterval(x, footprint.topLeftX, footprint.bottomRightX);
+			const long squaredDistance = (dx * dx) + (dz * dz);
+
+			if (squaredDistance <= MaxSquaredDistance && rowDistances[x] == squaredDistance)
+			{
+				bounds.topLeftX = std::min(bounds.topLeftX, x);
+				bounds.topLeftY = std::min(bounds.topLeftY, z);
+				bounds.bottomRightX = std::max(bounds.bottomRightX, x);
+				bounds.bottomRightY = std::max(bounds.bottomRightY, z);
+			}
+		}
+	}
+
+	return bounds;
+}
+
+void CoverageMap::RecomputeDistances(const SC4Rect<long>& area)
+{
+	// Any footprint that is within MaxDistance of a cell in the area is
+	// inside the expanded region, so the capped distances are exact.
+
+	const SC4Rect<long> region = ExpandAndClip(area, MaxDistance);
+
+	DistanceTransform::ComputeSquaredDistances(footprintMask, region, scratchDistances);
+
+	const long regionWidth = region.bottomRightX - region.topLeftX + 1;
+	constexpr uint32_t MaxSquaredDistance = MaxDistance * MaxDistance;
+
+	for (long z = area.topLeftY; z <= area.bottomRightY; z++)
+	{
+		const uint32_t* source = scratchDistances.data()
+			+ (static_cast<size_t>(z - region.topLeftY) * regionWidth)
+			+ (area.topLeftX - region.topLeftX);
+		uint16_t* rowDistances = squaredDistances.data() + (static_cast<size_t>(z) * cellCountX);
+
+		for (long x = area.topLeftX; x <= area.bottomRightX; x++)
+		{
+			const uint32_t value = *source++;
+
+			rowDistances[x] = value <= MaxSquaredDistance ? static_cast<uint16_t>(value) : FarSquaredDistance;
+		}
+	}
+}
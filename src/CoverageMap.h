@@ -0,0 +1,83 @@
+////////////////////////////////////////////////////////////////////////
+//
+// This file is part of sc4-data-view-extensions, a DLL Plugin for
+// SimCity 4 that extends the game's data views.
+//
+// Copyright (c) 2024 Nicholas Hayes
+//
+// This file is licensed under terms of the MIT License.
+// See LICENSE.txt for more information.
+//
+////////////////////////////////////////////////////////////////////////
+
+#pragma once
+#include "CellBitmap.h"
+#include "SC4Rect.h"
+#include <cstdint>
+#include <memory_resource>
+#include <vector>
+
+// Tracks the city cells that are covered by a set of occupant footprints and
+// the Euclidean distance from every city cell to the nearest footprint.
+// The distances are capped at MaxDistance cells, this bounds the area that
+// has to be recomputed when a footprint is added or removed.
+class CoverageMap
+{
+public:
+	static constexpr uint32_t MaxDistance = 64;
+
+	CoverageMap(std::pmr::memory_resource* memoryResource);
+
+	void Init(uint32_t cellCountX, uint32_t cellCountZ);
+	void Shutdown();
+
+	bool IsInitialized() const;
+	uint32_t GetCellCountX() const;
+	uint32_t GetCellCountZ() const;
+
+	// The version is incremented whenever the distances change.
+	uint32_t GetVersion() const;
+
+	void AddFootprint(const SC4Rect<long>& cells);
+	void RemoveFootprint(const SC4Rect<long>& cells);
+
+	// Orders the corners and clips the cells to the city bounds.
+	// Returns false if the cells are outside of the city.
+	bool ClipToCity(const SC4Rect<long>& cells, SC4Rect<long>& clipped) const;
+
+	// Defers the distance updates until EndBulkUpdate is called,
+	// the distances are then recomputed for the entire city.
+	void BeginBulkUpdate();
+	void EndBulkUpdate();
+
+	// Returns the distance in cells to the nearest footprint, or MaxDistance
+	// if there is no footprint within that range.
+	float GetDistance(uint32_t x, uint32_t z) const;
+	uint32_t GetSquaredDistance(uint32_t x, uint32_t z) const;
+
+	uint32_t GetCoveredCellCount(uint32_t radius) const;
+	void GetCoverageMask(uint32_t radius, CellBitmap& mask) const;
+
+	const CellBitmap& GetFootprintMask() const;
+
+private:
+	// The value stored for cells that are farther than MaxDistance from a footprint.
+	static constexpr uint16_t FarSquaredDistance = static_cast<uint16_t>((MaxDistance * MaxDistance) + 1);
+
+	SC4Rect<long> ExpandAndClip(const SC4Rect<long>& cells, long amount) const;
+	void UpdateDistancesAfterInsert(const SC4Rect<long>& footprint);
+	SC4Rect<long> GetCellsNearestTo(const SC4Rect<long>& footprint) const;
+	void RecomputeDistances(const SC4Rect<long>& area);
+
+	std::pmr::memory_resource* memoryResource;
+	uint32_t cellCountX;
+	uint32_t cellCountZ;
+	uint32_t version;
+	bool bulkUpdate;
+	// The number of footprints that cover each cell, the footprints can overlap.
+	std::pmr::vector<uint16_t> footprintCounts;
+	// The footprint cells, the map rows are Z and the columns are X.
+	CellBitmap footprintMask;
+	std::pmr::vector<uint16_t> squaredDistances;
+	std::vector<uint32_t> scratchDistances;
+};
@@ -0,0 +1,224 @@
+////////////////////////////////////////////////////////////////////////
+//
+// This file is part of sc4-data-view-extensions, a DLL Plugin for
+// SimCity 4 that extends the game's data views.
+//
+// Copyright (c) 2024 Nicholas Hayes
+//
+// This file is licensed under terms of the MIT License.
+// See LICENSE.txt for more information.
+//
+////////////////////////////////////////////////////////////////////////
+
+#include "DBPFFile.h"
+#include "Qfs.h"
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+	constexpr uint32_t kDBPFSignature = 0x46504244; // DBPF
+	constexpr size_t kHeaderSize = 96;
+
+	constexpr uint32_t kHeaderMajorVersionOffset = 4;
+	constexpr uint32_t kHeaderIndexMajorVersionOffset = 32;
+	constexpr uint32_t kHeaderIndexEntryCountOffset = 36;
+	constexpr uint32_t kHeaderIndexOffsetOffset = 40;
+	constexpr uint32_t kHeaderIndexSizeOffset = 44;
+
+	// Index version 7.0 entries are 20 bytes, version 7.1 adds a 4 byte instance extension.
+	constexpr uint32_t kIndexEntrySize70 = 20;
+	constexpr uint32_t kIndexEntrySize71 = 24;
+
+	// The directory entry that lists the compressed entries and their uncompressed sizes.
+	constexpr DBPFResourceKey kCompressedDirectoryKey{ 0xE86B1EEF, 0xE86B1EEF, 0x286B1F03 };
+
+	uint32_t ReadUint32(const uint8_t* data)
+	{
+		// The file data is not aligned, and DBPF files are little endian like x86.
+		uint32_t value;
+		std::memcpy(&value, data, sizeof(value));
+
+		return value;
+	}
+}
+
+DBPFFile::DBPFFile()
+	: mappedFile(),
+	  fileData(nullptr),
+	  fileSize(0),
+	  indexTable(nullptr),
+	  indexEntryCount(0),
+	  indexEntrySize(0),
+	  compressedEntries()
+{
+}
+
+bool DBPFFile::Open(const std::filesystem::path& path)
+{
+	Close();
+
+	if (!mappedFile.Open(path))
+	{
+		return false;
+	}
+
+	if (!Parse(mappedFile.GetData(), mappedFile.GetSize()))
+	{
+		Close();
+		return false;
+	}
+
+	return true;
+}
+
+void DBPFFile::Close()
+{
+	mappedFile.Close();
+	fileData = nullptr;
+	fileSize = 0;
+	indexTable = nullptr;
+	indexEntryCount = 0;
+	indexEntrySize = 0;
+	compressedEntries.clear();
+}
+
+bool DBPFFile::Parse(const uint8_t* data, size_t size)
+{
+	if (size < kHeaderSize
+		|| ReadUint32(data) != kDBPFSignature
+		|| ReadUint32(data + kHeaderMajorVersionOffset) != 1
+		|| ReadUint32(data + kHeaderIndexMajorVersionOffset) != 7)
+	{
+		return false;
+	}
+
+	const uint32_t entryCount = ReadUint32(data + kHeaderIndexEntryCountOffset);
+	const uint32_t indexOffset = ReadUint32(data + kHeaderIndexOffsetOffset);
+	const uint32_t indexSize = ReadUint32(data + kHeaderIndexSizeOffset);
+
+	uint32_t entrySize = kIndexEntrySize70;
+
+	if (entryCount > 0)
+	{
+		// The index minor version field is not reliable, the entry size
+		// is determined from the size of the index table.
+		if (indexSize == static_cast<uint64_t>(entryCount) * kIndexEntrySize71)
+		{
+			entrySize = kIndexEntrySize71;
+		}
+		else if (indexSize != static_cast<uint64_t>(entryCount) * kIndexEntrySize70)
+		{
+			return false;
+		}
+	}
+
+	if (indexOffset > size || size - indexOffset < indexSize)
+	{
+		return false;
+	}
+
+	fileData = data;
+	fileSize = size;
+	indexTable = data + indexOffset;
+	indexEntryCount = entryCount;
+	indexEntrySize = entrySize;
+
+	return ReadCompressedDirectory();
+}
+
+uint32_t DBPFFile::GetEntryCount() const
+{
+	return indexEntryCount;
+}
+
+DBPFEntry DBPFFile::GetEntry(uint32_t index) const
+{
+	const uint8_t* data = indexTable + (static_cast<size_t>(index) * indexEntrySize);
+
+	DBPFEntry entry{};
+	entry.key.type = ReadUint32(data);
+	entry.key.group = ReadUint32(data + 4);
+	entry.key.instance = ReadUint32(data + 8);
+
+	// The 7.1 instance extension is not used by SC4.
+	const uint8_t* location = data + (indexEntrySize - 8);
+	entry.offset = ReadUint32(location);
+	entry.size = ReadUint32(location + 4);
+
+	return entry;
+}
+
+bool DBPFFile::GetEntryData(
+	const DBPFEntry& entry,
+	std::vector<uint8_t>& buffer,
+	const uint8_t*& data,
+	size_t& size) const
+{
+	if (entry.offset > fileSize || fileSize - entry.offset < entry.size)
+	{
+		return false;
+	}
+
+	const uint8_t* entryData = fileData + entry.offset;
+
+	if (std::binary_search(compressedEntries.begin(), compressedEntries.end(), entry.key)
+		&& Qfs::IsCompressed(entryData, entry.size))
+	{
+		if (!Qfs::Decompress(entryData, entry.size, buffer))
+		{
+			return false;
+		}
+
+		data = buffer.data();
+		size = buffer.size();
+	}
+	else
+	{
+		data = entryData;
+		size = entry.size;
+	}
+
+	return true;
+}
+
+bool DBPFFile::ReadCompressedDirectory()
+{
+	compressedEntries.clear();
+
+	for (uint32_t i = 0; i < indexEntryCount; i++)
+	{
+		const DBPFEntry entry = GetEntry(i);
+
+		if (entry.key == kCompressedDirectoryKey)
+		{
+			if (entry.offset > fileSize || fileSize - entry.offset < entry.size)
+			{
+				return false;
+			}
+
+			// The directory entries have the same layout as the index entries, with the
+			// uncompressed size in place of the location.
+			const uint32_t directoryEntrySize = indexEntrySize - 4;
+			const uint32_t directoryEntryCount = entry.size / directoryEntrySize;
+			const uint8_t* data = fileData + entry.offset;
+
+			compressedEntries.reserve(directoryEntryCount);
+
+			for (uint32_t j = 0; j < directoryEntryCount; j++)
+			{
+				const uint8_t* directoryEntry = data + (static_cast<size_t>(j) * directoryEntrySize);
+
+				compressedEntries.push_back(DBPFResourceKey{
+					ReadUint32(directoryEntry),
+					ReadUint32(directoryEntry + 4),
+					ReadUint32(directoryEntry + 8) });
+			}
+
+			std::sort(compressedEntries.begin(), compressedEntries.end());
+			break;
+		}
+	}
+
+	return true;
+}
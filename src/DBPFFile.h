@@ -0,0 +1,70 @@
+////////////////////////////////////////////////////////////////////////
+//
+// This file is part of sc4-data-view-extensions, a DLL Plugin for
+// SimCity 4 that extends the game's data views.
+//
+// Copyright (c) 2024 Nicholas Hayes
+//
+// This file is licensed under terms of the MIT License.
+// See LICENSE.txt for more information.
+//
+////////////////////////////////////////////////////////////////////////
+
+#pragma once
+#include "MemoryMappedFile.h"
+#include <compare>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <vector>
+
+struct DBPFResourceKey
+{
+	uint32_t type;
+	uint32_t group;
+	uint32_t instance;
+
+	auto operator<=>(const DBPFResourceKey& other) const = default;
+};
+
+struct DBPFEntry
+{
+	DBPFResourceKey key;
+	uint32_t offset;
+	uint32_t size;
+};
+
+// Reads the entries of a DBPF file without going through the game's resource manager.
+// The file is memory mapped, the index table is read in place and the compressed
+// entries are decompressed when they are requested.
+class DBPFFile
+{
+public:
+	DBPFFile();
+
+	bool Open(const std::filesystem::path& path);
+	void Close();
+
+	// Parses a DBPF file that is already in memory, the data must remain valid
+	// until the file is closed.
+	bool Parse(const uint8_t* data, size_t size);
+
+	uint32_t GetEntryCount() const;
+	DBPFEntry GetEntry(uint32_t index) const;
+
+	// Gets the uncompressed entry data. The data points into the file if
+	// the entry is not compressed, otherwise it points into the buffer.
+	bool GetEntryData(const DBPFEntry& entry, std::vector<uint8_t>& buffer, const uint8_t*& data, size_t& size) const;
+
+private:
+	bool ReadCompressedDirectory();
+
+	MemoryMappedFile mappedFile;
+	const uint8_t* fileData;
+	size_t fileSize;
+	const uint8_t* indexTable;
+	uint32_t indexEntryCount;
+	uint32_t indexEntrySize;
+	// The keys of the compressed entries, sorted for binary search.
+	std::vector<DBPFResourceKey> compressedEntries;
+};
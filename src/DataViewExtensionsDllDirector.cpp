@@ -11,44 +11,118 @@
 ////////////////////////////////////////////////////////////////////////
 
 #include "cSC4WinMapViewHooks.h"
+#include "AuraExposureEngine.h"
+#include "AuraHistoryRecorder.h"
+#include "AuraIsolineManager.h"
+#include "AuraRegionManager.h"
+#include "BuildingAttributeIndex.h"
+#include "CoverageManager.h"
+#include "DataViewHighlightManager.h"
+#include "DataViewLuaFunctions.h"
+#include "EffectPropertyCache.h"
+#include "EffectRankingManager.h"
 #include "FileSystem.h"
+#include "FrameTaskScheduler.h"
 #include "GlobalPointers.h"
+#include "GridPyramidService.h"
+#include "GridSnapshotService.h"
+#include "HighlightModeRegistry.h"
 #include "Logger.h"
+#include "MemoryArena.h"
+#include "OccupantEventBus.h"
+#include "PluginEffectIndex.h"
+#include "ResidentialProximityOverlay.h"
 #include "SC4VersionDetection.h"
+#include "ServiceCoverageGapMap.h"
+#include "ThreadPool.h"
 #include "version.h"
+#include "cIGZAllocatorService.h"
+#include "cIGZCmdLine.h"
 #include "cIGZCOM.h"
 #include "cIGZFrameWork.h"
 #include "cIGZMessage2Standard.h"
 #include "cIGZMessageServer2.h"
+#include "cIGZPersistDBSegment.h"
+#include "cISC4App.h"
 #include "cISC4City.h"
 #include "cISC4SimGrid.h"
+#include "cRZAutoRefCount.h"
+#include "cRZBaseString.h"
 #include "cRZMessage2COMDirector.h"
 #include "GZServPtrs.h"
 #include "wil/result.h"
+#include <algorithm>
 #include <array>
+#include <cstdlib>
+#include <thread>
 
 static constexpr uint32_t kSC4MessagePostCityInit = 0x26D31EC1;
 static constexpr uint32_t kSC4MessagePreCityShutdown = 0x26D31EC2;
+static constexpr uint32_t kSC4MessageLoad = 0x26C63341;
+static constexpr uint32_t kSC4MessageSave = 0x26C63344;
+static constexpr uint32_t kSC4MessageSimNewMonth = 0x66956816;
 
-static constexpr std::array<uint32_t, 2> RequiredNotifications
+// The number of steps in the monthly analytics cache refresh task.
+static constexpr uint32_t AnalyticsRefreshStepCount = 5;
+
+static constexpr std::array<uint32_t, 5> RequiredNotifications
 {
 	kSC4MessagePostCityInit,
 	kSC4MessagePreCityShutdown,
+	kSC4MessageLoad,
+	kSC4MessageSave,
+	kSC4MessageSimNewMonth,
 };
 
 static constexpr uint32_t kDataViewExtensionsDllDirector = 0xEFB723C6;
 
 cISC4AuraSimulator* spAura = nullptr;
 cISC4OccupantManager* spOccupantManager = nullptr;
+AuraIsolineManager* spAuraIsolineManager = nullptr;
+AuraRegionManager* spAuraRegionManager = nullptr;
+OccupantEventBus* spOccupantEventBus = nullptr;
+CoverageManager* spCoverageManager = nullptr;
+EffectPropertyCache* spEffectPropertyCache = nullptr;
+EffectRankingManager* spEffectRankingManager = nullptr;
+ThreadPool* spThreadPool = nullptr;
+GridSnapshotService* spGridSnapshotService = nullptr;
+PluginEffectIndex* spPluginEffectIndex = nullptr;
+HighlightModeRegistry* spHighlightModeRegistry = nullptr;
+BuildingAttributeIndex* spBuildingAttributeIndex = nullptr;
+ResidentialProximityOverlay* spResidentialProximityOverlay = nullptr;
+GridPyramidService* spGridPyramidService = nullptr;
+ServiceCoverageGapMap* spServiceCoverageGapMap = nullptr;
+AuraExposureEngine* spAuraExposureEngine = nullptr;
+FrameTaskScheduler* spFrameTaskScheduler = nullptr;
+DataViewHighlightManager* spDataViewHighlightManager = nullptr;
 
 class DataViewExtensionsDllDirector final : public cRZMessage2COMDirector
 {
 public:
 	DataViewExtensionsDllDirector()
+		: analyticsRefreshTask(FrameTaskScheduler::InvalidTaskID)
 	{
 		Logger& logger = Logger::GetInstance();
 		logger.Init(FileSystem::GetLogFilePath(), LogLevel::Error);
 		logger.WriteLogFileHeader("SC4DataViewExtensions v" PLUGIN_VERSION_STR);
+
+		spOccupantEventBus = &occupantEventBus;
+		spAuraIsolineManager = &auraIsolineManager;
+		spAuraRegionManager = &auraRegionManager;
+		spCoverageManager = &coverageManager;
+		spEffectPropertyCache = &effectPropertyCache;
+		spEffectRankingManager = &effectRankingManager;
+		spThreadPool = &threadPool;
+		spGridSnapshotService = &gridSnapshotService;
+		spPluginEffectIndex = &pluginEffectIndex;
+		spHighlightModeRegistry = &highlightModeRegistry;
+		spBuildingAttributeIndex = &buildingAttributeIndex;
+		spResidentialProximityOverlay = &residentialProximityOverlay;
+		spGridPyramidService = &gridPyramidService;
+		spServiceCoverageGapMap = &serviceCoverageGapMap;
+		spAuraExposureEngine = &auraExposureEngine;
+		spFrameTaskScheduler = &frameTaskScheduler;
+		spDataViewHighlightManager = &dataViewHighlightManager;
 	}
 
 	uint32_t GetDirectorID() const
@@ -88,6 +162,8 @@ public:
 
 	bool PostAppInit()
 	{
+		Logger& logger = Logger::GetInstance();
+
 		cIGZMessageServer2Ptr pMsgServ;
 		if (pMsgServ)
 		{
@@ -97,6 +173,56 @@ public:
 			}
 		}
 
+		cIGZAllocatorServicePtr pAllocatorService;
+		if (pAllocatorService)
+		{
+			MemoryArenas::SetUseGameAllocator(true);
+		}
+
+		threadPool.Start(GetThreadPoolWorkerCount());
+		logger.WriteLineFormatted(
+			LogLevel::Info,
+			"Started %u worker threads.",
+			threadPool.GetWorkerCount());
+
+		frameTaskScheduler.SetBaseBudget(GetFrameTaskBudget());
+
+		if (!mpFrameWork->AddSystemService(&frameTaskScheduler)
+			|| !mpFrameWork->AddToTick(&frameTaskScheduler))
+		{
+			logger.WriteLine(LogLevel::Error, "Failed to register the frame task scheduler.");
+			// The deferred work runs when it is requested instead.
+			spFrameTaskScheduler = nullptr;
+		}
+
+		highlightModeRegistry.Load(FileSystem::GetConfigFilePath());
+
+		if (highlightModeRegistry.GetCount() > 0)
+		{
+			logger.WriteLineFormatted(
+				LogLevel::Info,
+				"Loaded %u custom highlight modes.",
+				highlightModeRegistry.GetCount());
+		}
+
+		coverageManager.Init();
+		effectRankingManager.Init();
+		buildingAttributeIndex.Init();
+
+		pluginEffectIndex.StartBuild(GetPluginDirectories(), FileSystem::GetPluginEffectIndexCachePath());
+
+		return true;
+	}
+
+	bool PreAppShutdown()
+	{
+		mpFrameWork->RemoveFromTick(&frameTaskScheduler);
+		mpFrameWork->RemoveSystemService(&frameTaskScheduler);
+		frameTaskScheduler.Shutdown();
+
+		pluginEffectIndex.Cancel();
+		threadPool.Stop();
+
 		return true;
 	}
 
@@ -110,6 +236,16 @@ public:
 		case kSC4MessagePreCityShutdown:
 			PreCityShutdown();
 			break;
+		case kSC4MessageLoad:
+			Load(reinterpret_cast<cIGZMessage2Standard*>(pMsg));
+			break;
+		case kSC4MessageSave:
+			Save(reinterpret_cast<cIGZMessage2Standard*>(pMsg));
+			break;
+		case kSC4MessageSimNewMonth:
+			auraHistoryRecorder.RecordMonth();
+			ScheduleAnalyticsRefresh();
+			break;
 		}
 
 		return true;
@@ -123,14 +259,232 @@ public:
 		{
 			spAura = pCity->GetAuraSimulator();
 			spOccupantManager = pCity->GetOccupantManager();
+
+			frameTaskScheduler.SetSimulator(pCity->GetSimulator());
+			occupantEventBus.PostCityInit(pCity);
+			residentialProximityOverlay.PostCityInit(pCity);
+			auraHistoryRecorder.PostCityInit(pCity->GetHistoryWarehouse());
+			serviceCoverageGapMap.PostCityInit(pCity);
+			auraExposureEngine.PostCityInit(pCity);
+
+			DataViewLuaFunctions::Register(pCity->GetAdvisorSystem());
 		}
 	}
 
 	void PreCityShutdown()
 	{
+		// The pending tasks can reference the city's simulators.
+		frameTaskScheduler.CancelAll();
+		frameTaskScheduler.SetSimulator(nullptr);
+
+		occupantEventBus.PreCityShutdown();
+		effectPropertyCache.Clear();
+		auraIsolineManager.PreCityShutdown();
+		auraRegionManager.PreCityShutdown();
+		auraHistoryRecorder.PreCityShutdown();
+		gridPyramidService.PreCityShutdown();
+		gridSnapshotService.PreCityShutdown();
+		residentialProximityOverlay.PreCityShutdown();
+		serviceCoverageGapMap.PreCityShutdown();
+		auraExposureEngine.PreCityShutdown();
+		MemoryArenas::ResetCityArenas();
+
 		spAura = nullptr;
 		spOccupantManager = nullptr;
 	}
+
+	void Load(cIGZMessage2Standard* pStandardMsg)
+	{
+		cRZAutoRefCount<cIGZPersistDBSegment> pSegment;
+
+		if (GetMessageSegment(pStandardMsg, pSegment))
+		{
+			CoverageIndex index;
+
+			// A missing or invalid record is not an error, the coverage maps
+			// are rebuilt from the city's occupants in that case.
+			if (CoverageIndexRecord::Read(pSegment, index))
+			{
+				coverageManager.SetPendingIndex(std::move(index));
+			}
+		}
+	}
+
+	void Save(cIGZMessage2Standard* pStandardMsg)
+	{
+		cRZAutoRefCount<cIGZPersistDBSegment> pSegment;
+
+		if (GetMessageSegment(pStandardMsg, pSegment))
+		{
+			CoverageIndex index;
+
+			if (coverageManager.GetIndex(index)
+				&& !CoverageIndexRecord::Write(pSegment, index))
+			{
+				Logger::GetInstance().WriteLine(LogLevel::Error, "Failed to save the coverage index.");
+			}
+		}
+	}
+
+private:
+
+	static bool GetMessageSegment(
+		cIGZMessage2Standard* pStandardMsg,
+		cRZAutoRefCount<cIGZPersistDBSegment>& pSegment)
+	{
+		cIGZUnknown* pUnknown = pStandardMsg->GetIGZUnknown();
+
+		return pUnknown && pUnknown->QueryInterface(GZIID_cIGZPersistDBSegment, pSegment.AsPPVoid());
+	}
+
+	static std::vector<PluginDirectory> GetPluginDirectories()
+	{
+		std::vector<PluginDirectory> directories;
+
+		cISC4AppPtr pSC4App;
+
+		if (pSC4App)
+		{
+			// The game's data files are loaded first, followed by the plugins.
+			cRZBaseString dataDirectory;
+			cRZBaseString pluginDirectory;
+			cRZBaseString userPluginDirectory;
+
+			if (pSC4App->GetDataDirectory(dataDirectory))
+			{
+				directories.push_back(PluginDirectory{ std::filesystem::path(dataDirectory.ToChar()), false });
+			}
+
+			if (pSC4App->GetPluginDirectory(pluginDirectory))
+			{
+				directories.push_back(PluginDirectory{ std::filesystem::path(pluginDirectory.ToChar()), true });
+			}
+
+			if (pSC4App->GetUserPluginDirectory(userPluginDirectory))
+			{
+				directories.push_back(PluginDirectory{ std::filesystem::path(userPluginDirectory.ToChar()), true });
+			}
+		}
+
+		return directories;
+	}
+
+	void ScheduleAnalyticsRefresh()
+	{
+		// The analytics caches are refreshed over several frames after each month,
+		// so opening a data view does not have to rebuild them all at once.
+		if (frameTaskScheduler.IsScheduled(analyticsRefreshTask))
+		{
+			return;
+		}
+
+		analyticsRefreshTask = frameTaskScheduler.Schedule(
+			"analytics refresh",
+			FrameTaskScheduler::Priority::Low,
+			[this, step = 0U](const FrameBudget& budget) mutable
+			{
+				do
+				{
+					RefreshAnalytics(step++);
+				} while (step < AnalyticsRefreshStepCount && !budget.IsExhausted());
+
+				return step >= AnalyticsRefreshStepCount;
+			});
+	}
+
+	void RefreshAnalytics(uint32_t step)
+	{
+		switch (step)
+		{
+		case 0:
+			gridPyramidService.GetPyramid(SnapshotGrid::Aura);
+			break;
+		case 1:
+			gridPyramidService.GetPyramid(SnapshotGrid::ParkMap);
+			break;
+		case 2:
+			gridPyramidService.GetPyramid(SnapshotGrid::LandmarkMap);
+			break;
+		case 3:
+			auraExposureEngine.GetCurve(SnapshotGrid::Aura, AuraExposureEngine::Tier::AllResidents);
+			break;
+		case 4:
+			serviceCoverageGapMap.RequestUpdate();
+			break;
+		}
+	}
+
+	double GetFrameTaskBudget()
+	{
+		// The -DataViewFrameBudget command line argument sets the number of
+		// milliseconds that the DLL's deferred tasks can use in each frame.
+		double budget = FrameTaskScheduler::DefaultBudget;
+
+		cIGZCmdLine* pCmdLine = mpFrameWork->CommandLine();
+
+		if (pCmdLine)
+		{
+			cRZBaseString value;
+
+			if (pCmdLine->IsSwitchPresent(cRZBaseString("DataViewFrameBudget"), value, true))
+			{
+				const double milliseconds = std::strtod(value.ToChar(), nullptr);
+
+				if (milliseconds > 0.0)
+				{
+					budget = milliseconds;
+				}
+			}
+		}
+
+		return budget;
+	}
+
+	uint32_t GetThreadPoolWorkerCount()
+	{
+		// The -CPUCount command line argument limits the number of processors
+		// the game uses, the DLL's workers are limited to the same processors.
+		uint32_t processorCount = std::thread::hardware_concurrency();
+
+		cIGZCmdLine* pCmdLine = mpFrameWork->CommandLine();
+
+		if (pCmdLine)
+		{
+			cRZBaseString value;
+
+			if (pCmdLine->IsSwitchPresent(cRZBaseString("CPUCount"), value, true))
+			{
+				const unsigned long cpuCount = std::strtoul(value.ToChar(), nullptr, 10);
+
+				if (cpuCount > 0)
+				{
+					processorCount = std::min(processorCount, static_cast<uint32_t>(cpuCount));
+				}
+			}
+		}
+
+		return ThreadPool::GetSpareProcessorCount(processorCount);
+	}
+
+	OccupantEventBus occupantEventBus;
+	AuraIsolineManager auraIsolineManager;
+	AuraRegionManager auraRegionManager;
+	CoverageManager coverageManager;
+	EffectPropertyCache effectPropertyCache;
+	EffectRankingManager effectRankingManager;
+	ThreadPool threadPool;
+	GridSnapshotService gridSnapshotService;
+	PluginEffectIndex pluginEffectIndex;
+	HighlightModeRegistry highlightModeRegistry;
+	BuildingAttributeIndex buildingAttributeIndex;
+	ResidentialProximityOverlay residentialProximityOverlay;
+	GridPyramidService gridPyramidService;
+	AuraHistoryRecorder auraHistoryRecorder;
+	ServiceCoverageGapMap serviceCoverageGapMap;
+	AuraExposureEngine auraExposureEngine;
+	FrameTaskScheduler frameTaskScheduler;
+	DataViewHighlightManager dataViewHighlightManager;
+	FrameTaskScheduler::TaskID analyticsRefreshTask;
 };
 
 cRZCOMDllDirector* RZGetCOMDllDirector() {
@@ -11,41 +11,89 @@
 ////////////////////////////////////////////////////////////////////////
 
 #include "DataViewHighlightManager.h"
-#include "cIGZMessage2Standard.h"
-#include "cIGZMessageServer2.h"
 #include "cISC4Occupant.h"
+#include "BuildingAgeFilter.h"
+#include "BuildingAttributeIndex.h"
+#include "BuildingProfileFilter.h"
+#include "EffectPropertyCache.h"
 #include "GlobalPointers.h"
-#include "GZCLSIDDefs.h"
-#include "GZServPtrs.h"
+#include "HighlightModeRegistry.h"
+#include "HighlightProgramFilter.h"
 #include "LandmarkEffectFilter.h"
+#include "MemoryArena.h"
+#include "OccupantEventBus.h"
+#include "OccupantTypes.h"
 #include "ParkEffectFilter.h"
 #include <algorithm>
-#include <array>
+#include <cmath>
 #include <vector>
 
-static const uint32_t kSC4MessageInsertOccupant = 0x99EF1142;
-static const uint32_t kSC4MessageRemoveOccupant = 0x99EF1143;
-
-static constexpr std::array<uint32_t, 2> RequiredNotifications =
-{
-	kSC4MessageInsertOccupant,
-	kSC4MessageRemoveOccupant,
-};
+// The number of occupants that the scan adds between the frame budget checks.
+static constexpr size_t kScanBatchSize = 64;
 
 DataViewHighlightManager::DataViewHighlightManager()
-	: refCount(0)
+	: highlightType(DataViewHighlightNone),
+	  occupantType(kOccupantTypeBuilding),
+	  effectPropertyID(0),
+	  defaultRadius(kDefaultHighlightRadius),
+	  latestConstructionDate(0),
+	  affectedOccupants(MemoryArenas::Get(MemorySubsystem::Highlights)),
+	  spatialIndex(),
+	  scanPosition(0),
+	  scanCompleted(true),
+	  scanTask(
+		"highlight scan",
+		FrameTaskScheduler::Priority::Normal,
+		[this](const FrameBudget& budget) { return ScanOccupants(budget); }),
+	  pendingChangesTask(
+		"highlight update",
+		FrameTaskScheduler::Priority::High,
+		[this](const FrameBudget&)
+		{
+			ApplyPendingChanges();
+			return true;
+		})
 {
 }
 
-void DataViewHighlightManager::Init(uint32_t highlightType)
+void DataViewHighlightManager::Init(uint32_t highlightType, ScanCompletedCallback scanCompleted)
 {
+	this->highlightType = highlightType;
+
 	switch (highlightType)
 	{
 	case DataViewHighlightParkEffect:
 		occupantFilter = new ParkEffectFilter();
+		effectPropertyID = kParkEffectProperty;
 		break;
 	case DataViewHighlightLandmarkEffect:
 		occupantFilter = new LandmarkEffectFilter();
+		effectPropertyID = kLandmarkEffectProperty;
+		break;
+	default:
+		switch (highlightType & DataViewHighlightCategoryMask)
+		{
+		case DataViewHighlightBuildingProfile:
+			occupantFilter = new BuildingProfileFilter(highlightType & 0xFFFF, (highlightType >> 16) & 0xFF);
+			break;
+		case DataViewHighlightBuildingAge:
+			latestConstructionDate = spBuildingAttributeIndex->GetLatestConstructionDate(highlightType & 0xFFFF);
+			occupantFilter = new BuildingAgeFilter(latestConstructionDate);
+			break;
+		default:
+		{
+			const HighlightModeDefinition* definition = spHighlightModeRegistry->Find(highlightType);
+
+			if (definition)
+			{
+				occupantFilter = new HighlightProgramFilter(*definition);
+				occupantType = definition->occupantType;
+				effectPropertyID = definition->effectPropertyID;
+				defaultRadius = definition->radius;
+			}
+			break;
+		}
+		}
 		break;
 	}
 
@@ -53,140 +101,478 @@ void DataViewHighlightManager::Init(uint32_t highlightType)
 	{
 		if (spOccupantManager)
 		{
-			spOccupantManager->IterateOccupants(
-				IterateOccupantsCallback,
-				this,
-				nullptr,
-				nullptr,
-			    static_cast<cISC4OccupantFilter*>(occupantFilter));
-
-			cIGZMessageServer2Ptr pMS2;
+			int cellCountX = 0;
+			int cellCountZ = 0;
 
-			if (pMS2)
+			if (spOccupantManager->GetWorldCellCount(cellCountX, cellCountZ) && cellCountX > 0 && cellCountZ > 0)
 			{
-				for (uint32_t messageID : RequiredNotifications)
-				{
-					pMS2->AddNotification(this, messageID);
-				}
+				spatialIndex.Init(static_cast<uint32_t>(cellCountX), static_cast<uint32_t>(cellCountZ));
 			}
+
+			// Each highlight filter only includes a single occupant type.
+			// The changes that arrive while the scan is running are applied when it completes.
+			spOccupantEventBus->Subscribe(this, occupantType);
+
+			this->scanCompleted = false;
+			scanCompletedCallback = std::move(scanCompleted);
+			scanTask.Request();
 		}
 	}
 }
 
 void DataViewHighlightManager::Shutdown()
 {
-	for (cISC4Occupant* pOccupant : affectedOccupants)
+	scanTask.Cancel();
+	pendingChangesTask.Cancel();
+	ClearScannedOccupants();
+	scanCompleted = true;
+	scanCompletedCallback = nullptr;
+
+	for (const HighlightedOccupant& item : affectedOccupants)
 	{
-		pOccupant->Release();
+		item.pOccupant->Release();
 	}
 
+	// The list storage is freed so that the highlight arena can be reset at city shutdown.
 	affectedOccupants.clear();
+	affectedOccupants.shrink_to_fit();
+	listedOccupants.clear();
+	ClearPendingChanges();
+	spatialIndex.Shutdown();
 	occupantFilter.Reset();
+	highlightType = DataViewHighlightNone;
+	occupantType = kOccupantTypeBuilding;
+	effectPropertyID = 0;
+	defaultRadius = kDefaultHighlightRadius;
+	latestConstructionDate = 0;
 
-	cIGZMessageServer2Ptr pMS2;
+	spOccupantEventBus->Unsubscribe(this);
+}
 
-	if (pMS2)
-	{
-		for (uint32_t messageID : RequiredNotifications)
-		{
-			pMS2->RemoveNotification(this, messageID);
-		}
-	}
+bool DataViewHighlightManager::IsHighlightTypeSupported(uint32_t highlightType)
+{
+	return IsBuiltInHighlightType(highlightType)
+		|| spHighlightModeRegistry->Find(highlightType) != nullptr;
+}
+
+bool DataViewHighlightManager::IsBuiltInHighlightType(uint32_t highlightType)
+{
+	const uint32_t category = highlightType & DataViewHighlightCategoryMask;
+
+	return highlightType == DataViewHighlightParkEffect
+		|| highlightType == DataViewHighlightLandmarkEffect
+		|| category == DataViewHighlightBuildingProfile
+		|| category == DataViewHighlightBuildingAge;
+}
+
+uint32_t DataViewHighlightManager::GetHighlightType() const
+{
+	return highlightType;
 }
 
-const std::vector<cISC4Occupant*>& DataViewHighlightManager::GetAffectedOccupants()
+const std::pmr::vector<HighlightedOccupant>& DataViewHighlightManager::GetAffectedOccupants()
 {
+	// The building age list also changes when the date advances.
+	pendingChangesTask.Request();
+
 	return affectedOccupants;
 }
 
-bool DataViewHighlightManager::QueryInterface(uint32_t riid, void** ppvObj)
+void DataViewHighlightManager::FindNearest(long x, long z, size_t count, std::vector<HighlightedOccupant>& output)
 {
-	if (riid == GZCLSID::kcIGZMessageTarget2)
+	output.clear();
+
+	// The query is answered from the last applied list, so a Lua call does not
+	// have to wait for the pending changes to be decoded.
+	pendingChangesTask.Request();
+
+	if (!spatialIndex.IsInitialized())
 	{
-		*ppvObj = static_cast<cIGZMessageTarget2*>(this);
-		AddRef();
+		return;
+	}
 
-		return true;
+	std::vector<cISC4Occupant*> occupants;
+	spatialIndex.FindNearest(x, z, count, occupants);
+
+	output.reserve(occupants.size());
+
+	for (cISC4Occupant* pOccupant : occupants)
+	{
+		// The effect values come from the property cache, so this avoids
+		// searching the highlight list for each occupant.
+		output.push_back(CreateHighlightedOccupant(pOccupant));
 	}
-	else if (riid ==GZIID_cIGZUnknown)
+}
+
+void DataViewHighlightManager::OccupantInserted(cISC4Occupant* pOccupant)
+{
+	if (occupantFilter && occupantFilter->IsOccupantIncluded(pOccupant))
 	{
-		*ppvObj = static_cast<cIGZUnknown*>(this);
-		AddRef();
+		QueueOccupantInserted(pOccupant);
+		pendingChangesTask.Request();
+	}
+}
 
-		return true;
+void DataViewHighlightManager::OccupantRemoved(cISC4Occupant* pOccupant)
+{
+	if (occupantFilter && occupantFilter->IsOccupantIncluded(pOccupant))
+	{
+		QueueOccupantRemoved(pOccupant);
+		pendingChangesTask.Request();
 	}
+}
 
-	return false;
+void DataViewHighlightManager::PreCityShutdown()
+{
+	// The occupants are about to be destroyed, so the references to them are released
+	// before the city memory arenas are reset.
+	Shutdown();
 }
 
-uint32_t DataViewHighlightManager::AddRef()
+bool DataViewHighlightManager::IterateOccupantsCallback(cISC4Occupant* pOccupant, void* pContext)
 {
-	return ++refCount;
+	pOccupant->AddRef();
+	static_cast<DataViewHighlightManager*>(pContext)->scannedOccupants.push_back(pOccupant);
+	return true;
 }
 
-uint32_t DataViewHighlightManager::Release()
+bool DataViewHighlightManager::GetIndexedOccupants(std::vector<cISC4Occupant*>& output) const
 {
-	if (refCount > 0)
+	bool result = true;
+
+	switch (highlightType & DataViewHighlightCategoryMask)
 	{
-		--refCount;
+	case DataViewHighlightBuildingProfile:
+		spBuildingAttributeIndex->GetBuildingsByProfile(highlightType & 0xFFFF, (highlightType >> 16) & 0xFF, output);
+		break;
+	case DataViewHighlightBuildingAge:
+		spBuildingAttributeIndex->GetBuildingsBuiltBefore(latestConstructionDate, output);
+		break;
+	default:
+		result = false;
+		break;
 	}
 
-	return refCount;
+	return result;
 }
 
-bool DataViewHighlightManager::DoMessage(cIGZMessage2* pMsg)
+bool DataViewHighlightManager::ScanOccupants(const FrameBudget& budget)
 {
-	cIGZMessage2Standard* pStandardMsg = static_cast<cIGZMessage2Standard*>(pMsg);
-	const uint32_t type = pStandardMsg->GetType();
-
-	if (type == kSC4MessageInsertOccupant)
+	if (scannedOccupants.empty())
 	{
-		cISC4Occupant* pOccupant = static_cast<cISC4Occupant*>(pStandardMsg->GetVoid1());
+		// The occupants are collected in the first slice, the game can't
+		// split its occupant iteration between frames.
+		if (GetIndexedOccupants(scannedOccupants))
+		{
+			for (cISC4Occupant* pOccupant : scannedOccupants)
+			{
+				pOccupant->AddRef();
+			}
+		}
+		else
+		{
+			spOccupantManager->IterateOccupants(
+				IterateOccupantsCallback,
+				this,
+				nullptr,
+				nullptr,
+				static_cast<cISC4OccupantFilter*>(occupantFilter));
+		}
+
+		affectedOccupants.reserve(scannedOccupants.size());
+		listedOccupants.reserve(scannedOccupants.size());
 
-		if (occupantFilter && occupantFilter->IsOccupantIncluded(pOccupant))
+		for (cISC4Occupant* pOccupant : scannedOccupants)
 		{
-			OccupantInserted(pOccupant);
+			listedOccupants.insert(pOccupant);
+
+			// An occupant that was inserted before the scan started is already
+			// in the scan results.
+			auto item = pendingChanges.find(pOccupant);
+
+			if (item != pendingChanges.end())
+			{
+				pOccupant->Release();
+				pendingChanges.erase(item);
+			}
 		}
 	}
-	else if (type == kSC4MessageRemoveOccupant)
+
+	// Decoding the effect properties is the expensive part, so the occupants
+	// are added in batches until the frame budget runs out.
+	while (scanPosition < scannedOccupants.size())
 	{
-		cISC4Occupant* pOccupant = static_cast<cISC4Occupant*>(pStandardMsg->GetVoid1());
+		const size_t batchEnd = std::min(scanPosition + kScanBatchSize, scannedOccupants.size());
+
+		for (; scanPosition < batchEnd; scanPosition++)
+		{
+			cISC4Occupant* pOccupant = scannedOccupants[scanPosition];
+
+			// The list takes ownership of the scan's reference.
+			affectedOccupants.push_back(CreateHighlightedOccupant(pOccupant));
+			AddToSpatialIndex(pOccupant);
+		}
 
-		if (occupantFilter && occupantFilter->IsOccupantIncluded(pOccupant))
+		if (scanPosition < scannedOccupants.size() && budget.IsExhausted())
 		{
-			OccupantRemoved(pOccupant);
+			return false;
 		}
 	}
 
+	ClearScannedOccupants();
+	SortAffectedOccupants();
+
+	scanCompleted = true;
+	ApplyPendingChanges();
+
+	if (scanCompletedCallback)
+	{
+		scanCompletedCallback();
+	}
+
 	return true;
 }
 
-bool DataViewHighlightManager::IterateOccupantsCallback(cISC4Occupant* pOccupant, void* pContext)
+void DataViewHighlightManager::ClearScannedOccupants()
 {
-	static_cast<DataViewHighlightManager*>(pContext)->OccupantInserted(pOccupant);
-	return true;
+	for (size_t i = scanPosition; i < scannedOccupants.size(); i++)
+	{
+		scannedOccupants[i]->Release();
+	}
+
+	scannedOccupants.clear();
+	scannedOccupants.shrink_to_fit();
+	scanPosition = 0;
 }
 
-void DataViewHighlightManager::OccupantInserted(cISC4Occupant* pOccupant)
+HighlightedOccupant DataViewHighlightManager::CreateHighlightedOccupant(cISC4Occupant* pOccupant) const
+{
+	// The effect property is decoded when the occupant is added to the list, the
+	// highlight refresh only reads the cached radius.
+
+	HighlightedOccupant item{ pOccupant, defaultRadius, 0.0f };
+
+	OccupantEffect effect{};
+
+	if (effectPropertyID != 0 && spEffectPropertyCache->GetEffect(pOccupant, effectPropertyID, effect))
+	{
+		item.radius = std::max(effect.radius, 0.0f);
+		item.strength = effect.strength;
+	}
+
+	return item;
+}
+
+void DataViewHighlightManager::SortAffectedOccupants()
 {
-	// Only add the item if it isn't already in the list.
+	// The strongest effects are highlighted first.
 
-	auto item = std::find(affectedOccupants.begin(), affectedOccupants.end(), pOccupant);
+	std::stable_sort(
+		affectedOccupants.begin(),
+		affectedOccupants.end(),
+		[](const HighlightedOccupant& lhs, const HighlightedOccupant& rhs)
+		{
+			return IsStrongerEffect(lhs.strength, rhs.strength);
+		});
+}
 
-	if (item == affectedOccupants.end())
+void DataViewHighlightManager::MergeAffectedOccupants(std::vector<HighlightedOccupant>& insertedOccupants)
+{
+	// The list is already sorted, so only the new occupants are sorted before
+	// they are merged into it.
+
+	if (insertedOccupants.empty())
+	{
+		return;
+	}
+
+	const auto compare = [](const HighlightedOccupant& lhs, const HighlightedOccupant& rhs)
+	{
+		return IsStrongerEffect(lhs.strength, rhs.strength);
+	};
+
+	std::stable_sort(insertedOccupants.begin(), insertedOccupants.end(), compare);
+
+	const size_t existingCount = affectedOccupants.size();
+	affectedOccupants.insert(affectedOccupants.end(), insertedOccupants.begin(), insertedOccupants.end());
+
+	std::inplace_merge(
+		affectedOccupants.begin(),
+		affectedOccupants.begin() + existingCount,
+		affectedOccupants.end(),
+		compare);
+}
+
+void DataViewHighlightManager::AddToSpatialIndex(cISC4Occupant* pOccupant)
+{
+	SC4Rect<long> footprint;
+
+	if (pOccupant->GetBoundingCityCells(footprint))
+	{
+		spatialIndex.Insert(pOccupant, footprint);
+	}
+}
+
+void DataViewHighlightManager::QueueOccupantInserted(cISC4Occupant* pOccupant)
+{
+	// The queue holds a reference to each pending insert so that the occupant
+	// stays alive until the batch is applied.
+
+	auto item = pendingChanges.find(pOccupant);
+
+	if (item != pendingChanges.end())
+	{
+		if (item->second == PendingChange::Remove)
+		{
+			// The occupant is still in the list.
+			pendingChanges.erase(item);
+		}
+	}
+	else if (listedOccupants.count(pOccupant) == 0)
 	{
 		pOccupant->AddRef();
-		affectedOccupants.push_back(pOccupant);
+		pendingChanges.emplace(pOccupant, PendingChange::Insert);
 	}
 }
 
-void DataViewHighlightManager::OccupantRemoved(cISC4Occupant* pOccupant)
+void DataViewHighlightManager::QueueOccupantRemoved(cISC4Occupant* pOccupant)
+{
+	auto item = pendingChanges.find(pOccupant);
+
+	if (item != pendingChanges.end())
+	{
+		if (item->second == PendingChange::Insert)
+		{
+			// The occupant was never added to the list.
+			pOccupant->Release();
+			pendingChanges.erase(item);
+		}
+	}
+	else if (listedOccupants.count(pOccupant) != 0)
+	{
+		pendingChanges.emplace(pOccupant, PendingChange::Remove);
+	}
+}
+
+void DataViewHighlightManager::QueueBuildingAgeChanges()
 {
-	auto item = std::find(affectedOccupants.begin(), affectedOccupants.end(), pOccupant);
+	if ((highlightType & DataViewHighlightCategoryMask) != DataViewHighlightBuildingAge || !occupantFilter)
+	{
+		return;
+	}
+
+	// The buildings get older as the simulator date advances, so the buildings
+	// that reached the age since the last update are added to the list.
+
+	const int32_t date = spBuildingAttributeIndex->GetLatestConstructionDate(highlightType & 0xFFFF);
 
-	if (item != affectedOccupants.end())
+	if (date == latestConstructionDate)
 	{
-		(*item)->Release();
-		affectedOccupants.erase(item);
+		return;
 	}
+
+	std::vector<cISC4Occupant*> changedBuildings;
+
+	if (date > latestConstructionDate)
+	{
+		spBuildingAttributeIndex->GetBuildingsBuiltBetween(latestConstructionDate + 1, date, changedBuildings);
+
+		for (cISC4Occupant* pOccupant : changedBuildings)
+		{
+			QueueOccupantInserted(pOccupant);
+		}
+	}
+	else
+	{
+		// The date only moves back if the simulator date was changed.
+		spBuildingAttributeIndex->GetBuildingsBuiltBetween(date + 1, latestConstructionDate, changedBuildings);
+
+		for (cISC4Occupant* pOccupant : changedBuildings)
+		{
+			QueueOccupantRemoved(pOccupant);
+		}
+	}
+
+	latestConstructionDate = date;
+
+	// The building age modes always use a BuildingAgeFilter, see Init.
+	BuildingAgeFilter* const pFilter = static_cast<BuildingAgeFilter*>(static_cast<cISC4OccupantFilter*>(occupantFilter));
+	pFilter->SetLatestConstructionDate(date);
+}
+
+void DataViewHighlightManager::ApplyPendingChanges()
+{
+	if (!scanCompleted)
+	{
+		// The scan applies the changes when it completes.
+		return;
+	}
+
+	QueueBuildingAgeChanges();
+
+	if (pendingChanges.empty())
+	{
+		return;
+	}
+
+	// The queue only holds real changes, see QueueOccupantInserted and QueueOccupantRemoved.
+
+	std::vector<HighlightedOccupant> insertedOccupants;
+	size_t removedCount = 0;
+
+	for (const auto& item : pendingChanges)
+	{
+		if (item.second == PendingChange::Insert)
+		{
+			// The list takes ownership of the queue's reference.
+			insertedOccupants.push_back(CreateHighlightedOccupant(item.first));
+			listedOccupants.insert(item.first);
+			AddToSpatialIndex(item.first);
+		}
+		else
+		{
+			removedCount++;
+		}
+	}
+
+	if (removedCount > 0)
+	{
+		auto newEnd = std::remove_if(
+			affectedOccupants.begin(),
+			affectedOccupants.end(),
+			[this](const HighlightedOccupant& highlighted)
+			{
+				cISC4Occupant* pOccupant = highlighted.pOccupant;
+
+				auto item = pendingChanges.find(pOccupant);
+
+				if (item == pendingChanges.end() || item->second != PendingChange::Remove)
+				{
+					return false;
+				}
+
+				listedOccupants.erase(pOccupant);
+				spatialIndex.Remove(pOccupant);
+				pOccupant->Release();
+				return true;
+			});
+
+		affectedOccupants.erase(newEnd, affectedOccupants.end());
+	}
+
+	pendingChanges.clear();
+	MergeAffectedOccupants(insertedOccupants);
+}
+
+void DataViewHighlightManager::ClearPendingChanges()
+{
+	for (const auto& item : pendingChanges)
+	{
+		if (item.second == PendingChange::Insert)
+		{
+			item.first->Release();
+		}
+	}
+
+	pendingChanges.clear();
 }
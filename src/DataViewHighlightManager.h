@@ -11,10 +11,16 @@
 ////////////////////////////////////////////////////////////////////////
 
 #pragma once
-#include "cIGZMessageTarget2.h"
+#include "FrameTaskScheduler.h"
+#include "IOccupantEventSubscriber.h"
+#include "OccupantSpatialIndex.h"
 #include "cISC4Occupant.h"
 #include "cISC4OccupantFilter.h"
 #include "cRZAutoRefCount.h"
+#include <functional>
+#include <memory_resource>
+#include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
 enum DataViewHighlight : uint32_t
@@ -39,41 +45,120 @@ enum DataViewHighlight : uint32_t
 
 	DataViewHighlightParkEffect = 10,
 	DataViewHighlightLandmarkEffect = 11,
+
+	// The building attribute highlight modes store their parameters
+	// in the low 24 bits of the value.
+	//
+	// BuildingProfile: 0x01WWPPPP, where WW is the wealth mask and PPPP is
+	// the purpose mask. See BuildingAttributeIndex for the mask format.
+	// BuildingAge: 0x0200YYYY, buildings that are at least YYYY years old.
+
+	DataViewHighlightBuildingProfile = 0x01000000,
+	DataViewHighlightBuildingAge = 0x02000000,
 };
 
-class cIGZMessage2Standard;
+static constexpr uint32_t DataViewHighlightCategoryMask = 0xFF000000;
+
+// The radius that is used when an occupant's effect property can't be decoded.
+static constexpr float kDefaultHighlightRadius = 128.0f;
+
+struct HighlightedOccupant
+{
+	cISC4Occupant* pOccupant;
+	// The highlight radius in meters.
+	float radius;
+	// The effect strength, used to order the highlights.
+	float strength;
+};
 
-class DataViewHighlightManager : private cIGZMessageTarget2
+class DataViewHighlightManager : private IOccupantEventSubscriber
 {
 public:
+	typedef std::function<void()> ScanCompletedCallback;
+
 	DataViewHighlightManager();
 
-	void Init(uint32_t highlightType);
+	// Starts a frame task that finds the occupants to highlight, the callback
+	// is called on the game thread when the list is complete.
+	void Init(uint32_t highlightType, ScanCompletedCallback scanCompleted);
 	void Shutdown();
 
-	const std::vector<cISC4Occupant*>& GetAffectedOccupants();
+	// Returns true if the highlight type is implemented by the DLL, this
+	// includes the highlight modes that are defined in the INI file.
+	static bool IsHighlightTypeSupported(uint32_t highlightType);
 
-private:
+	// Returns true if the highlight type is implemented in code.
+	static bool IsBuiltInHighlightType(uint32_t highlightType);
 
-	// cIGZUnknown
+	uint32_t GetHighlightType() const;
+	// The occupants are ordered from the strongest to the weakest effect.
+	// This is called when the game refreshes the highlights, the occupant changes
+	// are applied by a frame task and show up in a later refresh.
+	const std::pmr::vector<HighlightedOccupant>& GetAffectedOccupants();
 
-	bool QueryInterface(uint32_t riid, void** ppvObj);
-	uint32_t AddRef();
-	uint32_t Release();
+	// Gets up to count highlighted occupants ordered by the distance from the
+	// cell to the nearest cell of their footprint, starting with the closest.
+	// The result reflects the last applied list, the pending occupant changes
+	// are applied by a frame task like they are for GetAffectedOccupants.
+	void FindNearest(long x, long z, size_t count, std::vector<HighlightedOccupant>& output);
 
-	// cIGZMessageTarget2
+private:
+
+	// IOccupantEventSubscriber
 
-	bool DoMessage(cIGZMessage2* pMsg);
+	void OccupantInserted(cISC4Occupant* pOccupant);
+	void OccupantRemoved(cISC4Occupant* pOccupant);
+	void PreCityShutdown();
 
 	// Private members
 
 	static bool IterateOccupantsCallback(cISC4Occupant* pOccupant, void* pContext);
 
-	void OccupantInserted(cISC4Occupant* pOccupant);
-	void OccupantRemoved(cISC4Occupant* pOccupant);
-
-	uint32_t refCount;
+	bool GetIndexedOccupants(std::vector<cISC4Occupant*>& output) const;
+
+	bool ScanOccupants(const FrameBudget& budget);
+	void ClearScannedOccupants();
+
+	HighlightedOccupant CreateHighlightedOccupant(cISC4Occupant* pOccupant) const;
+	void SortAffectedOccupants();
+	void MergeAffectedOccupants(std::vector<HighlightedOccupant>& insertedOccupants);
+	void AddToSpatialIndex(cISC4Occupant* pOccupant);
+
+	void QueueBuildingAgeChanges();
+	void QueueOccupantInserted(cISC4Occupant* pOccupant);
+	void QueueOccupantRemoved(cISC4Occupant* pOccupant);
+	void ApplyPendingChanges();
+	void ClearPendingChanges();
+
+	enum class PendingChange : uint8_t
+	{
+		Insert = 0,
+		Remove = 1
+	};
+
+	uint32_t highlightType;
+	uint32_t occupantType;
+	uint32_t effectPropertyID;
+	float defaultRadius;
+	int32_t latestConstructionDate;
 	cRZAutoRefCount<cISC4OccupantFilter> occupantFilter;
-	std::vector<cISC4Occupant*> affectedOccupants;
+	std::pmr::vector<HighlightedOccupant> affectedOccupants;
+	OccupantSpatialIndex spatialIndex;
+	// The net change for each occupant that was inserted or removed since the
+	// last highlight update. Each entry changes the list: an insert is only queued
+	// for an occupant that is not listed, and a remove for one that is.
+	// An insert followed by a remove cancels out, as does a remove followed by an insert.
+	std::unordered_map<cISC4Occupant*, PendingChange> pendingChanges;
+	// The occupants that are in the list or waiting to be added by the scan.
+	// This lets the queue drop duplicate insert and remove messages.
+	std::unordered_set<cISC4Occupant*> listedOccupants;
+	// The occupants that the scan found, each one holds a reference until it is
+	// added to the list.
+	std::vector<cISC4Occupant*> scannedOccupants;
+	size_t scanPosition;
+	bool scanCompleted;
+	ScanCompletedCallback scanCompletedCallback;
+	FrameTaskRequest scanTask;
+	FrameTaskRequest pendingChangesTask;
 };
 
@@ -0,0 +1,484 @@
+////////////////////////////////////////////////////////////////////////
+//
+// This file is part of sc4-data-view-extensions, a DLL Plugin for
+// SimCity 4 that extends the game's data views.
+//
+// Copyright (c) 2024 Nicholas Hayes
+//
+// This file is licensed under terms of the MIT License.
+// See LICENSE.txt for more information.
+//
+////////////////////////////////////////////////////////////////////////
+
+#include "DataViewLuaFunctions.h"
+#include "AuraExposureEngine.h"
+#include "AuraIsolineManager.h"
+#include "CoverageManager.h"
+#include "DataViewHighlightManager.h"
+#include "EffectRankingManager.h"
+#include "GlobalPointers.h"
+#include "GridPyramidService.h"
+#include "GridSnapshotService.h"
+#include "Logger.h"
+#include "ServiceCoverageGapMap.h"
+#include "cISC4AdvisorSystem.h"
+#include "cISC4Occupant.h"
+#include "cS3DVector3.h"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <vector>
+
+// SCLuaUtil.h and cISCLua.h are newer than the gzcom-dll vendor snapshot, this
+// vendor's cISC4AdvisorSystem.h only forward declares cISCLua. The Lua functions
+// are built when those headers are added to the vendor include directory.
+#if __has_include("SCLuaUtil.h") && __has_include("cISCLua.h")
+#define HAS_SCLUA_HEADERS 1
+#include "cISCLua.h"
+#include "SCLuaUtil.h"
+#else
+#define HAS_SCLUA_HEADERS 0
+#endif
+
+#if HAS_SCLUA_HEADERS
+namespace
+{
+	constexpr const char* LuaTableName = "game";
+
+	// The width of a city cell in meters.
+	constexpr float CellWidth = 16.0f;
+
+	// The most items that a packed array result can contain.
+	constexpr size_t MaxTopLandmarks = 256;
+	constexpr size_t MaxNearestHighlights = 256;
+	constexpr size_t MaxIsolineValues = 65536;
+
+	int32_t GetIntegerArgument(cISCLua* pLua, int32_t index)
+	{
+		return static_cast<int32_t>(std::floor(pLua->ToNumber(index)));
+	}
+
+	void SetTableField(cISCLua* pLua, const char* name, double value)
+	{
+		pLua->PushString(name);
+		pLua->PushNumber(value);
+		pLua->SetTable(-3);
+	}
+
+	void SetArrayItem(cISCLua* pLua, int32_t index, double value)
+	{
+		pLua->PushNumber(index);
+		pLua->PushNumber(value);
+		pLua->SetTable(-3);
+	}
+
+	const CoverageMap* GetCoverageLayer(int32_t layer)
+	{
+		const CoverageMap* map = nullptr;
+
+		if (spCoverageManager)
+		{
+			if (layer == 0)
+			{
+				map = &spCoverageManager->GetParkCoverage();
+			}
+			else if (layer == 1)
+			{
+				map = &spCoverageManager->GetLandmarkCoverage();
+			}
+		}
+
+		return map && map->IsInitialized() ? map : nullptr;
+	}
+
+	int GridStats(lua_State* pState)
+	{
+		cRZAutoRefCount<cISCLua> pLua = SCLuaUtil::GetISCLuaFromFunctionState(pState);
+
+		if (!pLua)
+		{
+			return 0;
+		}
+
+		if (pLua->GetTop() < 5)
+		{
+			pLua->PushNil();
+			return 1;
+		}
+
+		const int32_t grid = GetIntegerArgument(pLua, 1);
+
+		if (grid < 0 || grid >= static_cast<int32_t>(SnapshotGrid::Count))
+		{
+			pLua->PushNil();
+			return 1;
+		}
+
+		const SnapshotGrid snapshotGrid = static_cast<SnapshotGrid>(grid);
+		const GridPyramid* pyramid = spGridPyramidService->GetPyramid(snapshotGrid);
+		const std::shared_ptr<const GridSnapshot> snapshot = spGridSnapshotService->GetSnapshot(snapshotGrid);
+
+		if (!pyramid || !snapshot)
+		{
+			pLua->PushNil();
+			return 1;
+		}
+
+		// The pyramid uses tract coordinates, the script uses cell coordinates.
+		const int32_t tractSize = std::max(snapshot->tractSize, 1);
+
+		const int32_t x1 = GetIntegerArgument(pLua, 2);
+		const int32_t z1 = GetIntegerArgument(pLua, 3);
+		const int32_t x2 = GetIntegerArgument(pLua, 4);
+		const int32_t z2 = GetIntegerArgument(pLua, 5);
+
+		const SC4Rect<int32_t> tracts(
+			std::min(x1, x2) / tractSize,
+			std::min(z1, z2) / tractSize,
+			std::max(x1, x2) / tractSize,
+			std::max(z1, z2) / tractSize);
+
+		GridPyramid::Stats stats{};
+
+		if (!pyramid->GetStats(tracts, stats))
+		{
+			pLua->PushNil();
+			return 1;
+		}
+
+		pLua->NewTable();
+		SetTableField(pLua, "min", stats.min);
+		SetTableField(pLua, "max", stats.max);
+		SetTableField(pLua, "mean", static_cast<double>(stats.sum) / stats.count);
+		SetTableField(pLua, "count", stats.count);
+
+		return 1;
+	}
+
+	int TopLandmarks(lua_State* pState)
+	{
+		cRZAutoRefCount<cISCLua> pLua = SCLuaUtil::GetISCLuaFromFunctionState(pState);
+
+		if (!pLua)
+		{
+			return 0;
+		}
+
+		const int32_t count = pLua->GetTop() >= 1 ? GetIntegerArgument(pLua, 1) : 10;
+
+		std::vector<RankedOccupant> landmarks;
+
+		if (spEffectRankingManager && count > 0)
+		{
+			spEffectRankingManager->GetTopOccupants(
+				DataViewHighlightLandmarkEffect,
+				std::min(static_cast<size_t>(count), MaxTopLandmarks),
+				landmarks);
+		}
+
+		pLua->NewTable();
+
+		int32_t index = 1;
+
+		for (const RankedOccupant& item : landmarks)
+		{
+			SetArrayItem(pLua, index++, std::floor(item.position.fX / CellWidth));
+			SetArrayItem(pLua, index++, std::floor(item.position.fZ / CellWidth));
+			SetArrayItem(pLua, index++, item.strength);
+			SetArrayItem(pLua, index++, item.radius / CellWidth);
+		}
+
+		return 1;
+	}
+
+	int CoveragePercent(lua_State* pState)
+	{
+		cRZAutoRefCount<cISCLua> pLua = SCLuaUtil::GetISCLuaFromFunctionState(pState);
+
+		if (!pLua)
+		{
+			return 0;
+		}
+
+		double percentage = 0.0;
+
+		if (pLua->GetTop() >= 2)
+		{
+			const CoverageMap* map = GetCoverageLayer(GetIntegerArgument(pLua, 1));
+			const int32_t radius = GetIntegerArgument(pLua, 2);
+
+			if (map && radius >= 0)
+			{
+				const uint64_t cellCount = static_cast<uint64_t>(map->GetCellCountX()) * map->GetCellCountZ();
+
+				if (cellCount > 0)
+				{
+					percentage = (100.0 * map->GetCoveredCellCount(static_cast<uint32_t>(radius))) / cellCount;
+				}
+			}
+		}
+
+		pLua->PushNumber(percentage);
+		return 1;
+	}
+
+	int NearestParkDistance(lua_State* pState)
+	{
+		cRZAutoRefCount<cISCLua> pLua = SCLuaUtil::GetISCLuaFromFunctionState(pState);
+
+		if (!pLua)
+		{
+			return 0;
+		}
+
+		const CoverageMap* map = GetCoverageLayer(0);
+
+		if (!map || pLua->GetTop() < 2)
+		{
+			pLua->PushNil();
+			return 1;
+		}
+
+		const int32_t x = GetIntegerArgument(pLua, 1);
+		const int32_t z = GetIntegerArgument(pLua, 2);
+
+		if (x < 0 || z < 0 || static_cast<uint32_t>(x) >= map->GetCellCountX() || static_cast<uint32_t>(z) >= map->GetCellCountZ())
+		{
+			pLua->PushNil();
+			return 1;
+		}
+
+		pLua->PushNumber(map->GetDistance(static_cast<uint32_t>(x), static_cast<uint32_t>(z)));
+		return 1;
+	}
+
+	int ExposurePercent(lua_State* pState)
+	{
+		cRZAutoRefCount<cISCLua> pLua = SCLuaUtil::GetISCLuaFromFunctionState(pState);
+
+		if (!pLua)
+		{
+			return 0;
+		}
+
+		const int32_t argumentCount = pLua->GetTop();
+
+		if (!spAuraExposureEngine || argumentCount < 2)
+		{
+			pLua->PushNil();
+			return 1;
+		}
+
+		const int32_t grid = GetIntegerArgument(pLua, 1);
+		const int32_t threshold = GetIntegerArgument(pLua, 2);
+		const int32_t tier = argumentCount >= 3 ? GetIntegerArgument(pLua, 3) : 0;
+
+		double percent = 0.0;
+
+		if (grid < 0
+			|| grid >= static_cast<int32_t>(SnapshotGrid::Count)
+			|| tier < 0
+			|| tier >= static_cast<int32_t>(AuraExposureEngine::Tier::Count)
+			|| !spAuraExposureEngine->GetPercentAtLeast(
+				static_cast<SnapshotGrid>(grid),
+				static_cast<AuraExposureEngine::Tier>(tier),
+				threshold,
+				percent))
+		{
+			pLua->PushNil();
+			return 1;
+		}
+
+		pLua->PushNumber(percent);
+		return 1;
+	}
+
+	int NearestHighlights(lua_State* pState)
+	{
+		cRZAutoRefCount<cISCLua> pLua = SCLuaUtil::GetISCLuaFromFunctionState(pState);
+
+		if (!pLua)
+		{
+			return 0;
+		}
+
+		const int32_t argumentCount = pLua->GetTop();
+
+		if (argumentCount < 2)
+		{
+			pLua->PushNil();
+			return 1;
+		}
+
+		const int32_t x = GetIntegerArgument(pLua, 1);
+		const int32_t z = GetIntegerArgument(pLua, 2);
+		const int32_t count = argumentCount >= 3 ? GetIntegerArgument(pLua, 3) : 10;
+
+		std::vector<HighlightedOccupant> occupants;
+
+		if (spDataViewHighlightManager && count > 0)
+		{
+			spDataViewHighlightManager->FindNearest(
+				x,
+				z,
+				std::min(static_cast<size_t>(count), MaxNearestHighlights),
+				occupants);
+		}
+
+		pLua->NewTable();
+
+		int32_t index = 1;
+
+		for (const HighlightedOccupant& item : occupants)
+		{
+			cS3DVector3 position;
+			item.pOccupant->GetPosition(&position);
+
+			SetArrayItem(pLua, index++, std::floor(position.fX / CellWidth));
+			SetArrayItem(pLua, index++, std::floor(position.fZ / CellWidth));
+			SetArrayItem(pLua, index++, item.strength);
+			SetArrayItem(pLua, index++, item.radius / CellWidth);
+		}
+
+		return 1;
+	}
+
+	int Isolines(lua_State* pState)
+	{
+		cRZAutoRefCount<cISCLua> pLua = SCLuaUtil::GetISCLuaFromFunctionState(pState);
+
+		if (!pLua)
+		{
+			return 0;
+		}
+
+		if (!spAuraIsolineManager || pLua->GetTop() < 2)
+		{
+			pLua->PushNil();
+			return 1;
+		}
+
+		const int32_t grid = GetIntegerArgument(pLua, 1);
+		const int32_t threshold = GetIntegerArgument(pLua, 2);
+
+		if (grid < 0 || grid >= static_cast<int32_t>(SnapshotGrid::Count))
+		{
+			pLua->PushNil();
+			return 1;
+		}
+
+		const SnapshotGrid snapshotGrid = static_cast<SnapshotGrid>(grid);
+		const PolylineBuffer* isolines = spAuraIsolineManager->GetIsolines(snapshotGrid, threshold);
+		const std::shared_ptr<const GridSnapshot> snapshot = spGridSnapshotService->GetSnapshot(snapshotGrid);
+
+		if (!isolines || !snapshot)
+		{
+			pLua->PushNil();
+			return 1;
+		}
+
+		// The isoline points use tract coordinates, the script uses cell coordinates.
+		const float tractSize = static_cast<float>(std::max(snapshot->tractSize, 1));
+
+		pLua->NewTable();
+
+		int32_t index = 1;
+		size_t valueCount = 0;
+
+		for (size_t i = 0; i < isolines->GetPolylineCount(); i++)
+		{
+			const uint32_t first = isolines->offsets[i];
+			const uint32_t last = isolines->offsets[i + 1];
+			const uint32_t pointCount = last - first;
+
+			// Only whole polylines are written to the array.
+			valueCount += 1 + (static_cast<size_t>(pointCount) * 2);
+
+			if (valueCount > MaxIsolineValues)
+			{
+				break;
+			}
+
+			SetArrayItem(pLua, index++, pointCount);
+
+			for (uint32_t point = first; point < last; point++)
+			{
+				SetArrayItem(pLua, index++, isolines->points[point * 2] * tractSize);
+				SetArrayItem(pLua, index++, isolines->points[(point * 2) + 1] * tractSize);
+			}
+		}
+
+		return 1;
+	}
+
+	int UnservedResidents(lua_State* pState)
+	{
+		cRZAutoRefCount<cISCLua> pLua = SCLuaUtil::GetISCLuaFromFunctionState(pState);
+
+		if (!pLua)
+		{
+			return 0;
+		}
+
+		if (spServiceCoverageGapMap)
+		{
+			pLua->PushNumber(spServiceCoverageGapMap->GetUnservedResidents());
+		}
+		else
+		{
+			pLua->PushNil();
+		}
+		return 1;
+	}
+
+	struct LuaFunction
+	{
+		const char* name;
+		lua_CFunction function;
+	};
+
+	constexpr std::array<LuaFunction, 8> LuaFunctions =
+	{{
+		{ "dataview_grid_stats", &GridStats },
+		{ "dataview_top_landmarks", &TopLandmarks },
+		{ "dataview_coverage_percent", &CoveragePercent },
+		{ "dataview_nearest_park_distance", &NearestParkDistance },
+		{ "dataview_exposure_percent", &ExposurePercent },
+		{ "dataview_nearest_highlights", &NearestHighlights },
+		{ "dataview_isolines", &Isolines },
+		{ "dataview_unserved_residents", &UnservedResidents },
+	}};
+}
+#endif // HAS_SCLUA_HEADERS
+
+void DataViewLuaFunctions::Register(cISC4AdvisorSystem* pAdvisorSystem)
+{
+	Logger& logger = Logger::GetInstance();
+
+#if HAS_SCLUA_HEADERS
+	for (const LuaFunction& item : LuaFunctions)
+	{
+		const SCLuaUtil::RegisterLuaFunctionStatus status = SCLuaUtil::RegisterLuaFunction(
+			pAdvisorSystem,
+			LuaTableName,
+			item.name,
+			item.function);
+
+		if (status != SCLuaUtil::RegisterLuaFunctionStatus::Ok)
+		{
+			logger.WriteLineFormatted(
+				LogLevel::Error,
+				"Failed to register the %s.%s Lua function, error code: %d.",
+				LuaTableName,
+				item.name,
+				static_cast<int32_t>(status));
+		}
+	}
+#else
+	static_cast<void>(pAdvisorSystem);
+
+	logger.WriteLine(
+		LogLevel::Info,
+		"The Lua functions are not available, this build does not have the gzcom-dll SCLuaUtil.h and cISCLua.h headers.");
+#endif // HAS_SCLUA_HEADERS
+}
@@ -0,0 +1,66 @@
+////////////////////////////////////////////////////////////////////////
+//
+// This file is part of sc4-data-view-extensions, a DLL Plugin for
+// SimCity 4 that extends the game's data views.
+//
+// Copyright (c) 2024 Nicholas Hayes
+//
+// This file is licensed under terms of the MIT License.
+// See LICENSE.txt for more information.
+//
+////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+class cISC4AdvisorSystem;
+
+// Registers the DLL's batched data query functions in the game's Lua table.
+// Each function answers an aggregate query in one native call using the DLL's
+// cached indexes, so a script does not have to loop over the city cells.
+// The functions are only registered when the DLL is built with the gzcom-dll
+// SCLuaUtil.h and cISCLua.h headers, see DataViewLuaFunctions.cpp.
+//
+// game.dataview_grid_stats(grid, x1, z1, x2, z2)
+//   The statistics of a grid in the inclusive cell rectangle.
+//   grid is 0 for the aura grid, 1 for the park map and 2 for the landmark map.
+//   Returns a table with the min, max, mean and count fields, or nil.
+//
+// game.dataview_top_landmarks(count)
+//   The strongest landmark effects. Returns a packed array with four values for
+//   each landmark: the X and Z cell position, the effect strength and the
+//   effect radius in cells.
+//
+// game.dataview_coverage_percent(layer, radius)
+//   The percentage of the city cells within radius cells of a park (layer 0)
+//   or landmark (layer 1).
+//
+// game.dataview_nearest_park_distance(x, z)
+//   The distance in cells from the cell to the nearest park, up to 64.
+//
+// game.dataview_exposure_percent(grid, threshold, wealth)
+//   The percentage of the residents that live in a tract where the grid value
+//   is at least the threshold. grid uses the same values as dataview_grid_stats.
+//   wealth is optional, 0 for all residents or 1 to 3 for the low, medium and
+//   high wealth residents. Returns nil if the grids are not available.
+//
+// game.dataview_nearest_highlights(x, z, count)
+//   The occupants of the active highlight mode that are closest to the cell,
+//   starting with the closest. Returns a packed array with the same four values
+//   for each occupant as dataview_top_landmarks. The array is empty when
+//   no highlight mode is active. The occupant changes since the last highlight
+//   update are not included until the next frame applies them.
+//
+// game.dataview_isolines(grid, threshold)
+//   The contour lines around the cells where the grid value is at least the
+//   threshold. grid uses the same values as dataview_grid_stats. Returns a packed
+//   array where each line starts with its point count, followed by the X and Z
+//   cell position of each point. Returns nil if the grid is not available.
+//
+// game.dataview_unserved_residents()
+//   The estimated number of residents that lack police, water or power
+//   coverage, see the Service Coverage Gaps data view. Returns nil if the
+//   coverage gap map is not available.
+namespace DataViewLuaFunctions
+{
+	void Register(cISC4AdvisorSystem* pAdvisorSystem);
+}
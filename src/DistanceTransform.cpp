@@ -0,0 +1,190 @@
+////////////////////////////////////////////////////////////////////////
+//
+// This file is part of sc4-data-view-extensions, a DLL Plugin for
+// SimCity 4 that extends the game's data views.
+//
+// Copyright (c) 2024 Nicholas Hayes
+//
+// This file is licensed under terms of the MIT License.
+// See LICENSE.txt for more information.
+//
+////////////////////////////////////////////////////////////////////////
+
+#include "DistanceTransform.h"
+#include "CellBitmap.h"
+#include <algorithm>
+#include <limits>
+
+namespace
+{
+	struct Workspace
+	{
+		std::vector<uint32_t> input;
+		std::vector<uint32_t> output;
+		std::vector<int32_t> parabolaLocations;
+		std::vector<double> boundaries;
+
+		void Resize(size_t length)
+		{
+			input.resize(length);
+			output.resize(length);
+			parabolaLocations.resize(length);
+			boundaries.resize(length + 1);
+		}
+	};
+
+	// Computes the lower envelope of the parabolas rooted at each sample.
+	void Transform1D(Workspace& workspace, int32_t length)
+	{
+		const uint32_t* f = workspace.input.data();
+		uint32_t* d = workspace.output.data();
+		int32_t* v = workspace.parabolaLocations.data();
+		double* z = workspace.boundaries.data();
+
+		constexpr double PositiveInfinity = std::numeric_limits<double>::infinity();
+
+		int32_t k = 0;
+		v[0] = 0;
+		z[0] = -PositiveInfinity;
+		z[1] = PositiveInfinity;
+
+		for (int32_t q = 1; q < length; q++)
+		{
+			double s = 0;
+
+			while (true)
+			{
+				const int32_t p = v[k];
+
+				s = ((static_cast<double>(f[q]) + (static_cast<double>(q) * q))
+					- (static_cast<double>(f[p]) + (static_cast<double>(p) * p)))
+					/ (2.0 * (q - p));
+
+				if (s <= z[k] && k > 0)
+				{
+					k--;
+				}
+				else
+				{
+					break;
+				}
+			}
+
+			if (s <= z[k])
+			{
+				// Only possible when k is 0, the new parabola replaces the first one.
+				v[0] = q;
+				z[0] = -PositiveInfinity;
+				z[1] = PositiveInfinity;
+			}
+			else
+			{
+				k++;
+				v[k] = q;
+				z[k] = s;
+				z[k + 1] = PositiveInfinity;
+			}
+		}
+
+		k = 0;
+
+		for (int32_t q = 0; q < length; q++)
+		{
+			while (z[k + 1] < q)
+			{
+				k++;
+			}
+
+			const int64_t delta = static_cast<int64_t>(q) - v[k];
+			const int64_t value = (delta * delta) + f[v[k]];
+
+			d[q] = static_cast<uint32_t>(std::min<int64_t>(value, DistanceTransform::Infinity));
+		}
+	}
+}
+
+void DistanceTransform::ComputeSquaredDistances(
+	const CellBitmap& sources,
+	const SC4Rect<long>& region,
+	std::vector<uint32_t>& output)
+{
+	const int32_t firstColumn = region.topLeftX;
+	const int32_t firstRow = region.topLeftY;
+	const int32_t columnCount = region.bottomRightX - region.topLeftX + 1;
+	const int32_t rowCount = region.bottomRightY - region.topLeftY + 1;
+
+	if (columnCount <= 0 || rowCount <= 0)
+	{
+		output.clear();
+		return;
+	}
+
+	output.resize(static_cast<size_t>(columnCount) * rowCount);
+
+	Workspace workspace;
+	workspace.Resize(static_cast<size_t>(std::max(columnCount, rowCount)));
+
+	// The source cells are read a bitmap word at a time, most of the words
+	// in a region are empty.
+
+	for (int32_t row = 0; row < rowCount; row++)
+	{
+		const uint32_t* words = sources.GetRowData(static_cast<uint32_t>(firstRow + row));
+		uint32_t* rowOutput = output.data() + (static_cast<size_t>(row) * columnCount);
+
+		std::fill(rowOutput, rowOutput + columnCount, Infinity);
+
+		int32_t column = 0;
+
+		while (column < columnCount)
+		{
+			const uint32_t mapColumn = static_cast<uint32_t>(firstColumn + column);
+			const uint32_t bitOffset = mapColumn & 31;
+			const int32_t bitCount = std::min(32 - static_cast<int32_t>(bitOffset), columnCount - column);
+			const uint32_t word = words[mapColumn / 32] >> bitOffset;
+
+			if (word != 0)
+			{
+				for (int32_t bit = 0; bit < bitCount; bit++)
+				{
+					if ((word & (1U << bit)) != 0)
+					{
+						rowOutput[column + bit] = 0;
+					}
+				}
+			}
+
+			column += bitCount;
+		}
+	}
+
+	// Pass 1: the distance to the nearest source in the same column of the region.
+
+	for (int32_t column = 0; column < columnCount; column++)
+	{
+		for (int32_t row = 0; row < rowCount; row++)
+		{
+			workspace.input[row] = output[(static_cast<size_t>(row) * columnCount) + column];
+		}
+
+		Transform1D(workspace, rowCount);
+
+		for (int32_t row = 0; row < rowCount; row++)
+		{
+			output[(static_cast<size_t>(row) * columnCount) + column] = workspace.output[row];
+		}
+	}
+
+	// Pass 2: combine the column distances along each row.
+
+	for (int32_t row = 0; row < rowCount; row++)
+	{
+		uint32_t* rowOutput = output.data() + (static_cast<size_t>(row) * columnCount);
+
+		std::copy(rowOutput, rowOutput + columnCount, workspace.input.begin());
+
+		Transform1D(workspace, columnCount);
+
+		std::copy(workspace.output.begin(), workspace.output.begin() + columnCount, rowOutput);
+	}
+}
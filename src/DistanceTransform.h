@@ -0,0 +1,36 @@
+////////////////////////////////////////////////////////////////////////
+//
+// This file is part of sc4-data-view-extensions, a DLL Plugin for
+// SimCity 4 that extends the game's data views.
+//
+// Copyright (c) 2024 Nicholas Hayes
+//
+// This file is licensed under terms of the MIT License.
+// See LICENSE.txt for more information.
+//
+////////////////////////////////////////////////////////////////////////
+
+#pragma once
+#include "SC4Rect.h"
+#include <cstdint>
+#include <vector>
+
+class CellBitmap;
+
+namespace DistanceTransform
+{
+	// The value that is used for cells that do not have a source cell in the region.
+	static constexpr uint32_t Infinity = 0x3FFFFFFF;
+
+	// Computes the squared Euclidean distance from each cell in the inclusive region to the
+	// nearest set cell of the source map that is also inside the region.
+	// The rectangle X coordinates are map columns and the Y coordinates are map rows.
+	// The output is stored in row-major order using the region dimensions.
+	//
+	// This uses the linear-time separable algorithm from Felzenszwalb and Huttenlocher,
+	// "Distance Transforms of Sampled Functions".
+	void ComputeSquaredDistances(
+		const CellBitmap& sources,
+		const SC4Rect<long>& region,
+		std::vector<uint32_t>& output);
+}
@@ -0,0 +1,291 @@
+////////////////////////////////////////////////////////////////////////
+//
+// This file is part of sc4-data-view-extensions, a DLL Plugin for
+// SimCity 4 that extends the game's data views.
+//
+// Copyright (c) 2024 Nicholas Hayes
+//
+// This file is licensed under terms of the MIT License.
+// See LICENSE.txt for more information.
+//
+////////////////////////////////////////////////////////////////////////
+
+#pragma once
+#include "cISC4SimGrid.h"
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstdint>
+#include <memory_resource>
+#include <vector>
+
+// A cISC4SimGrid implementation for the data sources that are computed by the DLL.
+// The values are stored in row-major order (Z rows of X tracts) and are filled in by
+// the component that owns the grid.
+// The grid is owned by the DLL, so the reference count does not control its lifetime.
+template<typename T>
+class DllSimGrid final : public cISC4SimGrid<T>
+{
+public:
+	// The width of a city cell in meters.
+	static constexpr float CellWidth = 16.0f;
+
+	DllSimGrid(std::pmr::memory_resource* memoryResource)
+		: refCount(0),
+		  instanceID(0),
+		  tractSize(1),
+		  tractShift(0),
+		  tractCountX(0),
+		  tractCountZ(0),
+		  values(memoryResource)
+	{
+	}
+
+	// Sets the grid dimensions and clears the values.
+	// The tract size is in cells and must be a power of two.
+	void Resize(int32_t cellCountX, int32_t cellCountZ, int32_t tractSizeInCells)
+	{
+		tractSize = std::max(tractSizeInCells, 1);
+		tractShift = std::countr_zero(static_cast<uint32_t>(tractSize));
+		tractCountX = std::max(cellCountX, 0) >> tractShift;
+		tractCountZ = std::max(cellCountZ, 0) >> tractShift;
+
+		values.assign(static_cast<size_t>(tractCountX) * tractCountZ, T());
+	}
+
+	void Clear()
+	{
+		tractCountX = 0;
+		tractCountZ = 0;
+		values.clear();
+		values.shrink_to_fit();
+	}
+
+	bool IsEmpty() const
+	{
+		return values.empty();
+	}
+
+	T* GetValues()
+	{
+		return values.data();
+	}
+
+	const T* GetValues() const
+	{
+		return values.data();
+	}
+
+	// cIGZUnknown
+
+	bool QueryInterface(uint32_t riid, void** ppvObj) override
+	{
+		if (riid == GZIID_cIGZUnknown)
+		{
+			*ppvObj = static_cast<cIGZUnknown*>(this);
+			AddRef();
+
+			return true;
+		}
+
+		return false;
+	}
+
+	uint32_t AddRef() override
+	{
+		return ++refCount;
+	}
+
+	uint32_t Release() override
+	{
+		if (refCount > 0)
+		{
+			--refCount;
+		}
+
+		return refCount;
+	}
+
+	// cISC4SimGrid
+
+	bool Init() override
+	{
+		return true;
+	}
+
+	bool Shutdown() override
+	{
+		return true;
+	}
+
+	uint32_t GetInstanceID() override
+	{
+		return instanceID;
+	}
+
+	bool SetInstanceID(uint32_t dwInstanceID) override
+	{
+		instanceID = dwInstanceID;
+		return true;
+	}
+
+	T GetCellValue(int32_t nCellX, int32_t nCellZ) override
+	{
+		return GetTractValue(nCellX >> tractShift, nCellZ >> tractShift);
+	}
+
+	T GetAverageValueInCellRect(int32_t nTopLeftX, int32_t nTopLeftZ, int32_t nBottomRightX, int32_t nBottomRightZ) override
+	{
+		return GetAverageValueInTractRect(
+			nTopLeftX >> tractShift,
+			nTopLeftZ >> tractShift,
+			nBottomRightX >> tractShift,
+			nBottomRightZ >> tractShift);
+	}
+
+	bool SetTractSize(int32_t nSize) override
+	{
+		// The owner controls the grid layout.
+		return false;
+	}
+
+	int32_t GetTractSize() override
+	{
+		return tractSize;
+	}
+
+	int32_t GetTractShift() override
+	{
+		return tractShift;
+	}
+
+	int32_t GetTractCountX() override
+	{
+		return tractCountX;
+	}
+
+	int32_t GetTractCountZ() override
+	{
+		return tractCountZ;
+	}
+
+	float GetTractWidthX() override
+	{
+		return CellWidth * static_cast<float>(tractSize);
+	}
+
+	float GetTractWidthZ() override
+	{
+		return CellWidth * static_cast<float>(tractSize);
+	}
+
+	float GetOneOverTractWidthX() override
+	{
+		return 1.0f / GetTractWidthX();
+	}
+
+	float GetOneOverTractWidthZ() override
+	{
+		return 1.0f / GetTractWidthZ();
+	}
+
+	bool TractIsInBounds(uint32_t dwTractX, uint32_t dwTractZ) override
+	{
+		return dwTractX < static_cast<uint32_t>(tractCountX) && dwTractZ < static_cast<uint32_t>(tractCountZ);
+	}
+
+	bool PositionToTract(float fPosX, float fPosZ, int32_t& nTractX, int32_t& nTractZ) override
+	{
+		nTractX = static_cast<int32_t>(std::floor(fPosX * GetOneOverTractWidthX()));
+		nTractZ = static_cast<int32_t>(std::floor(fPosZ * GetOneOverTractWidthZ()));
+
+		return TractIsInBounds(static_cast<uint32_t>(nTractX), static_cast<uint32_t>(nTractZ));
+	}
+
+	bool TractCornerToPosition(int32_t nTractX, int32_t nTractZ, float& fPosX, float& fPosZ) override
+	{
+		fPosX = static_cast<float>(nTractX) * GetTractWidthX();
+		fPosZ = static_cast<float>(nTractZ) * GetTractWidthZ();
+
+		return TractIsInBounds(static_cast<uint32_t>(nTractX), static_cast<uint32_t>(nTractZ));
+	}
+
+	bool TractCenterToPosition(int32_t nTractX, int32_t nTractZ, float& fPosX, float& fPosZ) override
+	{
+		fPosX = (static_cast<float>(nTractX) + 0.5f) * GetTractWidthX();
+		fPosZ = (static_cast<float>(nTractZ) + 0.5f) * GetTractWidthZ();
+
+		return TractIsInBounds(static_cast<uint32_t>(nTractX), static_cast<uint32_t>(nTractZ));
+	}
+
+	T GetTractValue(int32_t nTractX, int32_t nTractZ) override
+	{
+		if (!TractIsInBounds(static_cast<uint32_t>(nTractX), static_cast<uint32_t>(nTractZ)))
+		{
+			return T();
+		}
+
+		return values[(static_cast<size_t>(nTractZ) * tractCountX) + nTractX];
+	}
+
+	T GetAverageValueInTractRect(int32_t nTopLeftX, int32_t nTopLeftZ, int32_t nBottomRightX, int32_t nBottomRightZ) override
+	{
+		const int32_t startX = std::max(std::min(nTopLeftX, nBottomRightX), 0);
+		const int32_t startZ = std::max(std::min(nTopLeftZ, nBottomRightZ), 0);
+		const int32_t endX = std::min(std::max(nTopLeftX, nBottomRightX), tractCountX - 1);
+		const int32_t endZ = std::min(std::max(nTopLeftZ, nBottomRightZ), tractCountZ - 1);
+
+		if (startX > endX || startZ > endZ)
+		{
+			return T();
+		}
+
+		double total = 0;
+
+		for (int32_t z = startZ; z <= endZ; z++)
+		{
+			const T* row = values.data() + (static_cast<size_t>(z) * tractCountX);
+
+			for (int32_t x = startX; x <= endX; x++)
+			{
+				total += static_cast<double>(row[x]);
+			}
+		}
+
+		const double count = static_cast<double>(endX - startX + 1) * static_cast<double>(endZ - startZ + 1);
+
+		return static_cast<T>(total / count);
+	}
+
+	intptr_t GetGridData() override
+	{
+		return reinterpret_cast<intptr_t>(values.data());
+	}
+
+	intptr_t GetGridData() const override
+	{
+		return reinterpret_cast<intptr_t>(values.data());
+	}
+
+	void SetTractValue(int32_t nTractX, int32_t nTractZ, T value) override
+	{
+		if (TractIsInBounds(static_cast<uint32_t>(nTractX), static_cast<uint32_t>(nTractZ)))
+		{
+			values[(static_cast<size_t>(nTractZ) * tractCountX) + nTractX] = value;
+		}
+	}
+
+	void SetTractValues(T value) override
+	{
+		std::fill(values.begin(), values.end(), value);
+	}
+
+private:
+	uint32_t refCount;
+	uint32_t instanceID;
+	int32_t tractSize;
+	int32_t tractShift;
+	int32_t tractCountX;
+	int32_t tractCountZ;
+	std::pmr::vector<T> values;
+};
@@ -0,0 +1,156 @@
+////////////////////////////////////////////////////////////////////////
+//
+// This file is part of sc4-data-view-extensions, a DLL Plugin for
+// SimCity 4 that extends the game's data views.
+//
+// Copyright (c) 2024 Nicholas Hayes
+//
+// This file is licensed under terms of the MIT License.
+// See LICENSE.txt for more information.
+//
+////////////////////////////////////////////////////////////////////////
+
+#include "EffectPropertyCache.h"
+#include "BuildingOccupantUtil.h"
+#include "GlobalPointers.h"
+#include "PluginEffectIndex.h"
+#include "cIGZVariant.h"
+#include "cISC4BuildingOccupant.h"
+#include "cISC4Occupant.h"
+#include "cISCProperty.h"
+#include "cISCPropertyHolder.h"
+#include "cRZAutoRefCount.h"
+
+namespace
+{
+	bool GetArrayValue(const cIGZVariant* pVariant, uint32_t index, float& value)
+	{
+		if (index >= pVariant->GetCount())
+		{
+			return false;
+		}
+
+		bool result = true;
+
+		switch (pVariant->GetType())
+		{
+		case cIGZVariant::Type::Sint32Array:
+			value = static_cast<float>(pVariant->RefSint32()[index]);
+			break;
+		case cIGZVariant::Type::Uint32Array:
+			value = static_cast<float>(pVariant->RefUint32()[index]);
+			break;
+		case cIGZVariant::Type::Float32Array:
+			value = pVariant->RefFloat32()[index];
+			break;
+		case cIGZVariant::Type::Sint16Array:
+			value = static_cast<float>(pVariant->RefSint16()[index]);
+			break;
+		case cIGZVariant::Type::Uint16Array:
+			value = static_cast<float>(pVariant->RefUint16()[index]);
+			break;
+		case cIGZVariant::Type::Sint8Array:
+			value = static_cast<float>(pVariant->RefSint8()[index]);
+			break;
+		case cIGZVariant::Type::Uint8Array:
+			value = static_cast<float>(pVariant->RefUint8()[index]);
+			break;
+		default:
+			result = false;
+			break;
+		}
+
+		return result;
+	}
+}
+
+EffectPropertyCache::EffectPropertyCache() : entries()
+{
+}
+
+bool EffectPropertyCache::GetEffect(cISC4Occupant* pOccupant, uint32_t propertyID, OccupantEffect& effect)
+{
+	cRZAutoRefCount<cISC4BuildingOccupant> pBuildingOccupant;
+
+	if (!pOccupant->QueryInterface(GZIID_cISC4BuildingOccupant, pBuildingOccupant.AsPPVoid()))
+	{
+		const Entry entry = ReadProperty(pOccupant, propertyID);
+
+		effect = entry.effect;
+		return entry.valid;
+	}
+
+	// The game identifies a building type by its exemplar ID.
+	const uint32_t buildingType = pBuildingOccupant->GetBuildingType();
+	const uint64_t key = (static_cast<uint64_t>(buildingType) << 32) | propertyID;
+
+	auto item = entries.find(key);
+
+	if (item == entries.end())
+	{
+		Entry entry{};
+
+		// The occupant's own property is authoritative, the plugin index is only used
+		// when the occupant does not have a property holder. The index is keyed by the
+		// exemplar instance ID and does not follow the game's plugin load order.
+		if (pOccupant->AsPropertyHolder())
+		{
+			entry = ReadProperty(pOccupant, propertyID);
+		}
+		else if (spPluginEffectIndex && spPluginEffectIndex->GetEffect(buildingType, propertyID, entry.effect))
+		{
+			entry.valid = true;
+		}
+
+		item = entries.emplace(key, entry).first;
+	}
+
+	effect = item->second.effect;
+	return item->second.valid;
+}
+
+void EffectPropertyCache::Clear()
+{
+	entries.clear();
+}
+
+EffectPropertyCache::Entry EffectPropertyCache::ReadProperty(cISC4Occupant* pOccupant, uint32_t propertyID)
+{
+	const cISCPropertyHolder* pPropertyHolder = pOccupant->AsPropertyHolder();
+
+	if (pPropertyHolder)
+	{
+		const cISCProperty* pProperty = pPropertyHolder->GetProperty(propertyID);
+
+		if (pProperty)
+		{
+			return DecodeProperty(pProperty);
+		}
+	}
+
+	return Entry{};
+}
+
+EffectPropertyCache::Entry EffectPropertyCache::DecodeProperty(const cISCProperty* pProperty)
+{
+	// The effect properties are a two item array, the first item is the
+	// effect strength and the second item is the effect radius.
+
+	Entry entry{};
+
+	const cIGZVariant* pVariant = pProperty->GetPropertyValue();
+
+	if (pVariant)
+	{
+		entry.valid = GetArrayValue(pVariant, 0, entry.effect.strength)
+				   && GetArrayValue(pVariant, 1, entry.effect.radius);
+	}
+
+	if (!entry.valid)
+	{
+		entry.effect.strength = 0.0f;
+		entry.effect.radius = 0.0f;
+	}
+
+	return entry;
+}
@@ -0,0 +1,68 @@
+////////////////////////////////////////////////////////////////////////
+//
+// This file is part of sc4-data-view-extensions, a DLL Plugin for
+// SimCity 4 that extends the game's data views.
+//
+// Copyright (c) 2024 Nicholas Hayes
+//
+// This file is licensed under terms of the MIT License.
+// See LICENSE.txt for more information.
+//
+////////////////////////////////////////////////////////////////////////
+
+#pragma once
+#include <cmath>
+#include <cstdint>
+#include <unordered_map>
+
+class cISC4Occupant;
+class cISCProperty;
+
+static constexpr uint32_t kLandmarkEffectProperty = 0x2781284F;
+static constexpr uint32_t kParkEffectProperty = 0x27812850;
+
+// The decoded value of a Park Effect or Landmark Effect property.
+struct OccupantEffect
+{
+	float strength;
+	// The effect radius in meters.
+	float radius;
+};
+
+// Returns true if the first effect strength ranks above the second.
+// The strength is compared by magnitude, because some buildings have a negative effect.
+inline bool IsStrongerEffect(float lhsStrength, float rhsStrength)
+{
+	return std::abs(lhsStrength) > std::abs(rhsStrength);
+}
+
+// Caches the decoded Park Effect and Landmark Effect property values.
+// The entries are keyed by the building exemplar ID and property ID, so every
+// building of the same type only has its property decoded once. The
+// PluginEffectIndex is only used for the buildings that do not have a
+// property holder.
+// The occupants that are not buildings are decoded on each call.
+class EffectPropertyCache
+{
+public:
+	EffectPropertyCache();
+
+	// Returns false if the occupant does not have the property or
+	// its value is not a numeric array.
+	bool GetEffect(cISC4Occupant* pOccupant, uint32_t propertyID, OccupantEffect& effect);
+
+	void Clear();
+
+private:
+	struct Entry
+	{
+		OccupantEffect effect;
+		bool valid;
+	};
+
+	static Entry ReadProperty(cISC4Occupant* pOccupant, uint32_t propertyID);
+	static Entry DecodeProperty(const cISCProperty* pProperty);
+
+	// The key is the building exemplar ID in the high 32 bits and the property ID in the low 32 bits.
+	std::unordered_map<uint64_t, Entry> entries;
+};
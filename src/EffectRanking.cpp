@@ -0,0 +1,100 @@
+////////////////////////////////////////////////////////////////////////
+//
+// This file is part of sc4-data-view-extensions, a DLL Plugin for
+// SimCity 4 that extends the game's data views.
+//
+// Copyright (c) 2024 Nicholas Hayes
+//
+// This file is licensed under terms of the MIT License.
+// See LICENSE.txt for more information.
+//
+////////////////////////////////////////////////////////////////////////
+
+#include "EffectRanking.h"
+#include "EffectPropertyCache.h"
+#include "cISC4Occupant.h"
+#include <algorithm>
+#include <functional>
+
+bool EffectRanking::StrongestFirst::operator()(const RankedOccupant& lhs, const RankedOccupant& rhs) const
+{
+	// The ranking uses the same order as the highlighted occupant list.
+	if (IsStrongerEffect(lhs.strength, rhs.strength))
+	{
+		return true;
+	}
+	else if (IsStrongerEffect(rhs.strength, lhs.strength))
+	{
+		return false;
+	}
+
+	// Occupants with the same strength magnitude are ordered by their address, this
+	// keeps the keys unique so that each occupant can be found for removal.
+	return std::less<cISC4Occupant*>()(lhs.pOccupant, rhs.pOccupant);
+}
+
+EffectRanking::EffectRanking() : ranking(), occupantIndex()
+{
+}
+
+EffectRanking::~EffectRanking()
+{
+	Clear();
+}
+
+bool EffectRanking::Add(const RankedOccupant& item)
+{
+	if (occupantIndex.contains(item.pOccupant))
+	{
+		return false;
+	}
+
+	auto inserted = ranking.insert(item).first;
+	occupantIndex.emplace(item.pOccupant, inserted);
+	item.pOccupant->AddRef();
+
+	return true;
+}
+
+bool EffectRanking::Remove(cISC4Occupant* pOccupant)
+{
+	auto item = occupantIndex.find(pOccupant);
+
+	if (item == occupantIndex.end())
+	{
+		return false;
+	}
+
+	ranking.erase(item->second);
+	occupantIndex.erase(item);
+	pOccupant->Release();
+
+	return true;
+}
+
+void EffectRanking::Clear()
+{
+	for (const RankedOccupant& item : ranking)
+	{
+		item.pOccupant->Release();
+	}
+
+	ranking.clear();
+	occupantIndex.clear();
+}
+
+size_t EffectRanking::GetCount() const
+{
+	return ranking.size();
+}
+
+void EffectRanking::GetTop(size_t count, std::vector<RankedOccupant>& output) const
+{
+	output.clear();
+	output.reserve(std::min(count, ranking.size()));
+
+	for (auto it = ranking.begin(); it != ranking.end() && output.size() < count; ++it)
+	{
+		output.push_back(*it);
+	}
+}
@@ -0,0 +1,65 @@
+////////////////////////////////////////////////////////////////////////
+//
+// This file is part of sc4-data-view-extensions, a DLL Plugin for
+// SimCity 4 that extends the game's data views.
+//
+// Copyright (c) 2024 Nicholas Hayes
+//
+// This file is licensed under terms of the MIT License.
+// See LICENSE.txt for more information.
+//
+////////////////////////////////////////////////////////////////////////
+
+#pragma once
+#include "cS3DVector3.h"
+#include <cstddef>
+#include <cstdint>
+#include <set>
+#include <unordered_map>
+#include <vector>
+
+class cISC4Occupant;
+
+struct RankedOccupant
+{
+	cISC4Occupant* pOccupant;
+	float strength;
+	// The effect radius in meters.
+	float radius;
+	cS3DVector3 position;
+};
+
+// Orders a set of occupants by the magnitude of their effect strength.
+// Adding or removing an occupant is O(log n), and the strongest N
+// occupants can be read without visiting the rest of the set.
+// The ranking holds a reference to each occupant that it contains.
+class EffectRanking
+{
+public:
+	EffectRanking();
+	~EffectRanking();
+
+	EffectRanking(const EffectRanking&) = delete;
+	EffectRanking& operator=(const EffectRanking&) = delete;
+
+	// Returns false if the occupant is already ranked.
+	bool Add(const RankedOccupant& item);
+	bool Remove(cISC4Occupant* pOccupant);
+	void Clear();
+
+	size_t GetCount() const;
+
+	// Gets up to count occupants, starting with the strongest.
+	void GetTop(size_t count, std::vector<RankedOccupant>& output) const;
+
+private:
+	struct StrongestFirst
+	{
+		bool operator()(const RankedOccupant& lhs, const RankedOccupant& rhs) const;
+	};
+
+	typedef std::set<RankedOccupant, StrongestFirst> RankingSet;
+
+	RankingSet ranking;
+	std::unordered_map<cISC4Occupant*, RankingSet::const_iterator> occupantIndex;
+};
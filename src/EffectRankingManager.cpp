@@ -0,0 +1,155 @@
+////////////////////////////////////////////////////////////////////////
+//
+// This file is part of sc4-data-view-extensions, a DLL Plugin for
+// SimCity 4 that extends the game's data views.
+//
+// Copyright (c) 2024 Nicholas Hayes
+//
+// This file is licensed under terms of the MIT License.
+// See LICENSE.txt for more information.
+//
+////////////////////////////////////////////////////////////////////////
+
+#include "EffectRankingManager.h"
+#include "cISC4Occupant.h"
+#include "cISC4OccupantManager.h"
+#include "DataViewHighlightManager.h"
+#include "EffectPropertyCache.h"
+#include "GlobalPointers.h"
+#include "LandmarkEffectFilter.h"
+#include "OccupantEventBus.h"
+#include "OccupantTypes.h"
+#include "ParkEffectFilter.h"
+
+EffectRankingManager::RankingLayer::RankingLayer(cISC4OccupantFilter* filter, uint32_t effectPropertyID)
+	: filter(),
+	  effectPropertyID(effectPropertyID),
+	  ranking()
+{
+	// The assignment operator adds a reference to the filter.
+	this->filter = filter;
+}
+
+EffectRankingManager::EffectRankingManager()
+	: parkLayer(new ParkEffectFilter(), kParkEffectProperty),
+	  landmarkLayer(new LandmarkEffectFilter(), kLandmarkEffectProperty),
+	  rankingsBuilt(false)
+{
+}
+
+void EffectRankingManager::Init()
+{
+	spOccupantEventBus->Subscribe(this, kOccupantTypeBuilding);
+}
+
+void EffectRankingManager::Shutdown()
+{
+	spOccupantEventBus->Unsubscribe(this);
+}
+
+const EffectRanking& EffectRankingManager::GetParkRanking()
+{
+	BuildRankings();
+	return parkLayer.ranking;
+}
+
+const EffectRanking& EffectRankingManager::GetLandmarkRanking()
+{
+	BuildRankings();
+	return landmarkLayer.ranking;
+}
+
+bool EffectRankingManager::GetTopOccupants(
+	uint32_t highlightType,
+	size_t count,
+	std::vector<RankedOccupant>& output)
+{
+	BuildRankings();
+
+	bool result = true;
+
+	switch (highlightType)
+	{
+	case DataViewHighlightParkEffect:
+		parkLayer.ranking.GetTop(count, output);
+		break;
+	case DataViewHighlightLandmarkEffect:
+		landmarkLayer.ranking.GetTop(count, output);
+		break;
+	default:
+		output.clear();
+		result = false;
+		break;
+	}
+
+	return result;
+}
+
+void EffectRankingManager::OccupantInserted(cISC4Occupant* pOccupant)
+{
+	if (!rankingsBuilt)
+	{
+		// The occupant will be added by the scan when the rankings are first used.
+		return;
+	}
+
+	for (RankingLayer* layer : { &parkLayer, &landmarkLayer })
+	{
+		if (layer->filter->IsOccupantIncluded(pOccupant))
+		{
+			AddOccupant(*layer, pOccupant);
+		}
+	}
+}
+
+void EffectRankingManager::OccupantRemoved(cISC4Occupant* pOccupant)
+{
+	parkLayer.ranking.Remove(pOccupant);
+	landmarkLayer.ranking.Remove(pOccupant);
+}
+
+void EffectRankingManager::PreCityShutdown()
+{
+	// The rankings hold references to the occupants, these must be
+	// released before the city is destroyed.
+	parkLayer.ranking.Clear();
+	landmarkLayer.ranking.Clear();
+	rankingsBuilt = false;
+}
+
+bool EffectRankingManager::IterateOccupantsCallback(cISC4Occupant* pOccupant, void* pContext)
+{
+	// Both layers are filled from a single pass over the city's buildings.
+	static_cast<EffectRankingManager*>(pContext)->OccupantInserted(pOccupant);
+	return true;
+}
+
+void EffectRankingManager::BuildRankings()
+{
+	if (rankingsBuilt || !spOccupantManager)
+	{
+		return;
+	}
+
+	rankingsBuilt = true;
+
+	spOccupantManager->IterateOccupants(
+		IterateOccupantsCallback,
+		this,
+		nullptr,
+		nullptr,
+		kOccupantTypeBuilding);
+}
+
+void EffectRankingManager::AddOccupant(RankingLayer& layer, cISC4Occupant* pOccupant)
+{
+	OccupantEffect effect{};
+
+	if (spEffectPropertyCache->GetEffect(pOccupant, layer.effectPropertyID, effect))
+	{
+		RankedOccupant item{ pOccupant, effect.strength, effect.radius, cS3DVector3() };
+		pOccupant->GetPosition(&item.position);
+
+		layer.ranking.Add(item);
+	}
+}
@@ -0,0 +1,67 @@
+////////////////////////////////////////////////////////////////////////
+//
+// This file is part of sc4-data-view-extensions, a DLL Plugin for
+// SimCity 4 that extends the game's data views.
+//
+// Copyright (c) 2024 Nicholas Hayes
+//
+// This file is licensed under terms of the MIT License.
+// See LICENSE.txt for more information.
+//
+////////////////////////////////////////////////////////////////////////
+
+#pragma once
+#include "EffectRanking.h"
+#include "IOccupantEventSubscriber.h"
+#include "cISC4OccupantFilter.h"
+#include "cRZAutoRefCount.h"
+
+// Maintains the park and landmark effect rankings from the occupant
+// insert/remove events.
+// The rankings are built from an occupant scan the first time they are used
+// after a city is loaded, the events are ignored until then.
+class EffectRankingManager : private IOccupantEventSubscriber
+{
+public:
+	EffectRankingManager();
+
+	void Init();
+	void Shutdown();
+
+	const EffectRanking& GetParkRanking();
+	const EffectRanking& GetLandmarkRanking();
+
+	// Gets the strongest park or landmark effect contributors.
+	// The highlightType parameter is DataViewHighlightParkEffect or DataViewHighlightLandmarkEffect.
+	// Returns false for any other highlight type.
+	bool GetTopOccupants(uint32_t highlightType, size_t count, std::vector<RankedOccupant>& output);
+
+private:
+
+	struct RankingLayer
+	{
+		RankingLayer(cISC4OccupantFilter* filter, uint32_t effectPropertyID);
+
+		cRZAutoRefCount<cISC4OccupantFilter> filter;
+		uint32_t effectPropertyID;
+		EffectRanking ranking;
+	};
+
+	// IOccupantEventSubscriber
+
+	void OccupantInserted(cISC4Occupant* pOccupant);
+	void OccupantRemoved(cISC4Occupant* pOccupant);
+	void PreCityShutdown();
+
+	// Private members
+
+	static bool IterateOccupantsCallback(cISC4Occupant* pOccupant, void* pContext);
+
+	void BuildRankings();
+
+	static void AddOccupant(RankingLayer& layer, cISC4Occupant* pOccupant);
+
+	RankingLayer parkLayer;
+	RankingLayer landmarkLayer;
+	bool rankingsBuilt;
+};
@@ -35,6 +35,14 @@ namespace
 	}
 }
 
+std::filesystem::path FileSystem::GetConfigFilePath()
+{
+	std::filesystem::path path = GetDllFolderPath();
+	path /= L"SC4DataViewExtensions.ini"sv;
+
+	return path;
+}
+
 std::filesystem::path FileSystem::GetLogFilePath()
 {
 	std::filesystem::path path = GetDllFolderPath();
@@ -42,3 +50,11 @@ std::filesystem::path FileSystem::GetLogFilePath()
 
 	return path;
 }
+
+std::filesystem::path FileSystem::GetPluginEffectIndexCachePath()
+{
+	std::filesystem::path path = GetDllFolderPath();
+	path /= L"SC4DataViewExtensions.cache"sv;
+
+	return path;
+}
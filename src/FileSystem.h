@@ -15,6 +15,8 @@
 
 namespace FileSystem
 {
+	std::filesystem::path GetConfigFilePath();
 	std::filesystem::path GetLogFilePath();
+	std::filesystem::path GetPluginEffectIndexCachePath();
 };
 
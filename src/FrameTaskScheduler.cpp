@@ -0,0 +1,395 @@
+////////////////////////////////////////////////////////////////////////
+//
+// This file is part of sc4-data-view-extensions, a DLL Plugin for
+// SimCity 4 that extends the game's data views.
+//
+// Copyright (c) 2024 Nicholas Hayes
+//
+// This file is licensed under terms of the MIT License.
+// See LICENSE.txt for more information.
+//
+////////////////////////////////////////////////////////////////////////
+
+#include "FrameTaskScheduler.h"
+#include "GlobalPointers.h"
+#include "Logger.h"
+#include "cISC4Simulator.h"
+#include <algorithm>
+
+namespace
+{
+	constexpr uint32_t kFrameTaskSchedulerServiceID = 0x4A6E2D93;
+
+	constexpr double MinBudget = 0.25;
+	constexpr double MaxBudget = 16.0;
+
+	// The budget is reduced in proportion when the average frame takes longer than this.
+	constexpr double TargetFrameTime = 1000.0 / 30.0;
+	// The weight of the latest frame in the average frame time.
+	constexpr double FrameTimeSmoothing = 0.125;
+
+	// The simulator is not competing for the frame when the game is paused,
+	// and needs most of it at the fastest speed.
+	constexpr int32_t PausedSimSpeed = 0;
+	constexpr int32_t FastestSimSpeed = 3;
+	constexpr double PausedBudgetScale = 2.0;
+	constexpr double FastestBudgetScale = 0.5;
+
+	// A slice that exceeds the budget by more than this is reported as an overrun.
+	constexpr double OverrunTolerance = 2.0;
+
+	double GetElapsedMilliseconds(std::chrono::steady_clock::time_point start, std::chrono::steady_clock::time_point end)
+	{
+		return std::chrono::duration<double, std::milli>(end - start).count();
+	}
+}
+
+FrameBudget::FrameBudget(std::chrono::steady_clock::time_point deadline)
+	: deadline(deadline)
+{
+}
+
+FrameBudget FrameBudget::Unlimited()
+{
+	return FrameBudget(std::chrono::steady_clock::time_point::max());
+}
+
+bool FrameBudget::IsExhausted() const
+{
+	return std::chrono::steady_clock::now() >= deadline;
+}
+
+FrameTaskScheduler::FrameTaskScheduler()
+	: cRZBaseSystemService(kFrameTaskSchedulerServiceID, 0),
+	  queues(),
+	  pSimulator(nullptr),
+	  nextTaskID(InvalidTaskID + 1),
+	  runningTaskID(InvalidTaskID),
+	  runningTaskCanceled(false),
+	  baseBudget(DefaultBudget),
+	  currentBudget(DefaultBudget),
+	  averageFrameTime(0.0),
+	  overrunCount(0)
+{
+}
+
+void FrameTaskScheduler::SetBaseBudget(double milliseconds)
+{
+	baseBudget = std::clamp(milliseconds, MinBudget, MaxBudget);
+	currentBudget = baseBudget;
+}
+
+void FrameTaskScheduler::SetSimulator(cISC4Simulator* pSimulator)
+{
+	this->pSimulator = pSimulator;
+}
+
+FrameTaskScheduler::TaskID FrameTaskScheduler::Schedule(const char* name, Priority priority, TaskFunction function)
+{
+	if (priority >= Priority::Count || !function)
+	{
+		return InvalidTaskID;
+	}
+
+	const TaskID id = nextTaskID++;
+
+	if (nextTaskID == InvalidTaskID)
+	{
+		nextTaskID++;
+	}
+
+	queues[static_cast<size_t>(priority)].push_back(Task{ id, name, std::move(function), 0.0 });
+
+	return id;
+}
+
+bool FrameTaskScheduler::IsScheduled(TaskID id) const
+{
+	if (id == InvalidTaskID)
+	{
+		return false;
+	}
+
+	if (id == runningTaskID)
+	{
+		return !runningTaskCanceled;
+	}
+
+	for (const std::deque<Task>& queue : queues)
+	{
+		for (const Task& task : queue)
+		{
+			if (task.id == id)
+			{
+				return true;
+			}
+		}
+	}
+
+	return false;
+}
+
+bool FrameTaskScheduler::Cancel(TaskID id)
+{
+	if (id == InvalidTaskID)
+	{
+		return false;
+	}
+
+	if (id == runningTaskID)
+	{
+		// The task is removed when its current slice returns.
+		const bool wasScheduled = !runningTaskCanceled;
+		runningTaskCanceled = true;
+		return wasScheduled;
+	}
+
+	for (std::deque<Task>& queue : queues)
+	{
+		auto it = std::find_if(queue.begin(), queue.end(), [id](const Task& task) { return task.id == id; });
+
+		if (it != queue.end())
+		{
+			queue.erase(it);
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void FrameTaskScheduler::CancelAll()
+{
+	for (std::deque<Task>& queue : queues)
+	{
+		queue.clear();
+	}
+
+	if (runningTaskID != InvalidTaskID)
+	{
+		runningTaskCanceled = true;
+	}
+}
+
+double FrameTaskScheduler::GetCurrentBudget() const
+{
+	return currentBudget;
+}
+
+uint32_t FrameTaskScheduler::GetOverrunCount() const
+{
+	return overrunCount;
+}
+
+bool FrameTaskScheduler::Init()
+{
+	return true;
+}
+
+bool FrameTaskScheduler::Shutdown()
+{
+	CancelAll();
+	return true;
+}
+
+bool FrameTaskScheduler::OnTick(uint32_t timeElapsed)
+{
+	UpdateBudget(timeElapsed);
+
+	// A task can schedule another task, the running task is not in a queue.
+	if (runningTaskID != InvalidTaskID || !HasTasks())
+	{
+		return true;
+	}
+
+	const std::chrono::steady_clock::time_point frameStart = std::chrono::steady_clock::now();
+	const FrameBudget budget(frameStart + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+		std::chrono::duration<double, std::milli>(currentBudget)));
+
+	bool ranSlice = false;
+
+	while (!ranSlice || !budget.IsExhausted())
+	{
+		auto queue = std::find_if(
+			queues.begin(),
+			queues.end(),
+			[](const std::deque<Task>& item) { return !item.empty(); });
+
+		if (queue == queues.end())
+		{
+			break;
+		}
+
+		Task task = std::move(queue->front());
+		queue->pop_front();
+
+		runningTaskID = task.id;
+		runningTaskCanceled = false;
+
+		const std::chrono::steady_clock::time_point sliceStart = std::chrono::steady_clock::now();
+		const bool completed = task.function(budget);
+		const double sliceTime = GetElapsedMilliseconds(sliceStart, std::chrono::steady_clock::now());
+
+		runningTaskID = InvalidTaskID;
+		ranSlice = true;
+
+		CheckOverrun(task, sliceTime);
+
+		if (!completed && !runningTaskCanceled)
+		{
+			// The tasks with the same priority take turns.
+			queue->push_back(std::move(task));
+		}
+	}
+
+	return true;
+}
+
+void FrameTaskScheduler::UpdateBudget(uint32_t timeElapsed)
+{
+	if (timeElapsed > 0)
+	{
+		if (averageFrameTime <= 0.0)
+		{
+			averageFrameTime = static_cast<double>(timeElapsed);
+		}
+		else
+		{
+			averageFrameTime += (static_cast<double>(timeElapsed) - averageFrameTime) * FrameTimeSmoothing;
+		}
+	}
+
+	double budget = baseBudget;
+
+	if (averageFrameTime > TargetFrameTime)
+	{
+		budget *= TargetFrameTime / averageFrameTime;
+	}
+
+	if (pSimulator)
+	{
+		const int32_t simSpeed = pSimulator->GetSimSpeed();
+
+		if (simSpeed == PausedSimSpeed)
+		{
+			budget *= PausedBudgetScale;
+		}
+		else if (simSpeed >= FastestSimSpeed)
+		{
+			budget *= FastestBudgetScale;
+		}
+	}
+
+	currentBudget = std::clamp(budget, MinBudget, MaxBudget);
+}
+
+void FrameTaskScheduler::CheckOverrun(Task& task, double sliceTime)
+{
+	if (sliceTime <= currentBudget + OverrunTolerance)
+	{
+		return;
+	}
+
+	overrunCount++;
+
+	// A task is only reported again when its overrun is longer than the last one that was reported.
+	if (sliceTime > task.reportedSliceTime)
+	{
+		task.reportedSliceTime = sliceTime;
+
+		Logger::GetInstance().WriteLineFormatted(
+			LogLevel::Info,
+			"The %s task took %.2f ms, the frame budget is %.2f ms.",
+			task.name,
+			sliceTime,
+			currentBudget);
+	}
+}
+
+bool FrameTaskScheduler::HasTasks() const
+{
+	return std::any_of(
+		queues.begin(),
+		queues.end(),
+		[](const std::deque<Task>& queue) { return !queue.empty(); });
+}
+
+FrameTaskRequest::FrameTaskRequest(
+	const char* name,
+	FrameTaskScheduler::Priority priority,
+	FrameTaskScheduler::TaskFunction function)
+	: name(name),
+	  priority(priority),
+	  function(std::move(function)),
+	  taskID(FrameTaskScheduler::InvalidTaskID),
+	  runState()
+{
+}
+
+void FrameTaskRequest::Request()
+{
+	if (spFrameTaskScheduler)
+	{
+		if (spFrameTaskScheduler->IsScheduled(taskID))
+		{
+			// The running task may have already passed the data that changed.
+			if (runState->started)
+			{
+				runState->rerunRequested = true;
+			}
+		}
+		else
+		{
+			runState = std::make_shared<RunState>(RunState{ false, false });
+
+			taskID = spFrameTaskScheduler->Schedule(
+				name,
+				priority,
+				[state = runState, original = function, task = function](const FrameBudget& budget) mutable
+				{
+					state->started = true;
+
+					if (!task(budget))
+					{
+						return false;
+					}
+
+					if (state->rerunRequested)
+					{
+						// Start over with a new copy in the next slice, the task keeps its ID.
+						state->started = false;
+						state->rerunRequested = false;
+						task = original;
+						return false;
+					}
+
+					return true;
+				});
+		}
+	}
+	else
+	{
+		FrameTaskScheduler::TaskFunction task = function;
+		const FrameBudget unlimited = FrameBudget::Unlimited();
+
+		while (!task(unlimited))
+		{
+		}
+	}
+}
+
+bool FrameTaskRequest::IsPending() const
+{
+	return spFrameTaskScheduler && spFrameTaskScheduler->IsScheduled(taskID);
+}
+
+void FrameTaskRequest::Cancel()
+{
+	if (spFrameTaskScheduler)
+	{
+		spFrameTaskScheduler->Cancel(taskID);
+	}
+
+	taskID = FrameTaskScheduler::InvalidTaskID;
+	runState.reset();
+}
@@ -0,0 +1,140 @@
+////////////////////////////////////////////////////////////////////////
+//
+// This file is part of sc4-data-view-extensions, a DLL Plugin for
+// SimCity 4 that extends the game's data views.
+//
+// Copyright (c) 2024 Nicholas Hayes
+//
+// This file is licensed under terms of the MIT License.
+// See LICENSE.txt for more information.
+//
+////////////////////////////////////////////////////////////////////////
+
+#pragma once
+#include "cRZBaseSystemService.h"
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+
+class cISC4Simulator;
+
+// The time that a task may use in the current frame.
+class FrameBudget
+{
+public:
+	explicit FrameBudget(std::chrono::steady_clock::time_point deadline);
+
+	// A budget for work that must run to completion.
+	static FrameBudget Unlimited();
+
+	bool IsExhausted() const;
+
+private:
+	std::chrono::steady_clock::time_point deadline;
+};
+
+// Runs deferred DLL work on the game thread from the framework's tick, using
+// a small time budget in each frame.
+// A task is called once per slice until it returns true, so long running work
+// should do a bounded step and return false when the budget is exhausted.
+// The higher priority tasks run first, and the tasks with the same priority
+// take turns. At least one slice runs in each frame, so every task makes progress.
+class FrameTaskScheduler final : public cRZBaseSystemService
+{
+public:
+	enum class Priority : uint32_t
+	{
+		High = 0,
+		Normal,
+		Low,
+		Count
+	};
+
+	typedef uint32_t TaskID;
+	typedef std::function<bool(const FrameBudget&)> TaskFunction;
+
+	static constexpr TaskID InvalidTaskID = 0;
+	// The default time budget for a frame, in milliseconds.
+	static constexpr double DefaultBudget = 2.0;
+
+	FrameTaskScheduler();
+
+	// Sets the time budget for a frame when the game is running at its target frame rate.
+	void SetBaseBudget(double milliseconds);
+	// The budget is adjusted for the simulation speed when the simulator is set.
+	void SetSimulator(cISC4Simulator* pSimulator);
+
+	// The name must be a string literal, it is used when reporting an overrun.
+	TaskID Schedule(const char* name, Priority priority, TaskFunction function);
+	bool IsScheduled(TaskID id) const;
+	bool Cancel(TaskID id);
+	void CancelAll();
+
+	double GetCurrentBudget() const;
+	uint32_t GetOverrunCount() const;
+
+	// cIGZSystemService
+
+	bool Init() override;
+	bool Shutdown() override;
+	bool OnTick(uint32_t timeElapsed) override;
+
+private:
+	struct Task
+	{
+		TaskID id;
+		const char* name;
+		TaskFunction function;
+		// The longest slice that was reported as an overrun.
+		double reportedSliceTime;
+	};
+
+	void UpdateBudget(uint32_t timeElapsed);
+	void CheckOverrun(Task& task, double sliceTime);
+	bool HasTasks() const;
+
+	std::array<std::deque<Task>, static_cast<size_t>(Priority::Count)> queues;
+	cISC4Simulator* pSimulator;
+	TaskID nextTaskID;
+	TaskID runningTaskID;
+	bool runningTaskCanceled;
+	double baseBudget;
+	double currentBudget;
+	double averageFrameTime;
+	uint32_t overrunCount;
+};
+
+// Keeps at most one instance of a task scheduled, for work that is requested
+// repeatedly, e.g. from a data view's render hook. A request that is made before
+// the task starts is merged into it. A request that is made after the task ran its
+// first slice makes the task run again once it completes, so the request is not lost.
+// The task function is copied for each run, so its captured state starts over.
+class FrameTaskRequest
+{
+public:
+	// The name must be a string literal, see FrameTaskScheduler::Schedule.
+	FrameTaskRequest(const char* name, FrameTaskScheduler::Priority priority, FrameTaskScheduler::TaskFunction function);
+
+	// Schedules the task, or merges the request into the scheduled task.
+	// The task runs to completion before this returns if the scheduler is not available.
+	void Request();
+	bool IsPending() const;
+	void Cancel();
+
+private:
+	// Shared with the scheduled task, which can outlive a canceled request.
+	struct RunState
+	{
+		bool started;
+		bool rerunRequested;
+	};
+
+	const char* name;
+	FrameTaskScheduler::Priority priority;
+	FrameTaskScheduler::TaskFunction function;
+	FrameTaskScheduler::TaskID taskID;
+	std::shared_ptr<RunState> runState;
+};
@@ -14,5 +14,40 @@
 #include "cISC4AuraSimulator.h"
 #include "cISC4OccupantManager.h"
 
+class AuraIsolineManager;
+class AuraRegionManager;
+class AuraExposureEngine;
+class FrameTaskScheduler;
+class BuildingAttributeIndex;
+class DataViewHighlightManager;
+class CoverageManager;
+class EffectPropertyCache;
+class EffectRankingManager;
+class GridPyramidService;
+class GridSnapshotService;
+class HighlightModeRegistry;
+class OccupantEventBus;
+class PluginEffectIndex;
+class ResidentialProximityOverlay;
+class ServiceCoverageGapMap;
+class ThreadPool;
+
 extern cISC4AuraSimulator* spAura;
-extern cISC4OccupantManager* spOccupantManager;
\ No newline at end of file
+extern cISC4OccupantManager* spOccupantManager;
+extern AuraIsolineManager* spAuraIsolineManager;
+extern AuraRegionManager* spAuraRegionManager;
+extern OccupantEventBus* spOccupantEventBus;
+extern CoverageManager* spCoverageManager;
+extern EffectPropertyCache* spEffectPropertyCache;
+extern EffectRankingManager* spEffectRankingManager;
+extern ThreadPool* spThreadPool;
+extern GridSnapshotService* spGridSnapshotService;
+extern PluginEffectIndex* spPluginEffectIndex;
+extern HighlightModeRegistry* spHighlightModeRegistry;
+extern BuildingAttributeIndex* spBuildingAttributeIndex;
+extern ResidentialProximityOverlay* spResidentialProximityOverlay;
+extern GridPyramidService* spGridPyramidService;
+extern ServiceCoverageGapMap* spServiceCoverageGapMap;
+extern AuraExposureEngine* spAuraExposureEngine;
+extern FrameTaskScheduler* spFrameTaskScheduler;
+extern DataViewHighlightManager* spDataViewHighlightManager;
\ No newline at end of file
@@ -0,0 +1,481 @@
+////////////////////////////////////////////////////////////////////////
+//
+// This file is part of sc4-data-view-extensions, a DLL Plugin for
+// SimCity 4 that extends the game's data views.
+//
+// Copyright (c) 2024 Nicholas Hayes
+//
+// This file is licensed under terms of the MIT License.
+// See LICENSE.txt for more information.
+//
+////////////////////////////////////////////////////////////////////////
+
+#include "GridPyramid.h"
+#include <algorithm>
+#include <limits>
+
+GridPyramid::GridPyramid()
+	: levels(),
+	  dirtyBlocks(),
+	  rowMin(),
+	  rowMax(),
+	  rowSum(),
+	  generation(0)
+{
+}
+
+bool GridPyramid::Update(const GridSnapshot& snapshot)
+{
+	if (snapshot.width == 0 || snapshot.height == 0)
+	{
+		const bool changed = !IsEmpty();
+		Clear();
+		return changed;
+	}
+
+	if (levels.empty() || levels[0].width != snapshot.width || levels[0].height != snapshot.height)
+	{
+		Resize(snapshot.width, snapshot.height);
+	}
+
+	Level& base = levels[0];
+	bool changed = false;
+
+	for (uint32_t z = 0; z < base.height; z++)
+	{
+		const int16_t* source = snapshot.GetRow(z);
+		const size_t rowOffset = static_cast<size_t>(z) * base.width;
+		int16_t* target = base.min.data() + rowOffset;
+
+		const auto mismatch = std::mismatch(source, source + base.width, target);
+
+		if (mismatch.first == source + base.width)
+		{
+			continue;
+		}
+
+		// Find the last changed column so that only the blocks in that span are marked.
+		uint32_t lastColumn = base.width - 1;
+
+		while (source[lastColumn] == target[lastColumn])
+		{
+			lastColumn--;
+		}
+
+		const uint32_t firstColumn = static_cast<uint32_t>(mismatch.first - source);
+
+		std::copy(source + firstColumn, source + lastColumn + 1, target + firstColumn);
+		std::copy(source + firstColumn, source + lastColumn + 1, base.max.data() + rowOffset + firstColumn);
+		std::copy(source + firstColumn, source + lastColumn + 1, base.sum.data() + rowOffset + firstColumn);
+
+		MarkDirty(z, firstColumn, lastColumn);
+		changed = true;
+	}
+
+	for (size_t levelIndex = 0; levelIndex < levels.size(); levelIndex++)
+	{
+		Level& level = levels[levelIndex];
+		std::vector<uint8_t>& flags = dirtyBlocks[levelIndex];
+
+		for (uint32_t blockZ = 0; blockZ < level.blockCountZ; blockZ++)
+		{
+			for (uint32_t blockX = 0; blockX < level.blockCountX; blockX++)
+			{
+				const size_t blockIndex = static_cast<size_t>(blockZ) * level.blockCountX + blockX;
+
+				if (!flags[blockIndex])
+				{
+					continue;
+				}
+
+				flags[blockIndex] = 0;
+
+				if (levelIndex > 0)
+				{
+					RebuildBlock(levelIndex, blockX, blockZ);
+				}
+
+				level.blockVersions[blockIndex]++;
+
+				if (levelIndex + 1 < levels.size())
+				{
+					// A block covers one quarter of a block on the next level.
+					const Level& next = levels[levelIndex + 1];
+					dirtyBlocks[levelIndex + 1][static_cast<size_t>(blockZ >> 1) * next.blockCountX + (blockX >> 1)] = 1;
+				}
+			}
+		}
+	}
+
+	return changed;
+}
+
+void GridPyramid::Clear()
+{
+	if (!levels.empty())
+	{
+		generation++;
+	}
+
+	levels = std::vector<Level>();
+	dirtyBlocks = std::vector<std::vector<uint8_t>>();
+	rowMin = std::vector<int16_t>();
+	rowMax = std::vector<int16_t>();
+	rowSum = std::vector<int64_t>();
+}
+
+bool GridPyramid::IsEmpty() const
+{
+	return levels.empty();
+}
+
+uint32_t GridPyramid::GetGeneration() const
+{
+	return generation;
+}
+
+size_t GridPyramid::GetLevelCount() const
+{
+	return levels.size();
+}
+
+const GridPyramid::Level& GridPyramid::GetLevel(size_t index) const
+{
+	return levels[index];
+}
+
+GridPyramid::Stats GridPyramid::GetCellStats(size_t levelIndex, uint32_t x, uint32_t z) const
+{
+	const Level& level = levels[levelIndex];
+	const size_t index = static_cast<size_t>(z) * level.width + x;
+	const CellRect bounds = GetCellBounds(levelIndex, x, z);
+
+	Stats stats{};
+	stats.min = level.min[index];
+	stats.max = level.max[index];
+	stats.sum = level.sum[index];
+	stats.count = (bounds.right - bounds.left) * (bounds.bottom - bounds.top);
+
+	return stats;
+}
+
+size_t GridPyramid::GetLevelForSize(uint32_t maxWidth, uint32_t maxHeight) const
+{
+	for (size_t i = 0; i < levels.size(); i++)
+	{
+		if (levels[i].width <= maxWidth && levels[i].height <= maxHeight)
+		{
+			return i;
+		}
+	}
+
+	return levels.empty() ? 0 : levels.size() - 1;
+}
+
+bool GridPyramid::AnyAbove(const SC4Rect<int32_t>& rect, int32_t threshold) const
+{
+	CellRect clipped{};
+
+	if (!ClipRect(rect, clipped))
+	{
+		return false;
+	}
+
+	return AnyMatch(clipped, [threshold](int32_t min, int32_t max) { return max > threshold; });
+}
+
+bool GridPyramid::AnyBelow(const SC4Rect<int32_t>& rect, int32_t threshold) const
+{
+	CellRect clipped{};
+
+	if (!ClipRect(rect, clipped))
+	{
+		return false;
+	}
+
+	return AnyMatch(clipped, [threshold](int32_t min, int32_t max) { return min < threshold; });
+}
+
+bool GridPyramid::GetStats(const SC4Rect<int32_t>& rect, Stats& stats) const
+{
+	CellRect clipped{};
+
+	if (!ClipRect(rect, clipped))
+	{
+		return false;
+	}
+
+	stats.min = std::numeric_limits<int32_t>::max();
+	stats.max = std::numeric_limits<int32_t>::min();
+	stats.sum = 0;
+	stats.count = 0;
+
+	AccumulateStats(levels.size() - 1, 0, 0, clipped, stats);
+
+	return stats.count > 0;
+}
+
+void GridPyramid::Resize(uint32_t width, uint32_t height)
+{
+	levels.clear();
+	dirtyBlocks.clear();
+	generation++;
+
+	uint32_t levelWidth = width;
+	uint32_t levelHeight = height;
+	uint32_t shift = 0;
+
+	while (true)
+	{
+		Level& level = levels.emplace_back();
+		level.width = levelWidth;
+		level.height = levelHeight;
+		level.shift = shift;
+		level.blockCountX = (levelWidth + BlockSize - 1) / BlockSize;
+		level.blockCountZ = (levelHeight + BlockSize - 1) / BlockSize;
+
+		const size_t cellCount = static_cast<size_t>(levelWidth) * levelHeight;
+		const size_t blockCount = static_cast<size_t>(level.blockCountX) * level.blockCountZ;
+
+		level.min.assign(cellCount, 0);
+		level.max.assign(cellCount, 0);
+		level.sum.assign(cellCount, 0);
+		level.blockVersions.assign(blockCount, 0);
+
+		// Every block is built on the first update.
+		dirtyBlocks.emplace_back(blockCount, static_cast<uint8_t>(1));
+
+		if (levelWidth == 1 && levelHeight == 1)
+		{
+			break;
+		}
+
+		levelWidth = (levelWidth + 1) / 2;
+		levelHeight = (levelHeight + 1) / 2;
+		shift++;
+	}
+
+	rowMin.resize(width);
+	rowMax.resize(width);
+	rowSum.resize(width);
+}
+
+void GridPyramid::MarkDirty(uint32_t row, uint32_t firstColumn, uint32_t lastColumn)
+{
+	const Level& base = levels[0];
+	std::vector<uint8_t>& flags = dirtyBlocks[0];
+
+	const size_t rowOffset = static_cast<size_t>(row / BlockSize) * base.blockCountX;
+
+	for (uint32_t blockX = firstColumn / BlockSize; blockX <= lastColumn / BlockSize; blockX++)
+	{
+		flags[rowOffset + blockX] = 1;
+	}
+}
+
+void GridPyramid::RebuildBlock(size_t levelIndex, uint32_t blockX, uint32_t blockZ)
+{
+	const Level& source = levels[levelIndex - 1];
+	Level& target = levels[levelIndex];
+
+	const uint32_t firstColumn = blockX * BlockSize;
+	const uint32_t lastColumn = std::min(firstColumn + BlockSize, target.width);
+	const uint32_t firstRow = blockZ * BlockSize;
+	const uint32_t lastRow = std::min(firstRow + BlockSize, target.height);
+
+	for (uint32_t z = firstRow; z < lastRow; z++)
+	{
+		ReduceRows(source, z * 2, target, z, firstColumn, lastColumn);
+	}
+}
+
+void GridPyramid::ReduceRows(
+	const Level& source,
+	uint32_t sourceRow,
+	Level& target,
+	uint32_t targetRow,
+	uint32_t firstColumn,
+	uint32_t lastColumn)
+{
+	const uint32_t sourceFirst = firstColumn * 2;
+	const uint32_t sourceLast = std::min(lastColumn * 2, source.width);
+	const size_t offset0 = static_cast<size_t>(sourceRow) * source.width;
+	// The last row of an odd height level is reduced with itself.
+	const size_t offset1 = sourceRow + 1 < source.height ? offset0 + source.width : offset0;
+
+	const int16_t* min0 = source.min.data() + offset0;
+	const int16_t* min1 = source.min.data() + offset1;
+	const int16_t* max0 = source.max.data() + offset0;
+	const int16_t* max1 = source.max.data() + offset1;
+	const int64_t* sum0 = source.sum.data() + offset0;
+	const int64_t* sum1 = source.sum.data() + offset1;
+
+	// The vertical pass works on contiguous rows, which allows the compiler to
+	// vectorize it.
+	for (uint32_t x = sourceFirst; x < sourceLast; x++)
+	{
+		rowMin[x] = std::min(min0[x], min1[x]);
+		rowMax[x] = std::max(max0[x], max1[x]);
+	}
+
+	if (offset1 != offset0)
+	{
+		for (uint32_t x = sourceFirst; x < sourceLast; x++)
+		{
+			rowSum[x] = sum0[x] + sum1[x];
+		}
+	}
+	else
+	{
+		std::copy(sum0 + sourceFirst, sum0 + sourceLast, rowSum.data() + sourceFirst);
+	}
+
+	const size_t targetOffset = static_cast<size_t>(targetRow) * target.width;
+	int16_t* targetMin = target.min.data() + targetOffset;
+	int16_t* targetMax = target.max.data() + targetOffset;
+	int64_t* targetSum = target.sum.data() + targetOffset;
+
+	// The horizontal pass combines the column pairs, the last column of an odd
+	// width level has no pair.
+	const uint32_t pairedLast = std::min(lastColumn, source.width / 2);
+
+	for (uint32_t x = firstColumn; x < pairedLast; x++)
+	{
+		const uint32_t sx = x * 2;
+
+		targetMin[x] = std::min(rowMin[sx], rowMin[sx + 1]);
+		targetMax[x] = std::max(rowMax[sx], rowMax[sx + 1]);
+		targetSum[x] = rowSum[sx] + rowSum[sx + 1];
+	}
+
+	for (uint32_t x = std::max(firstColumn, pairedLast); x < lastColumn; x++)
+	{
+		const uint32_t sx = x * 2;
+
+		targetMin[x] = rowMin[sx];
+		targetMax[x] = rowMax[sx];
+		targetSum[x] = rowSum[sx];
+	}
+}
+
+bool GridPyramid::ClipRect(const SC4Rect<int32_t>& rect, CellRect& clipped) const
+{
+	if (levels.empty())
+	{
+		return false;
+	}
+
+	const Level& base = levels[0];
+
+	const int64_t left = std::max<int64_t>(rect.topLeftX, 0);
+	const int64_t top = std::max<int64_t>(rect.topLeftY, 0);
+	const int64_t right = std::min<int64_t>(static_cast<int64_t>(rect.bottomRightX) + 1, base.width);
+	const int64_t bottom = std::min<int64_t>(static_cast<int64_t>(rect.bottomRightY) + 1, base.height);
+
+	if (left >= right || top >= bottom)
+	{
+		return false;
+	}
+
+	clipped.left = static_cast<uint32_t>(left);
+	clipped.top = static_cast<uint32_t>(top);
+	clipped.right = static_cast<uint32_t>(right);
+	clipped.bottom = static_cast<uint32_t>(bottom);
+
+	return true;
+}
+
+GridPyramid::CellRect GridPyramid::GetCellBounds(size_t levelIndex, uint32_t x, uint32_t z) const
+{
+	const Level& base = levels[0];
+	const uint32_t shift = levels[levelIndex].shift;
+
+	CellRect bounds{};
+	bounds.left = x << shift;
+	bounds.top = z << shift;
+	bounds.right = std::min((x + 1) << shift, base.width);
+	bounds.bottom = std::min((z + 1) << shift, base.height);
+
+	return bounds;
+}
+
+template<typename Predicate>
+bool GridPyramid::AnyMatch(const CellRect& rect, Predicate predicate) const
+{
+	return AnyMatch(levels.size() - 1, 0, 0, rect, predicate);
+}
+
+template<typename Predicate>
+bool GridPyramid::AnyMatch(size_t levelIndex, uint32_t x, uint32_t z, const CellRect& rect, Predicate predicate) const
+{
+	const Level& level = levels[levelIndex];
+	const CellRect bounds = GetCellBounds(levelIndex, x, z);
+
+	if (bounds.right <= rect.left || bounds.left >= rect.right || bounds.bottom <= rect.top || bounds.top >= rect.bottom)
+	{
+		return false;
+	}
+
+	const size_t index = static_cast<size_t>(z) * level.width + x;
+
+	if (!predicate(level.min[index], level.max[index]))
+	{
+		return false;
+	}
+
+	// The summary is exact for a cell that is inside the rectangle.
+	if (bounds.left >= rect.left && bounds.right <= rect.right && bounds.top >= rect.top && bounds.bottom <= rect.bottom)
+	{
+		return true;
+	}
+
+	const Level& child = levels[levelIndex - 1];
+	const uint32_t childRight = std::min(x * 2 + 2, child.width);
+	const uint32_t childBottom = std::min(z * 2 + 2, child.height);
+
+	for (uint32_t childZ = z * 2; childZ < childBottom; childZ++)
+	{
+		for (uint32_t childX = x * 2; childX < childRight; childX++)
+		{
+			if (AnyMatch(levelIndex - 1, childX, childZ, rect, predicate))
+			{
+				return true;
+			}
+		}
+	}
+
+	return false;
+}
+
+void GridPyramid::AccumulateStats(size_t levelIndex, uint32_t x, uint32_t z, const CellRect& rect, Stats& stats) const
+{
+	const CellRect bounds = GetCellBounds(levelIndex, x, z);
+
+	if (bounds.right <= rect.left || bounds.left >= rect.right || bounds.bottom <= rect.top || bounds.top >= rect.bottom)
+	{
+		return;
+	}
+
+	if (bounds.left >= rect.left && bounds.right <= rect.right && bounds.top >= rect.top && bounds.bottom <= rect.bottom)
+	{
+		const Stats cell = GetCellStats(levelIndex, x, z);
+
+		stats.min = std::min(stats.min, cell.min);
+		stats.max = std::max(stats.max, cell.max);
+		stats.sum += cell.sum;
+		stats.count += cell.count;
+		return;
+	}
+
+	const Level& child = levels[levelIndex - 1];
+	const uint32_t childRight = std::min(x * 2 + 2, child.width);
+	const uint32_t childBottom = std::min(z * 2 + 2, child.height);
+
+	for (uint32_t childZ = z * 2; childZ < childBottom; childZ++)
+	{
+		for (uint32_t childX = x * 2; childX < childRight; childX++)
+		{
+			AccumulateStats(levelIndex - 1, childX, childZ, rect, stats);
+		}
+	}
+}
@@ -0,0 +1,120 @@
+////////////////////////////////////////////////////////////////////////
+//
+// This file is part of sc4-data-view-extensions, a DLL Plugin for
+// SimCity 4 that extends the game's data views.
+//
+// Copyright (c) 2024 Nicholas Hayes
+//
+// This file is licensed under terms of the MIT License.
+// See LICENSE.txt for more information.
+//
+////////////////////////////////////////////////////////////////////////
+
+#pragma once
+#include "GridSnapshot.h"
+#include "SC4Rect.h"
+#include <cstdint>
+#include <vector>
+
+// A min/max/mean pyramid of a grid snapshot.
+// Level 0 holds the snapshot values, and each cell of level N summarizes the
+// 2x2 block of level N - 1 cells below it. The levels are split into square
+// blocks, only the blocks that are above a changed block are recomputed when
+// the pyramid is updated.
+class GridPyramid
+{
+public:
+	// The block width and height in cells of the level.
+	static constexpr uint32_t BlockSize = 32;
+
+	struct Stats
+	{
+		int32_t min;
+		int32_t max;
+		// The sum of the level 0 values and the number of level 0 cells.
+		int64_t sum;
+		uint32_t count;
+
+		int32_t GetMean() const
+		{
+			return count > 0 ? static_cast<int32_t>(sum / static_cast<int64_t>(count)) : 0;
+		}
+	};
+
+	struct Level
+	{
+		uint32_t width;
+		uint32_t height;
+		// The level 0 cell count of a full cell on this level is 1 << (2 * shift).
+		uint32_t shift;
+		uint32_t blockCountX;
+		uint32_t blockCountZ;
+		std::vector<int16_t> min;
+		std::vector<int16_t> max;
+		std::vector<int64_t> sum;
+		// Incremented each time a block is recomputed.
+		std::vector<uint32_t> blockVersions;
+	};
+
+	GridPyramid();
+
+	// Copies the snapshot values and recomputes the blocks that changed.
+	// Returns true if any value changed.
+	bool Update(const GridSnapshot& snapshot);
+
+	void Clear();
+
+	bool IsEmpty() const;
+
+	// Incremented when the pyramid dimensions change.
+	uint32_t GetGeneration() const;
+
+	size_t GetLevelCount() const;
+	const Level& GetLevel(size_t index) const;
+	Stats GetCellStats(size_t levelIndex, uint32_t x, uint32_t z) const;
+
+	// Returns the smallest level with both dimensions at or below the specified size.
+	size_t GetLevelForSize(uint32_t maxWidth, uint32_t maxHeight) const;
+
+	// The rectangles are in level 0 cells, and the bottom right corner is inclusive.
+	// The rectangle is clipped to the grid bounds.
+
+	// Returns true if any value in the rectangle is above the threshold.
+	bool AnyAbove(const SC4Rect<int32_t>& rect, int32_t threshold) const;
+	// Returns true if any value in the rectangle is below the threshold.
+	bool AnyBelow(const SC4Rect<int32_t>& rect, int32_t threshold) const;
+	// Returns false if the rectangle does not contain any cells.
+	bool GetStats(const SC4Rect<int32_t>& rect, Stats& stats) const;
+
+private:
+	struct CellRect
+	{
+		uint32_t left;
+		uint32_t top;
+		// Exclusive
+		uint32_t right;
+		uint32_t bottom;
+	};
+
+	void Resize(uint32_t width, uint32_t height);
+	void MarkDirty(uint32_t row, uint32_t firstColumn, uint32_t lastColumn);
+	void RebuildBlock(size_t levelIndex, uint32_t blockX, uint32_t blockZ);
+	void ReduceRows(const Level& source, uint32_t sourceRow, Level& target, uint32_t targetRow, uint32_t firstColumn, uint32_t lastColumn);
+
+	bool ClipRect(const SC4Rect<int32_t>& rect, CellRect& clipped) const;
+	CellRect GetCellBounds(size_t levelIndex, uint32_t x, uint32_t z) const;
+	template<typename Predicate>
+	bool AnyMatch(const CellRect& rect, Predicate predicate) const;
+	template<typename Predicate>
+	bool AnyMatch(size_t levelIndex, uint32_t x, uint32_t z, const CellRect& rect, Predicate predicate) const;
+	void AccumulateStats(size_t levelIndex, uint32_t x, uint32_t z, const CellRect& rect, Stats& stats) const;
+
+	std::vector<Level> levels;
+	// The dirty block flags of each level.
+	std::vector<std::vector<uint8_t>> dirtyBlocks;
+	// The scratch buffers for the vertical reduction of two rows.
+	std::vector<int16_t> rowMin;
+	std::vector<int16_t> rowMax;
+	std::vector<int64_t> rowSum;
+	uint32_t generation;
+};
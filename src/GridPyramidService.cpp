@@ -0,0 +1,224 @@
+////////////////////////////////////////////////////////////////////////
+//
+// This file is part of sc4-data-view-extensions, a DLL Plugin for
+// SimCity 4 that extends the game's data views.
+//
+// Copyright (c) 2024 Nicholas Hayes
+//
+// This file is licensed under terms of the MIT License.
+// See LICENSE.txt for more information.
+//
+////////////////////////////////////////////////////////////////////////
+
+#include "GridPyramidService.h"
+#include "GlobalPointers.h"
+#include "MemoryArena.h"
+#include <algorithm>
+
+static_assert(static_cast<size_t>(SnapshotGrid::Count) == 3, "The overview grid initializer must match SnapshotGrid.");
+
+GridPyramidService::GridPyramidService()
+	: pyramids(),
+	  snapshotVersions(),
+	  tileCache(TileCacheCapacity),
+	  overviewGrids{
+		DllSimGrid<int16_t>(MemoryArenas::Get(MemorySubsystem::Overlays)),
+		DllSimGrid<int16_t>(MemoryArenas::Get(MemorySubsystem::Overlays)),
+		DllSimGrid<int16_t>(MemoryArenas::Get(MemorySubsystem::Overlays)) }
+{
+}
+
+const GridPyramid* GridPyramidService::GetPyramid(SnapshotGrid grid)
+{
+	if (!spAura)
+	{
+		return nullptr;
+	}
+
+	spGridSnapshotService->Capture(grid);
+
+	std::shared_ptr<const GridSnapshot> snapshot = spGridSnapshotService->GetSnapshot(grid);
+
+	if (!snapshot)
+	{
+		return nullptr;
+	}
+
+	const size_t index = static_cast<size_t>(grid);
+	GridPyramid& pyramid = pyramids[index];
+
+	if (snapshot->version != snapshotVersions[index])
+	{
+		pyramid.Update(*snapshot);
+		snapshotVersions[index] = snapshot->version;
+	}
+
+	return pyramid.IsEmpty() ? nullptr : &pyramid;
+}
+
+const ColorizedTile* GridPyramidService::GetColorizedTile(
+	uint32_t dataSource,
+	SnapshotGrid grid,
+	size_t level,
+	uint32_t tileX,
+	uint32_t tileZ,
+	ColorizeCallback callback,
+	void* pContext)
+{
+	const GridPyramid* pyramid = GetPyramid(grid);
+
+	if (!pyramid)
+	{
+		return nullptr;
+	}
+
+	return GetColorizedTile(dataSource, *pyramid, level, tileX, tileZ, callback, pContext);
+}
+
+cISC4SimGrid<int16_t>* GridPyramidService::GetOverviewGrid(SnapshotGrid grid, uint32_t maxWidth, uint32_t maxHeight)
+{
+	if (maxWidth == 0 || maxHeight == 0)
+	{
+		return nullptr;
+	}
+
+	const GridPyramid* pyramid = GetPyramid(grid);
+
+	if (!pyramid)
+	{
+		return nullptr;
+	}
+
+	const size_t level = pyramid->GetLevelForSize(maxWidth, maxHeight);
+
+	if (level == 0)
+	{
+		return nullptr;
+	}
+
+	const GridPyramid::Level& pyramidLevel = pyramid->GetLevel(level);
+	const int32_t tractSize = spGridSnapshotService->GetSnapshot(grid)->tractSize << pyramidLevel.shift;
+
+	DllSimGrid<int16_t>& overviewGrid = overviewGrids[static_cast<size_t>(grid)];
+
+	if (overviewGrid.GetTractCountX() != static_cast<int32_t>(pyramidLevel.width)
+		|| overviewGrid.GetTractCountZ() != static_cast<int32_t>(pyramidLevel.height)
+		|| overviewGrid.GetTractSize() != tractSize)
+	{
+		overviewGrid.Resize(
+			static_cast<int32_t>(pyramidLevel.width) * tractSize,
+			static_cast<int32_t>(pyramidLevel.height) * tractSize,
+			tractSize);
+	}
+
+	// The tiles are only colorized again when their pyramid block changed,
+	// so the copy below is the only work for an unchanged level.
+	int16_t* values = overviewGrid.GetValues();
+	const uint32_t dataSource = static_cast<uint32_t>(grid);
+
+	for (uint32_t tileZ = 0; tileZ < pyramidLevel.blockCountZ; tileZ++)
+	{
+		for (uint32_t tileX = 0; tileX < pyramidLevel.blockCountX; tileX++)
+		{
+			const ColorizedTile* tile = GetColorizedTile(dataSource, *pyramid, level, tileX, tileZ, ColorizeMean, nullptr);
+
+			if (!tile)
+			{
+				continue;
+			}
+
+			const uint32_t* pixels = tile->pixels.data();
+
+			for (uint32_t z = 0; z < tile->height; z++)
+			{
+				int16_t* row = values
+					+ (static_cast<size_t>(tileZ * GridPyramid::BlockSize + z) * pyramidLevel.width)
+					+ (tileX * GridPyramid::BlockSize);
+
+				for (uint32_t x = 0; x < tile->width; x++)
+				{
+					row[x] = static_cast<int16_t>(*pixels++);
+				}
+			}
+		}
+	}
+
+	return &overviewGrid;
+}
+
+void GridPyramidService::PreCityShutdown()
+{
+	for (GridPyramid& pyramid : pyramids)
+	{
+		pyramid.Clear();
+	}
+
+	for (DllSimGrid<int16_t>& overviewGrid : overviewGrids)
+	{
+		overviewGrid.Clear();
+	}
+
+	snapshotVersions.fill(0);
+	tileCache.Clear();
+}
+
+const ColorizedTile* GridPyramidService::GetColorizedTile(
+	uint32_t dataSource,
+	const GridPyramid& pyramid,
+	size_t level,
+	uint32_t tileX,
+	uint32_t tileZ,
+	ColorizeCallback callback,
+	void* pContext)
+{
+	if (level >= pyramid.GetLevelCount())
+	{
+		return nullptr;
+	}
+
+	const GridPyramid::Level& pyramidLevel = pyramid.GetLevel(level);
+
+	if (tileX >= pyramidLevel.blockCountX || tileZ >= pyramidLevel.blockCountZ)
+	{
+		return nullptr;
+	}
+
+	const ColorizedTileKey key{ dataSource, static_cast<uint32_t>(level), tileX, tileZ };
+	const uint32_t blockVersion = pyramidLevel.blockVersions[static_cast<size_t>(tileZ) * pyramidLevel.blockCountX + tileX];
+	const uint64_t stamp = (static_cast<uint64_t>(pyramid.GetGeneration()) << 32) | blockVersion;
+
+	const ColorizedTile* cached = tileCache.Find(key, stamp);
+
+	if (cached)
+	{
+		return cached;
+	}
+
+	ColorizedTile& tile = tileCache.Insert(key, stamp);
+
+	const uint32_t left = tileX * GridPyramid::BlockSize;
+	const uint32_t top = tileZ * GridPyramid::BlockSize;
+
+	tile.width = std::min(GridPyramid::BlockSize, pyramidLevel.width - left);
+	tile.height = std::min(GridPyramid::BlockSize, pyramidLevel.height - top);
+	tile.pixels.resize(static_cast<size_t>(tile.width) * tile.height);
+
+	uint32_t* pixels = tile.pixels.data();
+
+	for (uint32_t z = 0; z < tile.height; z++)
+	{
+		for (uint32_t x = 0; x < tile.width; x++)
+		{
+			*pixels++ = callback(pyramid.GetCellStats(level, left + x, top + z), pContext);
+		}
+	}
+
+	return &tile;
+}
+
+uint32_t GridPyramidService::ColorizeMean(const GridPyramid::Stats& stats, void* pContext)
+{
+	// The overview grids store the data view value instead of a color,
+	// the game colors the values in the same way as the full grid.
+	return static_cast<uint16_t>(static_cast<int16_t>(stats.GetMean()));
+}
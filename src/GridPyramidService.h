@@ -0,0 +1,75 @@
+////////////////////////////////////////////////////////////////////////
+//
+// This file is part of sc4-data-view-extensions, a DLL Plugin for
+// SimCity 4 that extends the game's data views.
+//
+// Copyright (c) 2024 Nicholas Hayes
+//
+// This file is licensed under terms of the MIT License.
+// See LICENSE.txt for more information.
+//
+////////////////////////////////////////////////////////////////////////
+
+#pragma once
+#include "ColorizedTileCache.h"
+#include "DllSimGrid.h"
+#include "GridPyramid.h"
+#include "GridSnapshotService.h"
+#include <array>
+
+// Maintains a min/max/mean pyramid of each snapshot grid, and a cache of the
+// colorized pyramid tiles for the zoomed out views.
+// The overview grids that the data views draw in place of a large game grid
+// are assembled from the cached tiles.
+// The pyramids are updated when they are requested, this must be called on
+// the game thread.
+class GridPyramidService
+{
+public:
+	// The number of colorized tiles that are kept in the cache.
+	static constexpr size_t TileCacheCapacity = 256;
+
+	typedef uint32_t(*ColorizeCallback)(const GridPyramid::Stats& stats, void* pContext);
+
+	GridPyramidService();
+
+	// Returns nullptr if a city is not loaded.
+	const GridPyramid* GetPyramid(SnapshotGrid grid);
+
+	// Gets a colorized block of a pyramid level, the tile size is GridPyramid::BlockSize.
+	// The data source is the caller's ID for the combination of the grid and the
+	// color mapping, the tile is only rebuilt when its pyramid block changes.
+	// Returns nullptr if a city is not loaded or the tile is out of range.
+	const ColorizedTile* GetColorizedTile(
+		uint32_t dataSource,
+		SnapshotGrid grid,
+		size_t level,
+		uint32_t tileX,
+		uint32_t tileZ,
+		ColorizeCallback callback,
+		void* pContext);
+
+	// Gets a data view grid of the tract means from the largest pyramid level that
+	// fits in the specified size, its tract size is scaled to cover the whole city.
+	// Returns nullptr if a city is not loaded or the full grid already fits.
+	cISC4SimGrid<int16_t>* GetOverviewGrid(SnapshotGrid grid, uint32_t maxWidth, uint32_t maxHeight);
+
+	void PreCityShutdown();
+
+private:
+	const ColorizedTile* GetColorizedTile(
+		uint32_t dataSource,
+		const GridPyramid& pyramid,
+		size_t level,
+		uint32_t tileX,
+		uint32_t tileZ,
+		ColorizeCallback callback,
+		void* pContext);
+
+	static uint32_t ColorizeMean(const GridPyramid::Stats& stats, void* pContext);
+
+	std::array<GridPyramid, static_cast<size_t>(SnapshotGrid::Count)> pyramids;
+	std::array<uint64_t, static_cast<size_t>(SnapshotGrid::Count)> snapshotVersions;
+	ColorizedTileCache tileCache;
+	std::array<DllSimGrid<int16_t>, static_cast<size_t>(SnapshotGrid::Count)> overviewGrids;
+};
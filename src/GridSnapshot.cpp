@@ -0,0 +1,118 @@
+////////////////////////////////////////////////////////////////////////
+//
+// This file is part of sc4-data-view-extensions, a DLL Plugin for
+// SimCity 4 that extends the game's data views.
+//
+// Copyright (c) 2024 Nicholas Hayes
+//
+// This file is licensed under terms of the MIT License.
+// See LICENSE.txt for more information.
+//
+////////////////////////////////////////////////////////////////////////
+
+#include "GridSnapshot.h"
+
+GridSnapshotChannel::GridSnapshotChannel()
+	: pool(),
+	  latest(),
+	  previous(),
+	  target(),
+	  rowBuffer(),
+	  lastVersion(0),
+	  anyRowChanged(false)
+{
+}
+
+std::shared_ptr<const GridSnapshot> GridSnapshotChannel::GetLatest() const
+{
+	return latest.load(std::memory_order_acquire);
+}
+
+void GridSnapshotChannel::Clear()
+{
+	latest.store(nullptr, std::memory_order_release);
+	previous.reset();
+	target.reset();
+	pool.clear();
+	rowBuffer = std::vector<int16_t>();
+}
+
+void GridSnapshotChannel::BeginCapture(uint32_t width, uint32_t height, int32_t tractSize)
+{
+	previous = latest.load(std::memory_order_acquire);
+	target.reset();
+
+	// A pooled buffer can be reused when the pool holds the only reference to it,
+	// no new references can be taken because it is not the latest snapshot.
+	for (const std::shared_ptr<GridSnapshot>& item : pool)
+	{
+		if (item != previous && item.use_count() == 1)
+		{
+			target = item;
+			break;
+		}
+	}
+
+	if (!target)
+	{
+		target = std::make_shared<GridSnapshot>();
+
+		if (pool.size() < PoolSize)
+		{
+			pool.push_back(target);
+		}
+	}
+
+	const size_t valueCount = static_cast<size_t>(width) * height;
+
+	if (target->width != width || target->height != height || target->values.size() != valueCount)
+	{
+		target->width = width;
+		target->height = height;
+		target->values.assign(valueCount, 0);
+	}
+
+	target->tractSize = tractSize;
+	target->changedRows.assign(height, 0);
+
+	// A size change invalidates every row of the previous snapshot.
+	anyRowChanged = !previous || previous->width != width || previous->height != height;
+
+	rowBuffer.resize(width);
+}
+
+void GridSnapshotChannel::CaptureRow(uint32_t row)
+{
+	int16_t* targetRow = target->values.data() + static_cast<size_t>(row) * target->width;
+
+	// The reused buffer holds an older version, only the rows that differ are copied.
+	if (!std::equal(rowBuffer.begin(), rowBuffer.end(), targetRow))
+	{
+		std::copy(rowBuffer.begin(), rowBuffer.end(), targetRow);
+	}
+
+	const bool sameSize = previous && previous->width == target->width && previous->height == target->height;
+
+	if (!sameSize || !std::equal(rowBuffer.begin(), rowBuffer.end(), previous->GetRow(row)))
+	{
+		target->changedRows[row] = 1;
+		anyRowChanged = true;
+	}
+}
+
+bool GridSnapshotChannel::EndCapture()
+{
+	bool published = false;
+
+	if (anyRowChanged)
+	{
+		target->version = ++lastVersion;
+		latest.store(target, std::memory_order_release);
+		published = true;
+	}
+
+	previous.reset();
+	target.reset();
+
+	return published;
+}
@@ -0,0 +1,89 @@
+////////////////////////////////////////////////////////////////////////
+//
+// This file is part of sc4-data-view-extensions, a DLL Plugin for
+// SimCity 4 that extends the game's data views.
+//
+// Copyright (c) 2024 Nicholas Hayes
+//
+// This file is licensed under terms of the MIT License.
+// See LICENSE.txt for more information.
+//
+////////////////////////////////////////////////////////////////////////
+
+#pragma once
+#include "cISC4SimGrid.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// An immutable copy of a simulation grid's tract values.
+// The values are widened to 16 bits and stored in row-major order.
+struct GridSnapshot
+{
+	// The version is incremented each time the grid values change.
+	uint64_t version;
+	uint32_t width;
+	uint32_t height;
+	int32_t tractSize;
+	std::vector<int16_t> values;
+	// 1 for each row that changed since the previous version.
+	std::vector<uint8_t> changedRows;
+
+	const int16_t* GetRow(uint32_t row) const
+	{
+		return values.data() + static_cast<size_t>(row) * width;
+	}
+};
+
+// Copies a simulation grid into a small pool of snapshot buffers.
+// Capture must be called on the game thread at a point where the simulator
+// is not modifying the grid, the latest snapshot can be read from any thread.
+// A buffer is only reused once no reader holds a reference to it.
+class GridSnapshotChannel
+{
+public:
+	static constexpr size_t PoolSize = 3;
+
+	GridSnapshotChannel();
+
+	// Returns true if a new snapshot was published.
+	template<typename T>
+	bool Capture(cISC4SimGrid<T>* grid)
+	{
+		const uint32_t width = static_cast<uint32_t>(std::max(grid->GetTractCountX(), 0));
+		const uint32_t height = static_cast<uint32_t>(std::max(grid->GetTractCountZ(), 0));
+
+		BeginCapture(width, height, grid->GetTractSize());
+
+		for (uint32_t z = 0; z < height; z++)
+		{
+			for (uint32_t x = 0; x < width; x++)
+			{
+				rowBuffer[x] = static_cast<int16_t>(grid->GetTractValue(static_cast<int32_t>(x), static_cast<int32_t>(z)));
+			}
+
+			CaptureRow(z);
+		}
+
+		return EndCapture();
+	}
+
+	std::shared_ptr<const GridSnapshot> GetLatest() const;
+
+	void Clear();
+
+private:
+	void BeginCapture(uint32_t width, uint32_t height, int32_t tractSize);
+	void CaptureRow(uint32_t row);
+	bool EndCapture();
+
+	std::vector<std::shared_ptr<GridSnapshot>> pool;
+	std::atomic<std::shared_ptr<const GridSnapshot>> latest;
+	std::shared_ptr<const GridSnapshot> previous;
+	std::shared_ptr<GridSnapshot> target;
+	std::vector<int16_t> rowBuffer;
+	uint64_t lastVersion;
+	bool anyRowChanged;
+};
@@ -0,0 +1,73 @@
+////////////////////////////////////////////////////////////////////////
+//
+// This file is part of sc4-data-view-extensions, a DLL Plugin for
+// SimCity 4 that extends the game's data views.
+//
+// Copyright (c) 2024 Nicholas Hayes
+//
+// This file is licensed under terms of the MIT License.
+// See LICENSE.txt for more information.
+//
+////////////////////////////////////////////////////////////////////////
+
+#include "GridSnapshotService.h"
+#include "GlobalPointers.h"
+
+GridSnapshotService::GridSnapshotService() : channels()
+{
+}
+
+void GridSnapshotService::Capture()
+{
+	for (size_t i = 0; i < channels.size(); i++)
+	{
+		Capture(static_cast<SnapshotGrid>(i));
+	}
+}
+
+void GridSnapshotService::Capture(SnapshotGrid grid)
+{
+	if (!spAura)
+	{
+		return;
+	}
+
+	GridSnapshotChannel& channel = channels[static_cast<size_t>(grid)];
+
+	switch (grid)
+	{
+	case SnapshotGrid::Aura:
+		if (cISC4SimGrid<int8_t>* auraGrid = spAura->GetAuraGrid())
+		{
+			channel.Capture(auraGrid);
+		}
+		break;
+	case SnapshotGrid::ParkMap:
+		if (cISC4SimGrid<int16_t>* parkMap = spAura->GetParkMap())
+		{
+			channel.Capture(parkMap);
+		}
+		break;
+	case SnapshotGrid::LandmarkMap:
+		if (cISC4SimGrid<int16_t>* landmarkMap = spAura->GetLandmarkMap())
+		{
+			channel.Capture(landmarkMap);
+		}
+		break;
+	default:
+		break;
+	}
+}
+
+std::shared_ptr<const GridSnapshot> GridSnapshotService::GetSnapshot(SnapshotGrid grid) const
+{
+	return channels[static_cast<size_t>(grid)].GetLatest();
+}
+
+void GridSnapshotService::PreCityShutdown()
+{
+	for (GridSnapshotChannel& channel : channels)
+	{
+		channel.Clear();
+	}
+}
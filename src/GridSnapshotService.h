@@ -0,0 +1,49 @@
+////////////////////////////////////////////////////////////////////////
+//
+// This file is part of sc4-data-view-extensions, a DLL Plugin for
+// SimCity 4 that extends the game's data views.
+//
+// Copyright (c) 2024 Nicholas Hayes
+//
+// This file is licensed under terms of the MIT License.
+// See LICENSE.txt for more information.
+//
+////////////////////////////////////////////////////////////////////////
+
+#pragma once
+#include "GridSnapshot.h"
+#include <array>
+
+enum class SnapshotGrid : uint32_t
+{
+	// cISC4AuraSimulator::GetAuraGrid
+	Aura = 0,
+	// cISC4AuraSimulator::GetParkMap
+	ParkMap,
+	// cISC4AuraSimulator::GetLandmarkMap
+	LandmarkMap,
+	Count
+};
+
+// Keeps versioned snapshots of the game's aura grids for the background analytics.
+class GridSnapshotService
+{
+public:
+	GridSnapshotService();
+
+	// Copies the grids that changed since the last capture.
+	// This must be called on the game thread.
+	void Capture();
+
+	// Copies a single grid if it changed since the last capture.
+	// This must be called on the game thread.
+	void Capture(SnapshotGrid grid);
+
+	// Returns nullptr if the grid has not been captured.
+	std::shared_ptr<const GridSnapshot> GetSnapshot(SnapshotGrid grid) const;
+
+	void PreCityShutdown();
+
+private:
+	std::array<GridSnapshotChannel, static_cast<size_t>(SnapshotGrid::Count)> channels;
+};
@@ -0,0 +1,204 @@
+////////////////////////////////////////////////////////////////////////
+//
+// This file is part of sc4-data-view-extensions, a DLL Plugin for
+// SimCity 4 that extends the game's data views.
+//
+// Copyright (c) 2024 Nicholas Hayes
+//
+// This file is licensed under terms of the MIT License.
+// See LICENSE.txt for more information.
+//
+////////////////////////////////////////////////////////////////////////
+
+#include "GridStatistics.h"
+#include <algorithm>
+#include <cmath>
+
+static constexpr size_t kBinCount = 65536;
+static constexpr size_t kCoarseBinShift = 8;
+static constexpr size_t kCoarseBinCount = kBinCount >> kCoarseBinShift;
+static constexpr int32_t kBinOffset = 32768;
+
+GridStatistics::GridStatistics()
+	: lastVersion(0),
+	  width(0),
+	  height(0),
+	  tractSize(1),
+	  sum(0),
+	  values(),
+	  bins(),
+	  coarseBins()
+{
+}
+
+void GridStatistics::Update(const GridSnapshot& snapshot)
+{
+	if (snapshot.version == lastVersion)
+	{
+		return;
+	}
+
+	// The changed rows are relative to the previous snapshot version, every row
+	// is compared if a version was skipped.
+	bool checkAllRows = snapshot.version != lastVersion + 1;
+
+	if (snapshot.width != width || snapshot.height != height || bins.empty())
+	{
+		Resize(snapshot.width, snapshot.height);
+		checkAllRows = true;
+	}
+
+	tractSize = snapshot.tractSize;
+
+	for (uint32_t z = 0; z < height; z++)
+	{
+		if (checkAllRows || snapshot.changedRows[z])
+		{
+			UpdateRow(z, snapshot.GetRow(z));
+		}
+	}
+
+	lastVersion = snapshot.version;
+}
+
+void GridStatistics::Clear()
+{
+	lastVersion = 0;
+	width = 0;
+	height = 0;
+	tractSize = 1;
+	sum = 0;
+	values = std::vector<int16_t>();
+	bins = std::vector<uint32_t>();
+	coarseBins = std::vector<uint32_t>();
+}
+
+uint32_t GridStatistics::GetCount() const
+{
+	return width * height;
+}
+
+int32_t GridStatistics::GetTractSize() const
+{
+	return tractSize;
+}
+
+double GridStatistics::GetMean() const
+{
+	const uint32_t count = GetCount();
+
+	return count > 0 ? static_cast<double>(sum) / count : 0.0;
+}
+
+int32_t GridStatistics::GetPercentile(double percentage) const
+{
+	const uint32_t count = GetCount();
+
+	if (count == 0)
+	{
+		return 0;
+	}
+
+	// The rank of the value in the sorted order, starting from 1.
+	const double fraction = std::clamp(percentage, 0.0, 100.0) / 100.0;
+	const uint32_t rank = std::max(static_cast<uint32_t>(std::ceil(fraction * count)), 1U);
+
+	uint32_t seen = 0;
+	size_t coarse = 0;
+
+	while (coarse < kCoarseBinCount && seen + coarseBins[coarse] < rank)
+	{
+		seen += coarseBins[coarse];
+		coarse++;
+	}
+
+	size_t bin = coarse << kCoarseBinShift;
+
+	while (bin < kBinCount - 1 && seen + bins[bin] < rank)
+	{
+		seen += bins[bin];
+		bin++;
+	}
+
+	return static_cast<int32_t>(bin) - kBinOffset;
+}
+
+uint32_t GridStatistics::GetCountAbove(int32_t threshold) const
+{
+	if (GetCount() == 0 || threshold >= kBinOffset - 1)
+	{
+		return 0;
+	}
+	else if (threshold < -kBinOffset)
+	{
+		return GetCount();
+	}
+
+	const size_t firstBin = GetBin(threshold + 1);
+	const size_t firstCoarseBin = (firstBin >> kCoarseBinShift) + 1;
+	const size_t fineEnd = std::min(firstCoarseBin << kCoarseBinShift, kBinCount);
+
+	uint32_t count = 0;
+
+	for (size_t i = firstBin; i < fineEnd; i++)
+	{
+		count += bins[i];
+	}
+
+	for (size_t i = firstCoarseBin; i < kCoarseBinCount; i++)
+	{
+		count += coarseBins[i];
+	}
+
+	return count;
+}
+
+void GridStatistics::Resize(uint32_t width, uint32_t height)
+{
+	this->width = width;
+	this->height = height;
+
+	const size_t count = static_cast<size_t>(width) * height;
+
+	// The values start at 0, the rows are then updated from the snapshot.
+	values.assign(count, 0);
+	bins.assign(kBinCount, 0);
+	coarseBins.assign(kCoarseBinCount, 0);
+	bins[GetBin(0)] = static_cast<uint32_t>(count);
+	coarseBins[GetBin(0) >> kCoarseBinShift] = static_cast<uint32_t>(count);
+	sum = 0;
+}
+
+void GridStatistics::UpdateRow(uint32_t row, const int16_t* rowValues)
+{
+	int16_t* current = values.data() + static_cast<size_t>(row) * width;
+
+	if (std::equal(rowValues, rowValues + width, current))
+	{
+		return;
+	}
+
+	for (uint32_t x = 0; x < width; x++)
+	{
+		const int16_t oldValue = current[x];
+		const int16_t newValue = rowValues[x];
+
+		if (oldValue != newValue)
+		{
+			const size_t oldBin = GetBin(oldValue);
+			const size_t newBin = GetBin(newValue);
+
+			bins[oldBin]--;
+			bins[newBin]++;
+			coarseBins[oldBin >> kCoarseBinShift]--;
+			coarseBins[newBin >> kCoarseBinShift]++;
+			sum += static_cast<int64_t>(newValue) - oldValue;
+			current[x] = newValue;
+		}
+	}
+}
+
+size_t GridStatistics::GetBin(int32_t value)
+{
+	return static_cast<size_t>(value + kBinOffset);
+}
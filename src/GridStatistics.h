@@ -0,0 +1,55 @@
+////////////////////////////////////////////////////////////////////////
+//
+// This file is part of sc4-data-view-extensions, a DLL Plugin for
+// SimCity 4 that extends the game's data views.
+//
+// Copyright (c) 2024 Nicholas Hayes
+//
+// This file is licensed under terms of the MIT License.
+// See LICENSE.txt for more information.
+//
+////////////////////////////////////////////////////////////////////////
+
+#pragma once
+#include "GridSnapshot.h"
+#include <cstdint>
+#include <vector>
+
+// Maintains the value histogram of a grid from its snapshots.
+// Only the rows that changed since the previous snapshot are visited, and only
+// the values that changed are moved between the histogram bins, so the
+// statistics can be read at any time without rescanning the grid.
+class GridStatistics
+{
+public:
+	GridStatistics();
+
+	void Update(const GridSnapshot& snapshot);
+	void Clear();
+
+	// The number of tracts in the grid.
+	uint32_t GetCount() const;
+	int32_t GetTractSize() const;
+
+	double GetMean() const;
+	// Gets the smallest value that the specified percentage of the tracts are at or below.
+	// The percentage must be in the range of [0, 100].
+	int32_t GetPercentile(double percentage) const;
+	uint32_t GetCountAbove(int32_t threshold) const;
+
+private:
+	void Resize(uint32_t width, uint32_t height);
+	void UpdateRow(uint32_t row, const int16_t* rowValues);
+
+	static size_t GetBin(int32_t value);
+
+	uint64_t lastVersion;
+	uint32_t width;
+	uint32_t height;
+	int32_t tractSize;
+	int64_t sum;
+	std::vector<int16_t> values;
+	// One bin for each int16_t value, and a coarse bin for each 256 fine bins.
+	std::vector<uint32_t> bins;
+	std::vector<uint32_t> coarseBins;
+};
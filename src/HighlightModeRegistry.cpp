@@ -0,0 +1,264 @@
+////////////////////////////////////////////////////////////////////////
+//
+// This file is part of sc4-data-view-extensions, a DLL Plugin for
+// SimCity 4 that extends the game's data views.
+//
+// Copyright (c) 2024 Nicholas Hayes
+//
+// This file is licensed under terms of the MIT License.
+// See LICENSE.txt for more information.
+//
+////////////////////////////////////////////////////////////////////////
+
+#include "HighlightModeRegistry.h"
+#include "DataViewHighlightManager.h"
+#include "Logger.h"
+#include "OccupantTypes.h"
+#include <charconv>
+#include <fstream>
+#include <string>
+#include <string_view>
+
+using namespace std::string_view_literals;
+
+namespace
+{
+	constexpr std::string_view kSectionPrefix = "HighlightMode."sv;
+
+	std::string_view Trim(std::string_view value)
+	{
+		const size_t first = value.find_first_not_of(" \t\r");
+
+		if (first == std::string_view::npos)
+		{
+			return std::string_view();
+		}
+
+		const size_t last = value.find_last_not_of(" \t\r");
+
+		return value.substr(first, last - first + 1);
+	}
+
+	bool EqualsIgnoreCase(std::string_view lhs, std::string_view rhs)
+	{
+		if (lhs.size() != rhs.size())
+		{
+			return false;
+		}
+
+		for (size_t i = 0; i < lhs.size(); i++)
+		{
+			const char l = (lhs[i] >= 'A' && lhs[i] <= 'Z') ? static_cast<char>(lhs[i] + 32) : lhs[i];
+			const char r = (rhs[i] >= 'A' && rhs[i] <= 'Z') ? static_cast<char>(rhs[i] + 32) : rhs[i];
+
+			if (l != r)
+			{
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	bool ParseUint32(std::string_view value, uint32_t& result)
+	{
+		int base = 10;
+
+		if (value.size() > 2 && value[0] == '0' && (value[1] == 'x' || value[1] == 'X'))
+		{
+			value.remove_prefix(2);
+			base = 16;
+		}
+
+		const std::from_chars_result parseResult = std::from_chars(value.data(), value.data() + value.size(), result, base);
+
+		return parseResult.ec == std::errc() && parseResult.ptr == value.data() + value.size();
+	}
+
+	bool ParseFloat(std::string_view value, float& result)
+	{
+		const std::from_chars_result parseResult = std::from_chars(value.data(), value.data() + value.size(), result);
+
+		return parseResult.ec == std::errc() && parseResult.ptr == value.data() + value.size();
+	}
+
+	struct PendingMode
+	{
+		uint32_t highlightType;
+		uint32_t line;
+		std::string filter;
+		uint32_t occupantType;
+		uint32_t effectPropertyID;
+		float radius;
+		bool valid;
+	};
+}
+
+HighlightModeRegistry::HighlightModeRegistry() : modes()
+{
+}
+
+void HighlightModeRegistry::Load(const std::filesystem::path& path)
+{
+	modes.clear();
+
+	std::ifstream stream(path);
+
+	if (!stream)
+	{
+		// The file is optional.
+		return;
+	}
+
+	Logger& logger = Logger::GetInstance();
+
+	std::vector<PendingMode> pendingModes;
+	PendingMode* currentMode = nullptr;
+	std::string line;
+	uint32_t lineNumber = 0;
+
+	while (std::getline(stream, line))
+	{
+		lineNumber++;
+
+		const std::string_view text = Trim(line);
+
+		if (text.empty() || text[0] == ';' || text[0] == '#')
+		{
+			continue;
+		}
+
+		if (text.front() == '[' && text.back() == ']')
+		{
+			currentMode = nullptr;
+
+			const std::string_view sectionName = Trim(text.substr(1, text.size() - 2));
+
+			if (sectionName.size() > kSectionPrefix.size()
+				&& EqualsIgnoreCase(sectionName.substr(0, kSectionPrefix.size()), kSectionPrefix))
+			{
+				PendingMode mode{};
+				mode.line = lineNumber;
+				mode.occupantType = kOccupantTypeBuilding;
+				mode.radius = kDefaultHighlightRadius;
+				mode.valid = ParseUint32(sectionName.substr(kSectionPrefix.size()), mode.highlightType);
+
+				if (!mode.valid)
+				{
+					logger.WriteLineFormatted(
+						LogLevel::Error,
+						"Invalid highlight mode value on line %u of the INI file.",
+						lineNumber);
+				}
+				else if (mode.highlightType <= DataViewHighlightLandmarkEffect
+					|| DataViewHighlightManager::IsBuiltInHighlightType(mode.highlightType))
+				{
+					logger.WriteLineFormatted(
+						LogLevel::Error,
+						"Highlight mode %u on line %u of the INI file is reserved by the game or the DLL.",
+						mode.highlightType,
+						lineNumber);
+					mode.valid = false;
+				}
+
+				pendingModes.push_back(std::move(mode));
+				currentMode = &pendingModes.back();
+			}
+
+			continue;
+		}
+
+		if (!currentMode || !currentMode->valid)
+		{
+			continue;
+		}
+
+		const size_t separator = text.find('=');
+
+		if (separator == std::string_view::npos)
+		{
+			logger.WriteLineFormatted(LogLevel::Error, "Expected a key=value pair on line %u of the INI file.", lineNumber);
+			continue;
+		}
+
+		const std::string_view key = Trim(text.substr(0, separator));
+		const std::string_view value = Trim(text.substr(separator + 1));
+		bool validValue = true;
+
+		if (EqualsIgnoreCase(key, "Filter"sv))
+		{
+			currentMode->filter = value;
+		}
+		else if (EqualsIgnoreCase(key, "OccupantType"sv))
+		{
+			validValue = ParseUint32(value, currentMode->occupantType);
+		}
+		else if (EqualsIgnoreCase(key, "EffectProperty"sv))
+		{
+			validValue = ParseUint32(value, currentMode->effectPropertyID);
+		}
+		else if (EqualsIgnoreCase(key, "Radius"sv))
+		{
+			validValue = ParseFloat(value, currentMode->radius) && currentMode->radius >= 0.0f;
+		}
+		else
+		{
+			logger.WriteLineFormatted(LogLevel::Error, "Unknown key on line %u of the INI file.", lineNumber);
+		}
+
+		if (!validValue)
+		{
+			logger.WriteLineFormatted(LogLevel::Error, "Invalid value on line %u of the INI file.", lineNumber);
+			currentMode->valid = false;
+		}
+	}
+
+	for (const PendingMode& pendingMode : pendingModes)
+	{
+		if (!pendingMode.valid)
+		{
+			continue;
+		}
+
+		HighlightModeDefinition definition{};
+		definition.highlightType = pendingMode.highlightType;
+		definition.occupantType = pendingMode.occupantType;
+		definition.effectPropertyID = pendingMode.effectPropertyID;
+		definition.radius = pendingMode.radius;
+
+		std::string errorMessage;
+
+		if (pendingMode.filter.empty())
+		{
+			logger.WriteLineFormatted(
+				LogLevel::Error,
+				"Highlight mode %u does not have a Filter value.",
+				pendingMode.highlightType);
+		}
+		else if (!definition.program.Compile(pendingMode.filter, errorMessage))
+		{
+			logger.WriteLineFormatted(
+				LogLevel::Error,
+				"Failed to compile the filter for highlight mode %u: %s",
+				pendingMode.highlightType,
+				errorMessage.c_str());
+		}
+		else
+		{
+			// A later section replaces an earlier section with the same value.
+			modes.insert_or_assign(definition.highlightType, std::move(definition));
+		}
+	}
+}
+
+const HighlightModeDefinition* HighlightModeRegistry::Find(uint32_t highlightType) const
+{
+	const auto item = modes.find(highlightType);
+
+	return item != modes.end() ? &item->second : nullptr;
+}
+
+uint32_t HighlightModeRegistry::GetCount() const
+{
+	return static_cast<uint32_t>(modes.size());
+}
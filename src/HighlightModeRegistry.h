@@ -0,0 +1,56 @@
+////////////////////////////////////////////////////////////////////////
+//
+// This file is part of sc4-data-view-extensions, a DLL Plugin for
+// SimCity 4 that extends the game's data views.
+//
+// Copyright (c) 2024 Nicholas Hayes
+//
+// This file is licensed under terms of the MIT License.
+// See LICENSE.txt for more information.
+//
+////////////////////////////////////////////////////////////////////////
+
+#pragma once
+#include "HighlightProgram.h"
+#include <filesystem>
+#include <unordered_map>
+
+struct HighlightModeDefinition
+{
+	uint32_t highlightType;
+	uint32_t occupantType;
+	// The effect property that provides the highlight radius and strength,
+	// or 0 to use the default radius.
+	uint32_t effectPropertyID;
+	// The highlight radius in meters.
+	float radius;
+	HighlightProgram program;
+};
+
+// The highlight modes that are defined in the DLL's INI file.
+//
+// Each mode is an INI section named HighlightMode.<value>, where <value> is the
+// "DataView: Highlight mode" property value. For example:
+//
+// [HighlightMode.12]
+// Filter=group(0x1300) & has(0x27812850)
+// OccupantType=0x278128A0
+// EffectProperty=0x27812850
+// Radius=128
+//
+// The Filter key is required, see HighlightProgram for the expression syntax.
+class HighlightModeRegistry
+{
+public:
+	HighlightModeRegistry();
+
+	void Load(const std::filesystem::path& path);
+
+	// Returns nullptr if the highlight mode is not defined.
+	const HighlightModeDefinition* Find(uint32_t highlightType) const;
+
+	uint32_t GetCount() const;
+
+private:
+	std::unordered_map<uint32_t, HighlightModeDefinition> modes;
+};
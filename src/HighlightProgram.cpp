@@ -0,0 +1,611 @@
+////////////////////////////////////////////////////////////////////////
+//
+// This file is part of sc4-data-view-extensions, a DLL Plugin for
+// SimCity 4 that extends the game's data views.
+//
+// Copyright (c) 2024 Nicholas Hayes
+//
+// This file is licensed under terms of the MIT License.
+// See LICENSE.txt for more information.
+//
+////////////////////////////////////////////////////////////////////////
+
+#include "HighlightProgram.h"
+#include "cIGZVariant.h"
+#include "cISC4Occupant.h"
+#include "cISCProperty.h"
+#include "cISCPropertyHolder.h"
+#include <charconv>
+#include <limits>
+
+namespace
+{
+	// Nesting deeper than this is rejected so that a malformed
+	// expression can not overflow the stack.
+	constexpr uint32_t kMaxNestingDepth = 32;
+
+	bool GetVariantNumber(const cIGZVariant* pVariant, uint32_t index, double& value)
+	{
+		const uint16_t type = pVariant->GetType();
+
+		if (type & cIGZVariant::TypeArray)
+		{
+			if (index >= pVariant->GetCount())
+			{
+				return false;
+			}
+		}
+		else if (index != 0)
+		{
+			return false;
+		}
+
+		bool result = true;
+
+		switch (type)
+		{
+		case cIGZVariant::Type::Bool:
+			value = pVariant->GetValBool() ? 1.0 : 0.0;
+			break;
+		case cIGZVariant::Type::Uint8:
+			value = pVariant->GetValUint8();
+			break;
+		case cIGZVariant::Type::Sint8:
+			value = pVariant->GetValSint8();
+			break;
+		case cIGZVariant::Type::Uint16:
+			value = pVariant->GetValUint16();
+			break;
+		case cIGZVariant::Type::Sint16:
+			value = pVariant->GetValSint16();
+			break;
+		case cIGZVariant::Type::Uint32:
+			value = pVariant->GetValUint32();
+			break;
+		case cIGZVariant::Type::Sint32:
+			value = pVariant->GetValSint32();
+			break;
+		case cIGZVariant::Type::Sint64:
+			value = static_cast<double>(pVariant->GetValSint64());
+			break;
+		case cIGZVariant::Type::Float32:
+			value = pVariant->GetValFloat32();
+			break;
+		case cIGZVariant::Type::BoolArray:
+			value = pVariant->RefBool()[index] ? 1.0 : 0.0;
+			break;
+		case cIGZVariant::Type::Uint8Array:
+			value = pVariant->RefUint8()[index];
+			break;
+		case cIGZVariant::Type::Sint8Array:
+			value = pVariant->RefSint8()[index];
+			break;
+		case cIGZVariant::Type::Uint16Array:
+			value = pVariant->RefUint16()[index];
+			break;
+		case cIGZVariant::Type::Sint16Array:
+			value = pVariant->RefSint16()[index];
+			break;
+		case cIGZVariant::Type::Uint32Array:
+			value = pVariant->RefUint32()[index];
+			break;
+		case cIGZVariant::Type::Sint32Array:
+			value = pVariant->RefSint32()[index];
+			break;
+		case cIGZVariant::Type::Sint64Array:
+			value = static_cast<double>(pVariant->RefSint64()[index]);
+			break;
+		case cIGZVariant::Type::Float32Array:
+			value = pVariant->RefFloat32()[index];
+			break;
+		default:
+			result = false;
+			break;
+		}
+
+		return result;
+	}
+}
+
+class HighlightProgram::Compiler
+{
+public:
+	Compiler(std::string_view expression, std::vector<Instruction>& output)
+		: expression(expression), position(0), depth(0), output(output), errorMessage()
+	{
+	}
+
+	bool Compile()
+	{
+		if (!ParseExpression())
+		{
+			return false;
+		}
+
+		SkipWhitespace();
+
+		if (position != expression.size())
+		{
+			return SetError("Unexpected character");
+		}
+
+		return true;
+	}
+
+	const std::string& GetErrorMessage() const
+	{
+		return errorMessage;
+	}
+
+private:
+	bool ParseExpression()
+	{
+		if (++depth > kMaxNestingDepth)
+		{
+			return SetError("The expression is nested too deeply");
+		}
+
+		std::vector<size_t> jumps;
+
+		if (!ParseTerm())
+		{
+			return false;
+		}
+
+		while (Match('|'))
+		{
+			// The remaining terms are skipped once a term is true.
+			jumps.push_back(Emit(Opcode::JumpIfTrue));
+
+			if (!ParseTerm())
+			{
+				return false;
+			}
+		}
+
+		PatchJumps(jumps);
+		depth--;
+
+		return true;
+	}
+
+	bool ParseTerm()
+	{
+		std::vector<size_t> jumps;
+
+		if (!ParseFactor())
+		{
+			return false;
+		}
+
+		while (Match('&'))
+		{
+			// The remaining factors are skipped once a factor is false.
+			jumps.push_back(Emit(Opcode::JumpIfFalse));
+
+			if (!ParseFactor())
+			{
+				return false;
+			}
+		}
+
+		PatchJumps(jumps);
+
+		return true;
+	}
+
+	bool ParseFactor()
+	{
+		if (Match('!'))
+		{
+			if (++depth > kMaxNestingDepth)
+			{
+				return SetError("The expression is nested too deeply");
+			}
+
+			if (!ParseFactor())
+			{
+				return false;
+			}
+
+			depth--;
+			Emit(Opcode::Not);
+
+			return true;
+		}
+		else if (Match('('))
+		{
+			return ParseExpression() && Expect(')');
+		}
+
+		return ParsePredicate();
+	}
+
+	bool ParsePredicate()
+	{
+		SkipWhitespace();
+
+		const size_t nameStart = position;
+
+		while (position < expression.size() && IsIdentifierChar(expression[position]))
+		{
+			position++;
+		}
+
+		const std::string_view name = expression.substr(nameStart, position - nameStart);
+
+		if (name.empty())
+		{
+			return SetError("Expected a predicate");
+		}
+
+		Instruction instruction{};
+
+		if (name == "type")
+		{
+			instruction.opcode = Opcode::TestOccupantType;
+		}
+		else if (name == "group")
+		{
+			instruction.opcode = Opcode::TestOccupantGroup;
+		}
+		else if (name == "has")
+		{
+			instruction.opcode = Opcode::TestHasProperty;
+		}
+		else if (name == "prop")
+		{
+			instruction.opcode = Opcode::TestPropertyValue;
+		}
+		else
+		{
+			return SetError("Unknown predicate");
+		}
+
+		if (!Expect('(') || !ParseUint32(instruction.operand))
+		{
+			return false;
+		}
+
+		if (instruction.opcode == Opcode::TestPropertyValue)
+		{
+			if (Match('['))
+			{
+				uint32_t index = 0;
+
+				if (!ParseUint32(index) || !Expect(']'))
+				{
+					return false;
+				}
+
+				if (index > std::numeric_limits<uint16_t>::max())
+				{
+					return SetError("The value index is too large");
+				}
+
+				instruction.valueIndex = static_cast<uint16_t>(index);
+			}
+
+			if (!ParseCompareOp(instruction.compare) || !ParseDouble(instruction.value))
+			{
+				return false;
+			}
+		}
+
+		if (!Expect(')'))
+		{
+			return false;
+		}
+
+		output.push_back(instruction);
+
+		return true;
+	}
+
+	bool ParseCompareOp(CompareOp& compare)
+	{
+		SkipWhitespace();
+
+		const std::string_view rest = expression.substr(position);
+
+		if (rest.starts_with("=="))
+		{
+			compare = CompareOp::Equal;
+		}
+		else if (rest.starts_with("!="))
+		{
+			compare = CompareOp::NotEqual;
+		}
+		else if (rest.starts_with("<="))
+		{
+			compare = CompareOp::LessOrEqual;
+		}
+		else if (rest.starts_with(">="))
+		{
+			compare = CompareOp::GreaterOrEqual;
+		}
+		else if (rest.starts_with("<"))
+		{
+			compare = CompareOp::Less;
+		}
+		else if (rest.starts_with(">"))
+		{
+			compare = CompareOp::Greater;
+		}
+		else
+		{
+			return SetError("Expected a comparison operator");
+		}
+
+		position += (compare == CompareOp::Less || compare == CompareOp::Greater) ? 1 : 2;
+
+		return true;
+	}
+
+	bool ParseUint32(uint32_t& value)
+	{
+		SkipWhitespace();
+
+		const char* first = expression.data() + position;
+		const char* last = expression.data() + expression.size();
+		int base = 10;
+
+		if (last - first > 2 && first[0] == '0' && (first[1] == 'x' || first[1] == 'X'))
+		{
+			first += 2;
+			base = 16;
+		}
+
+		const std::from_chars_result result = std::from_chars(first, last, value, base);
+
+		if (result.ec != std::errc())
+		{
+			return SetError("Expected an unsigned integer");
+		}
+
+		position = static_cast<size_t>(result.ptr - expression.data());
+
+		return true;
+	}
+
+	bool ParseDouble(double& value)
+	{
+		SkipWhitespace();
+
+		const std::string_view rest = expression.substr(position);
+
+		if (rest.starts_with("0x") || rest.starts_with("0X"))
+		{
+			uint32_t hexValue = 0;
+
+			if (!ParseUint32(hexValue))
+			{
+				return false;
+			}
+
+			value = hexValue;
+			return true;
+		}
+
+		const std::from_chars_result result = std::from_chars(rest.data(), rest.data() + rest.size(), value);
+
+		if (result.ec != std::errc())
+		{
+			return SetError("Expected a number");
+		}
+
+		position += static_cast<size_t>(result.ptr - rest.data());
+
+		return true;
+	}
+
+	size_t Emit(Opcode opcode)
+	{
+		Instruction instruction{};
+		instruction.opcode = opcode;
+
+		output.push_back(instruction);
+
+		return output.size() - 1;
+	}
+
+	void PatchJumps(const std::vector<size_t>& jumps)
+	{
+		const uint32_t target = static_cast<uint32_t>(output.size());
+
+		for (size_t jump : jumps)
+		{
+			output[jump].operand = target;
+		}
+	}
+
+	bool Match(char c)
+	{
+		SkipWhitespace();
+
+		if (position < expression.size() && expression[position] == c)
+		{
+			// '!' is also the first character of the '!=' operator, which is
+			// only valid inside a prop predicate.
+			if (c == '!' && position + 1 < expression.size() && expression[position + 1] == '=')
+			{
+				return false;
+			}
+
+			position++;
+			return true;
+		}
+
+		return false;
+	}
+
+	bool Expect(char c)
+	{
+		if (!Match(c))
+		{
+			std::string message("Expected '");
+			message.push_back(c);
+			message.push_back('\'');
+
+			return SetError(message.c_str());
+		}
+
+		return true;
+	}
+
+	void SkipWhitespace()
+	{
+		while (position < expression.size() && (expression[position] == ' ' || expression[position] == '\t'))
+		{
+			position++;
+		}
+	}
+
+	static bool IsIdentifierChar(char c)
+	{
+		return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
+	}
+
+	bool SetError(const char* message)
+	{
+		if (errorMessage.empty())
+		{
+			errorMessage = message;
+			errorMessage.append(" at position ");
+			errorMessage.append(std::to_string(position + 1));
+		}
+
+		return false;
+	}
+
+	std::string_view expression;
+	size_t position;
+	uint32_t depth;
+	std::vector<Instruction>& output;
+	std::string errorMessage;
+};
+
+HighlightProgram::HighlightProgram() : instructions()
+{
+}
+
+bool HighlightProgram::Compile(std::string_view expression, std::string& errorMessage)
+{
+	std::vector<Instruction> output;
+	Compiler compiler(expression, output);
+
+	if (!compiler.Compile())
+	{
+		errorMessage = compiler.GetErrorMessage();
+		return false;
+	}
+
+	instructions = std::move(output);
+	instructions.shrink_to_fit();
+
+	return true;
+}
+
+bool HighlightProgram::IsEmpty() const
+{
+	return instructions.empty();
+}
+
+bool HighlightProgram::Evaluate(cISC4Occupant* pOccupant) const
+{
+	const Instruction* const first = instructions.data();
+	const Instruction* const last = first + instructions.size();
+
+	bool result = false;
+
+	for (const Instruction* instruction = first; instruction < last; instruction++)
+	{
+		switch (instruction->opcode)
+		{
+		case Opcode::TestOccupantType:
+			result = static_cast<uint32_t>(pOccupant->GetType()) == instruction->operand;
+			break;
+		case Opcode::TestOccupantGroup:
+			result = pOccupant->IsOccupantGroup(instruction->operand);
+			break;
+		case Opcode::TestHasProperty:
+		{
+			const cISCPropertyHolder* pPropertyHolder = pOccupant->AsPropertyHolder();
+			result = pPropertyHolder && pPropertyHolder->HasProperty(instruction->operand);
+			break;
+		}
+		case Opcode::TestPropertyValue:
+			result = TestPropertyValue(pOccupant, *instruction);
+			break;
+		case Opcode::Not:
+			result = !result;
+			break;
+		case Opcode::JumpIfFalse:
+			if (!result)
+			{
+				// The loop increment moves to the target instruction.
+				instruction = first + instruction->operand - 1;
+			}
+			break;
+		case Opcode::JumpIfTrue:
+			if (result)
+			{
+				instruction = first + instruction->operand - 1;
+			}
+			break;
+		}
+	}
+
+	return result;
+}
+
+bool HighlightProgram::TestPropertyValue(cISC4Occupant* pOccupant, const Instruction& instruction)
+{
+	const cISCPropertyHolder* pPropertyHolder = pOccupant->AsPropertyHolder();
+
+	if (!pPropertyHolder)
+	{
+		return false;
+	}
+
+	const cISCProperty* pProperty = pPropertyHolder->GetProperty(instruction.operand);
+
+	if (!pProperty)
+	{
+		return false;
+	}
+
+	const cIGZVariant* pVariant = pProperty->GetPropertyValue();
+	double value = 0.0;
+
+	if (!pVariant || !GetVariantNumber(pVariant, instruction.valueIndex, value))
+	{
+		return false;
+	}
+
+	bool result = false;
+
+	switch (instruction.compare)
+	{
+	case CompareOp::Equal:
+		result = value == instruction.value;
+		break;
+	case CompareOp::NotEqual:
+		result = value != instruction.value;
+		break;
+	case CompareOp::Less:
+		result = value < instruction.value;
+		break;
+	case CompareOp::LessOrEqual:
+		result = value <= instruction.value;
+		break;
+	case CompareOp::Greater:
+		result = value > instruction.value;
+		break;
+	case CompareOp::GreaterOrEqual:
+		result = value >= instruction.value;
+		break;
+	}
+
+	return result;
+}
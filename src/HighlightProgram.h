@@ -0,0 +1,86 @@
+////////////////////////////////////////////////////////////////////////
+//
+// This file is part of sc4-data-view-extensions, a DLL Plugin for
+// SimCity 4 that extends the game's data views.
+//
+// Copyright (c) 2024 Nicholas Hayes
+//
+// This file is licensed under terms of the MIT License.
+// See LICENSE.txt for more information.
+//
+////////////////////////////////////////////////////////////////////////
+
+#pragma once
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+class cISC4Occupant;
+
+// An occupant predicate that is compiled from a filter expression.
+//
+// The expression syntax is:
+//   expression := term ( '|' term )*
+//   term       := factor ( '&' factor )*
+//   factor     := '!' factor | '(' expression ')' | predicate
+//   predicate  := 'type' '(' number ')'
+//               | 'group' '(' number ')'
+//               | 'has' '(' number ')'
+//               | 'prop' '(' number [ '[' number ']' ] compare number ')'
+//   compare    := '==' | '!=' | '<' | '<=' | '>' | '>='
+//
+// For example: group(0x1300) & !has(0x27812850) | prop(0x2781284F[0] >= 10)
+//
+// The expression is compiled to a flat list of instructions with short-circuit
+// jumps for the '&' and '|' operators.
+class HighlightProgram
+{
+public:
+	HighlightProgram();
+
+	bool Compile(std::string_view expression, std::string& errorMessage);
+
+	bool IsEmpty() const;
+
+	bool Evaluate(cISC4Occupant* pOccupant) const;
+
+private:
+	enum class Opcode : uint8_t
+	{
+		TestOccupantType,
+		TestOccupantGroup,
+		TestHasProperty,
+		TestPropertyValue,
+		Not,
+		JumpIfFalse,
+		JumpIfTrue,
+	};
+
+	enum class CompareOp : uint8_t
+	{
+		Equal,
+		NotEqual,
+		Less,
+		LessOrEqual,
+		Greater,
+		GreaterOrEqual,
+	};
+
+	struct Instruction
+	{
+		Opcode opcode;
+		CompareOp compare;
+		uint16_t valueIndex;
+		// The occupant type, occupant group or property ID for the tests,
+		// the target instruction index for the jumps.
+		uint32_t operand;
+		double value;
+	};
+
+	class Compiler;
+
+	static bool TestPropertyValue(cISC4Occupant* pOccupant, const Instruction& instruction);
+
+	std::vector<Instruction> instructions;
+};
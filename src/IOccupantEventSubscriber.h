@@ -0,0 +1,26 @@
+////////////////////////////////////////////////////////////////////////
+//
+// This file is part of sc4-data-view-extensions, a DLL Plugin for
+// SimCity 4 that extends the game's data views.
+//
+// Copyright (c) 2024 Nicholas Hayes
+//
+// This file is licensed under terms of the MIT License.
+// See LICENSE.txt for more information.
+//
+////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+class cISC4City;
+class cISC4Occupant;
+
+class IOccupantEventSubscriber
+{
+public:
+	virtual void OccupantInserted(cISC4Occupant* pOccupant) = 0;
+	virtual void OccupantRemoved(cISC4Occupant* pOccupant) = 0;
+
+	virtual void PostCityInit(cISC4City* pCity) {}
+	virtual void PreCityShutdown() {}
+};
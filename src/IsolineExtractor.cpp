@@ -0,0 +1,457 @@
+////////////////////////////////////////////////////////////////////////
+//
+// This file is part of sc4-data-view-extensions, a DLL Plugin for
+// SimCity 4 that extends the game's data views.
+//
+// Copyright (c) 2024 Nicholas Hayes
+//
+// This file is licensed under terms of the MIT License.
+// See LICENSE.txt for more information.
+//
+////////////////////////////////////////////////////////////////////////
+
+#include "IsolineExtractor.h"
+#include "GlobalPointers.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <limits>
+#include <unordered_map>
+#include <emmintrin.h>
+
+namespace
+{
+	constexpr uint32_t NoEdge = std::numeric_limits<uint32_t>::max();
+
+	// The cell corners are numbered clockwise from the top left:
+	// bit 0 = (x, z), bit 1 = (x + 1, z), bit 2 = (x + 1, z + 1), bit 3 = (x, z + 1).
+	// The cell edges are 0 = top, 1 = right, 2 = bottom, 3 = left.
+	// Each case lists up to two segments as pairs of edges, the saddle cases
+	// 5 and 10 use the first layout when the cell center is outside and the
+	// second layout when it is inside.
+	constexpr int8_t SegmentTable[16][4] =
+	{
+		{ -1, -1, -1, -1 },
+		{  3,  0, -1, -1 },
+		{  0,  1, -1, -1 },
+		{  3,  1, -1, -1 },
+		{  1,  2, -1, -1 },
+		{  3,  0,  1,  2 },
+		{  0,  2, -1, -1 },
+		{  3,  2, -1, -1 },
+		{  2,  3, -1, -1 },
+		{  2,  0, -1, -1 },
+		{  0,  1,  2,  3 },
+		{  2,  1, -1, -1 },
+		{  1,  3, -1, -1 },
+		{  1,  0, -1, -1 },
+		{  0,  3, -1, -1 },
+		{ -1, -1, -1, -1 },
+	};
+}
+
+IsolineExtractor::IsolineExtractor()
+	: width(0),
+	  height(0),
+	  tileCountX(0),
+	  tileCountZ(0),
+	  useCounter(0)
+{
+}
+
+void IsolineExtractor::Clear()
+{
+	width = 0;
+	height = 0;
+	tileCountX = 0;
+	tileCountZ = 0;
+	values = std::vector<int16_t>();
+	tileVersions = std::vector<uint32_t>();
+	cache.clear();
+	dirtyTiles = std::vector<uint32_t>();
+}
+
+void IsolineExtractor::Update(const GridSnapshot& snapshot)
+{
+	BeginUpdate(snapshot.width, snapshot.height);
+
+	for (uint32_t z = 0; z < snapshot.height; z++)
+	{
+		UpdateRow(z, snapshot.GetRow(z));
+	}
+}
+
+const PolylineBuffer& IsolineExtractor::GetIsolines(int32_t threshold)
+{
+	auto item = cache.find(threshold);
+
+	if (item == cache.end())
+	{
+		if (cache.size() >= MaxCachedThresholds)
+		{
+			cache.erase(std::min_element(
+				cache.begin(),
+				cache.end(),
+				[](const auto& lhs, const auto& rhs) { return lhs.second.lastUsed < rhs.second.lastUsed; }));
+		}
+
+		item = cache.try_emplace(threshold).first;
+	}
+
+	ThresholdCache& entry = item->second;
+	entry.lastUsed = ++useCounter;
+
+	if (entry.tiles.size() != tileVersions.size())
+	{
+		entry.tiles.clear();
+		entry.tiles.resize(tileVersions.size());
+		// The cached versions are set to a value that never matches
+		// so that every tile is built.
+		entry.tileVersions.assign(tileVersions.size(), NoEdge);
+	}
+
+	dirtyTiles.clear();
+
+	for (uint32_t i = 0; i < tileVersions.size(); i++)
+	{
+		if (entry.tileVersions[i] != tileVersions[i])
+		{
+			dirtyTiles.push_back(i);
+		}
+	}
+
+	const bool changed = !dirtyTiles.empty();
+
+	// Each tile only writes to its own polyline buffer, so the tiles are built in parallel.
+	spThreadPool->ParallelFor(
+		static_cast<uint32_t>(dirtyTiles.size()),
+		[&](uint32_t i)
+		{
+			const uint32_t tileIndex = dirtyTiles[i];
+
+			BuildTile(tileIndex % tileCountX, tileIndex / tileCountX, threshold, entry.tiles[tileIndex]);
+			entry.tileVersions[tileIndex] = tileVersions[tileIndex];
+		});
+
+	if (changed)
+	{
+		PolylineBuffer& combined = entry.combined;
+		combined.points.clear();
+		combined.offsets.clear();
+
+		for (const PolylineBuffer& tile : entry.tiles)
+		{
+			const uint32_t pointBase = static_cast<uint32_t>(combined.points.size() / 2);
+
+			combined.points.insert(combined.points.end(), tile.points.begin(), tile.points.end());
+
+			for (size_t i = 0; i < tile.GetPolylineCount(); i++)
+			{
+				combined.offsets.push_back(pointBase + tile.offsets[i]);
+			}
+		}
+
+		combined.offsets.push_back(static_cast<uint32_t>(combined.points.size() / 2));
+	}
+
+	return entry.combined;
+}
+
+void IsolineExtractor::BeginUpdate(uint32_t width, uint32_t height)
+{
+	if (this->width != width || this->height != height)
+	{
+		this->width = width;
+		this->height = height;
+
+		// The marching squares cells are between the tract centers, so there
+		// is one less cell than tracts in each direction.
+		const uint32_t cellCountX = width > 0 ? width - 1 : 0;
+		const uint32_t cellCountZ = height > 0 ? height - 1 : 0;
+
+		tileCountX = (cellCountX + TileSize - 1) / TileSize;
+		tileCountZ = (cellCountZ + TileSize - 1) / TileSize;
+
+		values.assign(static_cast<size_t>(width) * height, 0);
+		tileVersions.assign(static_cast<size_t>(tileCountX) * tileCountZ, 0);
+		cache.clear();
+	}
+}
+
+void IsolineExtractor::UpdateRow(uint32_t row, const int16_t* rowValues)
+{
+	int16_t* currentValues = values.data() + static_cast<size_t>(row) * width;
+
+	if (std::equal(rowValues, rowValues + width, currentValues))
+	{
+		return;
+	}
+
+	for (uint32_t x = 0; x < width; x++)
+	{
+		if (currentValues[x] != rowValues[x])
+		{
+			currentValues[x] = rowValues[x];
+			MarkCellsDirty(x, row);
+		}
+	}
+}
+
+void IsolineExtractor::MarkCellsDirty(uint32_t x, uint32_t z)
+{
+	// A tract value is a corner of up to four cells, the cells to its upper left,
+	// upper right, lower left and lower right.
+
+	if (width < 2 || height < 2)
+	{
+		return;
+	}
+
+	const uint32_t firstCellX = x > 0 ? x - 1 : 0;
+	const uint32_t firstCellZ = z > 0 ? z - 1 : 0;
+	const uint32_t lastCellX = std::min(x, width - 2);
+	const uint32_t lastCellZ = std::min(z, height - 2);
+
+	uint32_t previousTile = NoEdge;
+
+	for (uint32_t cellZ = firstCellZ; cellZ <= lastCellZ; cellZ++)
+	{
+		for (uint32_t cellX = firstCellX; cellX <= lastCellX; cellX++)
+		{
+			const uint32_t tileIndex = (cellZ / TileSize) * tileCountX + (cellX / TileSize);
+
+			if (tileIndex != previousTile)
+			{
+				tileVersions[tileIndex]++;
+				previousTile = tileIndex;
+			}
+		}
+	}
+}
+
+void IsolineExtractor::ClassifyRow(uint32_t row, int32_t threshold, uint8_t* flags) const
+{
+	// Sets each flag to 1 if the tract value is at or above the threshold.
+
+	const int16_t* rowValues = values.data() + static_cast<size_t>(row) * width;
+
+	if (threshold <= std::numeric_limits<int16_t>::min())
+	{
+		std::fill(flags, flags + width, 1);
+		return;
+	}
+	else if (threshold > std::numeric_limits<int16_t>::max())
+	{
+		std::fill(flags, flags + width, 0);
+		return;
+	}
+
+	const __m128i limit = _mm_set1_epi16(static_cast<int16_t>(threshold - 1));
+	const __m128i one = _mm_set1_epi8(1);
+
+	uint32_t x = 0;
+
+	for (; x + 16 <= width; x += 16)
+	{
+		const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(rowValues + x));
+		const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(rowValues + x + 8));
+
+		// The comparison results are 0 or -1, packing them to bytes keeps the values.
+		const __m128i mask = _mm_packs_epi16(_mm_cmpgt_epi16(a, limit), _mm_cmpgt_epi16(b, limit));
+
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(flags + x), _mm_and_si128(mask, one));
+	}
+
+	for (; x < width; x++)
+	{
+		flags[x] = rowValues[x] >= threshold ? 1 : 0;
+	}
+}
+
+void IsolineExtractor::BuildTile(uint32_t tileX, uint32_t tileZ, int32_t threshold, PolylineBuffer& output) const
+{
+	output.points.clear();
+	output.offsets.clear();
+
+	const uint32_t firstCellX = tileX * TileSize;
+	const uint32_t firstCellZ = tileZ * TileSize;
+	const uint32_t endCellX = std::min(firstCellX + TileSize, width - 1);
+	const uint32_t endCellZ = std::min(firstCellZ + TileSize, height - 1);
+
+	std::vector<uint8_t> upperFlags(width);
+	std::vector<uint8_t> lowerFlags(width);
+	std::vector<Segment> segments;
+
+	ClassifyRow(firstCellZ, threshold, upperFlags.data());
+
+	for (uint32_t z = firstCellZ; z < endCellZ; z++)
+	{
+		ClassifyRow(z + 1, threshold, lowerFlags.data());
+
+		for (uint32_t x = firstCellX; x < endCellX; x++)
+		{
+			uint32_t cellCase = upperFlags[x]
+							  | (upperFlags[x + 1] << 1)
+							  | (lowerFlags[x + 1] << 2)
+							  | (lowerFlags[x] << 3);
+
+			if (cellCase == 0 || cellCase == 15)
+			{
+				continue;
+			}
+
+			if (cellCase == 5 || cellCase == 10)
+			{
+				const int16_t* upper = values.data() + static_cast<size_t>(z) * width + x;
+				const int16_t* lower = upper + width;
+				const int32_t center = (upper[0] + upper[1] + lower[0] + lower[1]) / 4;
+
+				// When the center is inside, the saddle connects the two inside corners.
+				if (center >= threshold)
+				{
+					cellCase = cellCase == 5 ? 10 : 5;
+				}
+			}
+
+			// The edges are identified by the index of their first tract, times two,
+			// plus one for the vertical edges. Adjacent cells produce the same identifier
+			// for their shared edge.
+			const uint32_t topEdge = (z * width + x) * 2;
+			const uint32_t leftEdge = topEdge + 1;
+			const uint32_t rightEdge = (z * width + x + 1) * 2 + 1;
+			const uint32_t bottomEdge = ((z + 1) * width + x) * 2;
+			const uint32_t edges[4] = { topEdge, rightEdge, bottomEdge, leftEdge };
+
+			const int8_t* entry = SegmentTable[cellCase];
+
+			for (int i = 0; i < 4 && entry[i] >= 0; i += 2)
+			{
+				segments.push_back(Segment{ edges[entry[i]], edges[entry[i + 1]] });
+			}
+		}
+
+		std::swap(upperFlags, lowerFlags);
+	}
+
+	if (segments.empty())
+	{
+		return;
+	}
+
+	// The segments are joined into polylines, every edge is shared by at most two segments.
+
+	std::unordered_map<uint32_t, std::pair<uint32_t, uint32_t>> edgeSegments;
+	edgeSegments.reserve(segments.size() * 2);
+
+	for (uint32_t i = 0; i < segments.size(); i++)
+	{
+		for (uint32_t edge : { segments[i].edgeA, segments[i].edgeB })
+		{
+			auto result = edgeSegments.try_emplace(edge, i, NoEdge);
+
+			if (!result.second)
+			{
+				result.first->second.second = i;
+			}
+		}
+	}
+
+	std::vector<bool> used(segments.size(), false);
+	std::vector<uint32_t> chain;
+
+	auto extendChain = [&](uint32_t segmentIndex, uint32_t edge)
+	{
+		while (true)
+		{
+			const auto& pair = edgeSegments[edge];
+			const uint32_t next = pair.first == segmentIndex ? pair.second : pair.first;
+
+			if (next == NoEdge || used[next])
+			{
+				break;
+			}
+
+			used[next] = true;
+			edge = segments[next].edgeA == edge ? segments[next].edgeB : segments[next].edgeA;
+			chain.push_back(edge);
+			segmentIndex = next;
+		}
+	};
+
+	auto isOpenEnd = [&](uint32_t edge)
+	{
+		return edgeSegments[edge].second == NoEdge;
+	};
+
+	// The open polylines are started from one of their ends, so that they
+	// are not split in two. The closed loops are handled in a second pass.
+
+	for (int pass = 0; pass < 2; pass++)
+	{
+		for (uint32_t i = 0; i < segments.size(); i++)
+		{
+			if (used[i])
+			{
+				continue;
+			}
+
+			Segment segment = segments[i];
+
+			if (pass == 0)
+			{
+				if (isOpenEnd(segment.edgeB))
+				{
+					std::swap(segment.edgeA, segment.edgeB);
+				}
+				else if (!isOpenEnd(segment.edgeA))
+				{
+					continue;
+				}
+			}
+
+			used[i] = true;
+			chain.clear();
+			chain.push_back(segment.edgeA);
+			chain.push_back(segment.edgeB);
+			extendChain(i, segment.edgeB);
+
+			output.offsets.push_back(static_cast<uint32_t>(output.points.size() / 2));
+
+			for (uint32_t edge : chain)
+			{
+				float pointX = 0.0f;
+				float pointZ = 0.0f;
+				GetEdgePoint(edge, threshold, pointX, pointZ);
+
+				output.points.push_back(pointX);
+				output.points.push_back(pointZ);
+			}
+		}
+	}
+
+	output.offsets.push_back(static_cast<uint32_t>(output.points.size() / 2));
+}
+
+void IsolineExtractor::GetEdgePoint(uint32_t edge, int32_t threshold, float& x, float& z) const
+{
+	const uint32_t index = edge / 2;
+	const uint32_t firstX = index % width;
+	const uint32_t firstZ = index / width;
+	const bool vertical = (edge & 1) != 0;
+
+	const int32_t first = values[index];
+	const int32_t second = values[vertical ? index + width : index + 1];
+
+	// The point is placed where the linear interpolation of the two values crosses the threshold.
+	float t = 0.5f;
+
+	if (first != second)
+	{
+		t = std::clamp(
+			(static_cast<float>(threshold) - 0.5f - static_cast<float>(first)) / static_cast<float>(second - first),
+			0.0f,
+			1.0f);
+	}
+
+	x = static_cast<float>(firstX) + (vertical ? 0.0f : t);
+	z = static_cast<float>(firstZ) + (vertical ? t : 0.0f);
+}
@@ -0,0 +1,90 @@
+////////////////////////////////////////////////////////////////////////
+//
+// This file is part of sc4-data-view-extensions, a DLL Plugin for
+// SimCity 4 that extends the game's data views.
+//
+// Copyright (c) 2024 Nicholas Hayes
+//
+// This file is licensed under terms of the MIT License.
+// See LICENSE.txt for more information.
+//
+////////////////////////////////////////////////////////////////////////
+
+#pragma once
+#include "GridSnapshot.h"
+#include <cstdint>
+#include <map>
+#include <vector>
+
+// A set of polylines stored in two flat arrays.
+// The points are X/Z pairs in tract units, the value of tract (x, z) is at
+// point (x, z). Polyline i uses the points from offsets[i] to offsets[i + 1].
+struct PolylineBuffer
+{
+	std::vector<float> points;
+	std::vector<uint32_t> offsets;
+
+	size_t GetPolylineCount() const
+	{
+		return offsets.empty() ? 0 : offsets.size() - 1;
+	}
+};
+
+// Extracts the contour lines of a grid at one or more threshold values
+// using marching squares.
+// The grid is split into square tiles, the contours of each tile are cached
+// for each threshold and only the tiles whose values changed are rebuilt.
+// The contours are not joined across tile edges.
+class IsolineExtractor
+{
+public:
+	// The tile width and height in tracts.
+	static constexpr uint32_t TileSize = 32;
+
+	// The number of thresholds that are cached before the oldest is discarded.
+	static constexpr size_t MaxCachedThresholds = 16;
+
+	IsolineExtractor();
+
+	// Copies the snapshot values and marks the tiles that changed.
+	void Update(const GridSnapshot& snapshot);
+
+	void Clear();
+
+	// Gets the contours for the threshold, the tracts with a value at or above
+	// the threshold are inside the contours.
+	const PolylineBuffer& GetIsolines(int32_t threshold);
+
+private:
+	struct Segment
+	{
+		uint32_t edgeA;
+		uint32_t edgeB;
+	};
+
+	struct ThresholdCache
+	{
+		std::vector<PolylineBuffer> tiles;
+		std::vector<uint32_t> tileVersions;
+		PolylineBuffer combined;
+		uint64_t lastUsed;
+	};
+
+	void BeginUpdate(uint32_t width, uint32_t height);
+	void UpdateRow(uint32_t row, const int16_t* rowValues);
+	void MarkCellsDirty(uint32_t x, uint32_t z);
+
+	void ClassifyRow(uint32_t row, int32_t threshold, uint8_t* flags) const;
+	void BuildTile(uint32_t tileX, uint32_t tileZ, int32_t threshold, PolylineBuffer& output) const;
+	void GetEdgePoint(uint32_t edge, int32_t threshold, float& x, float& z) const;
+
+	uint32_t width;
+	uint32_t height;
+	uint32_t tileCountX;
+	uint32_t tileCountZ;
+	uint64_t useCounter;
+	std::vector<int16_t> values;
+	std::vector<uint32_t> tileVersions;
+	std::map<int32_t, ThresholdCache> cache;
+	std::vector<uint32_t> dirtyTiles;
+};
@@ -0,0 +1,253 @@
+////////////////////////////////////////////////////////////////////////
+//
+// This file is part of sc4-data-view-extensions, a DLL Plugin for
+// SimCity 4 that extends the game's data views.
+//
+// Copyright (c) 2024 Nicholas Hayes
+//
+// This file is licensed under terms of the MIT License.
+// See LICENSE.txt for more information.
+//
+////////////////////////////////////////////////////////////////////////
+
+#include "MemoryArena.h"
+#include "cGZAllocatorServiceSTLAllocator.h"
+#include "Logger.h"
+#include <algorithm>
+#include <array>
+#include <new>
+
+namespace
+{
+	// The game's allocator does not document its alignment, so the allocation is padded
+	// and the offset to the start of the block is stored in the byte before the aligned pointer.
+	constexpr size_t MaxGameAllocatorAlignment = 128;
+
+	void* AllocateFromGame(size_t bytes, size_t alignment)
+	{
+		cGZAllocatorServiceSTLAllocator<uint8_t> allocator;
+
+		uint8_t* block = allocator.allocate(bytes + alignment);
+
+		if (!block)
+		{
+			throw std::bad_alloc();
+		}
+
+		const uintptr_t address = reinterpret_cast<uintptr_t>(block) + 1;
+		const uintptr_t alignedAddress = (address + (alignment - 1)) & ~static_cast<uintptr_t>(alignment - 1);
+
+		uint8_t* aligned = reinterpret_cast<uint8_t*>(alignedAddress);
+		aligned[-1] = static_cast<uint8_t>(aligned - block - 1);
+
+		return aligned;
+	}
+
+	void DeallocateFromGame(void* p, size_t bytes)
+	{
+		cGZAllocatorServiceSTLAllocator<uint8_t> allocator;
+
+		uint8_t* aligned = static_cast<uint8_t*>(p);
+		uint8_t* block = aligned - aligned[-1] - 1;
+
+		allocator.deallocate(block, bytes);
+	}
+
+	constexpr std::array<const char*, static_cast<size_t>(MemorySubsystem::Count)> SubsystemNames =
+	{
+		"Highlights",
+		"Coverage",
+		"Overlays",
+	};
+
+	std::array<MemoryArena*, static_cast<size_t>(MemorySubsystem::Count)>& GetArenas()
+	{
+		static std::array<MemoryArena*, static_cast<size_t>(MemorySubsystem::Count)> arenas = []()
+		{
+			std::array<MemoryArena*, static_cast<size_t>(MemorySubsystem::Count)> items{};
+
+			// The arenas are intentionally never destroyed, the DLL's static objects
+			// may still hold containers that use them during process shutdown.
+			for (size_t i = 0; i < items.size(); i++)
+			{
+				items[i] = new MemoryArena(SubsystemNames[i]);
+			}
+
+			return items;
+		}();
+
+		return arenas;
+	}
+}
+
+MemoryArena::UpstreamResource::UpstreamResource()
+	: bytesReserved(0),
+	  bytesReservedHighWater(0),
+	  useGameAllocator(false)
+{
+}
+
+void* MemoryArena::UpstreamResource::do_allocate(size_t bytes, size_t alignment)
+{
+	void* p = nullptr;
+
+	if (useGameAllocator && alignment <= MaxGameAllocatorAlignment)
+	{
+		p = AllocateFromGame(bytes, alignment);
+	}
+	else
+	{
+		p = std::pmr::new_delete_resource()->allocate(bytes, alignment);
+	}
+
+	bytesReserved += bytes;
+	bytesReservedHighWater = std::max(bytesReservedHighWater, bytesReserved);
+
+	return p;
+}
+
+void MemoryArena::UpstreamResource::do_deallocate(void* p, size_t bytes, size_t alignment)
+{
+	if (useGameAllocator && alignment <= MaxGameAllocatorAlignment)
+	{
+		DeallocateFromGame(p, bytes);
+	}
+	else
+	{
+		std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+	}
+
+	bytesReserved -= bytes;
+}
+
+bool MemoryArena::UpstreamResource::do_is_equal(const std::pmr::memory_resource& other) const noexcept
+{
+	return this == &other;
+}
+
+MemoryArena::MemoryArena(const char* name)
+	: name(name),
+	  bytesInUse(0),
+	  bytesInUseHighWater(0),
+	  upstream(),
+	  pool(&upstream)
+{
+}
+
+const char* MemoryArena::GetName() const
+{
+	return name;
+}
+
+size_t MemoryArena::GetBytesInUse() const
+{
+	return bytesInUse;
+}
+
+size_t MemoryArena::GetBytesInUseHighWater() const
+{
+	return bytesInUseHighWater;
+}
+
+size_t MemoryArena::GetBytesReserved() const
+{
+	return upstream.bytesReserved;
+}
+
+size_t MemoryArena::GetBytesReservedHighWater() const
+{
+	return upstream.bytesReservedHighWater;
+}
+
+void MemoryArena::SetUseGameAllocator(bool value)
+{
+	// The backing store can only be changed when the arena does not hold any
+	// memory from the previous one.
+	if (upstream.bytesReserved == 0)
+	{
+		upstream.useGameAllocator = value;
+	}
+}
+
+bool MemoryArena::Reset()
+{
+	if (bytesInUse != 0)
+	{
+		return false;
+	}
+
+	pool.release();
+	return true;
+}
+
+void* MemoryArena::do_allocate(size_t bytes, size_t alignment)
+{
+	void* p = pool.allocate(bytes, alignment);
+
+	bytesInUse += bytes;
+	bytesInUseHighWater = std::max(bytesInUseHighWater, bytesInUse);
+
+	return p;
+}
+
+void MemoryArena::do_deallocate(void* p, size_t bytes, size_t alignment)
+{
+	pool.deallocate(p, bytes, alignment);
+
+	bytesInUse -= bytes;
+}
+
+bool MemoryArena::do_is_equal(const std::pmr::memory_resource& other) const noexcept
+{
+	return this == &other;
+}
+
+MemoryArena* MemoryArenas::Get(MemorySubsystem subsystem)
+{
+	return GetArenas()[static_cast<size_t>(subsystem)];
+}
+
+void MemoryArenas::SetUseGameAllocator(bool value)
+{
+	for (MemoryArena* arena : GetArenas())
+	{
+		arena->SetUseGameAllocator(value);
+	}
+}
+
+void MemoryArenas::WriteStatisticsToLog()
+{
+	Logger& logger = Logger::GetInstance();
+
+	if (logger.IsEnabled(LogLevel::Info))
+	{
+		for (const MemoryArena* arena : GetArenas())
+		{
+			logger.WriteLineFormatted(
+				LogLevel::Info,
+				"Memory arena %s: %zu bytes in use (peak %zu), %zu bytes reserved (peak %zu).",
+				arena->GetName(),
+				arena->GetBytesInUse(),
+				arena->GetBytesInUseHighWater(),
+				arena->GetBytesReserved(),
+				arena->GetBytesReservedHighWater());
+		}
+	}
+}
+
+void MemoryArenas::ResetCityArenas()
+{
+	WriteStatisticsToLog();
+
+	for (MemoryArena* arena : GetArenas())
+	{
+		if (!arena->Reset())
+		{
+			Logger::GetInstance().WriteLineFormatted(
+				LogLevel::Error,
+				"Unable to reset the %s memory arena, %zu bytes are still in use.",
+				arena->GetName(),
+				arena->GetBytesInUse());
+		}
+	}
+}
@@ -0,0 +1,90 @@
+////////////////////////////////////////////////////////////////////////
+//
+// This file is part of sc4-data-view-extensions, a DLL Plugin for
+// SimCity 4 that extends the game's data views.
+//
+// Copyright (c) 2024 Nicholas Hayes
+//
+// This file is licensed under terms of the MIT License.
+// See LICENSE.txt for more information.
+//
+////////////////////////////////////////////////////////////////////////
+
+#pragma once
+#include <cstdint>
+#include <memory_resource>
+
+// The DLL subsystems that allocate their city-lifetime containers from a memory arena.
+enum class MemorySubsystem : uint32_t
+{
+	Highlights = 0,
+	Coverage,
+	Overlays,
+	Count
+};
+
+// A pooled memory resource that tracks the number of bytes that are in use by
+// a DLL subsystem.
+// The pooled chunks are returned to the upstream allocator in bulk when the
+// arena is reset, which prevents the city load/unload cycles from fragmenting
+// the 32-bit address space.
+class MemoryArena final : public std::pmr::memory_resource
+{
+public:
+	MemoryArena(const char* name);
+
+	const char* GetName() const;
+
+	size_t GetBytesInUse() const;
+	size_t GetBytesInUseHighWater() const;
+	size_t GetBytesReserved() const;
+	size_t GetBytesReservedHighWater() const;
+
+	void SetUseGameAllocator(bool value);
+
+	// Returns false if the subsystem still has outstanding allocations.
+	bool Reset();
+
+private:
+
+	// The memory resource that the pooled chunks are allocated from.
+	class UpstreamResource final : public std::pmr::memory_resource
+	{
+	public:
+		UpstreamResource();
+
+		size_t bytesReserved;
+		size_t bytesReservedHighWater;
+		bool useGameAllocator;
+
+	private:
+		void* do_allocate(size_t bytes, size_t alignment) override;
+		void do_deallocate(void* p, size_t bytes, size_t alignment) override;
+		bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override;
+	};
+
+	void* do_allocate(size_t bytes, size_t alignment) override;
+	void do_deallocate(void* p, size_t bytes, size_t alignment) override;
+	bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override;
+
+	const char* name;
+	size_t bytesInUse;
+	size_t bytesInUseHighWater;
+	UpstreamResource upstream;
+	std::pmr::unsynchronized_pool_resource pool;
+};
+
+namespace MemoryArenas
+{
+	MemoryArena* Get(MemorySubsystem subsystem);
+
+	// Selects the game's allocator service as the backing store for the arenas.
+	// This must be called before the subsystems allocate any memory.
+	void SetUseGameAllocator(bool value);
+
+	void WriteStatisticsToLog();
+
+	// Releases the pooled memory of every arena at city shutdown.
+	// The subsystems must have freed their containers before this is called.
+	void ResetCityArenas();
+}
@@ -0,0 +1,114 @@
+////////////////////////////////////////////////////////////////////////
+//
+// This file is part of sc4-data-view-extensions, a DLL Plugin for
+// SimCity 4 that extends the game's data views.
+//
+// Copyright (c) 2024 Nicholas Hayes
+//
+// This file is licensed under terms of the MIT License.
+// See LICENSE.txt for more information.
+//
+////////////////////////////////////////////////////////////////////////
+
+#include "MemoryMappedFile.h"
+#include <Windows.h>
+#include "wil/resource.h"
+#include <limits>
+
+struct MemoryMappedFile::Handles
+{
+	wil::unique_hfile file;
+	wil::unique_handle mapping;
+	wil::unique_mapview_ptr<void> view;
+};
+
+MemoryMappedFile::MemoryMappedFile()
+	: handles(),
+	  data(nullptr),
+	  size(0)
+{
+}
+
+MemoryMappedFile::~MemoryMappedFile()
+{
+}
+
+bool MemoryMappedFile::Open(const std::filesystem::path& path)
+{
+	Close();
+
+	auto newHandles = std::make_unique<Handles>();
+
+	newHandles->file.reset(CreateFileW(
+		path.c_str(),
+		GENERIC_READ,
+		FILE_SHARE_READ,
+		nullptr,
+		OPEN_EXISTING,
+		FILE_ATTRIBUTE_NORMAL,
+		nullptr));
+
+	if (!newHandles->file)
+	{
+		return false;
+	}
+
+	LARGE_INTEGER fileSize{};
+
+	// The game is a 32-bit process, a file that is larger than the address
+	// space can not be mapped. An empty file can not be mapped either.
+	if (!GetFileSizeEx(newHandles->file.get(), &fileSize)
+		|| fileSize.QuadPart <= 0
+		|| static_cast<uint64_t>(fileSize.QuadPart) > std::numeric_limits<size_t>::max())
+	{
+		return false;
+	}
+
+	newHandles->mapping.reset(CreateFileMappingW(
+		newHandles->file.get(),
+		nullptr,
+		PAGE_READONLY,
+		0,
+		0,
+		nullptr));
+
+	if (!newHandles->mapping)
+	{
+		return false;
+	}
+
+	newHandles->view.reset(MapViewOfFile(newHandles->mapping.get(), FILE_MAP_READ, 0, 0, 0));
+
+	if (!newHandles->view)
+	{
+		return false;
+	}
+
+	data = static_cast<const uint8_t*>(newHandles->view.get());
+	size = static_cast<size_t>(fileSize.QuadPart);
+	handles = std::move(newHandles);
+
+	return true;
+}
+
+void MemoryMappedFile::Close()
+{
+	handles.reset();
+	data = nullptr;
+	size = 0;
+}
+
+bool MemoryMappedFile::IsOpen() const
+{
+	return data != nullptr;
+}
+
+const uint8_t* MemoryMappedFile::GetData() const
+{
+	return data;
+}
+
+size_t MemoryMappedFile::GetSize() const
+{
+	return size;
+}
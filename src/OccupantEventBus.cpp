@@ -0,0 +1,250 @@
+////////////////////////////////////////////////////////////////////////
+//
+// This file is part of sc4-data-view-extensions, a DLL Plugin for
+// SimCity 4 that extends the game's data views.
+//
+// Copyright (c) 2024 Nicholas Hayes
+//
+// This file is licensed under terms of the MIT License.
+// See LICENSE.txt for more information.
+//
+////////////////////////////////////////////////////////////////////////
+
+#include "OccupantEventBus.h"
+#include "cIGZMessage2Standard.h"
+#include "cIGZMessageServer2.h"
+#include "cISC4Occupant.h"
+#include "GZCLSIDDefs.h"
+#include "GZServPtrs.h"
+#include <algorithm>
+#include <array>
+
+static const uint32_t kSC4MessageInsertOccupant = 0x99EF1142;
+static const uint32_t kSC4MessageRemoveOccupant = 0x99EF1143;
+
+static constexpr std::array<uint32_t, 2> RequiredNotifications =
+{
+	kSC4MessageInsertOccupant,
+	kSC4MessageRemoveOccupant,
+};
+
+OccupantEventBus::OccupantEventBus()
+	: refCount(0),
+	  receivingOccupantMessages(false),
+	  dispatching(false)
+{
+}
+
+void OccupantEventBus::Subscribe(IOccupantEventSubscriber* pSubscriber, uint32_t occupantType)
+{
+	if (!pSubscriber)
+	{
+		return;
+	}
+
+	auto item = std::find_if(
+		subscriptions.begin(),
+		subscriptions.end(),
+		[pSubscriber](const Subscription& subscription) { return subscription.pSubscriber == pSubscriber; });
+
+	if (item != subscriptions.end())
+	{
+		item->occupantType = occupantType;
+	}
+	else
+	{
+		subscriptions.push_back(Subscription{ occupantType, pSubscriber });
+	}
+
+	if (!receivingOccupantMessages)
+	{
+		AddOccupantNotifications();
+	}
+}
+
+void OccupantEventBus::Unsubscribe(IOccupantEventSubscriber* pSubscriber)
+{
+	for (Subscription& subscription : subscriptions)
+	{
+		if (subscription.pSubscriber == pSubscriber)
+		{
+			// The entry is removed after the current message has been dispatched,
+			// this allows a subscriber to unsubscribe from its own callback.
+			subscription.pSubscriber = nullptr;
+		}
+	}
+
+	if (!dispatching)
+	{
+		RemoveUnsubscribedEntries();
+	}
+}
+
+void OccupantEventBus::PostCityInit(cISC4City* pCity)
+{
+	dispatching = true;
+
+	const size_t count = subscriptions.size();
+
+	for (size_t i = 0; i < count; i++)
+	{
+		IOccupantEventSubscriber* pSubscriber = subscriptions[i].pSubscriber;
+
+		if (pSubscriber)
+		{
+			pSubscriber->PostCityInit(pCity);
+		}
+	}
+
+	dispatching = false;
+	RemoveUnsubscribedEntries();
+}
+
+void OccupantEventBus::PreCityShutdown()
+{
+	dispatching = true;
+
+	const size_t count = subscriptions.size();
+
+	for (size_t i = 0; i < count; i++)
+	{
+		IOccupantEventSubscriber* pSubscriber = subscriptions[i].pSubscriber;
+
+		if (pSubscriber)
+		{
+			pSubscriber->PreCityShutdown();
+		}
+	}
+
+	dispatching = false;
+	RemoveUnsubscribedEntries();
+}
+
+bool OccupantEventBus::QueryInterface(uint32_t riid, void** ppvObj)
+{
+	if (riid == GZCLSID::kcIGZMessageTarget2)
+	{
+		*ppvObj = static_cast<cIGZMessageTarget2*>(this);
+		AddRef();
+
+		return true;
+	}
+	else if (riid == GZIID_cIGZUnknown)
+	{
+		*ppvObj = static_cast<cIGZUnknown*>(this);
+		AddRef();
+
+		return true;
+	}
+
+	return false;
+}
+
+uint32_t OccupantEventBus::AddRef()
+{
+	return ++refCount;
+}
+
+uint32_t OccupantEventBus::Release()
+{
+	if (refCount > 0)
+	{
+		--refCount;
+	}
+
+	return refCount;
+}
+
+bool OccupantEventBus::DoMessage(cIGZMessage2* pMsg)
+{
+	cIGZMessage2Standard* pStandardMsg = static_cast<cIGZMessage2Standard*>(pMsg);
+	const uint32_t type = pStandardMsg->GetType();
+
+	if (type == kSC4MessageInsertOccupant || type == kSC4MessageRemoveOccupant)
+	{
+		cISC4Occupant* pOccupant = static_cast<cISC4Occupant*>(pStandardMsg->GetVoid1());
+
+		if (pOccupant)
+		{
+			// The occupant type is read once per message and the subscribers are
+			// filtered against it, so the per-subscriber cost is a compare of two
+			// integers in a contiguous table.
+			const uint32_t occupantType = static_cast<uint32_t>(pOccupant->GetType());
+			const bool inserted = type == kSC4MessageInsertOccupant;
+
+			dispatching = true;
+
+			const size_t count = subscriptions.size();
+
+			for (size_t i = 0; i < count; i++)
+			{
+				const Subscription& subscription = subscriptions[i];
+
+				if (subscription.pSubscriber
+					&& (subscription.occupantType == AnyOccupantType || subscription.occupantType == occupantType))
+				{
+					if (inserted)
+					{
+						subscription.pSubscriber->OccupantInserted(pOccupant);
+					}
+					else
+					{
+						subscription.pSubscriber->OccupantRemoved(pOccupant);
+					}
+				}
+			}
+
+			dispatching = false;
+			RemoveUnsubscribedEntries();
+		}
+	}
+
+	return true;
+}
+
+void OccupantEventBus::AddOccupantNotifications()
+{
+	cIGZMessageServer2Ptr pMS2;
+
+	if (pMS2)
+	{
+		for (uint32_t messageID : RequiredNotifications)
+		{
+			pMS2->AddNotification(this, messageID);
+		}
+
+		receivingOccupantMessages = true;
+	}
+}
+
+void OccupantEventBus::RemoveOccupantNotifications()
+{
+	cIGZMessageServer2Ptr pMS2;
+
+	if (pMS2)
+	{
+		for (uint32_t messageID : RequiredNotifications)
+		{
+			pMS2->RemoveNotification(this, messageID);
+		}
+	}
+
+	receivingOccupantMessages = false;
+}
+
+void OccupantEventBus::RemoveUnsubscribedEntries()
+{
+	auto newEnd = std::remove_if(
+		subscriptions.begin(),
+		subscriptions.end(),
+		[](const Subscription& subscription) { return subscription.pSubscriber == nullptr; });
+
+	subscriptions.erase(newEnd, subscriptions.end());
+
+	// The game's message server only sends the occupant messages
+	// to the bus when at least one component is listening for them.
+	if (subscriptions.empty() && receivingOccupantMessages)
+	{
+		RemoveOccupantNotifications();
+	}
+}
@@ -0,0 +1,63 @@
+////////////////////////////////////////////////////////////////////////
+//
+// This file is part of sc4-data-view-extensions, a DLL Plugin for
+// SimCity 4 that extends the game's data views.
+//
+// Copyright (c) 2024 Nicholas Hayes
+//
+// This file is licensed under terms of the MIT License.
+// See LICENSE.txt for more information.
+//
+////////////////////////////////////////////////////////////////////////
+
+#pragma once
+#include "cIGZMessageTarget2.h"
+#include "IOccupantEventSubscriber.h"
+#include <vector>
+
+// Receives the game's occupant insert/remove messages once and fans them
+// out to the DLL components that are interested in them.
+// The city lifecycle events are forwarded by the DLL director.
+class OccupantEventBus : private cIGZMessageTarget2
+{
+public:
+	// Passing this value as the occupant type subscribes to all occupants.
+	static constexpr uint32_t AnyOccupantType = 0;
+
+	OccupantEventBus();
+
+	void Subscribe(IOccupantEventSubscriber* pSubscriber, uint32_t occupantType = AnyOccupantType);
+	void Unsubscribe(IOccupantEventSubscriber* pSubscriber);
+
+	void PostCityInit(cISC4City* pCity);
+	void PreCityShutdown();
+
+private:
+
+	// cIGZUnknown
+
+	bool QueryInterface(uint32_t riid, void** ppvObj);
+	uint32_t AddRef();
+	uint32_t Release();
+
+	// cIGZMessageTarget2
+
+	bool DoMessage(cIGZMessage2* pMsg);
+
+	// Private members
+
+	struct Subscription
+	{
+		uint32_t occupantType;
+		IOccupantEventSubscriber* pSubscriber;
+	};
+
+	void AddOccupantNotifications();
+	void RemoveOccupantNotifications();
+	void RemoveUnsubscribedEntries();
+
+	uint32_t refCount;
+	bool receivingOccupantMessages;
+	bool dispatching;
+	std::vector<Subscription> subscriptions;
+};
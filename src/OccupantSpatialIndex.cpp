@@ -0,0 +1,300 @@
+////////////////////////////////////////////////////////////////////////
+//
+// This file is part of sc4-data-view-extensions, a DLL Plugin for
+// SimCity 4 that extends the game's data views.
+//
+// Copyright (c) 2024 Nicholas Hayes
+//
+// This file is licensed under terms of the MIT License.
+// See LICENSE.txt for more information.
+//
+////////////////////////////////////////////////////////////////////////
+
+#include "OccupantSpatialIndex.h"
+#include <algorithm>
+#include <utility>
+
+OccupantSpatialIndex::OccupantSpatialIndex()
+	: bucketCountX(0),
+	  bucketCountZ(0),
+	  buckets(),
+	  footprints()
+{
+}
+
+void OccupantSpatialIndex::Init(uint32_t cellCountX, uint32_t cellCountZ)
+{
+	bucketCountX = (cellCountX + BucketSize - 1) / BucketSize;
+	bucketCountZ = (cellCountZ + BucketSize - 1) / BucketSize;
+
+	buckets.clear();
+	buckets.resize(static_cast<size_t>(bucketCountX) * bucketCountZ);
+	footprints.clear();
+}
+
+void OccupantSpatialIndex::Shutdown()
+{
+	bucketCountX = 0;
+	bucketCountZ = 0;
+
+	buckets.clear();
+	buckets.shrink_to_fit();
+	footprints.clear();
+}
+
+bool OccupantSpatialIndex::IsInitialized() const
+{
+	return !buckets.empty();
+}
+
+size_t OccupantSpatialIndex::GetCount() const
+{
+	return footprints.size();
+}
+
+bool OccupantSpatialIndex::Insert(cISC4Occupant* pOccupant, const SC4Rect<long>& footprint)
+{
+	SC4Rect<long> bucketRange;
+
+	if (!GetBucketRange(footprint, bucketRange) || !footprints.try_emplace(pOccupant, footprint).second)
+	{
+		return false;
+	}
+
+	for (long z = bucketRange.topLeftY; z <= bucketRange.bottomRightY; z++)
+	{
+		for (long x = bucketRange.topLeftX; x <= bucketRange.bottomRightX; x++)
+		{
+			buckets[static_cast<size_t>(z) * bucketCountX + x].push_back(Entry{ pOccupant, footprint });
+		}
+	}
+
+	return true;
+}
+
+bool OccupantSpatialIndex::Remove(cISC4Occupant* pOccupant)
+{
+	auto item = footprints.find(pOccupant);
+
+	if (item == footprints.end())
+	{
+		return false;
+	}
+
+	SC4Rect<long> bucketRange;
+
+	if (GetBucketRange(item->second, bucketRange))
+	{
+		for (long z = bucketRange.topLeftY; z <= bucketRange.bottomRightY; z++)
+		{
+			for (long x = bucketRange.topLeftX; x <= bucketRange.bottomRightX; x++)
+			{
+				std::vector<Entry>& bucket = buckets[static_cast<size_t>(z) * bucketCountX + x];
+
+				// The bucket order is not significant, so the entry is swapped with the last item.
+				auto entry = std::find_if(
+					bucket.begin(),
+					bucket.end(),
+					[pOccupant](const Entry& entry) { return entry.pOccupant == pOccupant; });
+
+				if (entry != bucket.end())
+				{
+					*entry = bucket.back();
+					bucket.pop_back();
+				}
+			}
+		}
+	}
+
+	footprints.erase(item);
+	return true;
+}
+
+void OccupantSpatialIndex::FindAtCell(long x, long z, std::vector<cISC4Occupant*>& output) const
+{
+	output.clear();
+
+	if (x < 0 || z < 0)
+	{
+		return;
+	}
+
+	const uint32_t bucketX = static_cast<uint32_t>(x) / BucketSize;
+	const uint32_t bucketZ = static_cast<uint32_t>(z) / BucketSize;
+
+	if (bucketX >= bucketCountX || bucketZ >= bucketCountZ)
+	{
+		return;
+	}
+
+	for (const Entry& entry : buckets[static_cast<size_t>(bucketZ) * bucketCountX + bucketX])
+	{
+		if (x >= entry.footprint.topLeftX
+			&& x <= entry.footprint.bottomRightX
+			&& z >= entry.footprint.topLeftY
+			&& z <= entry.footprint.bottomRightY)
+		{
+			output.push_back(entry.pOccupant);
+		}
+	}
+}
+
+void OccupantSpatialIndex::FindInRect(const SC4Rect<long>& cells, std::vector<cISC4Occupant*>& output) const
+{
+	output.clear();
+
+	SC4Rect<long> bucketRange;
+
+	if (!GetBucketRange(cells, bucketRange))
+	{
+		return;
+	}
+
+	const long left = std::min(cells.topLeftX, cells.bottomRightX);
+	const long right = std::max(cells.topLeftX, cells.bottomRightX);
+	const long top = std::min(cells.topLeftY, cells.bottomRightY);
+	const long bottom = std::max(cells.topLeftY, cells.bottomRightY);
+
+	for (long z = bucketRange.topLeftY; z <= bucketRange.bottomRightY; z++)
+	{
+		for (long x = bucketRange.topLeftX; x <= bucketRange.bottomRightX; x++)
+		{
+			for (const Entry& entry : buckets[static_cast<size_t>(z) * bucketCountX + x])
+			{
+				if (entry.footprint.topLeftX <= right
+					&& entry.footprint.bottomRightX >= left
+					&& entry.footprint.topLeftY <= bottom
+					&& entry.footprint.bottomRightY >= top)
+				{
+					output.push_back(entry.pOccupant);
+				}
+			}
+		}
+	}
+
+	// Occupants that span several buckets are found more than once.
+	std::sort(output.begin(), output.end());
+	output.erase(std::unique(output.begin(), output.end()), output.end());
+}
+
+void OccupantSpatialIndex::FindNearest(long x, long z, size_t count, std::vector<cISC4Occupant*>& output) const
+{
+	output.clear();
+
+	if (count == 0 || footprints.empty())
+	{
+		return;
+	}
+
+	const long centerX = std::clamp(x, 0L, static_cast<long>(bucketCountX * BucketSize) - 1) / static_cast<long>(BucketSize);
+	const long centerZ = std::clamp(z, 0L, static_cast<long>(bucketCountZ * BucketSize) - 1) / static_cast<long>(BucketSize);
+	const long maxRing = static_cast<long>(std::max(bucketCountX, bucketCountZ));
+
+	std::unordered_map<cISC4Occupant*, uint32_t> candidates;
+
+	// The buckets are searched in square rings around the bucket that contains
+	// the cell. A bucket in ring r + 1 is at least r * BucketSize cells away,
+	// so the search stops once the closest count occupants are nearer than that.
+
+	for (long ring = 0; ring <= maxRing; ring++)
+	{
+		for (long bz = centerZ - ring; bz <= centerZ + ring; bz++)
+		{
+			if (bz < 0 || bz >= static_cast<long>(bucketCountZ))
+			{
+				continue;
+			}
+
+			const bool edgeRow = bz == centerZ - ring || bz == centerZ + ring;
+			const long step = edgeRow || ring == 0 ? 1 : 2 * ring;
+
+			for (long bx = centerX - ring; bx <= centerX + ring; bx += step)
+			{
+				if (bx < 0 || bx >= static_cast<long>(bucketCountX))
+				{
+					continue;
+				}
+
+				for (const Entry& entry : buckets[static_cast<size_t>(bz) * bucketCountX + bx])
+				{
+					candidates.try_emplace(entry.pOccupant, GetSquaredDistance(entry.footprint, x, z));
+				}
+			}
+		}
+
+		if (candidates.size() >= count)
+		{
+			const uint32_t ringDistance = static_cast<uint32_t>(ring) * BucketSize;
+
+			size_t closerCount = 0;
+
+			for (const auto& item : candidates)
+			{
+				if (item.second <= ringDistance * ringDistance)
+				{
+					closerCount++;
+				}
+			}
+
+			if (closerCount >= count)
+			{
+				break;
+			}
+		}
+	}
+
+	std::vector<std::pair<uint32_t, cISC4Occupant*>> sorted;
+	sorted.reserve(candidates.size());
+
+	for (const auto& item : candidates)
+	{
+		sorted.emplace_back(item.second, item.first);
+	}
+
+	const size_t outputCount = std::min(count, sorted.size());
+
+	std::partial_sort(sorted.begin(), sorted.begin() + outputCount, sorted.end());
+
+	output.reserve(outputCount);
+
+	for (size_t i = 0; i < outputCount; i++)
+	{
+		output.push_back(sorted[i].second);
+	}
+}
+
+bool OccupantSpatialIndex::GetBucketRange(const SC4Rect<long>& cells, SC4Rect<long>& bucketRange) const
+{
+	if (bucketCountX == 0 || bucketCountZ == 0)
+	{
+		return false;
+	}
+
+	const long maxCellX = static_cast<long>(bucketCountX * BucketSize) - 1;
+	const long maxCellZ = static_cast<long>(bucketCountZ * BucketSize) - 1;
+
+	const long left = std::max(std::min(cells.topLeftX, cells.bottomRightX), 0L);
+	const long top = std::max(std::min(cells.topLeftY, cells.bottomRightY), 0L);
+	const long right = std::min(std::max(cells.topLeftX, cells.bottomRightX), maxCellX);
+	const long bottom = std::min(std::max(cells.topLeftY, cells.bottomRightY), maxCellZ);
+
+	if (left > right || top > bottom)
+	{
+		return false;
+	}
+
+	bucketRange.topLeftX = left / static_cast<long>(BucketSize);
+	bucketRange.topLeftY = top / static_cast<long>(BucketSize);
+	bucketRange.bottomRightX = right / static_cast<long>(BucketSize);
+	bucketRange.bottomRightY = bottom / static_cast<long>(BucketSize);
+
+	return true;
+}
+
+uint32_t OccupantSpatialIndex::GetSquaredDistance(const SC4Rect<long>& footprint, long x, long z)
+{
+	const long dx = std::max({ footprint.topLeftX - x, 0L, x - footprint.bottomRightX });
+	const long dz = std::max({ footprint.topLeftY - z, 0L, z - footprint.bottomRightY });
+
+	return static_cast<uint32_t>(dx * dx + dz * dz);
+}
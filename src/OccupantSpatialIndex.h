@@ -0,0 +1,68 @@
+////////////////////////////////////////////////////////////////////////
+//
+// This file is part of sc4-data-view-extensions, a DLL Plugin for
+// SimCity 4 that extends the game's data views.
+//
+// Copyright (c) 2024 Nicholas Hayes
+//
+// This file is licensed under terms of the MIT License.
+// See LICENSE.txt for more information.
+//
+////////////////////////////////////////////////////////////////////////
+
+#pragma once
+#include "SC4Rect.h"
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+class cISC4Occupant;
+
+// A uniform bucket grid over the city cells that finds the occupants
+// at or near a cell without visiting every occupant.
+// Each occupant is stored in every bucket that its footprint overlaps,
+// the footprints use inclusive city cell coordinates.
+class OccupantSpatialIndex
+{
+public:
+	// The bucket width and height in cells.
+	static constexpr uint32_t BucketSize = 8;
+
+	OccupantSpatialIndex();
+
+	void Init(uint32_t cellCountX, uint32_t cellCountZ);
+	void Shutdown();
+
+	bool IsInitialized() const;
+	size_t GetCount() const;
+
+	// Returns false if the occupant is already in the index.
+	bool Insert(cISC4Occupant* pOccupant, const SC4Rect<long>& footprint);
+	bool Remove(cISC4Occupant* pOccupant);
+
+	// Gets the occupants whose footprint contains the cell.
+	void FindAtCell(long x, long z, std::vector<cISC4Occupant*>& output) const;
+
+	// Gets the occupants whose footprint overlaps the inclusive cell rectangle.
+	void FindInRect(const SC4Rect<long>& cells, std::vector<cISC4Occupant*>& output) const;
+
+	// Gets up to count occupants ordered by the distance from the cell
+	// to the nearest cell of their footprint, starting with the closest.
+	void FindNearest(long x, long z, size_t count, std::vector<cISC4Occupant*>& output) const;
+
+private:
+	struct Entry
+	{
+		cISC4Occupant* pOccupant;
+		SC4Rect<long> footprint;
+	};
+
+	bool GetBucketRange(const SC4Rect<long>& cells, SC4Rect<long>& buckets) const;
+	static uint32_t GetSquaredDistance(const SC4Rect<long>& footprint, long x, long z);
+
+	uint32_t bucketCountX;
+	uint32_t bucketCountZ;
+	std::vector<std::vector<Entry>> buckets;
+	std::unordered_map<cISC4Occupant*, SC4Rect<long>> footprints;
+};
@@ -0,0 +1,18 @@
+////////////////////////////////////////////////////////////////////////
+//
+// This file is part of sc4-data-view-extensions, a DLL Plugin for
+// SimCity 4 that extends the game's data views.
+//
+// Copyright (c) 2024 Nicholas Hayes
+//
+// This file is licensed under terms of the MIT License.
+// See LICENSE.txt for more information.
+//
+////////////////////////////////////////////////////////////////////////
+
+#pragma once
+#include <cstdint>
+
+// The occupant type of the lots' buildings, cISC4Occupant::GetType returns
+// this value for all buildings.
+static constexpr uint32_t kOccupantTypeBuilding = 0x278128A0;
@@ -0,0 +1,685 @@
+////////////////////////////////////////////////////////////////////////
+//
+// This file is part of sc4-data-view-extensions, a DLL Plugin for
+// SimCity 4 that extends the game's data views.
+//
+// Copyright (c) 2024 Nicholas Hayes
+//
+// This file is licensed under terms of the MIT License.
+// See LICENSE.txt for more information.
+//
+////////////////////////////////////////////////////////////////////////
+
+#include "PluginEffectIndex.h"
+#include "BinaryStream.h"
+#include "DBPFFile.h"
+#include "GlobalPointers.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
+namespace
+{
+	constexpr uint32_t kExemplarTypeID = 0x6534284A;
+	constexpr uint32_t kCohortTypeID = 0x05342861;
+
+	constexpr uint32_t kExemplarTypeProperty = 0x00000010;
+	constexpr uint32_t kExemplarTypeBuilding = 0x00000002;
+
+	// Only the binary exemplar format is read, the text format is rarely used.
+	constexpr char kBinaryExemplarSignature[] = "EQZB";
+	constexpr char kBinaryCohortSignature[] = "CQZB";
+	constexpr size_t kExemplarHeaderSize = 24;
+
+	constexpr uint16_t kPropertyKeyTypeArray = 0x80;
+
+	// Inheritance deeper than this is treated as a cohort cycle.
+	constexpr uint32_t kMaxCohortDepth = 16;
+
+	constexpr uint32_t kCacheSignature = 0x49505644; // DVPI
+	constexpr uint32_t kCacheVersion = 1;
+
+	size_t GetPropertyValueSize(uint16_t valueType)
+	{
+		switch (valueType)
+		{
+		case 0x100: // Uint8
+		case 0xB00: // Bool
+		case 0xC00: // String
+			return 1;
+		case 0x200: // Uint16
+			return 2;
+		case 0x300: // Uint32
+		case 0x700: // Sint32
+		case 0x900: // Float32
+			return 4;
+		case 0x800: // Sint64
+			return 8;
+		default:
+			return 0;
+		}
+	}
+
+	float ReadPropertyValue(const uint8_t* data, uint16_t valueType)
+	{
+		float value = 0.0f;
+
+		switch (valueType)
+		{
+		case 0x100:
+			value = static_cast<float>(data[0]);
+			break;
+		case 0x200:
+		{
+			uint16_t temp;
+			std::memcpy(&temp, data, sizeof(temp));
+			value = static_cast<float>(temp);
+			break;
+		}
+		case 0x300:
+		{
+			uint32_t temp;
+			std::memcpy(&temp, data, sizeof(temp));
+			value = static_cast<float>(temp);
+			break;
+		}
+		case 0x700:
+		{
+			int32_t temp;
+			std::memcpy(&temp, data, sizeof(temp));
+			value = static_cast<float>(temp);
+			break;
+		}
+		case 0x800:
+		{
+			int64_t temp;
+			std::memcpy(&temp, data, sizeof(temp));
+			value = static_cast<float>(temp);
+			break;
+		}
+		case 0x900:
+			std::memcpy(&value, data, sizeof(value));
+			break;
+		}
+
+		return value;
+	}
+
+	bool ParseExemplar(
+		const DBPFEntry& entry,
+		const uint8_t* data,
+		size_t size,
+		PluginEffectIndex::ExemplarRecord& record)
+	{
+		const bool isCohort = entry.key.type == kCohortTypeID;
+
+		if (size < kExemplarHeaderSize
+			|| std::memcmp(data, isCohort ? kBinaryCohortSignature : kBinaryExemplarSignature, 4) != 0)
+		{
+			return false;
+		}
+
+		BinaryReader reader(data, size);
+		reader.Skip(8);
+
+		uint32_t parentType = 0;
+		uint32_t propertyCount = 0;
+
+		record = {};
+		record.group = entry.key.group;
+		record.instance = entry.key.instance;
+		record.flags = isCohort ? static_cast<uint32_t>(PluginEffectIndex::ExemplarRecord::IsCohort) : 0;
+
+		if (!reader.Read(parentType)
+			|| !reader.Read(record.parentGroup)
+			|| !reader.Read(record.parentInstance)
+			|| !reader.Read(propertyCount))
+		{
+			return false;
+		}
+
+		for (uint32_t i = 0; i < propertyCount; i++)
+		{
+			uint32_t id = 0;
+			uint16_t valueType = 0;
+			uint16_t keyType = 0;
+			uint8_t unused = 0;
+			uint32_t valueCount = 1;
+
+			if (!reader.Read(id)
+				|| !reader.Read(valueType)
+				|| !reader.Read(keyType)
+				|| !reader.Read(unused)
+				|| (keyType == kPropertyKeyTypeArray && !reader.Read(valueCount)))
+			{
+				return false;
+			}
+
+			const size_t valueSize = GetPropertyValueSize(valueType);
+
+			if (valueSize == 0)
+			{
+				return false;
+			}
+
+			const uint8_t* values = reader.GetCurrent();
+
+			if (static_cast<uint64_t>(valueCount) * valueSize > size
+				|| !reader.Skip(static_cast<size_t>(valueCount) * valueSize))
+			{
+				return false;
+			}
+
+			switch (id)
+			{
+			case kExemplarTypeProperty:
+				if (valueCount == 1 && valueType != 0xC00)
+				{
+					record.exemplarType = static_cast<uint32_t>(ReadPropertyValue(values, valueType));
+					record.flags |= PluginEffectIndex::ExemplarRecord::HasExemplarType;
+				}
+				break;
+			case kParkEffectProperty:
+			case kLandmarkEffectProperty:
+				// The effect properties are a two item array, the first item is the
+				// effect strength and the second item is the effect radius.
+				if (valueCount >= 2 && valueType != 0xC00 && valueType != 0xB00)
+				{
+					OccupantEffect effect{};
+					effect.strength = ReadPropertyValue(values, valueType);
+					effect.radius = ReadPropertyValue(values + valueSize, valueType);
+
+					if (id == kParkEffectProperty)
+					{
+						record.parkEffect = effect;
+						record.flags |= PluginEffectIndex::ExemplarRecord::HasParkEffect;
+					}
+					else
+					{
+						record.landmarkEffect = effect;
+						record.flags |= PluginEffectIndex::ExemplarRecord::HasLandmarkEffect;
+					}
+				}
+				break;
+			}
+		}
+
+		return true;
+	}
+
+	bool IsRecordUsed(const PluginEffectIndex::ExemplarRecord& record)
+	{
+		// The exemplars that can not be buildings are dropped to keep the cache small,
+		// every cohort is kept because a building may inherit its values from it.
+		if (record.flags & PluginEffectIndex::ExemplarRecord::IsCohort)
+		{
+			return true;
+		}
+
+		if (record.flags & PluginEffectIndex::ExemplarRecord::HasExemplarType)
+		{
+			return record.exemplarType == kExemplarTypeBuilding;
+		}
+
+		return record.parentGroup != 0 || record.parentInstance != 0;
+	}
+
+	uint64_t MakeRecordKey(uint32_t group, uint32_t instance)
+	{
+		return (static_cast<uint64_t>(group) << 32) | instance;
+	}
+}
+
+PluginEffectIndex::PluginEffectIndex()
+	: buildings(),
+	  buildThread(),
+	  cancelRequested(false)
+{
+}
+
+PluginEffectIndex::~PluginEffectIndex()
+{
+	Cancel();
+}
+
+void PluginEffectIndex::StartBuild(std::vector<PluginDirectory> directories, std::filesystem::path cachePath)
+{
+	Cancel();
+
+	cancelRequested.store(false, std::memory_order_relaxed);
+
+	// The build uses a dedicated thread instead of a pool task, ThreadPool::Submit
+	// runs the task on the calling thread when the pool has no workers and that
+	// would block the game's startup on the plugin scan.
+	buildThread = std::thread(
+		[this, directories = std::move(directories), cachePath = std::move(cachePath)]() mutable
+		{
+			RunBuild(std::move(directories), std::move(cachePath));
+		});
+}
+
+void PluginEffectIndex::Cancel()
+{
+	cancelRequested.store(true, std::memory_order_relaxed);
+
+	if (buildThread.joinable())
+	{
+		buildThread.join();
+	}
+}
+
+bool PluginEffectIndex::IsReady() const
+{
+	return buildings.load(std::memory_order_acquire) != nullptr;
+}
+
+bool PluginEffectIndex::GetEffect(uint32_t buildingType, uint32_t propertyID, OccupantEffect& effect) const
+{
+	const std::shared_ptr<const BuildingEffectMap> map = buildings.load(std::memory_order_acquire);
+
+	if (!map)
+	{
+		return false;
+	}
+
+	const auto item = map->find(buildingType);
+
+	if (item == map->end())
+	{
+		return false;
+	}
+
+	const BuildingEffects& value = item->second;
+
+	if (propertyID == kParkEffectProperty && value.hasParkEffect)
+	{
+		effect = value.parkEffect;
+		return true;
+	}
+	else if (propertyID == kLandmarkEffectProperty && value.hasLandmarkEffect)
+	{
+		effect = value.landmarkEffect;
+		return true;
+	}
+
+	return false;
+}
+
+std::shared_ptr<const PluginEffectIndex::BuildingEffectMap> PluginEffectIndex::GetBuildings() const
+{
+	return buildings.load(std::memory_order_acquire);
+}
+
+bool PluginEffectIndex::ScanFile(FileScan& file)
+{
+	file.records.clear();
+
+	DBPFFile dbpf;
+
+	if (!dbpf.Open(file.path))
+	{
+		return false;
+	}
+
+	std::vector<uint8_t> buffer;
+	const uint32_t entryCount = dbpf.GetEntryCount();
+
+	for (uint32_t i = 0; i < entryCount; i++)
+	{
+		const DBPFEntry entry = dbpf.GetEntry(i);
+
+		if (entry.key.type == kExemplarTypeID || entry.key.type == kCohortTypeID)
+		{
+			const uint8_t* data = nullptr;
+			size_t size = 0;
+			ExemplarRecord record{};
+
+			if (dbpf.GetEntryData(entry, buffer, data, size)
+				&& ParseExemplar(entry, data, size, record)
+				&& IsRecordUsed(record))
+			{
+				file.records.push_back(record);
+			}
+		}
+	}
+
+	return true;
+}
+
+bool PluginEffectIndex::ReadCache(const std::filesystem::path& cachePath, std::vector<FileScan>& files)
+{
+	std::ifstream stream(cachePath, std::ios::binary);
+
+	if (!stream)
+	{
+		return false;
+	}
+
+	const std::vector<uint8_t> data((std::istreambuf_iterator<char>(stream)), std::istreambuf_iterator<char>());
+	BinaryReader reader(data.data(), data.size());
+
+	uint32_t signature = 0;
+	uint32_t version = 0;
+	uint32_t fileCount = 0;
+
+	if (!reader.Read(signature)
+		|| signature != kCacheSignature
+		|| !reader.Read(version)
+		|| version != kCacheVersion
+		|| !reader.Read(fileCount))
+	{
+		return false;
+	}
+
+	std::vector<FileScan> cachedFiles;
+
+	for (uint32_t i = 0; i < fileCount; i++)
+	{
+		FileScan file{};
+		uint32_t pathLength = 0;
+		uint32_t recordCount = 0;
+
+		if (!reader.Read(pathLength))
+		{
+			return false;
+		}
+
+		const uint8_t* pathData = reader.GetCurrent();
+
+		if (!reader.Skip(pathLength)
+			|| !reader.Read(file.size)
+			|| !reader.Read(file.writeTime)
+			|| !reader.Read(recordCount))
+		{
+			return false;
+		}
+
+		file.path = std::filesystem::path(std::u8string(
+			reinterpret_cast<const char8_t*>(pathData),
+			reinterpret_cast<const char8_t*>(pathData) + pathLength));
+		file.scanned = true;
+
+		for (uint32_t j = 0; j < recordCount; j++)
+		{
+			ExemplarRecord record{};
+
+			if (!reader.Read(record.group)
+				|| !reader.Read(record.instance)
+				|| !reader.Read(record.parentGroup)
+				|| !reader.Read(record.parentInstance)
+				|| !reader.Read(record.exemplarType)
+				|| !reader.Read(record.flags)
+				|| !reader.Read(record.parkEffect.strength)
+				|| !reader.Read(record.parkEffect.radius)
+				|| !reader.Read(record.landmarkEffect.strength)
+				|| !reader.Read(record.landmarkEffect.radius))
+			{
+				return false;
+			}
+
+			file.records.push_back(record);
+		}
+
+		cachedFiles.push_back(std::move(file));
+	}
+
+	files = std::move(cachedFiles);
+	return true;
+}
+
+bool PluginEffectIndex::WriteCache(const std::filesystem::path& cachePath, const std::vector<FileScan>& files)
+{
+	std::vector<uint8_t> data;
+	BinaryWriter writer(data);
+
+	writer.Write(kCacheSignature);
+	writer.Write(kCacheVersion);
+	writer.Write(static_cast<uint32_t>(files.size()));
+
+	for (const FileScan& file : files)
+	{
+		const std::u8string path = file.path.u8string();
+
+		writer.Write(static_cast<uint32_t>(path.size()));
+		writer.WriteBytes(path.data(), path.size());
+		writer.Write(file.size);
+		writer.Write(file.writeTime);
+		writer.Write(static_cast<uint32_t>(file.records.size()));
+
+		for (const ExemplarRecord& record : file.records)
+		{
+			writer.Write(record.group);
+			writer.Write(record.instance);
+			writer.Write(record.parentGroup);
+			writer.Write(record.parentInstance);
+			writer.Write(record.exemplarType);
+			writer.Write(record.flags);
+			writer.Write(record.parkEffect.strength);
+			writer.Write(record.parkEffect.radius);
+			writer.Write(record.landmarkEffect.strength);
+			writer.Write(record.landmarkEffect.radius);
+		}
+	}
+
+	std::ofstream stream(cachePath, std::ios::binary | std::ios::trunc);
+
+	if (!stream)
+	{
+		return false;
+	}
+
+	stream.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size()));
+
+	return static_cast<bool>(stream);
+}
+
+PluginEffectIndex::BuildingEffectMap PluginEffectIndex::ResolveBuildings(const std::vector<FileScan>& files)
+{
+	// The records from the later files replace the earlier records with the same group and instance.
+	std::unordered_map<uint64_t, const ExemplarRecord*> exemplars;
+	std::unordered_map<uint64_t, const ExemplarRecord*> cohorts;
+
+	for (const FileScan& file : files)
+	{
+		for (const ExemplarRecord& record : file.records)
+		{
+			auto& target = (record.flags & ExemplarRecord::IsCohort) ? cohorts : exemplars;
+			target[MakeRecordKey(record.group, record.instance)] = &record;
+		}
+	}
+
+	BuildingEffectMap result;
+
+	for (const auto& item : exemplars)
+	{
+		// The values that the exemplar does not set are inherited from its parent cohorts.
+		const ExemplarRecord* current = item.second;
+		uint32_t remaining = ExemplarRecord::HasExemplarType
+						   | ExemplarRecord::HasParkEffect
+						   | ExemplarRecord::HasLandmarkEffect;
+		uint32_t exemplarType = 0;
+		BuildingEffects effects{};
+
+		for (uint32_t depth = 0; current && remaining != 0 && depth < kMaxCohortDepth; depth++)
+		{
+			const uint32_t found = current->flags & remaining;
+
+			if (found & ExemplarRecord::HasExemplarType)
+			{
+				exemplarType = current->exemplarType;
+			}
+
+			if (found & ExemplarRecord::HasParkEffect)
+			{
+				effects.hasParkEffect = true;
+				effects.parkEffect = current->parkEffect;
+			}
+
+			if (found & ExemplarRecord::HasLandmarkEffect)
+			{
+				effects.hasLandmarkEffect = true;
+				effects.landmarkEffect = current->landmarkEffect;
+			}
+
+			remaining &= ~found;
+
+			if (current->parentGroup == 0 && current->parentInstance == 0)
+			{
+				break;
+			}
+
+			const auto parent = cohorts.find(MakeRecordKey(current->parentGroup, current->parentInstance));
+			current = parent != cohorts.end() ? parent->second : nullptr;
+		}
+
+		if (exemplarType == kExemplarTypeBuilding && (effects.hasParkEffect || effects.hasLandmarkEffect))
+		{
+			// The game identifies a building type by its exemplar instance ID.
+			result[item.second->instance] = effects;
+		}
+	}
+
+	return result;
+}
+
+void PluginEffectIndex::RunBuild(std::vector<PluginDirectory> directories, std::filesystem::path cachePath)
+{
+	try
+	{
+		std::vector<FileScan> files = FindFiles(directories);
+		std::vector<FileScan> cachedFiles;
+
+		if (ReadCache(cachePath, cachedFiles))
+		{
+			std::unordered_map<std::filesystem::path::string_type, FileScan*> cachedFileMap;
+
+			for (FileScan& cachedFile : cachedFiles)
+			{
+				cachedFileMap.emplace(cachedFile.path.native(), &cachedFile);
+			}
+
+			for (FileScan& file : files)
+			{
+				auto item = cachedFileMap.find(file.path.native());
+
+				if (item != cachedFileMap.end()
+					&& item->second->size == file.size
+					&& item->second->writeTime == file.writeTime)
+				{
+					file.records = std::move(item->second->records);
+					file.scanned = true;
+				}
+			}
+		}
+
+		std::vector<uint32_t> pendingFiles;
+
+		for (uint32_t i = 0; i < static_cast<uint32_t>(files.size()); i++)
+		{
+			if (!files[i].scanned)
+			{
+				pendingFiles.push_back(i);
+			}
+		}
+
+		if (!pendingFiles.empty())
+		{
+			spThreadPool->ParallelFor(
+				static_cast<uint32_t>(pendingFiles.size()),
+				[&](uint32_t index)
+				{
+					if (!cancelRequested.load(std::memory_order_relaxed))
+					{
+						FileScan& file = files[pendingFiles[index]];
+
+						// A file that is not a DBPF file is cached with no records,
+						// so that it is skipped until it changes.
+						ScanFile(file);
+						file.scanned = true;
+					}
+				});
+
+			if (!cancelRequested.load(std::memory_order_relaxed))
+			{
+				WriteCache(cachePath, files);
+			}
+		}
+
+		if (!cancelRequested.load(std::memory_order_relaxed))
+		{
+			buildings.store(
+				std::make_shared<const BuildingEffectMap>(ResolveBuildings(files)),
+				std::memory_order_release);
+		}
+	}
+	catch (const std::exception&)
+	{
+		// The index is optional, the effects are read from the occupants
+		// when it is not available.
+	}
+}
+
+std::vector<PluginEffectIndex::FileScan> PluginEffectIndex::FindFiles(const std::vector<PluginDirectory>& directories)
+{
+	std::vector<FileScan> files;
+
+	for (const PluginDirectory& directory : directories)
+	{
+		std::vector<std::filesystem::path> paths;
+		std::error_code ec;
+
+		if (directory.recursive)
+		{
+			for (auto it = std::filesystem::recursive_directory_iterator(
+					directory.path,
+					std::filesystem::directory_options::skip_permission_denied,
+					ec);
+				!ec && it != std::filesystem::recursive_directory_iterator();
+				it.increment(ec))
+			{
+				if (it->is_regular_file(ec))
+				{
+					paths.push_back(it->path());
+				}
+			}
+		}
+		else
+		{
+			for (auto it = std::filesystem::directory_iterator(directory.path, ec);
+				!ec && it != std::filesystem::directory_iterator();
+				it.increment(ec))
+			{
+				if (it->is_regular_file(ec))
+				{
+					paths.push_back(it->path());
+				}
+			}
+		}
+
+		std::sort(paths.begin(), paths.end());
+
+		for (std::filesystem::path& path : paths)
+		{
+			FileScan file{};
+			file.size = std::filesystem::file_size(path, ec);
+
+			if (ec)
+			{
+				continue;
+			}
+
+			file.writeTime = std::filesystem::last_write_time(path, ec).time_since_epoch().count();
+
+			if (ec)
+			{
+				continue;
+			}
+
+			file.path = std::move(path);
+			files.push_back(std::move(file));
+		}
+	}
+
+	return files;
+}
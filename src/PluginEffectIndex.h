@@ -0,0 +1,118 @@
+////////////////////////////////////////////////////////////////////////
+//
+// This file is part of sc4-data-view-extensions, a DLL Plugin for
+// SimCity 4 that extends the game's data views.
+//
+// Copyright (c) 2024 Nicholas Hayes
+//
+// This file is licensed under terms of the MIT License.
+// See LICENSE.txt for more information.
+//
+////////////////////////////////////////////////////////////////////////
+
+#pragma once
+#include "EffectPropertyCache.h"
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+struct PluginDirectory
+{
+	std::filesystem::path path;
+	bool recursive;
+};
+
+// An index of the building exemplars that have park or landmark effects.
+// The index is built on its own thread by reading the game's DBPF files directly,
+// and the file scans are split across the thread pool. The scan results are cached
+// so that the files which have not changed since the previous launch are not read again.
+class PluginEffectIndex
+{
+public:
+	struct BuildingEffects
+	{
+		bool hasParkEffect;
+		bool hasLandmarkEffect;
+		OccupantEffect parkEffect;
+		OccupantEffect landmarkEffect;
+	};
+
+	// The key is the building exemplar instance ID.
+	typedef std::unordered_map<uint32_t, BuildingEffects> BuildingEffectMap;
+
+	PluginEffectIndex();
+	~PluginEffectIndex();
+
+	PluginEffectIndex(const PluginEffectIndex&) = delete;
+	PluginEffectIndex& operator=(const PluginEffectIndex&) = delete;
+
+	// The directories are scanned in the listed order, and the files in each
+	// directory are scanned in path order. A later file overrides the exemplars
+	// in the earlier files.
+	// The build never runs on the calling thread, even if the thread pool has no workers.
+	void StartBuild(std::vector<PluginDirectory> directories, std::filesystem::path cachePath);
+
+	// Stops a running build and waits for it to exit.
+	void Cancel();
+
+	bool IsReady() const;
+
+	// Gets the effect for the building with the specified exemplar instance ID.
+	// Returns false if the index is not ready or the building does not have the effect.
+	bool GetEffect(uint32_t buildingType, uint32_t propertyID, OccupantEffect& effect) const;
+
+	// Returns nullptr if the index is not ready.
+	std::shared_ptr<const BuildingEffectMap> GetBuildings() const;
+
+	// The exemplar and cohort values that were read from a single file.
+	// The inherited values are resolved after all of the files have been scanned.
+	struct ExemplarRecord
+	{
+		enum Flags : uint32_t
+		{
+			IsCohort = 1 << 0,
+			HasExemplarType = 1 << 1,
+			HasParkEffect = 1 << 2,
+			HasLandmarkEffect = 1 << 3,
+		};
+
+		uint32_t group;
+		uint32_t instance;
+		uint32_t parentGroup;
+		uint32_t parentInstance;
+		uint32_t exemplarType;
+		uint32_t flags;
+		OccupantEffect parkEffect;
+		OccupantEffect landmarkEffect;
+	};
+
+	struct FileScan
+	{
+		std::filesystem::path path;
+		uint64_t size;
+		int64_t writeTime;
+		std::vector<ExemplarRecord> records;
+		bool scanned;
+	};
+
+private:
+	void RunBuild(std::vector<PluginDirectory> directories, std::filesystem::path cachePath);
+
+	static std::vector<FileScan> FindFiles(const std::vector<PluginDirectory>& directories);
+
+	// Reads the exemplars and cohorts from a DBPF file.
+	static bool ScanFile(FileScan& file);
+
+	static bool ReadCache(const std::filesystem::path& cachePath, std::vector<FileScan>& files);
+	static bool WriteCache(const std::filesystem::path& cachePath, const std::vector<FileScan>& files);
+
+	static BuildingEffectMap ResolveBuildings(const std::vector<FileScan>& files);
+
+	std::atomic<std::shared_ptr<const BuildingEffectMap>> buildings;
+	std::thread buildThread;
+	std::atomic<bool> cancelRequested;
+};
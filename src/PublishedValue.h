@@ -0,0 +1,72 @@
+////////////////////////////////////////////////////////////////////////
+//
+// This file is part of sc4-data-view-extensions, a DLL Plugin for
+// SimCity 4 that extends the game's data views.
+//
+// Copyright (c) 2024 Nicholas Hayes
+//
+// This file is licensed under terms of the MIT License.
+// See LICENSE.txt for more information.
+//
+////////////////////////////////////////////////////////////////////////
+
+#pragma once
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// Hands a value computed on a worker thread to the game thread.
+// The value is published with an atomic pointer swap, so the game thread
+// can read it without taking a lock. A replaced value stays valid until
+// ReclaimRetired is called, which the game thread does at a point where it
+// does not hold a pointer from an earlier Get call.
+template<typename T>
+class PublishedValue
+{
+public:
+	PublishedValue() : current(nullptr), retiredMutex(), retired()
+	{
+	}
+
+	~PublishedValue()
+	{
+		Reset();
+	}
+
+	PublishedValue(const PublishedValue&) = delete;
+	PublishedValue& operator=(const PublishedValue&) = delete;
+
+	void Publish(std::unique_ptr<T> value)
+	{
+		T* previousValue = current.exchange(value.release(), std::memory_order_acq_rel);
+
+		if (previousValue)
+		{
+			std::lock_guard<std::mutex> lock(retiredMutex);
+			retired.emplace_back(previousValue);
+		}
+	}
+
+	const T* Get() const
+	{
+		return current.load(std::memory_order_acquire);
+	}
+
+	void ReclaimRetired()
+	{
+		std::lock_guard<std::mutex> lock(retiredMutex);
+		retired.clear();
+	}
+
+	void Reset()
+	{
+		delete current.exchange(nullptr, std::memory_order_acq_rel);
+		ReclaimRetired();
+	}
+
+private:
+	std::atomic<T*> current;
+	std::mutex retiredMutex;
+	std::vector<std::unique_ptr<T>> retired;
+};
@@ -0,0 +1,147 @@
+////////////////////////////////////////////////////////////////////////
+//
+// This file is part of sc4-data-view-extensions, a DLL Plugin for
+// SimCity 4 that extends the game's data views.
+//
+// Copyright (c) 2024 Nicholas Hayes
+//
+// This file is licensed under terms of the MIT License.
+// See LICENSE.txt for more information.
+//
+////////////////////////////////////////////////////////////////////////
+
+#include "Qfs.h"
+#include <cstring>
+
+namespace
+{
+	// The compressed size, the 0x10FB signature and the 24-bit big endian uncompressed size.
+	constexpr size_t kHeaderSize = 9;
+	constexpr size_t kSignatureOffset = 4;
+}
+
+bool Qfs::IsCompressed(const uint8_t* data, size_t size)
+{
+	return size >= kHeaderSize
+		&& data[kSignatureOffset] == 0x10
+		&& data[kSignatureOffset + 1] == 0xFB;
+}
+
+bool Qfs::Decompress(const uint8_t* data, size_t size, std::vector<uint8_t>& output)
+{
+	if (!IsCompressed(data, size))
+	{
+		return false;
+	}
+
+	size_t position = kSignatureOffset + 2;
+
+	const size_t uncompressedSize = (static_cast<size_t>(data[position]) << 16)
+								  | (static_cast<size_t>(data[position + 1]) << 8)
+								  | static_cast<size_t>(data[position + 2]);
+	position += 3;
+
+	output.resize(uncompressedSize);
+
+	uint8_t* const dest = output.data();
+	size_t destPosition = 0;
+
+	while (position < size)
+	{
+		const uint32_t control = data[position];
+		size_t plainCount = 0;
+		size_t copyCount = 0;
+		size_t copyOffset = 0;
+
+		if (control < 0x80)
+		{
+			if (size - position < 2)
+			{
+				return false;
+			}
+
+			const uint32_t byte1 = data[position + 1];
+			position += 2;
+
+			plainCount = control & 0x03;
+			copyCount = ((control & 0x1C) >> 2) + 3;
+			copyOffset = ((control & 0x60) << 3) + byte1 + 1;
+		}
+		else if (control < 0xC0)
+		{
+			if (size - position < 3)
+			{
+				return false;
+			}
+
+			const uint32_t byte1 = data[position + 1];
+			const uint32_t byte2 = data[position + 2];
+			position += 3;
+
+			plainCount = (byte1 >> 6) & 0x03;
+			copyCount = (control & 0x3F) + 4;
+			copyOffset = ((byte1 & 0x3F) << 8) + byte2 + 1;
+		}
+		else if (control < 0xE0)
+		{
+			if (size - position < 4)
+			{
+				return false;
+			}
+
+			const uint32_t byte1 = data[position + 1];
+			const uint32_t byte2 = data[position + 2];
+			const uint32_t byte3 = data[position + 3];
+			position += 4;
+
+			plainCount = control & 0x03;
+			copyCount = ((control & 0x0C) << 6) + byte3 + 5;
+			copyOffset = ((control & 0x10) << 12) + (byte1 << 8) + byte2 + 1;
+		}
+		else
+		{
+			position += 1;
+
+			// The 0xFC to 0xFF codes end the stream after their plain bytes.
+			plainCount = control < 0xFC ? ((control & 0x1F) << 2) + 4 : control & 0x03;
+		}
+
+		if (plainCount > 0)
+		{
+			if (size - position < plainCount || uncompressedSize - destPosition < plainCount)
+			{
+				return false;
+			}
+
+			std::memcpy(dest + destPosition, data + position, plainCount);
+			position += plainCount;
+			destPosition += plainCount;
+		}
+
+		if (copyCount > 0)
+		{
+			if (copyOffset > destPosition || uncompressedSize - destPosition < copyCount)
+			{
+				return false;
+			}
+
+			// The source and destination can overlap, a short offset repeats the
+			// previous bytes, so the copy has to run forward one byte at a time.
+			const uint8_t* source = dest + destPosition - copyOffset;
+
+			for (size_t i = 0; i < copyCount; i++)
+			{
+				dest[destPosition + i] = source[i];
+			}
+
+			destPosition += copyCount;
+		}
+
+		if (control >= 0xFC)
+		{
+			break;
+		}
+	}
+
+	return destPosition == uncompressedSize;
+}
@@ -0,0 +1,28 @@
+////////////////////////////////////////////////////////////////////////
+//
+// This file is part of sc4-data-view-extensions, a DLL Plugin for
+// SimCity 4 that extends the game's data views.
+//
+// Copyright (c) 2024 Nicholas Hayes
+//
+// This file is licensed under terms of the MIT License.
+// See LICENSE.txt for more information.
+//
+////////////////////////////////////////////////////////////////////////
+
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// The QFS/RefPack compression used for the compressed DBPF entries.
+namespace Qfs
+{
+	// Returns true if the data starts with a QFS header.
+	bool IsCompressed(const uint8_t* data, size_t size);
+
+	// Decompresses a DBPF entry, the data starts with the 4 byte
+	// compressed size that precedes the QFS header.
+	// Returns false if the data is not valid QFS data.
+	bool Decompress(const uint8_t* data, size_t size, std::vector<uint8_t>& output);
+}
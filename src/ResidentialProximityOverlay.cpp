@@ -0,0 +1,204 @@
+////////////////////////////////////////////////////////////////////////
+//
+// This file is part of sc4-data-view-extensions, a DLL Plugin for
+// SimCity 4 that extends the game's data views.
+//
+// Copyright (c) 2024 Nicholas Hayes
+//
+// This file is licensed under terms of the MIT License.
+// See LICENSE.txt for more information.
+//
+////////////////////////////////////////////////////////////////////////
+
+#include "ResidentialProximityOverlay.h"
+#include "cISC4BuildingOccupant.h"
+#include "cISC4City.h"
+#include "cISC4ResidentialSimulator.h"
+#include "cISC4Simulator.h"
+#include "MemoryArena.h"
+#include <algorithm>
+
+namespace
+{
+	constexpr std::array<cISC4BuildingOccupant::WealthType, ResidentialProximityOverlay::ChannelCount> ChannelWealthTypes =
+	{
+		cISC4BuildingOccupant::WealthType::Low,
+		cISC4BuildingOccupant::WealthType::Medium,
+		cISC4BuildingOccupant::WealthType::High,
+	};
+}
+
+ResidentialProximityOverlay::ResidentialProximityOverlay()
+	: pResidentialSimulator(nullptr),
+	  pSimulator(nullptr),
+	  grid(MemoryArenas::Get(MemorySubsystem::Overlays)),
+	  channels(),
+	  capturedSimDate(0),
+	  capturedSimTime(0),
+	  refresh(
+		"residential proximity refresh",
+		FrameTaskScheduler::Priority::Normal,
+		[this](const FrameBudget&)
+		{
+			Update();
+			return true;
+		})
+{
+}
+
+cISC4SimGrid<int16_t>* ResidentialProximityOverlay::GetOverlayGrid()
+{
+	if (!pResidentialSimulator)
+	{
+		return nullptr;
+	}
+
+	refresh.Request();
+
+	return grid.IsEmpty() ? nullptr : &grid;
+}
+
+void ResidentialProximityOverlay::PackRow(
+	const int16_t* low,
+	const int16_t* medium,
+	const int16_t* high,
+	int16_t* output,
+	size_t count)
+{
+	// The loop body is branch-free so that the compiler can vectorize it.
+	// Ties are resolved in favor of the higher wealth level.
+	for (size_t i = 0; i < count; i++)
+	{
+		const int32_t l = low[i];
+		const int32_t m = medium[i];
+		const int32_t h = high[i];
+
+		const int32_t lowOrMedium = std::max(l, m);
+		const int32_t strongest = std::max(lowOrMedium, h);
+		const int32_t wealth = h >= lowOrMedium ? 3 : (m >= l ? 2 : 1);
+
+		output[i] = static_cast<int16_t>(strongest != 0 ? (wealth << 8) | strongest : 0);
+	}
+}
+
+void ResidentialProximityOverlay::PostCityInit(cISC4City* pCity)
+{
+	pResidentialSimulator = pCity->GetResidentialSimulator();
+	pSimulator = pCity->GetSimulator();
+}
+
+void ResidentialProximityOverlay::PreCityShutdown()
+{
+	refresh.Cancel();
+	pResidentialSimulator = nullptr;
+	pSimulator = nullptr;
+	grid.Clear();
+
+	for (GridSnapshotChannel& channel : channels)
+	{
+		channel.Clear();
+	}
+
+	capturedSimDate = 0;
+	capturedSimTime = 0;
+}
+
+bool ResidentialProximityOverlay::Update()
+{
+	if (!pResidentialSimulator)
+	{
+		return false;
+	}
+
+	const int32_t simDate = pSimulator ? pSimulator->GetSimDateNumber() : 0;
+	const int32_t simTime = pSimulator ? pSimulator->GetSimTime() : 0;
+
+	if (!grid.IsEmpty() && pSimulator && simDate == capturedSimDate && simTime == capturedSimTime)
+	{
+		return true;
+	}
+
+	std::array<cISC4SimGrid<uint8_t>*, ChannelCount> maps{};
+
+	for (size_t i = 0; i < ChannelCount; i++)
+	{
+		maps[i] = pResidentialSimulator->GetProximityMap(ChannelWealthTypes[i]);
+
+		if (!maps[i])
+		{
+			return false;
+		}
+	}
+
+	const int32_t tractSize = maps[0]->GetTractSize();
+	const int32_t width = std::max(maps[0]->GetTractCountX(), 0);
+	const int32_t height = std::max(maps[0]->GetTractCountZ(), 0);
+
+	for (size_t i = 1; i < ChannelCount; i++)
+	{
+		if (maps[i]->GetTractSize() != tractSize
+			|| maps[i]->GetTractCountX() != width
+			|| maps[i]->GetTractCountZ() != height)
+		{
+			return false;
+		}
+	}
+
+	capturedSimDate = simDate;
+	capturedSimTime = simTime;
+
+	// The game does not provide bulk access to the maps, the snapshot channels
+	// read each map once and mark the rows that differ from the previous capture.
+	std::array<bool, ChannelCount> captured{};
+	std::array<std::shared_ptr<const GridSnapshot>, ChannelCount> snapshots;
+
+	for (size_t i = 0; i < ChannelCount; i++)
+	{
+		captured[i] = channels[i].Capture(maps[i]);
+		snapshots[i] = channels[i].GetLatest();
+
+		if (!snapshots[i])
+		{
+			return false;
+		}
+	}
+
+	const bool reset = grid.IsEmpty()
+		|| grid.GetTractSize() != tractSize
+		|| grid.GetTractCountX() != width
+		|| grid.GetTractCountZ() != height;
+
+	if (reset)
+	{
+		grid.Resize(width * tractSize, height * tractSize, tractSize);
+	}
+	else if (std::none_of(captured.begin(), captured.end(), [](bool value) { return value; }))
+	{
+		return true;
+	}
+
+	int16_t* values = grid.GetValues();
+
+	for (uint32_t z = 0; z < static_cast<uint32_t>(height); z++)
+	{
+		bool rowChanged = reset;
+
+		for (size_t i = 0; i < ChannelCount && !rowChanged; i++)
+		{
+			// The changed rows of an older snapshot were packed by an earlier update.
+			rowChanged = captured[i] && snapshots[i]->changedRows[z] != 0;
+		}
+
+		if (rowChanged)
+		{
+			PackRow(
+				snapshots[0]->GetRow(z),
+				snapshots[1]->GetRow(z),
+				snapshots[2]->GetRow(z),
+				values + static_cast<size_t>(z) * static_cast<size_t>(width),
+				static_cast<size_t>(width));
+		}
+	}
+
+	return true;
+}
@@ -0,0 +1,67 @@
+////////////////////////////////////////////////////////////////////////
+//
+// This file is part of sc4-data-view-extensions, a DLL Plugin for
+// SimCity 4 that extends the game's data views.
+//
+// Copyright (c) 2024 Nicholas Hayes
+//
+// This file is licensed under terms of the MIT License.
+// See LICENSE.txt for more information.
+//
+////////////////////////////////////////////////////////////////////////
+
+#pragma once
+#include "DllSimGrid.h"
+#include "FrameTaskScheduler.h"
+#include "GridSnapshot.h"
+#include <array>
+#include <cstdint>
+
+class cISC4City;
+class cISC4ResidentialSimulator;
+class cISC4Simulator;
+
+// Combines the residential simulator's low, medium and high wealth proximity maps
+// into a single data view grid.
+// Each tract value holds the wealth level with the strongest proximity value in the
+// high byte (1 = low, 2 = medium, 3 = high) and that proximity value in the low byte,
+// or 0 when none of the wealth levels have a proximity value.
+// The maps are captured into snapshots by a frame task after the simulation has
+// advanced, and a row is only repacked when one of its snapshots changed.
+class ResidentialProximityOverlay
+{
+public:
+	static constexpr size_t ChannelCount = 3;
+
+	ResidentialProximityOverlay();
+
+	// This is called from the data view's render hook, it requests a frame task
+	// that updates the overlay and returns the grid from the last update.
+	// Returns nullptr if a city is not loaded or the overlay has not been updated.
+	cISC4SimGrid<int16_t>* GetOverlayGrid();
+
+	// Packs one row of the three proximity channels into the overlay values.
+	static void PackRow(
+		const int16_t* low,
+		const int16_t* medium,
+		const int16_t* high,
+		int16_t* output,
+		size_t count);
+
+	void PostCityInit(cISC4City* pCity);
+	void PreCityShutdown();
+
+private:
+	bool Update();
+
+	cISC4ResidentialSimulator* pResidentialSimulator;
+	cISC4Simulator* pSimulator;
+	DllSimGrid<int16_t> grid;
+	// The proximity map snapshots, one channel per wealth level.
+	std::array<GridSnapshotChannel, ChannelCount> channels;
+	// The simulation date and time of the last capture, the maps only change
+	// when the simulation runs.
+	int32_t capturedSimDate;
+	int32_t capturedSimTime;
+	FrameTaskRequest refresh;
+};
@@ -0,0 +1,451 @@
+////////////////////////////////////////////////////////////////////////
+//
+// This file is part of sc4-data-view-extensions, a DLL Plugin for
+// SimCity 4 that extends the game's data views.
+//
+// Copyright (c) 2024 Nicholas Hayes
+//
+// This file is licensed under terms of the MIT License.
+// See LICENSE.txt for more information.
+//
+////////////////////////////////////////////////////////////////////////
+
+#include "ServiceCoverageGapMap.h"
+#include "MemoryArena.h"
+#include "cISC4City.h"
+#include "cISC4PlumbingSimulator.h"
+#include "cISC4PoliceSimulator.h"
+#include "cISC4PowerSimulator.h"
+#include "cISC4ResidentialSimulator.h"
+#include "cISC4Simulator.h"
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <limits>
+#include <numeric>
+
+namespace
+{
+	// A cached value that never matches an input value, which forces the tract to be written.
+	constexpr int32_t UnknownValue = std::numeric_limits<int32_t>::min();
+
+	// The number of rows that are read or combined between the frame budget checks.
+	constexpr int32_t RowsPerStep = 8;
+
+	std::pmr::memory_resource* GetOverlayArena()
+	{
+		return MemoryArenas::Get(MemorySubsystem::Overlays);
+	}
+}
+
+ServiceCoverageGapMap::InputLayer::InputLayer(std::pmr::memory_resource* memoryResource)
+	: tractSize(0),
+	  tractCountX(0),
+	  tractCountZ(0),
+	  values(memoryResource),
+	  bitmap(0, 0, false, memoryResource)
+{
+}
+
+ServiceCoverageGapMap::ServiceCoverageGapMap()
+	: pPoliceSimulator(nullptr),
+	  pPlumbingSimulator(nullptr),
+	  pPowerSimulator(nullptr),
+	  pResidentialSimulator(nullptr),
+	  pSimulator(nullptr),
+	  layers{
+		InputLayer(GetOverlayArena()),
+		InputLayer(GetOverlayArena()),
+		InputLayer(GetOverlayArena()),
+		InputLayer(GetOverlayArena()) },
+	  grid(GetOverlayArena()),
+	  commonTractSize(0),
+	  commonTractCountX(0),
+	  commonTractCountZ(0),
+	  dirtyRows(GetOverlayArena()),
+	  rowUnservedResidents(GetOverlayArena()),
+	  unservedResidents(0),
+	  updateCompleted(false),
+	  updateInProgress(false),
+	  updateInput(Input::Police),
+	  updateRow(0),
+	  updateSimDate(0),
+	  updateSimTime(0),
+	  refresh(
+		"service coverage gap refresh",
+		FrameTaskScheduler::Priority::Normal,
+		[this](const FrameBudget& budget) { return Update(budget); })
+{
+}
+
+cISC4SimGrid<int16_t>* ServiceCoverageGapMap::GetGapGrid()
+{
+	if (!pPoliceSimulator)
+	{
+		return nullptr;
+	}
+
+	refresh.Request();
+
+	return grid.IsEmpty() ? nullptr : &grid;
+}
+
+uint32_t ServiceCoverageGapMap::GetUnservedResidents()
+{
+	if (!pPoliceSimulator)
+	{
+		return 0;
+	}
+
+	if (updateCompleted)
+	{
+		refresh.Request();
+	}
+	else
+	{
+		Update(FrameBudget::Unlimited());
+	}
+
+	return unservedResidents;
+}
+
+void ServiceCoverageGapMap::RequestUpdate()
+{
+	if (pPoliceSimulator)
+	{
+		refresh.Request();
+	}
+}
+
+void ServiceCoverageGapMap::PostCityInit(cISC4City* pCity)
+{
+	pPoliceSimulator = pCity->GetPoliceSimulator();
+	pPlumbingSimulator = pCity->GetPlumbingSimulator();
+	pPowerSimulator = pCity->GetPowerSimulator();
+	pResidentialSimulator = pCity->GetResidentialSimulator();
+	pSimulator = pCity->GetSimulator();
+}
+
+void ServiceCoverageGapMap::PreCityShutdown()
+{
+	refresh.Cancel();
+	pPoliceSimulator = nullptr;
+	pPlumbingSimulator = nullptr;
+	pPowerSimulator = nullptr;
+	pResidentialSimulator = nullptr;
+	pSimulator = nullptr;
+
+	// The containers must release their memory before the city arenas are reset.
+	for (InputLayer& layer : layers)
+	{
+		layer.tractSize = 0;
+		layer.tractCountX = 0;
+		layer.tractCountZ = 0;
+		layer.values.clear();
+		layer.values.shrink_to_fit();
+		layer.bitmap = CellBitmap(0, 0, false, GetOverlayArena());
+	}
+
+	grid.Clear();
+	commonTractSize = 0;
+	commonTractCountX = 0;
+	commonTractCountZ = 0;
+	dirtyRows.clear();
+	dirtyRows.shrink_to_fit();
+	rowUnservedResidents.clear();
+	rowUnservedResidents.shrink_to_fit();
+	unservedResidents = 0;
+	updateCompleted = false;
+	updateInProgress = false;
+	updateInput = Input::Police;
+	updateRow = 0;
+	updateSimDate = 0;
+	updateSimTime = 0;
+}
+
+bool ServiceCoverageGapMap::Update(const FrameBudget& budget)
+{
+	InputGrids grids{};
+
+	if (!GetInputGrids(grids))
+	{
+		return true;
+	}
+
+	if (!updateInProgress)
+	{
+		const int32_t simDate = pSimulator ? pSimulator->GetSimDateNumber() : 0;
+		const int32_t simTime = pSimulator ? pSimulator->GetSimTime() : 0;
+
+		if (updateCompleted && pSimulator && simDate == updateSimDate && simTime == updateSimTime)
+		{
+			return true;
+		}
+
+		updateSimDate = simDate;
+		updateSimTime = simTime;
+		updateInProgress = true;
+		updateInput = Input::Police;
+		updateRow = 0;
+	}
+
+	// The grids are read over several frames, so the layout is checked in each
+	// slice and a change starts the update over.
+	if (UpdateLayout(grids))
+	{
+		updateInput = Input::Police;
+		updateRow = 0;
+	}
+
+	while (updateInput != Input::Count)
+	{
+		if (ReadInputRows(updateInput, grids, updateRow))
+		{
+			updateInput = static_cast<Input>(static_cast<uint32_t>(updateInput) + 1);
+			updateRow = 0;
+		}
+		else
+		{
+			updateRow += RowsPerStep;
+		}
+
+		if (budget.IsExhausted())
+		{
+			return false;
+		}
+	}
+
+	while (updateRow < commonTractCountZ)
+	{
+		const int32_t lastRow = std::min(updateRow + RowsPerStep, commonTractCountZ);
+
+		for (; updateRow < lastRow; updateRow++)
+		{
+			if (dirtyRows[updateRow])
+			{
+				CombineRow(static_cast<uint32_t>(updateRow));
+				dirtyRows[updateRow] = 0;
+			}
+		}
+
+		if (updateRow < commonTractCountZ && budget.IsExhausted())
+		{
+			return false;
+		}
+	}
+
+	const double residents = std::accumulate(rowUnservedResidents.begin(), rowUnservedResidents.end(), 0.0);
+
+	unservedResidents = static_cast<uint32_t>(std::lround(residents));
+	updateCompleted = true;
+	updateInProgress = false;
+
+	return true;
+}
+
+bool ServiceCoverageGapMap::GetInputGrids(InputGrids& grids) const
+{
+	if (!pPoliceSimulator || !pPlumbingSimulator || !pPowerSimulator || !pResidentialSimulator)
+	{
+		return false;
+	}
+
+	grids.police = pPoliceSimulator->GetPolicePowerGrid();
+	grids.water = pPlumbingSimulator->GetWateredGrid();
+	grids.power = pPowerSimulator->GetPoweredGrid();
+	grids.population = nullptr;
+
+	return grids.police
+		&& grids.water
+		&& grids.power
+		&& pResidentialSimulator->GetPopulationGrids(grids.population, nullptr, nullptr)
+		&& grids.population;
+}
+
+bool ServiceCoverageGapMap::UpdateLayout(const InputGrids& grids)
+{
+	// The inputs cover the whole city, the common layout uses the finest tract size.
+	const int32_t tractSize = std::max(std::min({
+		grids.police->GetTractSize(),
+		grids.water->GetTractSize(),
+		grids.power->GetTractSize(),
+		grids.population->GetTractSize() }), 1);
+	const int32_t cellCountX = std::max(grids.police->GetTractCountX(), 0) * grids.police->GetTractSize();
+	const int32_t cellCountZ = std::max(grids.police->GetTractCountZ(), 0) * grids.police->GetTractSize();
+
+	const bool reset = tractSize != commonTractSize
+		|| (cellCountX / tractSize) != commonTractCountX
+		|| (cellCountZ / tractSize) != commonTractCountZ;
+
+	if (reset)
+	{
+		commonTractSize = tractSize;
+		commonTractCountX = cellCountX / tractSize;
+		commonTractCountZ = cellCountZ / tractSize;
+
+		grid.Resize(cellCountX, cellCountZ, tractSize);
+		dirtyRows.assign(static_cast<size_t>(commonTractCountZ), 1);
+		rowUnservedResidents.assign(static_cast<size_t>(commonTractCountZ), 0.0);
+	}
+
+	bool changed = reset;
+
+	changed |= SetLayerLayout(Input::Police, grids.police, reset);
+	changed |= SetLayerLayout(Input::Water, grids.water, reset);
+	changed |= SetLayerLayout(Input::Power, grids.power, reset);
+	changed |= SetLayerLayout(Input::Population, grids.population, reset);
+
+	return changed;
+}
+
+template<typename T>
+bool ServiceCoverageGapMap::SetLayerLayout(Input input, cISC4SimGrid<T>* inputGrid, bool reset)
+{
+	InputLayer& layer = GetLayer(input);
+
+	const int32_t tractSize = std::max(inputGrid->GetTractSize(), 1);
+	const int32_t tractCountX = std::max(inputGrid->GetTractCountX(), 0);
+	const int32_t tractCountZ = std::max(inputGrid->GetTractCountZ(), 0);
+
+	if (!reset
+		&& layer.tractSize == tractSize
+		&& layer.tractCountX == tractCountX
+		&& layer.tractCountZ == tractCountZ)
+	{
+		return false;
+	}
+
+	layer.tractSize = tractSize;
+	layer.tractCountX = tractCountX;
+	layer.tractCountZ = tractCountZ;
+	layer.values.assign(static_cast<size_t>(tractCountX) * tractCountZ, UnknownValue);
+	layer.bitmap = CellBitmap(
+		static_cast<uint32_t>(commonTractCountZ),
+		static_cast<uint32_t>(commonTractCountX),
+		false,
+		GetOverlayArena());
+
+	return true;
+}
+
+bool ServiceCoverageGapMap::ReadInputRows(Input input, const InputGrids& grids, int32_t firstRow)
+{
+	switch (input)
+	{
+	case Input::Police:
+		return ReadLayerRows(input, grids.police, firstRow);
+	case Input::Water:
+		return ReadLayerRows(input, grids.water, firstRow);
+	case Input::Power:
+		return ReadLayerRows(input, grids.power, firstRow);
+	case Input::Population:
+	default:
+		return ReadLayerRows(input, grids.population, firstRow);
+	}
+}
+
+template<typename T>
+bool ServiceCoverageGapMap::ReadLayerRows(Input input, cISC4SimGrid<T>* inputGrid, int32_t firstRow)
+{
+	InputLayer& layer = GetLayer(input);
+
+	const int32_t lastRow = std::min(firstRow + RowsPerStep, layer.tractCountZ);
+
+	// Each input tract covers a square block of common tracts, the tract sizes are powers of two.
+	const int32_t scale = std::max(layer.tractSize / commonTractSize, 1);
+
+	int32_t* cachedValue = layer.values.data() + (static_cast<size_t>(firstRow) * layer.tractCountX);
+
+	for (int32_t z = firstRow; z < lastRow; z++)
+	{
+		bool rowChanged = false;
+
+		for (int32_t x = 0; x < layer.tractCountX; x++)
+		{
+			const int32_t value = static_cast<int32_t>(inputGrid->GetTractValue(x, z));
+
+			if (*cachedValue != value)
+			{
+				*cachedValue = value;
+				rowChanged = true;
+
+				layer.bitmap.SetRect(
+					z * scale,
+					x * scale,
+					(z * scale) + scale - 1,
+					(x * scale) + scale - 1,
+					value > 0);
+			}
+
+			cachedValue++;
+		}
+
+		if (rowChanged)
+		{
+			const int32_t lastCommonRow = std::min((z + 1) * scale, commonTractCountZ);
+
+			for (int32_t row = z * scale; row < lastCommonRow; row++)
+			{
+				dirtyRows[row] = 1;
+			}
+		}
+	}
+
+	return lastRow >= layer.tractCountZ;
+}
+
+void ServiceCoverageGapMap::CombineRow(uint32_t row)
+{
+	const InputLayer& population = GetLayer(Input::Population);
+	const uint32_t* populated = population.bitmap.GetRowData(row);
+	const uint32_t* police = GetLayer(Input::Police).bitmap.GetRowData(row);
+	const uint32_t* water = GetLayer(Input::Water).bitmap.GetRowData(row);
+	const uint32_t* power = GetLayer(Input::Power).bitmap.GetRowData(row);
+	const uint32_t wordsPerRow = population.bitmap.GetWordsPerRow();
+
+	const uint32_t width = static_cast<uint32_t>(commonTractCountX);
+	int16_t* values = grid.GetValues() + (static_cast<size_t>(row) * width);
+
+	std::fill_n(values, width, static_cast<int16_t>(0));
+
+	const int32_t populationScale = std::max(population.tractSize / commonTractSize, 1);
+	const double tractsPerPopulationTract = static_cast<double>(populationScale) * populationScale;
+	const int32_t* populationRow = population.values.data()
+		+ (static_cast<size_t>(row / populationScale) * population.tractCountX);
+
+	double residents = 0.0;
+
+	for (uint32_t wordIndex = 0; wordIndex < wordsPerRow; wordIndex++)
+	{
+		// missing = populated & ~covered, the padding bits are zero in every bitmap.
+		const uint32_t noPolice = populated[wordIndex] & ~police[wordIndex];
+		const uint32_t noWater = populated[wordIndex] & ~water[wordIndex];
+		const uint32_t noPower = populated[wordIndex] & ~power[wordIndex];
+
+		uint32_t missing = noPolice | noWater | noPower;
+
+		while (missing != 0)
+		{
+			const uint32_t bit = static_cast<uint32_t>(std::countr_zero(missing));
+			const uint32_t mask = 1U << bit;
+			const uint32_t column = (wordIndex * 32) + bit;
+
+			values[column] = static_cast<int16_t>(
+				((noPolice & mask) ? NoPolice : 0)
+				| ((noWater & mask) ? NoWater : 0)
+				| ((noPower & mask) ? NoPower : 0));
+
+			residents += populationRow[column / populationScale] / tractsPerPopulationTract;
+
+			// Clear the lowest set bit.
+			missing &= missing - 1;
+		}
+	}
+
+	rowUnservedResidents[row] = residents;
+}
+
+ServiceCoverageGapMap::InputLayer& ServiceCoverageGapMap::GetLayer(Input input)
+{
+	return layers[static_cast<size_t>(input)];
+}
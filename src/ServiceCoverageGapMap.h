@@ -0,0 +1,137 @@
+////////////////////////////////////////////////////////////////////////
+//
+// This file is part of sc4-data-view-extensions, a DLL Plugin for
+// SimCity 4 that extends the game's data views.
+//
+// Copyright (c) 2024 Nicholas Hayes
+//
+// This file is licensed under terms of the MIT License.
+// See LICENSE.txt for more information.
+//
+////////////////////////////////////////////////////////////////////////
+
+#pragma once
+#include "CellBitmap.h"
+#include "DllSimGrid.h"
+#include "FrameTaskScheduler.h"
+#include <array>
+#include <cstdint>
+#include <memory_resource>
+#include <vector>
+
+class cISC4City;
+class cISC4PlumbingSimulator;
+class cISC4PoliceSimulator;
+class cISC4PowerSimulator;
+class cISC4ResidentialSimulator;
+class cISC4Simulator;
+
+// Finds the populated tracts that lack police, water or power coverage.
+// The input grids are converted to bitmaps with a common tract layout, the
+// finest tract size of the inputs.
+// The update runs incrementally in a frame task after the simulation has advanced:
+// the input rows are read in steps within the frame budget, only the tracts whose
+// values changed are rewritten, and only the common rows that contain a changed
+// tract are combined again, one bitmap word at a time.
+class ServiceCoverageGapMap
+{
+public:
+	// The data view grid value is a combination of these flags for the populated
+	// tracts, and 0 for the tracts that are unpopulated or have every service.
+	static constexpr int16_t NoPolice = 1 << 0;
+	static constexpr int16_t NoWater = 1 << 1;
+	static constexpr int16_t NoPower = 1 << 2;
+
+	ServiceCoverageGapMap();
+
+	// This is called from the data view's render hook, it requests a frame task
+	// that updates the map and returns the grid from the last update.
+	// Returns nullptr if a city is not loaded or the map has not been updated.
+	cISC4SimGrid<int16_t>* GetGapGrid();
+
+	// Gets the estimated number of residents that lack at least one service,
+	// from the last update. The residents of a population tract are divided
+	// evenly between its common tracts.
+	// The first call after a city is loaded completes an update, later calls
+	// request a frame task.
+	uint32_t GetUnservedResidents();
+
+	// Requests a frame task that updates the map.
+	void RequestUpdate();
+
+	void PostCityInit(cISC4City* pCity);
+	void PreCityShutdown();
+
+private:
+	enum class Input : uint32_t
+	{
+		Police = 0,
+		Water,
+		Power,
+		Population,
+		Count
+	};
+
+	struct InputGrids
+	{
+		cISC4SimGrid<short>* police;
+		cISC4SimGrid<uint8_t>* water;
+		cISC4SimGrid<uint8_t>* power;
+		cISC4SimGrid<uint16_t>* population;
+	};
+
+	struct InputLayer
+	{
+		InputLayer(std::pmr::memory_resource* memoryResource);
+
+		int32_t tractSize;
+		int32_t tractCountX;
+		int32_t tractCountZ;
+		// The tract values in the input grid's own layout.
+		std::pmr::vector<int32_t> values;
+		// The tracts with a value above 0 in the common layout.
+		CellBitmap bitmap;
+	};
+
+	// Returns true when the update is complete.
+	bool Update(const FrameBudget& budget);
+	bool GetInputGrids(InputGrids& grids) const;
+	// Returns true if the layout changed.
+	bool UpdateLayout(const InputGrids& grids);
+	template<typename T>
+	bool SetLayerLayout(Input input, cISC4SimGrid<T>* inputGrid, bool reset);
+	// Returns true when the last row of the input was read.
+	bool ReadInputRows(Input input, const InputGrids& grids, int32_t firstRow);
+	template<typename T>
+	bool ReadLayerRows(Input input, cISC4SimGrid<T>* inputGrid, int32_t firstRow);
+	void CombineRow(uint32_t row);
+
+	InputLayer& GetLayer(Input input);
+
+	cISC4PoliceSimulator* pPoliceSimulator;
+	cISC4PlumbingSimulator* pPlumbingSimulator;
+	cISC4PowerSimulator* pPowerSimulator;
+	cISC4ResidentialSimulator* pResidentialSimulator;
+	cISC4Simulator* pSimulator;
+	std::array<InputLayer, static_cast<size_t>(Input::Count)> layers;
+	DllSimGrid<int16_t> grid;
+	int32_t commonTractSize;
+	int32_t commonTractCountX;
+	int32_t commonTractCountZ;
+	// 1 for each common row that must be combined again.
+	std::pmr::vector<uint8_t> dirtyRows;
+	// The unserved residents of each common row.
+	std::pmr::vector<double> rowUnservedResidents;
+	uint32_t unservedResidents;
+	bool updateCompleted;
+	// The position of the update that is in progress. The combine step
+	// starts when all of the inputs have been read.
+	bool updateInProgress;
+	Input updateInput;
+	int32_t updateRow;
+	// The simulation date and time when the last update started, the input
+	// grids only change when the simulation runs.
+	int32_t updateSimDate;
+	int32_t updateSimTime;
+	FrameTaskRequest refresh;
+};
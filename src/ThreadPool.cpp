@@ -0,0 +1,243 @@
+////////////////////////////////////////////////////////////////////////
+//
+// This file is part of sc4-data-view-extensions, a DLL Plugin for
+// SimCity 4 that extends the game's data views.
+//
+// Copyright (c) 2024 Nicholas Hayes
+//
+// This file is licensed under terms of the MIT License.
+// See LICENSE.txt for more information.
+//
+////////////////////////////////////////////////////////////////////////
+
+#include "ThreadPool.h"
+#include <algorithm>
+
+namespace
+{
+	// The index of the current thread's queue, or -1 if the thread is not a pool worker.
+	thread_local int32_t currentWorkerIndex = -1;
+
+	struct ParallelForState
+	{
+		std::atomic<uint32_t> nextItem;
+		std::atomic<uint32_t> completedItems;
+		uint32_t count;
+		const std::function<void(uint32_t)>* func;
+
+		ParallelForState(uint32_t count, const std::function<void(uint32_t)>* func)
+			: nextItem(0), completedItems(0), count(count), func(func)
+		{
+		}
+
+		void RunItems()
+		{
+			uint32_t item = nextItem.fetch_add(1, std::memory_order_relaxed);
+
+			while (item < count)
+			{
+				(*func)(item);
+
+				if (completedItems.fetch_add(1, std::memory_order_acq_rel) + 1 == count)
+				{
+					completedItems.notify_all();
+				}
+
+				item = nextItem.fetch_add(1, std::memory_order_relaxed);
+			}
+		}
+	};
+}
+
+ThreadPool::ThreadPool()
+	: pendingTaskCount(0),
+	  nextQueue(0),
+	  stopping(false)
+{
+}
+
+ThreadPool::~ThreadPool()
+{
+	Stop();
+}
+
+void ThreadPool::Start(uint32_t workerCount)
+{
+	Stop();
+
+	stopping = false;
+
+	for (uint32_t i = 0; i < workerCount; i++)
+	{
+		queues.push_back(std::make_unique<WorkerQueue>());
+	}
+
+	for (uint32_t i = 0; i < workerCount; i++)
+	{
+		workers.emplace_back(&ThreadPool::WorkerMain, this, i);
+	}
+}
+
+void ThreadPool::Stop()
+{
+	{
+		std::lock_guard<std::mutex> lock(wakeMutex);
+		stopping = true;
+	}
+	wakeCondition.notify_all();
+
+	for (std::thread& worker : workers)
+	{
+		worker.join();
+	}
+
+	workers.clear();
+	queues.clear();
+	pendingTaskCount = 0;
+}
+
+uint32_t ThreadPool::GetWorkerCount() const
+{
+	return static_cast<uint32_t>(workers.size());
+}
+
+void ThreadPool::Submit(std::function<void()> task)
+{
+	if (queues.empty())
+	{
+		task();
+		return;
+	}
+
+	// A worker adds the tasks it creates to its own queue, other threads
+	// distribute their tasks over all of the queues.
+	const uint32_t queueIndex = currentWorkerIndex >= 0
+		? static_cast<uint32_t>(currentWorkerIndex)
+		: nextQueue.fetch_add(1, std::memory_order_relaxed) % static_cast<uint32_t>(queues.size());
+
+	WorkerQueue& queue = *queues[queueIndex];
+
+	{
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		queue.tasks.push_back(std::move(task));
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(wakeMutex);
+		pendingTaskCount.fetch_add(1, std::memory_order_release);
+	}
+	wakeCondition.notify_one();
+}
+
+void ThreadPool::ParallelFor(uint32_t count, const std::function<void(uint32_t)>& func)
+{
+	if (workers.empty() || count <= 1)
+	{
+		for (uint32_t i = 0; i < count; i++)
+		{
+			func(i);
+		}
+
+		return;
+	}
+
+	// The state is shared with the helper tasks because a helper may start after
+	// this call has returned, it will find no remaining items and exit.
+	auto state = std::make_shared<ParallelForState>(count, &func);
+
+	const uint32_t helperCount = std::min(GetWorkerCount(), count - 1);
+
+	for (uint32_t i = 0; i < helperCount; i++)
+	{
+		Submit([state]() { state->RunItems(); });
+	}
+
+	state->RunItems();
+
+	// The calling thread only runs items from this loop, it does not pick up other
+	// queued tasks. When RunItems returns every item has been claimed by a thread
+	// that is running it, so the wait can not deadlock a nested call on a worker.
+	uint32_t completed = state->completedItems.load(std::memory_order_acquire);
+
+	while (completed < count)
+	{
+		state->completedItems.wait(completed, std::memory_order_acquire);
+		completed = state->completedItems.load(std::memory_order_acquire);
+	}
+}
+
+uint32_t ThreadPool::GetSpareProcessorCount(uint32_t processorCount)
+{
+	return processorCount > 1 ? processorCount - 1 : 0;
+}
+
+void ThreadPool::WorkerMain(uint32_t index)
+{
+	currentWorkerIndex = static_cast<int32_t>(index);
+
+	while (true)
+	{
+		if (TryRunTask(index))
+		{
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock(wakeMutex);
+		wakeCondition.wait(
+			lock,
+			[this]() { return stopping || pendingTaskCount.load(std::memory_order_acquire) > 0; });
+
+		if (stopping)
+		{
+			break;
+		}
+	}
+
+	currentWorkerIndex = -1;
+}
+
+bool ThreadPool::TryRunTask(uint32_t preferredQueue)
+{
+	const uint32_t queueCount = static_cast<uint32_t>(queues.size());
+
+	if (queueCount == 0)
+	{
+		return false;
+	}
+
+	std::function<void()> task;
+
+	for (uint32_t i = 0; i < queueCount && !task; i++)
+	{
+		const uint32_t queueIndex = (preferredQueue + i) % queueCount;
+		WorkerQueue& queue = *queues[queueIndex];
+
+		std::lock_guard<std::mutex> lock(queue.mutex);
+
+		if (!queue.tasks.empty())
+		{
+			if (i == 0)
+			{
+				// The newest task in the thread's own queue is likely to use
+				// data that is still in the processor cache.
+				task = std::move(queue.tasks.back());
+				queue.tasks.pop_back();
+			}
+			else
+			{
+				task = std::move(queue.tasks.front());
+				queue.tasks.pop_front();
+			}
+		}
+	}
+
+	if (!task)
+	{
+		return false;
+	}
+
+	pendingTaskCount.fetch_sub(1, std::memory_order_acq_rel);
+	task();
+
+	return true;
+}
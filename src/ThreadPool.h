@@ -0,0 +1,71 @@
+////////////////////////////////////////////////////////////////////////
+//
+// This file is part of sc4-data-view-extensions, a DLL Plugin for
+// SimCity 4 that extends the game's data views.
+//
+// Copyright (c) 2024 Nicholas Hayes
+//
+// This file is licensed under terms of the MIT License.
+// See LICENSE.txt for more information.
+//
+////////////////////////////////////////////////////////////////////////
+
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// A work-stealing thread pool for the DLL's grid processing.
+// Each worker has its own task queue, a worker takes the newest task from
+// its own queue and steals the oldest task from the other queues when its
+// queue is empty.
+class ThreadPool
+{
+public:
+	ThreadPool();
+	~ThreadPool();
+
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	// A worker count of 0 runs all the work on the calling thread.
+	void Start(uint32_t workerCount);
+	void Stop();
+
+	uint32_t GetWorkerCount() const;
+
+	void Submit(std::function<void()> task);
+
+	// Calls func(i) for each i in [0, count) and returns when all of the calls
+	// have finished. The calling thread runs a share of the items and then
+	// waits for the items that the workers are running.
+	void ParallelFor(uint32_t count, const std::function<void(uint32_t)>& func);
+
+	// Gets the number of workers for a machine with the specified number of
+	// processors, one processor is left for the game's main thread.
+	static uint32_t GetSpareProcessorCount(uint32_t processorCount);
+
+private:
+	struct WorkerQueue
+	{
+		std::mutex mutex;
+		std::deque<std::function<void()>> tasks;
+	};
+
+	void WorkerMain(uint32_t index);
+	bool TryRunTask(uint32_t preferredQueue);
+
+	std::vector<std::unique_ptr<WorkerQueue>> queues;
+	std::vector<std::thread> workers;
+	std::mutex wakeMutex;
+	std::condition_variable wakeCondition;
+	std::atomic<uint32_t> pendingTaskCount;
+	std::atomic<uint32_t> nextQueue;
+	std::atomic<bool> stopping;
+};
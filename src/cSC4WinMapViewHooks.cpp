@@ -11,14 +11,20 @@
 ////////////////////////////////////////////////////////////////////////
 
 #include "cSC4WinMapViewHooks.h"
+#include "AuraRegionManager.h"
 #include "cGZMessage.h"
 #include "cIGZWin.h"
 #include "cISC4AuraSimulator.h"
 #include "cRZAutoRefCount.h"
+#include "CoverageManager.h"
 #include "DebugUtil.h"
 #include "GlobalPointers.h"
+#include "GridPyramidService.h"
+#include "ResidentialProximityOverlay.h"
+#include "ServiceCoverageGapMap.h"
 #include "DataViewHighlightManager.h"
 #include "Patcher.h"
+#include <algorithm>
 #include <array>
 
 namespace
@@ -40,6 +46,11 @@ namespace
 	static const uint32_t DataViewType_LandmarkAura = 13;
 	static const uint32_t DataViewType_TransientAura = 14;
 	static const uint32_t DataViewType_TrafficVolume = 76;
+	static const uint32_t DataViewType_ParkCoverage = 77;
+	static const uint32_t DataViewType_LandmarkCoverage = 78;
+	static const uint32_t DataViewType_AuraRegions = 79;
+	static const uint32_t DataViewType_ResidentialProximity = 80;
+	static const uint32_t DataViewType_ServiceCoverageGap = 81;
 
 	static const uint32_t MoistureButtonID1 = 0x5012;
 	static const uint32_t MoistureButtonID2 = 0x5112;
@@ -48,17 +59,136 @@ namespace
 	static const uint32_t LandmarkAuraButtonID1 = 0x5014;
 	static const uint32_t LandmarkAuraButtonID2 = 0x5114;
 
-	static constexpr std::array<uint32_t, 6> NewNotificationTargets =
+	struct CustomDataViewButton
 	{
-		MoistureButtonID1, MoistureButtonID2, ParkAuraButtonID1,
-		ParkAuraButtonID2, LandmarkAuraButtonID1, LandmarkAuraButtonID2,
+		uint32_t buttonID;
+		uint32_t alternateButtonID;
+		uint32_t dataViewType;
 	};
 
-	DataViewHighlightManager occupantHighlightManager;
+	static constexpr std::array<CustomDataViewButton, 3> CustomDataViewButtons =
+	{{
+		{ MoistureButtonID1, MoistureButtonID2, DataViewType_Moisture },
+		{ ParkAuraButtonID1, ParkAuraButtonID2, DataViewType_ParkAura },
+		{ LandmarkAuraButtonID1, LandmarkAuraButtonID2, DataViewType_LandmarkAura },
+	}};
+
+	// The data view radio buttons use the IDs 0x5000 - 0x51FF, the second set of
+	// IDs belongs to the buttons in the alternate (expanded) data view panel.
+	static constexpr uint32_t DataViewButtonIDBase = 0x5000;
+	static constexpr size_t DataViewButtonIDCount = 0x200;
+
+	// The game's own highest data view radio button index.
+	static constexpr uint32_t OriginalMaxRadioButtonIndex = 0x11;
+
+	// Maps a button ID (relative to DataViewButtonIDBase) to a one-based index into
+	// CustomDataViewButtons, 0 marks a button that is not one of ours.
+	typedef std::array<uint8_t, DataViewButtonIDCount> ButtonDispatchTable;
+
+	static constexpr bool IsDataViewButtonID(uint32_t buttonID)
+	{
+		return buttonID >= DataViewButtonIDBase && (buttonID - DataViewButtonIDBase) < DataViewButtonIDCount;
+	}
+
+	static constexpr ButtonDispatchTable BuildButtonDispatchTable()
+	{
+		ButtonDispatchTable table{};
+
+		for (size_t i = 0; i < CustomDataViewButtons.size(); i++)
+		{
+			const CustomDataViewButton& button = CustomDataViewButtons[i];
+			const uint8_t value = static_cast<uint8_t>(i + 1);
+
+			table[button.buttonID - DataViewButtonIDBase] = value;
+			table[button.alternateButtonID - DataViewButtonIDBase] = value;
+		}
+
+		return table;
+	}
+
+	static constexpr bool ValidateCustomDataViewButtons()
+	{
+		ButtonDispatchTable seen{};
+
+		for (const CustomDataViewButton& button : CustomDataViewButtons)
+		{
+			if (!IsDataViewButtonID(button.buttonID) || !IsDataViewButtonID(button.alternateButtonID))
+			{
+				return false;
+			}
+
+			const uint32_t ids[2] = { button.buttonID - DataViewButtonIDBase, button.alternateButtonID - DataViewButtonIDBase };
+
+			for (const uint32_t id : ids)
+			{
+				if (seen[id] != 0)
+				{
+					return false;
+				}
+				seen[id] = 1;
+			}
+		}
+
+		return true;
+	}
+
+	static constexpr uint32_t GetMaxRadioButtonIndex()
+	{
+		uint32_t maxIndex = OriginalMaxRadioButtonIndex;
+
+		for (const CustomDataViewButton& button : CustomDataViewButtons)
+		{
+			const uint32_t index = (button.buttonID - DataViewButtonIDBase) & 0xFF;
+
+			if (index > maxIndex)
+			{
+				maxIndex = index;
+			}
+		}
+
+		return maxIndex;
+	}
+
+	static_assert(CustomDataViewButtons.size() < 0xFF, "The dispatch table uses one-based uint8_t indices.");
+	static_assert(ValidateCustomDataViewButtons(), "The custom data view button IDs must be unique and in the data view button range.");
+
+	static constexpr ButtonDispatchTable CustomButtonDispatchTable = BuildButtonDispatchTable();
+	static constexpr uint32_t MaxRadioButtonIndex = GetMaxRadioButtonIndex();
+
+	const CustomDataViewButton* FindCustomDataViewButton(uint32_t buttonID)
+	{
+		const CustomDataViewButton* button = nullptr;
+
+		if (IsDataViewButtonID(buttonID))
+		{
+			const uint8_t value = CustomButtonDispatchTable[buttonID - DataViewButtonIDBase];
+
+			if (value != 0)
+			{
+				button = &CustomDataViewButtons[value - 1];
+			}
+		}
+
+		return button;
+	}
 
 	static const uintptr_t DoMessage_HandledRadioButton_Continue = 0x7A592B;
 	static const uintptr_t DoMessage_UnhandledRadioButton_Continue = 0x7A571B;
 
+	bool DispatchCustomRadioButton(void* pMapView, uint32_t buttonID)
+	{
+		const CustomDataViewButton* button = FindCustomDataViewButton(buttonID);
+
+		if (button)
+		{
+			// The game always selects the view using the first button ID.
+			OnViewModeButtonSelected(pMapView, button->buttonID, button->dataViewType);
+			return true;
+		}
+
+		return false;
+	}
+
 	void NAKED_FUN DoMessageHook()
 	{
 		__asm
@@ -66,56 +196,28 @@ namespace
 			push eax
 			push ecx
 			push edx
-			cmp eax, MoistureButtonID1
-			jz moistureRadioButtonClick
-			cmp eax, MoistureButtonID2
-			jz moistureRadioButtonClick
-			cmp eax, ParkAuraButtonID1
-			jz parkRadioButtonClick
-			cmp eax, ParkAuraButtonID2
-			jz parkRadioButtonClick
-			cmp eax, LandmarkAuraButtonID1
-			jz landmarkRadioButtonClick
-			cmp eax, LandmarkAuraButtonID2
-			jz landmarkRadioButtonClick
+			lea ecx, [esi + -8]
+			push eax // button id
+			push ecx // map view
+			call DispatchCustomRadioButton // (cdecl)
+			add esp, 8
+			test al, al
 			pop edx
 			pop ecx
 			pop eax
+			jnz radioButtonHandled
 			cmp eax, 0x5101
 			jmp DoMessage_UnhandledRadioButton_Continue
 
-			moistureRadioButtonClick:
-			push DataViewType_Moisture
-			push MoistureButtonID1
-			lea ecx, [esi + -8]
-			call OnViewModeButtonSelected // (thiscall)
-			pop edx
-			pop ecx
-			pop eax
-			jmp DoMessage_HandledRadioButton_Continue
-
-			parkRadioButtonClick:
-			push DataViewType_ParkAura
-			push ParkAuraButtonID1
-			lea ecx, [esi + -8]
-			call OnViewModeButtonSelected // (thiscall)
-			pop edx
-			pop ecx
-			pop eax
-			jmp DoMessage_HandledRadioButton_Continue
-
-			landmarkRadioButtonClick:
-			push DataViewType_LandmarkAura
-			push LandmarkAuraButtonID1
-			lea ecx, [esi + -8]
-			call OnViewModeButtonSelected // (thiscall)
-			pop edx
-			pop ecx
-			pop eax
+			radioButtonHandled:
 			jmp DoMessage_HandledRadioButton_Continue
 		}
 	}
 
+	// The size of the map view window, the data view covers the whole city in this area.
+	uint32_t mapViewWidth = 0;
+	uint32_t mapViewHeight = 0;
+
 	static const uintptr_t Update_DataTypeSwitch_CaseDefault_Continue = 0x7A4375;
 	static const uintptr_t Update_DataTypeSwitch_Continue = 0x7A30B3;
 	static const uintptr_t Update_Sint8Grid_Continue = 0x7A3240;
@@ -140,12 +242,44 @@ namespace
 
 		if (spAura)
 		{
-			landmarkMap = spAura->GetLandmarkMap();
+			// A landmark map with more tracts than the map view has pixels is drawn
+			// from a smaller level of its pyramid.
+			landmarkMap = spGridPyramidService->GetOverviewGrid(SnapshotGrid::LandmarkMap, mapViewWidth, mapViewHeight);
+
+			if (!landmarkMap)
+			{
+				landmarkMap = spAura->GetLandmarkMap();
+			}
 		}
 
 		return landmarkMap;
 	}
 
+	cISC4SimGrid<int16_t>* GetParkCoverageGrid()
+	{
+		return spCoverageManager->GetParkCoverageGrid();
+	}
+
+	cISC4SimGrid<int16_t>* GetLandmarkCoverageGrid()
+	{
+		return spCoverageManager->GetLandmarkCoverageGrid();
+	}
+
+	cISC4SimGrid<int16_t>* GetAuraRegionGrid()
+	{
+		return spAuraRegionManager->GetAuraRegionGrid();
+	}
+
+	cISC4SimGrid<int16_t>* GetResidentialProximityGrid()
+	{
+		return spResidentialProximityOverlay->GetOverlayGrid();
+	}
+
+	cISC4SimGrid<int16_t>* GetServiceCoverageGapGrid()
+	{
+		return spServiceCoverageGapMap->GetGapGrid();
+	}
+
 	void NAKED_FUN UpdateHook()
 	{
 		__asm
@@ -154,6 +288,16 @@ namespace
 			jz updateLandmarkDataView
 			cmp eax, DataViewType_TransientAura
 			jz updateTransientAuraDataView
+			cmp eax, DataViewType_ParkCoverage
+			jz updateParkCoverageDataView
+			cmp eax, DataViewType_LandmarkCoverage
+			jz updateLandmarkCoverageDataView
+			cmp eax, DataViewType_AuraRegions
+			jz updateAuraRegionsDataView
+			cmp eax, DataViewType_ResidentialProximity
+			jz updateResidentialProximityDataView
+			cmp eax, DataViewType_ServiceCoverageGap
+			jz updateServiceCoverageGapDataView
 			cmp eax, DataViewType_TrafficVolume
 			ja dataTypeDefaultSwitchCase
 			jmp Update_DataTypeSwitch_Continue
@@ -173,26 +317,82 @@ namespace
 			jz nullPointer
 			jmp Update_Sint8Grid_Continue
 
+			updateParkCoverageDataView:
+			call GetParkCoverageGrid // (cdecl)
+			test eax, eax
+			jz nullPointer
+			jmp Update_Sint16Grid_Continue
+
+			updateLandmarkCoverageDataView:
+			call GetLandmarkCoverageGrid // (cdecl)
+			test eax, eax
+			jz nullPointer
+			jmp Update_Sint16Grid_Continue
+
+			updateAuraRegionsDataView:
+			call GetAuraRegionGrid // (cdecl)
+			test eax, eax
+			jz nullPointer
+			jmp Update_Sint16Grid_Continue
+
+			updateResidentialProximityDataView:
+			call GetResidentialProximityGrid // (cdecl)
+			test eax, eax
+			jz nullPointer
+			jmp Update_Sint16Grid_Continue
+
+			updateServiceCoverageGapDataView:
+			call GetServiceCoverageGapGrid // (cdecl)
+			test eax, eax
+			jz nullPointer
+			jmp Update_Sint16Grid_Continue
+
 			nullPointer:
 			jmp Update_NullPointer_Continue
 		}
 	}
 
+	struct RadioButtonNotificationContext
+	{
+		cIGZWin* pTargetWin;
+		size_t remaining;
+	};
+
+	bool RegisterCustomRadioButtonNotificationsCallback(cIGZWin* pWin, uint32_t riid, void* pObj, void* pContext)
+	{
+		RadioButtonNotificationContext* context = static_cast<RadioButtonNotificationContext*>(pContext);
+
+		if (pWin)
+		{
+			if (FindCustomDataViewButton(pWin->GetID()))
+			{
+				pWin->SetNotificationTarget(context->pTargetWin);
+				context->remaining--;
+			}
+
+			if (context->remaining > 0 && pWin->GetChildCount() > 0)
+			{
+				pWin->EnumChildren(GZIID_cIGZWin, &RegisterCustomRadioButtonNotificationsCallback, pContext);
+			}
+		}
+
+		// Stop the traversal once all of the buttons have been found.
+		return context->remaining > 0;
+	}
+
 	void RegisterCustomRadioButtonNotifications(cIGZWin* parent, cIGZUnknown* mapView)
 	{
 		cRZAutoRefCount<cIGZWin> pTargetWin;
 
 		if (mapView->QueryInterface(GZIID_cIGZWin, pTargetWin.AsPPVoid()))
 		{
-			for (const uint32_t& buttonID : NewNotificationTargets)
-			{
-				cIGZWin* child = parent->GetChildWindowFromIDRecursive(buttonID);
+			mapViewWidth = static_cast<uint32_t>(std::max(pTargetWin->GetW(), 0));
+			mapViewHeight = static_cast<uint32_t>(std::max(pTargetWin->GetH(), 0));
 
-				if (child)
-				{
-					child->SetNotificationTarget(pTargetWin);
-				}
-			}
+			// Walk the window tree once instead of searching it for every button ID.
+			RadioButtonNotificationContext context{ pTargetWin, CustomDataViewButtons.size() * 2 };
+
+			parent->EnumChildren(GZIID_cIGZWin, &RegisterCustomRadioButtonNotificationsCallback, &context);
 		}
 	}
 
@@ -211,26 +411,33 @@ namespace
 		}
 	}
 
-	void __fastcall InitHighlightManager(uint32_t highlightType, void* edxUnused)
+	void __fastcall InitHighlightManager(uint32_t highlightType, void* pMapView)
 	{
-		occupantHighlightManager.Init(highlightType);
+		// The occupant scan runs in a frame task, the game's highlights are
+		// refreshed again when it completes.
+		spDataViewHighlightManager->Init(highlightType, [pMapView]() { UpdateHighlights(pMapView); });
 	}
 
 	void ShutdownHighlightManager()
 	{
-		occupantHighlightManager.Shutdown();
+		spDataViewHighlightManager->Shutdown();
 	}
 
 	void __fastcall RefreshHighlightedOccupants(void* pThis, void* edxUnused)
 	{
-		const std::vector<cISC4Occupant*>& affectedOccupants = occupantHighlightManager.GetAffectedOccupants();
+		const std::pmr::vector<HighlightedOccupant>& affectedOccupants = spDataViewHighlightManager->GetAffectedOccupants();
 
-		for (cISC4Occupant* pOccupant : affectedOccupants)
+		for (const HighlightedOccupant& item : affectedOccupants)
 		{
-			AddNewHighlight(pThis, pOccupant, 0.0f);
+			AddNewHighlight(pThis, item.pOccupant, item.radius);
 		}
 	}
 
+	bool IsCustomHighlightType(uint32_t highlightType)
+	{
+		return DataViewHighlightManager::IsHighlightTypeSupported(highlightType);
+	}
+
 	static const uintptr_t HighlightOccupant_Switch_Continue = 0x7A1A6E;
 	static const uintptr_t HighlightOccupant_SwitchCaseDefault_Continue = 0x7A1FD2;
 
@@ -239,10 +446,17 @@ namespace
 		_asm
 		{
 			mov eax, [edi + 0x980]
-			cmp eax, DataViewHighlightParkEffect
-			jz refreshCustomHighlightedOccupants
-			cmp eax, DataViewHighlightLandmarkEffect
-			jz refreshCustomHighlightedOccupants
+			push eax // Preserve the highlight type for the game's switch statement.
+			push ecx
+			push edx
+			push eax
+			call IsCustomHighlightType // (cdecl)
+			add esp, 4
+			pop edx
+			pop ecx
+			test al, al
+			pop eax
+			jnz refreshCustomHighlightedOccupants
 			jmp HighlightOccupant_Switch_Continue
 
 			refreshCustomHighlightedOccupants:
@@ -260,6 +474,7 @@ namespace
 		__asm
 		{
 			mov ecx, dword ptr[edi + 0x980] // highlight type
+			mov edx, edi // map view
 			call InitHighlightManager // (fastcall)
 			mov ecx, edi
 			call UpdateHighlights
@@ -287,8 +502,8 @@ namespace
 
 	void InstallMaxRadioButtonIDPatch()
 	{
-		// Change the original value 0x11 to 0x14
-		Patcher::OverwriteMemoryUint32(0x7A0F3D, 0x14);
+		// Raise the original value of 0x11 to the highest button index that we handle.
+		Patcher::OverwriteMemoryUint32(0x7A0F3D, MaxRadioButtonIndex);
 	}
 
 	void InstallSetDataViewHooks()
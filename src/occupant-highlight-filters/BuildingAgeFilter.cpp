@@ -0,0 +1,48 @@
+////////////////////////////////////////////////////////////////////////
+//
+// This file is part of sc4-data-view-extensions, a DLL Plugin for
+// SimCity 4 that extends the game's data views.
+//
+// Copyright (c) 2024 Nicholas Hayes
+//
+// This file is licensed under terms of the MIT License.
+// See LICENSE.txt for more information.
+//
+////////////////////////////////////////////////////////////////////////
+
+#include "BuildingAgeFilter.h"
+#include "BuildingAttributeIndex.h"
+#include "cISC4Occupant.h"
+#include "OccupantTypes.h"
+
+BuildingAgeFilter::BuildingAgeFilter(int32_t latestConstructionDate)
+	: latestConstructionDate(latestConstructionDate)
+{
+}
+
+void BuildingAgeFilter::SetLatestConstructionDate(int32_t date)
+{
+	latestConstructionDate = date;
+}
+
+bool BuildingAgeFilter::IsOccupantIncluded(cISC4Occupant* pOccupant)
+{
+	bool result = false;
+
+	if (pOccupant)
+	{
+		if (pOccupant->GetType() == kOccupantTypeBuilding)
+		{
+			cISC4BuildingOccupant::PurposeType purpose{};
+			cISC4BuildingOccupant::WealthType wealth{};
+			int32_t constructionDate = 0;
+
+			if (BuildingAttributeIndex::GetBuildingAttributes(pOccupant, purpose, wealth, constructionDate))
+			{
+				result = constructionDate <= latestConstructionDate;
+			}
+		}
+	}
+
+	return result;
+}
@@ -0,0 +1,28 @@
+////////////////////////////////////////////////////////////////////////
+//
+// This file is part of sc4-data-view-extensions, a DLL Plugin for
+// SimCity 4 that extends the game's data views.
+//
+// Copyright (c) 2024 Nicholas Hayes
+//
+// This file is licensed under terms of the MIT License.
+// See LICENSE.txt for more information.
+//
+////////////////////////////////////////////////////////////////////////
+
+#pragma once
+#include "cSC4BaseOccupantFilter.h"
+
+class BuildingAgeFilter : public cSC4BaseOccupantFilter
+{
+public:
+	BuildingAgeFilter(int32_t latestConstructionDate);
+
+	// Lets the highlight manager advance the date without creating a new filter.
+	void SetLatestConstructionDate(int32_t date);
+
+	bool IsOccupantIncluded(cISC4Occupant* pOccupant) override;
+
+private:
+	int32_t latestConstructionDate;
+};
@@ -0,0 +1,44 @@
+////////////////////////////////////////////////////////////////////////
+//
+// This file is part of sc4-data-view-extensions, a DLL Plugin for
+// SimCity 4 that extends the game's data views.
+//
+// Copyright (c) 2024 Nicholas Hayes
+//
+// This file is licensed under terms of the MIT License.
+// See LICENSE.txt for more information.
+//
+////////////////////////////////////////////////////////////////////////
+
+#include "BuildingProfileFilter.h"
+#include "BuildingAttributeIndex.h"
+#include "cISC4Occupant.h"
+#include "OccupantTypes.h"
+
+BuildingProfileFilter::BuildingProfileFilter(uint32_t purposeMask, uint32_t wealthMask)
+	: purposeMask(purposeMask),
+	  wealthMask(wealthMask)
+{
+}
+
+bool BuildingProfileFilter::IsOccupantIncluded(cISC4Occupant* pOccupant)
+{
+	bool result = false;
+
+	if (pOccupant)
+	{
+		if (pOccupant->GetType() == kOccupantTypeBuilding)
+		{
+			cISC4BuildingOccupant::PurposeType purpose{};
+			cISC4BuildingOccupant::WealthType wealth{};
+			int32_t constructionDate = 0;
+
+			if (BuildingAttributeIndex::GetBuildingAttributes(pOccupant, purpose, wealth, constructionDate))
+			{
+				result = BuildingAttributeIndex::IsProfileIncluded(purpose, wealth, purposeMask, wealthMask);
+			}
+		}
+	}
+
+	return result;
+}
@@ -0,0 +1,27 @@
+////////////////////////////////////////////////////////////////////////
+//
+// This file is part of sc4-data-view-extensions, a DLL Plugin for
+// SimCity 4 that extends the game's data views.
+//
+// Copyright (c) 2024 Nicholas Hayes
+//
+// This file is licensed under terms of the MIT License.
+// See LICENSE.txt for more information.
+//
+////////////////////////////////////////////////////////////////////////
+
+#pragma once
+#include "cSC4BaseOccupantFilter.h"
+
+class BuildingProfileFilter : public cSC4BaseOccupantFilter
+{
+public:
+	// See BuildingAttributeIndex for the mask format.
+	BuildingProfileFilter(uint32_t purposeMask, uint32_t wealthMask);
+
+	bool IsOccupantIncluded(cISC4Occupant* pOccupant) override;
+
+private:
+	uint32_t purposeMask;
+	uint32_t wealthMask;
+};
@@ -0,0 +1,40 @@
+////////////////////////////////////////////////////////////////////////
+//
+// This file is part of sc4-data-view-extensions, a DLL Plugin for
+// SimCity 4 that extends the game's data views.
+//
+// Copyright (c) 2024 Nicholas Hayes
+//
+// This file is licensed under terms of the MIT License.
+// See LICENSE.txt for more information.
+//
+////////////////////////////////////////////////////////////////////////
+
+#include "HighlightProgramFilter.h"
+#include "HighlightModeRegistry.h"
+#include "cISC4Occupant.h"
+
+HighlightProgramFilter::HighlightProgramFilter(const HighlightModeDefinition& definition)
+	: definition(definition)
+{
+}
+
+bool HighlightProgramFilter::IsOccupantIncluded(cISC4Occupant* pOccupant)
+{
+	bool result = false;
+
+	if (pOccupant)
+	{
+		if (static_cast<uint32_t>(pOccupant->GetType()) == definition.occupantType)
+		{
+			result = definition.program.Evaluate(pOccupant);
+		}
+	}
+
+	return result;
+}
+
+bool HighlightProgramFilter::IsOccupantTypeIncluded(uint32_t dwType)
+{
+	return dwType == definition.occupantType;
+}
@@ -0,0 +1,28 @@
+////////////////////////////////////////////////////////////////////////
+//
+// This file is part of sc4-data-view-extensions, a DLL Plugin for
+// SimCity 4 that extends the game's data views.
+//
+// Copyright (c) 2024 Nicholas Hayes
+//
+// This file is licensed under terms of the MIT License.
+// See LICENSE.txt for more information.
+//
+////////////////////////////////////////////////////////////////////////
+
+#pragma once
+#include "cSC4BaseOccupantFilter.h"
+
+struct HighlightModeDefinition;
+
+class HighlightProgramFilter : public cSC4BaseOccupantFilter
+{
+public:
+	HighlightProgramFilter(const HighlightModeDefinition& definition);
+
+	bool IsOccupantIncluded(cISC4Occupant* pOccupant) override;
+	bool IsOccupantTypeIncluded(uint32_t dwType) override;
+
+private:
+	const HighlightModeDefinition& definition;
+};
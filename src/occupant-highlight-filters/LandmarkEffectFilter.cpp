@@ -13,6 +13,7 @@
 #include "LandmarkEffectFilter.h"
 #include "cISCPropertyHolder.h"
 #include "cISC4Occupant.h"
+#include "OccupantTypes.h"
 
 LandmarkEffectFilter::LandmarkEffectFilter()
 {
@@ -20,14 +21,13 @@ LandmarkEffectFilter::LandmarkEffectFilter()
 
 bool LandmarkEffectFilter::IsOccupantIncluded(cISC4Occupant* pOccupant)
 {
-	constexpr uint32_t OccupantGroup_Building = 0x278128A0;
 	constexpr uint32_t LandmarkEffectPropertyId = 0x2781284F;
 
 	bool result = false;
 
 	if (pOccupant)
 	{
-		if (pOccupant->GetType() == OccupantGroup_Building)
+		if (pOccupant->GetType() == kOccupantTypeBuilding)
 		{
 			result = pOccupant->AsPropertyHolder()->HasProperty(LandmarkEffectPropertyId);
 		}
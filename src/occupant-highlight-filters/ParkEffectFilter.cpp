@@ -13,16 +13,16 @@
 #include "ParkEffectFilter.h"
 #include "cISCPropertyHolder.h"
 #include "cISC4Occupant.h"
+#include "OccupantTypes.h"
 
 bool ParkEffectFilter::IsOccupantIncluded(cISC4Occupant* pOccupant)
 {
-	constexpr uint32_t OccupantType_Building = 0x278128A0;
 	constexpr uint32_t ParkEffectPropertyId = 0x27812850;
 	bool result = false;
 
 	if (pOccupant)
 	{
-		if (pOccupant->GetType() == OccupantType_Building)
+		if (pOccupant->GetType() == kOccupantTypeBuilding)
 		{
 			result = pOccupant->AsPropertyHolder()->HasProperty(ParkEffectPropertyId);
 		}
@@ -0,0 +1,201 @@
+////////////////////////////////////////////////////////////////////////
+//
+// This file is part of sc4-data-view-extensions, a DLL Plugin for
+// SimCity 4 that extends the game's data views.
+//
+// Copyright (c) 2024 Nicholas Hayes
+//
+// This file is licensed under terms of the MIT License.
+// See LICENSE.txt for more information.
+//
+////////////////////////////////////////////////////////////////////////
+
+// Compares CellBitmap with cRZCellMap at 256x256 and 1024x1024 cells.
+// cRZCellMap has no bulk operations, so its side of the boolean, count and
+// rectangle benchmarks uses the per-cell loops that the DLL would otherwise need.
+//
+// Usage: CellBitmapBenchmark
+
+#include "CellBitmap.h"
+#include "cRZCellMap.h"
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <random>
+
+namespace
+{
+	// Prevents the compiler from removing the benchmarked work.
+	uint64_t checksum = 0;
+
+	template<typename Func>
+	double MeasureMicroseconds(uint32_t iterations, Func&& func)
+	{
+		const auto start = std::chrono::steady_clock::now();
+
+		for (uint32_t i = 0; i < iterations; i++)
+		{
+			func();
+		}
+
+		const auto end = std::chrono::steady_clock::now();
+
+		return std::chrono::duration<double, std::micro>(end - start).count() / iterations;
+	}
+
+	void PrintResult(const char* name, double cellMapTime, double bitmapTime)
+	{
+		std::printf(
+			"  %-12s cRZCellMap %10.2f us   CellBitmap %9.2f us   %7.1fx\n",
+			name,
+			cellMapTime,
+			bitmapTime,
+			bitmapTime > 0.0 ? cellMapTime / bitmapTime : 0.0);
+	}
+
+	void FillRandom(cRZCellMap& cellMap, CellBitmap& bitmap, uint32_t size, uint32_t seed)
+	{
+		std::mt19937 random(seed);
+
+		for (uint32_t row = 0; row < size; row++)
+		{
+			for (uint32_t column = 0; column < size; column++)
+			{
+				const bool value = (random() & 3) == 0;
+
+				cellMap.SetValue(row, column, value);
+				bitmap.SetValue(row, column, value);
+			}
+		}
+	}
+
+	void RunBenchmarks(uint32_t size, uint32_t iterations)
+	{
+		std::printf("%ux%u cells, %u iterations\n", size, size, iterations);
+
+		cRZCellMap cellMapA(size, size, false);
+		cRZCellMap cellMapB(size, size, false);
+		CellBitmap bitmapA(size, size, false);
+		CellBitmap bitmapB(size, size, false);
+
+		FillRandom(cellMapA, bitmapA, size, 1);
+		FillRandom(cellMapB, bitmapB, size, 2);
+
+		PrintResult(
+			"copy",
+			MeasureMicroseconds(iterations, [&]()
+			{
+				cRZCellMap copy(cellMapA);
+				checksum += copy.GetValue(size - 1, size - 1);
+			}),
+			MeasureMicroseconds(iterations, [&]()
+			{
+				CellBitmap copy(bitmapA);
+				checksum += copy.GetValue(size - 1, size - 1);
+			}));
+
+		PrintResult(
+			"and",
+			MeasureMicroseconds(iterations, [&]()
+			{
+				cRZCellMap result(cellMapA);
+
+				for (uint32_t row = 0; row < size; row++)
+				{
+					for (uint32_t column = 0; column < size; column++)
+					{
+						result.SetValue(row, column, result.GetValue(row, column) && cellMapB.GetValue(row, column));
+					}
+				}
+
+				checksum += result.GetValue(0, 0);
+			}),
+			MeasureMicroseconds(iterations, [&]()
+			{
+				CellBitmap result(bitmapA);
+				result.And(bitmapB);
+				checksum += result.GetValue(0, 0);
+			}));
+
+		PrintResult(
+			"count",
+			MeasureMicroseconds(iterations, [&]()
+			{
+				uint32_t count = 0;
+
+				for (uint32_t row = 0; row < size; row++)
+				{
+					for (uint32_t column = 0; column < size; column++)
+					{
+						count += cellMapA.GetValue(row, column);
+					}
+				}
+
+				checksum += count;
+			}),
+			MeasureMicroseconds(iterations, [&]()
+			{
+				checksum += bitmapA.CountSetCells();
+			}));
+
+		const uint32_t rectFirst = size / 8;
+		const uint32_t rectLast = size - (size / 8) - 1;
+
+		PrintResult(
+			"set rect",
+			MeasureMicroseconds(iterations, [&]()
+			{
+				for (uint32_t row = rectFirst; row <= rectLast; row++)
+				{
+					for (uint32_t column = rectFirst; column <= rectLast; column++)
+					{
+						cellMapB.SetValue(row, column, true);
+					}
+				}
+
+				checksum += cellMapB.GetValue(rectFirst, rectFirst);
+			}),
+			MeasureMicroseconds(iterations, [&]()
+			{
+				bitmapB.SetRect(rectFirst, rectFirst, rectLast, rectLast, true);
+				checksum += bitmapB.GetValue(rectFirst, rectFirst);
+			}));
+
+		PrintResult(
+			"set cells",
+			MeasureMicroseconds(iterations, [&]()
+			{
+				for (uint32_t row = 0; row < size; row++)
+				{
+					for (uint32_t column = row & 1; column < size; column += 2)
+					{
+						cellMapA.SetValue(row, column, true);
+					}
+				}
+
+				checksum += cellMapA.GetValue(1, 1);
+			}),
+			MeasureMicroseconds(iterations, [&]()
+			{
+				for (uint32_t row = 0; row < size; row++)
+				{
+					for (uint32_t column = row & 1; column < size; column += 2)
+					{
+						bitmapA.SetValue(row, column, true);
+					}
+				}
+
+				checksum += bitmapA.GetValue(1, 1);
+			}));
+	}
+}
+
+int main()
+{
+	RunBenchmarks(256, 200);
+	RunBenchmarks(1024, 20);
+
+	std::printf("checksum %llu\n", static_cast<unsigned long long>(checksum));
+
+	return 0;
+}
@@ -0,0 +1,42 @@
+////////////////////////////////////////////////////////////////////////
+//
+// This file is part of sc4-data-view-extensions, a DLL Plugin for
+// SimCity 4 that extends the game's data views.
+//
+// Copyright (c) 2024 Nicholas Hayes
+//
+// This file is licensed under terms of the MIT License.
+// See LICENSE.txt for more information.
+//
+////////////////////////////////////////////////////////////////////////
+
+// The gzcom-dll header asserts the size of the game's 32-bit class layout,
+// this copy of its declaration omits that check so the gzcom-dll
+// implementation can be built for a 64-bit benchmark.
+
+#pragma once
+#include <cstdint>
+
+class cRZCellMap
+{
+public:
+	cRZCellMap(uint32_t rows, uint32_t columns, bool initialValue);
+	cRZCellMap(cRZCellMap const& other);
+	cRZCellMap(cRZCellMap&& other) noexcept;
+
+	cRZCellMap& operator=(cRZCellMap const& other);
+	cRZCellMap& operator=(cRZCellMap&& other) noexcept;
+
+	virtual ~cRZCellMap();
+
+	bool GetValue(uint32_t column, uint32_t row) const;
+	void SetValue(uint32_t column, uint32_t row, bool value);
+
+private:
+	void DestroyData();
+
+	uint32_t rows;
+	uint32_t columns;
+	uint32_t columnIntegerCount;
+	uint32_t** data;
+};
@@ -0,0 +1,184 @@
+////////////////////////////////////////////////////////////////////////
+//
+// This file is part of sc4-data-view-extensions, a DLL Plugin for
+// SimCity 4 that extends the game's data views.
+//
+// Copyright (c) 2024 Nicholas Hayes
+//
+// This file is licensed under terms of the MIT License.
+// See LICENSE.txt for more information.
+//
+////////////////////////////////////////////////////////////////////////
+
+// Measures the contour extraction of a 256x256 aura-like grid at 8 thresholds.
+// The full pass builds every tile, the cached pass has no changed tiles and
+// the incremental pass changes the values in one tile between the updates.
+//
+// Usage: IsolineExtractorBenchmark
+
+#include "IsolineExtractor.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <thread>
+
+ThreadPool* spThreadPool = nullptr;
+
+namespace
+{
+	constexpr uint32_t kGridSize = 256;
+	constexpr std::array<int32_t, 8> kThresholds = { -96, -64, -32, 0, 32, 64, 96, 128 };
+
+	// Prevents the compiler from removing the benchmarked work.
+	size_t checksum = 0;
+
+	template<typename Func>
+	double MeasureMicroseconds(uint32_t iterations, Func&& func)
+	{
+		const auto start = std::chrono::steady_clock::now();
+
+		for (uint32_t i = 0; i < iterations; i++)
+		{
+			func(i);
+		}
+
+		const auto end = std::chrono::steady_clock::now();
+
+		return std::chrono::duration<double, std::micro>(end - start).count() / iterations;
+	}
+
+	// A sum of random peaks and pits, similar to the game's aura grid.
+	GridSnapshot CreateSnapshot()
+	{
+		GridSnapshot snapshot{};
+		snapshot.version = 1;
+		snapshot.width = kGridSize;
+		snapshot.height = kGridSize;
+		snapshot.tractSize = 1;
+		snapshot.values.resize(static_cast<size_t>(kGridSize) * kGridSize);
+		snapshot.changedRows.assign(kGridSize, 1);
+
+		struct Peak
+		{
+			float x;
+			float z;
+			float radius;
+			float strength;
+		};
+
+		std::mt19937 random(1);
+		std::uniform_real_distribution<float> position(0.0f, static_cast<float>(kGridSize));
+		std::uniform_real_distribution<float> radius(4.0f, 24.0f);
+		std::uniform_real_distribution<float> strength(-160.0f, 200.0f);
+
+		std::vector<Peak> peaks(96);
+
+		for (Peak& peak : peaks)
+		{
+			peak = { position(random), position(random), radius(random), strength(random) };
+		}
+
+		for (uint32_t z = 0; z < kGridSize; z++)
+		{
+			for (uint32_t x = 0; x < kGridSize; x++)
+			{
+				float value = 0.0f;
+
+				for (const Peak& peak : peaks)
+				{
+					const float dx = static_cast<float>(x) - peak.x;
+					const float dz = static_cast<float>(z) - peak.z;
+
+					value += peak.strength * std::exp(-((dx * dx) + (dz * dz)) / (2.0f * peak.radius * peak.radius));
+				}
+
+				snapshot.values[static_cast<size_t>(z) * kGridSize + x] = static_cast<int16_t>(std::clamp(value, -255.0f, 255.0f));
+			}
+		}
+
+		return snapshot;
+	}
+
+	void GetAllIsolines(IsolineExtractor& extractor)
+	{
+		for (int32_t threshold : kThresholds)
+		{
+			checksum += extractor.GetIsolines(threshold).points.size();
+		}
+	}
+
+	void RunBenchmarks(uint32_t workerCount, const GridSnapshot& snapshot)
+	{
+		ThreadPool threadPool;
+		threadPool.Start(workerCount);
+		spThreadPool = &threadPool;
+
+		IsolineExtractor extractor;
+
+		const double fullTime = MeasureMicroseconds(20, [&](uint32_t)
+		{
+			extractor.Clear();
+			extractor.Update(snapshot);
+			GetAllIsolines(extractor);
+		});
+
+		const double cachedTime = MeasureMicroseconds(200, [&](uint32_t)
+		{
+			extractor.Update(snapshot);
+			GetAllIsolines(extractor);
+		});
+
+		GridSnapshot changed = snapshot;
+
+		const double incrementalTime = MeasureMicroseconds(200, [&](uint32_t iteration)
+		{
+			// Raise or lower the values in one tile near the middle of the grid.
+			const int16_t delta = (iteration & 1) ? -40 : 40;
+
+			for (uint32_t z = 96; z < 128; z++)
+			{
+				for (uint32_t x = 96; x < 128; x++)
+				{
+					changed.values[static_cast<size_t>(z) * kGridSize + x] += delta;
+				}
+			}
+
+			extractor.Update(changed);
+			GetAllIsolines(extractor);
+		});
+
+		std::printf(
+			"  %2u workers   full %9.1f us   cached %8.1f us   one tile changed %8.1f us\n",
+			workerCount,
+			fullTime,
+			cachedTime,
+			incrementalTime);
+
+		spThreadPool = nullptr;
+		threadPool.Stop();
+	}
+}
+
+int main()
+{
+	const GridSnapshot snapshot = CreateSnapshot();
+
+	std::printf("%ux%u grid, %zu thresholds\n", kGridSize, kGridSize, kThresholds.size());
+
+	RunBenchmarks(0, snapshot);
+
+	const uint32_t spareProcessors = ThreadPool::GetSpareProcessorCount(std::thread::hardware_concurrency());
+
+	if (spareProcessors > 0)
+	{
+		RunBenchmarks(spareProcessors, snapshot);
+	}
+
+	std::printf("checksum %zu\n", checksum);
+
+	return 0;
+}
@@ -0,0 +1,110 @@
+////////////////////////////////////////////////////////////////////////
+//
+// This file is part of sc4-data-view-extensions, a DLL Plugin for
+// SimCity 4 that extends the game's data views.
+//
+// Copyright (c) 2024 Nicholas Hayes
+//
+// This file is licensed under terms of the MIT License.
+// See LICENSE.txt for more information.
+//
+////////////////////////////////////////////////////////////////////////
+
+
+// A POSIX implementation of the MemoryMappedFile class that is used
+// to run the DBPF reader tests on Linux.
+
+#include "MemoryMappedFile.h"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+struct MemoryMappedFile::Handles
+{
+	int file = -1;
+	void* view = nullptr;
+	size_t viewSize = 0;
+
+	~Handles()
+	{
+		if (view)
+		{
+			munmap(view, viewSize);
+		}
+
+		if (file >= 0)
+		{
+			close(file);
+		}
+	}
+};
+
+MemoryMappedFile::MemoryMappedFile()
+	: handles(),
+	  data(nullptr),
+	  size(0)
+{
+}
+
+MemoryMappedFile::~MemoryMappedFile()
+{
+}
+
+bool MemoryMappedFile::Open(const std::filesystem::path& path)
+{
+	Close();
+
+	auto newHandles = std::make_unique<Handles>();
+	newHandles->file = open(path.c_str(), O_RDONLY);
+
+	if (newHandles->file < 0)
+	{
+		return false;
+	}
+
+	struct stat status {};
+
+	// An empty file can not be mapped.
+	if (fstat(newHandles->file, &status) != 0 || status.st_size <= 0)
+	{
+		return false;
+	}
+
+	newHandles->viewSize = static_cast<size_t>(status.st_size);
+	newHandles->view = mmap(nullptr, newHandles->viewSize, PROT_READ, MAP_PRIVATE, newHandles->file, 0);
+
+	if (newHandles->view == MAP_FAILED)
+	{
+		newHandles->view = nullptr;
+		return false;
+	}
+
+	data = static_cast<const uint8_t*>(newHandles->view);
+	size = newHandles->viewSize;
+	handles = std::move(newHandles);
+
+	return true;
+}
+
+void MemoryMappedFile::Close()
+{
+	handles.reset();
+	data = nullptr;
+	size = 0;
+}
+
+bool MemoryMappedFile::IsOpen() const
+{
+	return data != nullptr;
+}
+
+const uint8_t* MemoryMappedFile::GetData() const
+{
+	return data;
+}
+
+size_t MemoryMappedFile::GetSize() const
+{
+	return size;
+}
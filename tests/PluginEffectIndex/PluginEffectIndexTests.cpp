@@ -0,0 +1,135 @@
+////////////////////////////////////////////////////////////////////////
+//
+// This file is part of sc4-data-view-extensions, a DLL Plugin for
+// SimCity 4 that extends the game's data views.
+//
+// Copyright (c) 2024 Nicholas Hayes
+//
+// This file is licensed under terms of the MIT License.
+// See LICENSE.txt for more information.
+//
+////////////////////////////////////////////////////////////////////////
+
+// Builds the plugin effect index from the DBPF files in the fixtures directory
+// and checks the resolved building effects.
+//
+// Usage: PluginEffectIndexTests <plugin directory>
+
+#include "PluginEffectIndex.h"
+#include "ThreadPool.h"
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <thread>
+
+ThreadPool* spThreadPool = nullptr;
+
+namespace
+{
+	int failureCount = 0;
+
+#define CHECK(expression) \
+	do \
+	{ \
+		if (!(expression)) \
+		{ \
+			std::printf("%s(%d): CHECK failed: %s\n", __FILE__, __LINE__, #expression); \
+			failureCount++; \
+		} \
+	} while (false)
+
+	constexpr uint32_t kParkBuilding = 0x1001;
+	constexpr uint32_t kOverriddenBuilding = 0x1002;
+	constexpr uint32_t kNonBuildingExemplar = 0x1003;
+
+	bool WaitForIndex(const PluginEffectIndex& index)
+	{
+		const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(30);
+
+		while (!index.IsReady())
+		{
+			if (std::chrono::steady_clock::now() > deadline)
+			{
+				return false;
+			}
+
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+
+		return true;
+	}
+
+	void CheckBuildingEffects(const PluginEffectIndex& index)
+	{
+		const std::shared_ptr<const PluginEffectIndex::BuildingEffectMap> buildings = index.GetBuildings();
+
+		CHECK(buildings != nullptr);
+		CHECK(buildings && buildings->size() == 2);
+
+		OccupantEffect effect{};
+
+		// The building inherits its exemplar type and park effect from the cohort.
+		CHECK(index.GetEffect(kParkBuilding, kParkEffectProperty, effect));
+		CHECK(effect.strength == 30.5f && effect.radius == 128.0f);
+		CHECK(!index.GetEffect(kParkBuilding, kLandmarkEffectProperty, effect));
+
+		// The exemplar in the later file replaces the earlier one.
+		CHECK(index.GetEffect(kOverriddenBuilding, kLandmarkEffectProperty, effect));
+		CHECK(effect.strength == 99.0f && effect.radius == 48.0f);
+		CHECK(index.GetEffect(kOverriddenBuilding, kParkEffectProperty, effect));
+		CHECK(effect.strength == 5.0f && effect.radius == 16.0f);
+
+		CHECK(!index.GetEffect(kNonBuildingExemplar, kLandmarkEffectProperty, effect));
+	}
+
+	void RunBuildTest(const std::filesystem::path& pluginDirectory, const std::filesystem::path& cachePath, uint32_t workerCount)
+	{
+		ThreadPool pool;
+		pool.Start(workerCount);
+		spThreadPool = &pool;
+
+		PluginEffectIndex index;
+		index.StartBuild({ { pluginDirectory, true } }, cachePath);
+
+		CHECK(WaitForIndex(index));
+		CheckBuildingEffects(index);
+
+		index.Cancel();
+		pool.Stop();
+		spThreadPool = nullptr;
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	if (argc < 2)
+	{
+		std::printf("Usage: %s <plugin directory>\n", argv[0]);
+		return 2;
+	}
+
+	const std::filesystem::path pluginDirectory = argv[1];
+	const std::filesystem::path cachePath = std::filesystem::temp_directory_path() / "PluginEffectIndexTests.cache";
+
+	std::error_code ec;
+	std::filesystem::remove(cachePath, ec);
+
+	// The first build scans the files and writes the cache, the second build reads
+	// the cache. The build must not depend on the pool having workers.
+	RunBuildTest(pluginDirectory, cachePath, 3);
+	CHECK(std::filesystem::exists(cachePath));
+	RunBuildTest(pluginDirectory, cachePath, 0);
+
+	// A corrupt cache is ignored and the files are scanned again.
+	std::filesystem::resize_file(cachePath, 10, ec);
+	RunBuildTest(pluginDirectory, cachePath, 1);
+
+	std::filesystem::remove(cachePath, ec);
+
+	if (failureCount == 0)
+	{
+		std::printf("All tests passed.\n");
+	}
+
+	return failureCount == 0 ? 0 : 1;
+}
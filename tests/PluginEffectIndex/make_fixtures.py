@@ -0,0 +1,168 @@
+#!/usr/bin/env python3
+# This file is part of sc4-data-view-extensions, a DLL Plugin for
+# SimCity 4 that extends the game's data views.
+#
+# Copyright (c) 2024 Nicholas Hayes
+#
+# This file is licensed under terms of the MIT License.
+# See LICENSE.txt for more information.
+
+# Writes the DBPF plugin files that are used by the PluginEffectIndex tests.
+# The files are checked in, this script documents their contents and can be
+# used to recreate them.
+#
+# Usage: make_fixtures.py [output directory]
+
+import os
+import struct
+import sys
+
+EXEMPLAR_TYPE = 0x6534284A
+COHORT_TYPE = 0x05342861
+DIRECTORY_TYPE = 0xE86B1EEF
+
+EXEMPLAR_TYPE_PROPERTY = 0x00000010
+EXEMPLAR_NAME_PROPERTY = 0x00000020
+PARK_EFFECT_PROPERTY = 0x27812850
+LANDMARK_EFFECT_PROPERTY = 0x2781284F
+
+VALUE_FORMATS = {0x300: 'I', 0x700: 'i', 0x900: 'f', 0xC00: 'B'}
+
+
+def qfs_compress(raw):
+    """Compresses the data using the QFS/RefPack format with a simple greedy match search."""
+    output = bytearray()
+    literals = bytearray()
+    position = 0
+    size = len(raw)
+
+    def flush_literals():
+        nonlocal literals
+        while len(literals) >= 4:
+            count = min(112, len(literals) // 4 * 4)
+            output.append(0xE0 + (count - 4) // 4)
+            output.extend(literals[:count])
+            literals = literals[count:]
+
+    while position < size:
+        best_length = 0
+        best_offset = 0
+
+        for offset in range(1, min(position, 1024) + 1):
+            length = 0
+            while length < 10 and position + length < size and raw[position + length - offset] == raw[position + length]:
+                length += 1
+            if length > best_length:
+                best_length = length
+                best_offset = offset
+
+        if best_length >= 3:
+            flush_literals()
+            # The 2-byte copy command carries up to 3 literal bytes.
+            literal_count = len(literals)
+            offset = best_offset - 1
+            output.append(((offset >> 3) & 0x60) | ((best_length - 3) << 2) | literal_count)
+            output.append(offset & 0xFF)
+            output.extend(literals)
+            literals = bytearray()
+            position += best_length
+        else:
+            literals.append(raw[position])
+            position += 1
+
+    flush_literals()
+    output.append(0xFC + len(literals))
+    output.extend(literals)
+
+    body = bytes([0x10, 0xFB]) + struct.pack('>I', size)[1:] + bytes(output)
+    return struct.pack('<I', len(body) + 4) + body
+
+
+def exemplar(is_cohort, parent, properties):
+    """Builds a binary exemplar or cohort with the (id, value type, values) properties."""
+    data = bytearray(b'CQZB1###' if is_cohort else b'EQZB1###')
+    data += struct.pack('<III', COHORT_TYPE, *parent)
+    data += struct.pack('<I', len(properties))
+
+    for property_id, value_type, values in properties:
+        value_format = VALUE_FORMATS[value_type]
+
+        if len(values) == 1 and value_type != 0xC00:
+            data += struct.pack('<IHHB', property_id, value_type, 0, 0)
+            data += struct.pack('<' + value_format, values[0])
+        else:
+            data += struct.pack('<IHHBI', property_id, value_type, 0x80, 0, len(values))
+            data += struct.pack('<%d%s' % (len(values), value_format), *values)
+
+    return bytes(data)
+
+
+def write_dbpf(path, entries):
+    """Writes a DBPF 1.0 file with index version 7.0 from (type, group, instance, data, compress) entries."""
+    data = bytearray(96)
+    index = []
+    directory = []
+
+    for entry_type, group, instance, raw, compress in entries:
+        payload = qfs_compress(raw) if compress else raw
+
+        if compress:
+            directory.append((entry_type, group, instance, len(raw)))
+
+        index.append((entry_type, group, instance, len(data), len(payload)))
+        data += payload
+
+    if directory:
+        directory_data = b''.join(struct.pack('<IIII', *item) for item in directory)
+        index.append((DIRECTORY_TYPE, DIRECTORY_TYPE, 0x286B1F03, len(data), len(directory_data)))
+        data += directory_data
+
+    index_offset = len(data)
+
+    for item in index:
+        data += struct.pack('<IIIII', *item)
+
+    struct.pack_into('<4sII', data, 0, b'DBPF', 1, 0)
+    struct.pack_into('<IIII', data, 32, 7, len(index), index_offset, len(index) * 20)
+
+    with open(path, 'wb') as file:
+        file.write(data)
+
+
+def main():
+    output_directory = sys.argv[1] if len(sys.argv) > 1 else os.path.join(os.path.dirname(__file__), 'fixtures')
+    plugins = os.path.join(output_directory, 'plugins')
+    os.makedirs(os.path.join(plugins, 'sub'), exist_ok=True)
+
+    write_dbpf(os.path.join(plugins, 'a.dat'), [
+        # A cohort with a park effect, building 0x1001 inherits its type and effect.
+        (COHORT_TYPE, 0x100, 0x200, exemplar(True, (0, 0), [
+            (EXEMPLAR_TYPE_PROPERTY, 0x300, [2]),
+            (PARK_EFFECT_PROPERTY, 0x900, [30.5, 128.0])]), True),
+        (EXEMPLAR_TYPE, 0x100, 0x1001, exemplar(False, (0x100, 0x200), [
+            (EXEMPLAR_NAME_PROPERTY, 0xC00, list(b'Some park name here, some park name here'))]), True),
+        # A building with a negative landmark effect, replaced by sub/b.dat.
+        (EXEMPLAR_TYPE, 0x100, 0x1002, exemplar(False, (0, 0), [
+            (EXEMPLAR_TYPE_PROPERTY, 0x300, [2]),
+            (LANDMARK_EFFECT_PROPERTY, 0x700, [-20, 64])]), False),
+        # A landmark effect on an exemplar that is not a building.
+        (EXEMPLAR_TYPE, 0x100, 0x1003, exemplar(False, (0, 0), [
+            (EXEMPLAR_TYPE_PROPERTY, 0x300, [4]),
+            (LANDMARK_EFFECT_PROPERTY, 0x700, [50, 64])]), False),
+        (0x12345678, 1, 2, b'junk' * 50, True),
+    ])
+
+    write_dbpf(os.path.join(plugins, 'sub', 'b.dat'), [
+        (EXEMPLAR_TYPE, 0x100, 0x1002, exemplar(False, (0, 0), [
+            (EXEMPLAR_TYPE_PROPERTY, 0x300, [2]),
+            (LANDMARK_EFFECT_PROPERTY, 0x900, [99.0, 48.0]),
+            (PARK_EFFECT_PROPERTY, 0x300, [5, 16])]), True),
+    ])
+
+    # A file that is not a DBPF file is skipped.
+    with open(os.path.join(plugins, 'readme.txt'), 'w') as file:
+        file.write('not dbpf')
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,195 @@
+////////////////////////////////////////////////////////////////////////
+//
+// This file is part of sc4-data-view-extensions, a DLL Plugin for
+// SimCity 4 that extends the game's data views.
+//
+// Copyright (c) 2024 Nicholas Hayes
+//
+// This file is licensed under terms of the MIT License.
+// See LICENSE.txt for more information.
+//
+////////////////////////////////////////////////////////////////////////
+
+// Measures how the thread pool scales with its worker count on two tile-parallel
+// workloads over a 1024x1024 grid: a min/max/sum reduction of each 32x32 tile,
+// and the IsolineExtractor contours at 8 thresholds.
+// The speedup is relative to the run with no workers, where ParallelFor runs
+// every item on the calling thread.
+//
+// Usage: ThreadPoolBenchmark
+
+#include "IsolineExtractor.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <random>
+#include <thread>
+
+ThreadPool* spThreadPool = nullptr;
+
+namespace
+{
+	constexpr uint32_t kGridSize = 1024;
+	constexpr uint32_t kTileSize = 32;
+	constexpr uint32_t kTileCount = (kGridSize / kTileSize) * (kGridSize / kTileSize);
+	constexpr std::array<uint32_t, 5> kWorkerCounts = { 0, 1, 2, 4, 8 };
+	constexpr std::array<int32_t, 8> kThresholds = { -96, -64, -32, 0, 32, 64, 96, 128 };
+
+	// Prevents the compiler from removing the benchmarked work.
+	int64_t checksum = 0;
+
+	struct TileStats
+	{
+		int32_t min;
+		int32_t max;
+		int64_t sum;
+	};
+
+	template<typename Func>
+	double MeasureMilliseconds(uint32_t iterations, Func&& func)
+	{
+		const auto start = std::chrono::steady_clock::now();
+
+		for (uint32_t i = 0; i < iterations; i++)
+		{
+			func();
+		}
+
+		const auto end = std::chrono::steady_clock::now();
+
+		return std::chrono::duration<double, std::milli>(end - start).count() / iterations;
+	}
+
+	GridSnapshot CreateSnapshot()
+	{
+		GridSnapshot snapshot{};
+		snapshot.version = 1;
+		snapshot.width = kGridSize;
+		snapshot.height = kGridSize;
+		snapshot.tractSize = 1;
+		snapshot.values.resize(static_cast<size_t>(kGridSize) * kGridSize);
+		snapshot.changedRows.assign(kGridSize, 1);
+
+		// Smoothed noise, so that the contours have a realistic length.
+		std::mt19937 random(1);
+		std::uniform_int_distribution<int32_t> noise(-255, 255);
+
+		constexpr uint32_t kCoarseSize = kGridSize / 16;
+		std::vector<int32_t> coarse(static_cast<size_t>(kCoarseSize + 1) * (kCoarseSize + 1));
+
+		for (int32_t& value : coarse)
+		{
+			value = noise(random);
+		}
+
+		for (uint32_t z = 0; z < kGridSize; z++)
+		{
+			for (uint32_t x = 0; x < kGridSize; x++)
+			{
+				const uint32_t cx = x / 16;
+				const uint32_t cz = z / 16;
+				const int32_t fx = static_cast<int32_t>(x % 16);
+				const int32_t fz = static_cast<int32_t>(z % 16);
+
+				const int32_t top = coarse[cz * (kCoarseSize + 1) + cx] * (16 - fx) + coarse[cz * (kCoarseSize + 1) + cx + 1] * fx;
+				const int32_t bottom = coarse[(cz + 1) * (kCoarseSize + 1) + cx] * (16 - fx) + coarse[(cz + 1) * (kCoarseSize + 1) + cx + 1] * fx;
+
+				snapshot.values[static_cast<size_t>(z) * kGridSize + x] = static_cast<int16_t>(((top * (16 - fz)) + (bottom * fz)) / 256);
+			}
+		}
+
+		return snapshot;
+	}
+
+	void ReduceTiles(const GridSnapshot& snapshot, std::vector<TileStats>& output)
+	{
+		constexpr uint32_t tileCountX = kGridSize / kTileSize;
+
+		spThreadPool->ParallelFor(
+			kTileCount,
+			[&](uint32_t tileIndex)
+			{
+				const uint32_t left = (tileIndex % tileCountX) * kTileSize;
+				const uint32_t top = (tileIndex / tileCountX) * kTileSize;
+
+				TileStats stats{ INT32_MAX, INT32_MIN, 0 };
+
+				for (uint32_t z = top; z < top + kTileSize; z++)
+				{
+					const int16_t* row = snapshot.GetRow(z) + left;
+
+					for (uint32_t x = 0; x < kTileSize; x++)
+					{
+						stats.min = std::min<int32_t>(stats.min, row[x]);
+						stats.max = std::max<int32_t>(stats.max, row[x]);
+						stats.sum += row[x];
+					}
+				}
+
+				output[tileIndex] = stats;
+			});
+
+		checksum += output[kTileCount / 2].sum;
+	}
+
+	void ExtractIsolines(const GridSnapshot& snapshot)
+	{
+		IsolineExtractor extractor;
+		extractor.Update(snapshot);
+
+		for (int32_t threshold : kThresholds)
+		{
+			checksum += static_cast<int64_t>(extractor.GetIsolines(threshold).points.size());
+		}
+	}
+}
+
+int main()
+{
+	const GridSnapshot snapshot = CreateSnapshot();
+	std::vector<TileStats> tileStats(kTileCount);
+
+	std::printf(
+		"%ux%u grid, %u tiles, %u hardware threads\n",
+		kGridSize,
+		kGridSize,
+		kTileCount,
+		std::thread::hardware_concurrency());
+
+	double baseReduceTime = 0.0;
+	double baseIsolineTime = 0.0;
+
+	for (uint32_t workerCount : kWorkerCounts)
+	{
+		ThreadPool threadPool;
+		threadPool.Start(workerCount);
+		spThreadPool = &threadPool;
+
+		const double reduceTime = MeasureMilliseconds(50, [&]() { ReduceTiles(snapshot, tileStats); });
+		const double isolineTime = MeasureMilliseconds(5, [&]() { ExtractIsolines(snapshot); });
+
+		if (workerCount == 0)
+		{
+			baseReduceTime = reduceTime;
+			baseIsolineTime = isolineTime;
+		}
+
+		std::printf(
+			"  %u workers   tile reduce %8.3f ms (%4.2fx)   isolines %8.2f ms (%4.2fx)\n",
+			workerCount,
+			reduceTime,
+			baseReduceTime / reduceTime,
+			isolineTime,
+			baseIsolineTime / isolineTime);
+
+		spThreadPool = nullptr;
+		threadPool.Stop();
+	}
+
+	std::printf("checksum %lld\n", static_cast<long long>(checksum));
+
+	return 0;
+}